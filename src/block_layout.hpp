@@ -0,0 +1,225 @@
+/**
+ * @file block_layout.hpp
+ * @brief 按剖析结果重排基本块，使热路径顺序执行
+ */
+
+#ifndef _BLOCK_LAYOUT_HPP_
+#define _BLOCK_LAYOUT_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./profile_data.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 基本块布局
+ *        块的热度取块中各四元式所在源程序行在剖析数据中的执行次数的最大值，没有记录的块热度未知。
+ *        在每个函数内从入口块开始贪心地排成链：下一个块取当前块尚未放置的后继中最热的一个，
+ *        热度未知或相同时保持原来的顺序执行的后继；没有可放的后继时取原顺序中第一个未放置的块，
+ *        剖析中未执行的块放在函数末尾。执行到函数末尾而返回的块固定为函数的最后一块。
+ *        重排后修正控制流：顺序执行的后继不再紧随其后时，若条件跳转的目标紧随其后且条件可以取反则把条件取反，否则补一条跳转；
+ *        跳到紧随其后的块的无条件跳转删除。最后重新编号标号
+ */
+class BlockLayout {
+public:
+    static constexpr int Npos = -1;
+
+    BlockLayout(Semantic& semantic, const ProfileData& profile)
+        : semantic_(semantic), profile_(profile), moved_(0), inverted_(0), inserted_(0), removed_(0) {}
+
+    /**
+     * @brief  : 重排所有函数的基本块
+     * @return : 改变了位置的基本块个数
+     */
+    int
+    Run() {
+        auto&            quadruples = semantic_.quadruples();
+        ControlFlowGraph cfg(quadruples);
+        next_label_ = 0;
+        for (const auto& qua : quadruples) {
+            next_label_ = qua.label > next_label_ ? qua.label : next_label_;
+        }
+        next_label_ += 2; /* 原最大标号 + 1 表示末尾之后，不能使用 */
+
+        std::vector<Quadruple> output;
+        output.reserve(quadruples.size() + cfg.block_count());
+        const auto& entries = cfg.entries();
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int first = entries[f];
+            int last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+            if (quadruples[cfg.begin(first)].operate != Opcode::FunBegin) {
+                /* 程序开头不属于任何函数的四元式保持原样 */
+                for (int b = first; b < last; ++b) {
+                    Append(output, cfg, b, Npos, Npos);
+                }
+                continue;
+            }
+            std::vector<int> order = Order(cfg, first, last);
+            for (size_t k = 0; k < order.size(); ++k) {
+                int b = order[k];
+                moved_ += b != first + static_cast<int>(k);
+                Append(output, cfg, b, FallThrough(cfg, b, last), k + 1 < order.size() ? order[k + 1] : Npos);
+            }
+        }
+        quadruples.swap(output);
+        semantic_.RenumberLabels();
+        return moved_;
+    }
+
+    /* 改变了位置的基本块个数 */
+    int
+    moved() const {
+        return moved_;
+    }
+
+    /* 取反的条件跳转条数 */
+    int
+    inverted() const {
+        return inverted_;
+    }
+
+    /* 补上的无条件跳转条数 */
+    int
+    inserted() const {
+        return inserted_;
+    }
+
+    /* 删除的跳到下一块的无条件跳转条数 */
+    int
+    removed() const {
+        return removed_;
+    }
+
+private:
+    /* 块的热度：所含四元式所在行的最大执行次数，没有记录时为 Npos */
+    int64_t
+    Weight(const ControlFlowGraph& cfg, int block) const {
+        return profile_.range_count(semantic_.quadruples(), cfg.begin(block), cfg.end(block));
+    }
+
+    /* 块顺序执行的后继：最后一条是无条件跳转或返回、或者是函数的最后一块时为 Npos */
+    int
+    FallThrough(const ControlFlowGraph& cfg, int block, int last) const {
+        Opcode op = semantic_.quadruples()[cfg.end(block) - 1].operate;
+        return op == Opcode::Jump || op == Opcode::Return || block + 1 >= last ? Npos : block + 1;
+    }
+
+    /* 原顺序中第一个未放置的块；skip_cold 时跳过剖析中未执行的块 */
+    int
+    FirstUnplaced(const ControlFlowGraph& cfg, const std::vector<char>& placed, int first, bool skip_cold) const {
+        for (int b = first; b < first + static_cast<int>(placed.size()); ++b) {
+            if (!placed[b - first] && !(skip_cold && Weight(cfg, b) == 0)) {
+                return b;
+            }
+        }
+        return Npos;
+    }
+
+    /* 函数 [first, last) 中基本块的新顺序 */
+    std::vector<int>
+    Order(const ControlFlowGraph& cfg, int first, int last) const {
+        const auto&       quadruples = semantic_.quadruples();
+        std::vector<char> placed(last - first, 0);
+        std::vector<int>  order;
+        order.reserve(last - first);
+
+        /* 执行到函数末尾而返回的块固定在最后 */
+        Opcode end_op = quadruples[cfg.end(last - 1) - 1].operate;
+        int    pinned = last - 1 != first && end_op != Opcode::Jump && end_op != Opcode::Return ? last - 1 : Npos;
+        int    remain = last - first - (pinned != Npos);
+        if (pinned != Npos) {
+            placed[pinned - first] = 1;
+        }
+        int current = first;
+        placed[0]   = 1;
+        order.push_back(first);
+        while (static_cast<int>(order.size()) < remain) {
+            /* 后继的热度都已知时取最热的，相同时取原来顺序执行的后继；有未知的则保持原顺序 */
+            int     next    = Npos;
+            int64_t best    = 0;
+            bool    unknown = false;
+            for (const int* s = cfg.succ_begin(current); s != cfg.succ_end(current); ++s) {
+                if (*s < first || *s >= last || placed[*s - first]) {
+                    continue;
+                }
+                int64_t weight = Weight(cfg, *s);
+                unknown |= weight == Npos;
+                if (next == Npos || weight > best || (weight == best && *s == current + 1)) {
+                    next = *s;
+                    best = weight;
+                }
+            }
+            if (unknown && current + 1 < last && !placed[current + 1 - first]) {
+                next = current + 1;
+                best = Weight(cfg, next);
+            }
+            /* 没有可放的后继，或者后继在剖析中未执行：先放其余执行过的块 */
+            if (next == Npos || best == 0) {
+                int hot = FirstUnplaced(cfg, placed, first, true);
+                next    = hot != Npos ? hot : next != Npos ? next : FirstUnplaced(cfg, placed, first, false);
+            }
+            placed[next - first] = 1;
+            order.push_back(next);
+            current = next;
+        }
+        if (pinned != Npos) {
+            order.push_back(pinned);
+        }
+        return order;
+    }
+
+    /**
+     * @brief : 输出块 block，并按新的下一块 next 修正它的出口
+     * @param fall : 原来顺序执行的后继，没有时为 Npos
+     */
+    void
+    Append(std::vector<Quadruple>& output, const ControlFlowGraph& cfg, int block, int fall, int next) {
+        const auto& quadruples = semantic_.quadruples();
+        int         begin = cfg.begin(block), end = cfg.end(block);
+        for (int i = begin; i < end; ++i) {
+            output.push_back(quadruples[i]);
+        }
+        auto& exit   = output.back();
+        int   target = exit.operate == Opcode::Jump || IsConditionalJump(exit.operate) ? cfg.block_of_label(exit.result.id)
+                                                                                         : Npos;
+        if (exit.operate == Opcode::Jump && target != Npos && target == next) {
+            /* 块只有这条跳转时它的标号可能是跳转目标，改为空操作保留标号 */
+            if (end - begin == 1) {
+                exit.operate = Opcode::Nop;
+                exit.result  = Operand();
+            } else {
+                output.pop_back();
+            }
+            ++removed_;
+            return;
+        }
+        if (fall == Npos || fall == next) {
+            return;
+        }
+        int fall_label = quadruples[cfg.begin(fall)].label;
+        if (CanInvertJump(exit.operate) && target == next) {
+            exit.operate   = InvertJump(exit.operate);
+            exit.result.id = fall_label;
+            ++inverted_;
+            return;
+        }
+        int row = exit.row;
+        output.push_back(Quadruple(next_label_++, Opcode::Jump, Operand(), Operand(), Operand(Operand::Label, fall_label), row));
+        ++inserted_;
+    }
+
+    Semantic&          semantic_;
+    const ProfileData& profile_;
+    int                next_label_; /* 补上的跳转使用的新标号 */
+    int                moved_;      /* 改变了位置的基本块个数 */
+    int                inverted_;   /* 取反的条件跳转条数 */
+    int                inserted_;   /* 补上的无条件跳转条数 */
+    int                removed_;    /* 删除的跳到下一块的无条件跳转条数 */
+};
+
+constexpr int BlockLayout::Npos;
+
+#endif // !_BLOCK_LAYOUT_HPP_
@@ -0,0 +1,574 @@
+/**
+ * @file bytecode.hpp
+ * @brief 寄存器字节码：指令格式、程序表示以及由寄存器分配结果生成字节码
+ */
+
+#ifndef _BYTECODE_HPP_
+#define _BYTECODE_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./quadruple.hpp"
+#include "./register_allocation.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 字节码操作码表，X(名字, 文本)
+ *        R[x] 为当前栈帧的寄存器，K[x] 为常量池，G[x] 为全局区(按变量编号，存放全局变量与返回值变量)
+ *          Move a b       : R[a] = R[b]            LoadK a b : R[a] = K[b]
+ *          GetG a b       : R[a] = G[b]            SetG a b  : G[a] = R[b]            SetGK a b : G[a] = K[b]
+ *          <算术> a b c   : R[a] = R[b] op R[c]    <算术>K a b c : R[a] = R[b] op K[c]
+ *          IToF/FToI a b  : R[a] = conv(R[b])
+ *          Jmp c          : 跳到 c
+ *          <比较> a b c   : R[a] cmp R[b] 时跳到 c   <比较>K a b c : R[a] cmp K[b] 时跳到 c
+ *          Param a        : 压入实参 R[a]          Call a b : 调用函数 b，结果写入 R[a] (a 为 -1 时丢弃)
+ *          Ret a          : 返回 G[a]              RetR a b : G[a] = R[b] 并返回    RetK a b : G[a] = K[b] 并返回
+ *        超级指令 IAddK<比较>[K] 由 IAddK 与紧随其后的整型比较跳转合并而成：执行 IAddK 后直接执行下一条比较跳转；
+ *        下一条指令仍保留在原位，跳到它时单独执行
+ */
+#define BYTECODE_OPCODES(X)                                                                                                  \
+    X(Move, "move") X(LoadK, "loadk") X(GetG, "getg") X(SetG, "setg") X(SetGK, "setgk")                                       \
+    X(IAdd, "iadd") X(ISub, "isub") X(IMul, "imul") X(IDiv, "idiv")                                                           \
+    X(FAdd, "fadd") X(FSub, "fsub") X(FMul, "fmul") X(FDiv, "fdiv")                                                           \
+    X(IAddK, "iaddk") X(ISubK, "isubk") X(IMulK, "imulk") X(IDivK, "idivk")                                                   \
+    X(FAddK, "faddk") X(FSubK, "fsubk") X(FMulK, "fmulk") X(FDivK, "fdivk")                                                   \
+    X(IToF, "itof") X(FToI, "ftoi") X(Jmp, "jmp")                                                                             \
+    X(IJLt, "ijlt") X(IJLe, "ijle") X(IJGt, "ijgt") X(IJGe, "ijge") X(IJEq, "ijeq") X(IJNe, "ijne")                           \
+    X(FJLt, "fjlt") X(FJLe, "fjle") X(FJGt, "fjgt") X(FJGe, "fjge") X(FJEq, "fjeq") X(FJNe, "fjne")                           \
+    X(IJLtK, "ijltk") X(IJLeK, "ijlek") X(IJGtK, "ijgtk") X(IJGeK, "ijgek") X(IJEqK, "ijeqk") X(IJNeK, "ijnek")                \
+    X(FJLtK, "fjltk") X(FJLeK, "fjlek") X(FJGtK, "fjgtk") X(FJGeK, "fjgek") X(FJEqK, "fjeqk") X(FJNeK, "fjnek")                \
+    X(Param, "param") X(Call, "call") X(Ret, "ret") X(RetR, "retr") X(RetK, "retk")                                           \
+    X(IAddKJLt, "iaddk+ijlt") X(IAddKJLe, "iaddk+ijle") X(IAddKJGt, "iaddk+ijgt")                                             \
+    X(IAddKJGe, "iaddk+ijge") X(IAddKJEq, "iaddk+ijeq") X(IAddKJNe, "iaddk+ijne")                                             \
+    X(IAddKJLtK, "iaddk+ijltk") X(IAddKJLeK, "iaddk+ijlek") X(IAddKJGtK, "iaddk+ijgtk")                                       \
+    X(IAddKJGeK, "iaddk+ijgek") X(IAddKJEqK, "iaddk+ijeqk") X(IAddKJNeK, "iaddk+ijnek")
+
+/**
+ * @brief 字节码操作码
+ */
+enum class VmOp : uint8_t {
+#define BYTECODE_ENUM(name, text) name,
+    BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+        Count
+};
+
+/**
+ * @brief  : 字节码操作码的文本形式
+ */
+inline const char*
+VmOpText(VmOp op) {
+    static const char* const texts[] = {
+#define BYTECODE_TEXT(name, text) text,
+        BYTECODE_OPCODES(BYTECODE_TEXT)
+#undef BYTECODE_TEXT
+    };
+    return op < VmOp::Count ? texts[static_cast<int>(op)] : "?";
+}
+
+/**
+ * @brief 定长的字节码指令：操作码与三个 32 位操作数(寄存器、常量、全局区下标或跳转目标)
+ */
+struct Instruction {
+    uint8_t op;
+    uint8_t reserved[3];
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+/**
+ * @brief 字节码中的函数(按全局符号表中的位置编号，不是函数的表项 entry 为 -1)
+ */
+struct BytecodeFunction {
+    int32_t name;        /* 函数名在名字表中的下标 */
+    int32_t entry;       /* 第一条指令的下标 */
+    int32_t frame_size;  /* 栈帧的寄存器个数 */
+    int32_t ret_value;   /* 返回值变量在全局区中的下标 */
+    int32_t param_begin; /* 形参寄存器在 parameters 中的范围 [param_begin, param_begin + param_count) */
+    int32_t param_count;
+};
+
+/**
+ * @brief 执行字节码所需的只读视图，可以指向 BytecodeProgram 或映射到内存的目标文件
+ */
+struct BytecodeView {
+    const Instruction*      code;
+    int32_t                 code_size;
+    const Value*            constants;
+    int32_t                 constant_count;
+    const BytecodeFunction* functions;
+    int32_t                 function_count;
+    const int32_t*          parameters; /* 形参寄存器，未使用的形参为 -1 */
+    int32_t                 globals;    /* 全局区大小 */
+    int32_t                 main;       /* main 函数 */
+    ValueType               main_type;  /* main 的返回类型 */
+};
+
+/**
+ * @brief 字节码程序
+ */
+struct BytecodeProgram {
+    std::vector<Instruction>      code;
+    std::vector<Value>            constants;
+    std::vector<ValueType>        constant_types;
+    std::vector<BytecodeFunction> functions;
+    std::vector<int32_t>          parameters;
+    std::vector<std::string>      names;        /* 驻留的名字：函数名与全局区中变量的名字 */
+    std::vector<int32_t>          global_names; /* 全局区下标 -> 名字下标，没有出现的变量为 -1 */
+    int32_t                       main      = -1;
+    ValueType                     main_type = ValueType::Void;
+
+    BytecodeView
+    View() const {
+        return BytecodeView{ code.data(),       static_cast<int32_t>(code.size()),
+                             constants.data(),  static_cast<int32_t>(constants.size()),
+                             functions.data(),  static_cast<int32_t>(functions.size()),
+                             parameters.data(), static_cast<int32_t>(global_names.size()),
+                             main,              main_type };
+    }
+
+    /**
+     * @brief : 输出反汇编：函数表、常量池与指令
+     */
+    void
+    Print(std::ostream& os) const {
+        os << "constants :";
+        for (size_t k = 0; k < constants.size(); ++k) {
+            os << " K" << k << "=";
+            PrintConstant(os, static_cast<int32_t>(k));
+        }
+        os << std::endl;
+        for (size_t f = 0; f < functions.size(); ++f) {
+            const auto& function = functions[f];
+            if (function.entry < 0) {
+                continue;
+            }
+            os << std::endl << names[function.name] << " : entry " << function.entry << ", frame " << function.frame_size;
+            for (int k = 0; k < function.param_count; ++k) {
+                os << (k ? ", " : ", params ") << "R" << parameters[function.param_begin + k];
+            }
+            os << std::endl;
+            int end = static_cast<int>(code.size());
+            for (const auto& other : functions) {
+                end = other.entry > function.entry && other.entry < end ? other.entry : end;
+            }
+            for (int i = function.entry; i < end; ++i) {
+                PrintInstruction(os, i);
+            }
+        }
+    }
+
+    void
+    PrintInstruction(std::ostream& os, int index) const {
+        const auto& ins = code[index];
+        VmOp        op  = static_cast<VmOp>(ins.op);
+        os << "    " << index << " : " << VmOpText(op);
+        switch (op) {
+            case VmOp::Move:
+            case VmOp::IToF:
+            case VmOp::FToI:
+                os << " R" << ins.a << ", R" << ins.b;
+                break;
+            case VmOp::LoadK:
+                os << " R" << ins.a << ", ";
+                PrintConstant(os, ins.b);
+                break;
+            case VmOp::GetG:
+                os << " R" << ins.a << ", " << GlobalName(ins.b);
+                break;
+            case VmOp::SetG:
+            case VmOp::RetR:
+                os << " " << GlobalName(ins.a) << ", R" << ins.b;
+                break;
+            case VmOp::SetGK:
+            case VmOp::RetK:
+                os << " " << GlobalName(ins.a) << ", ";
+                PrintConstant(os, ins.b);
+                break;
+            case VmOp::Jmp:
+                os << " " << ins.c;
+                break;
+            case VmOp::Param:
+                os << " R" << ins.a;
+                break;
+            case VmOp::Call:
+                os << " " << (ins.a < 0 ? std::string("-") : "R" + std::to_string(ins.a)) << ", "
+                   << names[functions[ins.b].name];
+                break;
+            case VmOp::Ret:
+                os << " " << GlobalName(ins.a);
+                break;
+            default:
+                if (op >= VmOp::IAdd && op <= VmOp::FDiv) {
+                    os << " R" << ins.a << ", R" << ins.b << ", R" << ins.c;
+                } else if (op >= VmOp::IAddK && op <= VmOp::FDivK) {
+                    os << " R" << ins.a << ", R" << ins.b << ", ";
+                    PrintConstant(os, ins.c);
+                } else if (op >= VmOp::IJLt && op <= VmOp::FJNe) {
+                    os << " R" << ins.a << ", R" << ins.b << ", " << ins.c;
+                } else if (op >= VmOp::IJLtK && op <= VmOp::FJNeK) {
+                    os << " R" << ins.a << ", ";
+                    PrintConstant(os, ins.b);
+                    os << ", " << ins.c;
+                } else {
+                    /* 超级指令：IAddK 的操作数，比较跳转在下一条 */
+                    os << " R" << ins.a << ", R" << ins.b << ", ";
+                    PrintConstant(os, ins.c);
+                }
+                break;
+        }
+        os << std::endl;
+    }
+
+private:
+    void
+    PrintConstant(std::ostream& os, int32_t k) const {
+        if (constant_types[k] == ValueType::Float) {
+            os << constants[k].f;
+        } else {
+            os << constants[k].i;
+        }
+    }
+
+    std::string
+    GlobalName(int32_t g) const {
+        return global_names[g] >= 0 ? names[global_names[g]] : "G" + std::to_string(g);
+    }
+};
+
+/**
+ * @brief 由寄存器分配的结果生成字节码
+ *        栈帧的寄存器依次为：整型寄存器、浮点寄存器、溢出槽，以及两个生成字节码用的临时寄存器；
+ *        常量操作数进入常量池，全局变量与返回值变量在全局区。
+ *        算术运算与比较跳转的第二个操作数是常量时使用 K 形式(可交换的运算与比较交换操作数后也使用)，
+ *        其余情况下常量与全局变量先装入临时寄存器，结果为全局变量时写入临时寄存器再存回。
+ *        最后做窥孔合并：给返回值变量赋值后紧接返回合并为 RetR/RetK，IAddK 后紧接整型比较跳转合并为超级指令
+ */
+class BytecodeCompiler {
+public:
+    static constexpr int Npos = -1;
+
+    BytecodeCompiler(const Semantic& semantic, const RegisterAllocation& allocation)
+        : semantic_(semantic), allocation_(allocation), superinstructions_(0) {}
+
+    /**
+     * @brief : 生成字节码程序
+     */
+    void
+    Run() {
+        const auto& code = allocation_.code();
+        int         functions = 0;
+        int         max_label = 0;
+        for (const auto& qua : code) {
+            if (qua.operate == Opcode::FunBegin || qua.operate == Opcode::Call) {
+                functions = qua.arg_1.id + 1 > functions ? qua.arg_1.id + 1 : functions;
+            }
+            max_label = qua.label > max_label ? qua.label : max_label;
+        }
+        program_ = BytecodeProgram();
+        program_.functions.assign(functions, BytecodeFunction{ Npos, Npos, 0, Npos, 0, 0 });
+        program_.global_names.assign(semantic_.variable_count(), Npos);
+        label_index_.assign(max_label + 2, Npos);
+        constant_index_.clear();
+        name_index_.clear();
+
+        for (const auto& frame : allocation_.frames()) {
+            if (frame.function != Npos) {
+                Lower(frame);
+            }
+        }
+        for (auto& fixup : fixups_) {
+            int target                 = fixup.label >= 0 && fixup.label <= max_label ? label_index_[fixup.label] : Npos;
+            program_.code[fixup.index].c = target != Npos && target >= fixup.begin && target < fixup.end ? target
+                                                                                                       : fixup.end - 1;
+        }
+        fixups_.clear();
+        Combine();
+    }
+
+    const BytecodeProgram&
+    program() const {
+        return program_;
+    }
+
+    /* 合并得到的超级指令条数(含 RetR/RetK) */
+    int
+    superinstructions() const {
+        return superinstructions_;
+    }
+
+private:
+    /**
+     * @brief 待填写的跳转目标：指令下标、目标标号与所在函数的指令范围(跳出函数体即跳到末尾的返回)
+     */
+    struct Fixup {
+        int index;
+        int label;
+        int begin;
+        int end;
+    };
+
+    int32_t
+    Name(const std::string& name) {
+        auto it = name_index_.find(name);
+        if (it != name_index_.end()) {
+            return it->second;
+        }
+        program_.names.push_back(name);
+        name_index_.emplace(name, static_cast<int32_t>(program_.names.size() - 1));
+        return static_cast<int32_t>(program_.names.size() - 1);
+    }
+
+    int32_t
+    ConstantIndex(const Operand& opd) {
+        int64_t key = (static_cast<int64_t>(opd.id) << 2) | static_cast<int64_t>(opd.type);
+        auto    it  = constant_index_.find(key);
+        if (it != constant_index_.end()) {
+            return it->second;
+        }
+        program_.constants.push_back(semantic_.ConstantValue(opd));
+        program_.constant_types.push_back(opd.type);
+        constant_index_.emplace(key, static_cast<int32_t>(program_.constants.size() - 1));
+        return static_cast<int32_t>(program_.constants.size() - 1);
+    }
+
+    int32_t
+    GlobalIndex(const Operand& opd) {
+        if (program_.global_names[opd.id] == Npos) {
+            std::ostringstream name;
+            semantic_.PrintOperand(name, opd);
+            program_.global_names[opd.id] = Name(name.str());
+        }
+        return opd.id;
+    }
+
+    /* 栈帧中的寄存器下标，不在栈帧中的操作数为 Npos */
+    int32_t
+    FrameRegister(const Operand& opd) const {
+        if (opd.kind == Operand::Register) {
+            return opd.type == ValueType::Float ? int_registers_ + opd.id : opd.id;
+        }
+        if (opd.kind == Operand::Slot) {
+            return int_registers_ + float_registers_ + opd.id;
+        }
+        return Npos;
+    }
+
+    void
+    Emit(VmOp op, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+        program_.code.push_back(Instruction{ static_cast<uint8_t>(op), { 0, 0, 0 }, a, b, c });
+    }
+
+    /* 把操作数放到寄存器中：常量与全局变量装入临时寄存器 temp */
+    int32_t
+    Materialize(const Operand& opd, int32_t temp) {
+        int32_t reg = FrameRegister(opd);
+        if (reg != Npos) {
+            return reg;
+        }
+        if (opd.kind == Operand::Constant) {
+            Emit(VmOp::LoadK, temp, ConstantIndex(opd));
+        } else {
+            Emit(VmOp::GetG, temp, GlobalIndex(opd));
+        }
+        return temp;
+    }
+
+    /* 四元式操作码对应的字节码：寄存器形式或 K 形式 */
+    static VmOp
+    ArithOp(Opcode op, bool constant) {
+        int base = constant ? static_cast<int>(VmOp::IAddK) : static_cast<int>(VmOp::IAdd);
+        return static_cast<VmOp>(base + static_cast<int>(op) - static_cast<int>(Opcode::IAdd));
+    }
+
+    static VmOp
+    JumpOp(Opcode op, bool constant) {
+        int base = constant ? static_cast<int>(VmOp::IJLtK) : static_cast<int>(VmOp::IJLt);
+        return static_cast<VmOp>(base + static_cast<int>(op) - static_cast<int>(Opcode::IJumpLt));
+    }
+
+    /* 结果写入 result：在栈帧中直接写入，否则经临时寄存器存回全局区 */
+    int32_t
+    ResultRegister(const Operand& result) const {
+        int32_t reg = FrameRegister(result);
+        return reg != Npos ? reg : temp_;
+    }
+
+    void
+    StoreResult(const Operand& result) {
+        if (FrameRegister(result) == Npos) {
+            Emit(VmOp::SetG, GlobalIndex(result), temp_);
+        }
+    }
+
+    void
+    Lower(const RegisterAllocation::Frame& frame) {
+        const auto& code = allocation_.code();
+        auto&       function = program_.functions[frame.function];
+        int_registers_       = frame.registers[0];
+        float_registers_     = frame.registers[1];
+        temp_                = int_registers_ + float_registers_ + frame.slots;
+
+        function.name        = Name(semantic_.FunctionInfo(frame.function).id_name);
+        function.entry       = static_cast<int32_t>(program_.code.size());
+        function.frame_size  = temp_ + 2;
+        function.ret_value   = GlobalIndex(Operand(Operand::Variable, semantic_.ReturnVariable(frame.function)));
+        function.param_begin = static_cast<int32_t>(program_.parameters.size());
+        function.param_count = static_cast<int32_t>(frame.parameters.size());
+        for (const auto& formal : frame.parameters) {
+            program_.parameters.push_back(formal.IsNone() ? Npos : FrameRegister(formal));
+        }
+        if (code[frame.begin].label == semantic_.main_label()) {
+            program_.main      = frame.function;
+            program_.main_type = SpecifierValueType(semantic_.FunctionInfo(frame.function).sp_type);
+        }
+
+        size_t fixups = fixups_.size();
+        for (int i = frame.begin; i < frame.end; ++i) {
+            const auto& qua = code[i];
+            if (label_index_[qua.label] == Npos) {
+                label_index_[qua.label] = static_cast<int>(program_.code.size());
+            }
+            LowerQuadruple(qua, frame.function);
+        }
+        /* 落出函数末尾的隐式返回，也是跳出函数体的跳转的目标 */
+        Emit(VmOp::Ret, function.ret_value);
+        for (size_t k = fixups; k < fixups_.size(); ++k) {
+            fixups_[k].begin = function.entry;
+            fixups_[k].end   = static_cast<int>(program_.code.size());
+        }
+    }
+
+    void
+    LowerQuadruple(const Quadruple& qua, int function) {
+        switch (qua.operate) {
+            case Opcode::Nop:
+            case Opcode::FunBegin:
+                break;
+            case Opcode::Assign: {
+                int32_t dst = FrameRegister(qua.result);
+                int32_t src = FrameRegister(qua.arg_1);
+                if (dst != Npos) {
+                    if (src != Npos) {
+                        if (src != dst) {
+                            Emit(VmOp::Move, dst, src);
+                        }
+                    } else if (qua.arg_1.kind == Operand::Constant) {
+                        Emit(VmOp::LoadK, dst, ConstantIndex(qua.arg_1));
+                    } else {
+                        Emit(VmOp::GetG, dst, GlobalIndex(qua.arg_1));
+                    }
+                } else if (qua.arg_1.kind == Operand::Constant) {
+                    Emit(VmOp::SetGK, GlobalIndex(qua.result), ConstantIndex(qua.arg_1));
+                } else {
+                    Emit(VmOp::SetG, GlobalIndex(qua.result), Materialize(qua.arg_1, temp_));
+                }
+            } break;
+            case Opcode::IAdd:
+            case Opcode::ISub:
+            case Opcode::IMul:
+            case Opcode::IDiv:
+            case Opcode::FAdd:
+            case Opcode::FSub:
+            case Opcode::FMul:
+            case Opcode::FDiv: {
+                Operand a = qua.arg_1, b = qua.arg_2;
+                if (a.kind == Operand::Constant && b.kind != Operand::Constant && IsCommutative(qua.operate)) {
+                    std::swap(a, b);
+                }
+                int32_t lhs = Materialize(a, temp_);
+                if (b.kind == Operand::Constant) {
+                    Emit(ArithOp(qua.operate, true), ResultRegister(qua.result), lhs, ConstantIndex(b));
+                } else {
+                    Emit(ArithOp(qua.operate, false), ResultRegister(qua.result), lhs, Materialize(b, temp_ + 1));
+                }
+                StoreResult(qua.result);
+            } break;
+            case Opcode::IntToFloat:
+            case Opcode::FloatToInt:
+                Emit(qua.operate == Opcode::IntToFloat ? VmOp::IToF : VmOp::FToI, ResultRegister(qua.result),
+                     Materialize(qua.arg_1, temp_));
+                StoreResult(qua.result);
+                break;
+            case Opcode::Jump:
+                fixups_.push_back(Fixup{ static_cast<int>(program_.code.size()), qua.result.id, 0, 0 });
+                Emit(VmOp::Jmp);
+                break;
+            case Opcode::Param:
+                Emit(VmOp::Param, Materialize(qua.arg_1, temp_));
+                break;
+            case Opcode::Call:
+                Emit(VmOp::Call, qua.result.type == ValueType::Void ? Npos : ResultRegister(qua.result), qua.arg_1.id);
+                if (qua.result.type != ValueType::Void) {
+                    StoreResult(qua.result);
+                }
+                break;
+            case Opcode::Return:
+                Emit(VmOp::Ret, program_.functions[function].ret_value);
+                break;
+            default: {
+                /* 条件跳转 */
+                Opcode  op = qua.operate;
+                Operand a = qua.arg_1, b = qua.arg_2;
+                if (a.kind == Operand::Constant && b.kind != Operand::Constant) {
+                    std::swap(a, b);
+                    op = MirrorJump(op);
+                }
+                bool    constant = b.kind == Operand::Constant;
+                int32_t lhs      = Materialize(a, temp_);
+                int32_t rhs      = constant ? ConstantIndex(b) : Materialize(b, temp_ + 1);
+                fixups_.push_back(Fixup{ static_cast<int>(program_.code.size()), qua.result.id, 0, 0 });
+                Emit(JumpOp(op, constant), lhs, rhs);
+            } break;
+        }
+    }
+
+    /* 窥孔合并为超级指令 */
+    void
+    Combine() {
+        auto& code = program_.code;
+        for (size_t i = 0; i + 1 < code.size(); ++i) {
+            auto&       first = code[i];
+            const auto& next  = code[i + 1];
+            VmOp        op    = static_cast<VmOp>(first.op);
+            VmOp        jump  = static_cast<VmOp>(next.op);
+            if ((op == VmOp::SetG || op == VmOp::SetGK) && jump == VmOp::Ret && first.a == next.a) {
+                first.op = static_cast<uint8_t>(op == VmOp::SetG ? VmOp::RetR : VmOp::RetK);
+                ++superinstructions_;
+            } else if (op == VmOp::IAddK && jump >= VmOp::IJLt && jump <= VmOp::IJNe) {
+                first.op = static_cast<uint8_t>(static_cast<int>(VmOp::IAddKJLt) + static_cast<int>(jump)
+                                                - static_cast<int>(VmOp::IJLt));
+                ++superinstructions_;
+            } else if (op == VmOp::IAddK && jump >= VmOp::IJLtK && jump <= VmOp::IJNeK) {
+                first.op = static_cast<uint8_t>(static_cast<int>(VmOp::IAddKJLtK) + static_cast<int>(jump)
+                                                - static_cast<int>(VmOp::IJLtK));
+                ++superinstructions_;
+            }
+        }
+    }
+
+    const Semantic&           semantic_;
+    const RegisterAllocation& allocation_;
+    BytecodeProgram           program_;
+
+    std::vector<int>                      label_index_;    /* 标号 -> 第一条指令的下标 */
+    std::vector<Fixup>                    fixups_;         /* 待填写的跳转目标 */
+    std::unordered_map<int64_t, int32_t>  constant_index_; /* (常量驻留编号, 类型) -> 常量池下标 */
+    std::unordered_map<std::string, int32_t> name_index_;  /* 名字 -> 名字表下标 */
+
+    int32_t int_registers_;   /* 当前函数的整型寄存器个数 */
+    int32_t float_registers_; /* 当前函数的浮点寄存器个数 */
+    int32_t temp_;            /* 当前函数的第一个临时寄存器 */
+    int     superinstructions_;
+};
+
+constexpr int BytecodeCompiler::Npos;
+
+#endif // !_BYTECODE_HPP_
@@ -10,31 +10,122 @@
  */
 
 #include <iostream>
+#include <new>
 #include <string>
 
 #include <cstdlib>
 #include <cstring>
 
+#include "bytecode.hpp"
+#include "control_flow.hpp"
+#include "elf_writer.hpp"
 #include "grammatical_analysis.hpp"
+#include "interpreter.hpp"
+#include "jit.hpp"
 #include "lexical_analysis.hpp"
+#include "native.hpp"
+#include "object_file.hpp"
+#include "pass_manager.hpp"
+#include "profile_data.hpp"
+#include "profiler.hpp"
+#include "register_allocation.hpp"
+#include "ssa.hpp"
+#include "util.hpp"
+#include "vm.hpp"
 
 using namespace std;
 
+/* 全局堆分配次数，用于 --alloc-stats 统计各阶段的分配开销 */
+static size_t g_allocation_count = 0;
+
+void*
+operator new(size_t size) {
+    ++g_allocation_count;
+    if (void* ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+/* 与上面的 operator new 配对；GCC 无法识别这种替换而误报 new/free 不匹配 */
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void
+operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
 void
 usage(const char* prompt = nullptr) {
     if (prompt)
         cout << prompt << endl;
     cout << "用法如下：" << endl;
     cout << "    ./compiler -x [源文件路径] -g [文法文件路径]: 分析类C程序代码文件语法" << endl;
+    cout << "    --alloc-stats : 输出词法/语法/语义分析各阶段的堆分配次数" << endl;
+    cout << "    --cfg         : 将中间代码的基本块与控制流图输出至 cfg.txt" << endl;
+    cout << "    -O0/-O1/-O2   : 优化级别，-O 同 -O2；O1 为常量传播、值编号、复写传播、死代码删除与跳转优化，O2 另加内联与循环优化" << endl;
+    cout << "    --passes=列表 : 按逗号分隔的顺序执行优化遍(inline,sccp,gvn,copy-prop,dce,licm,jump-thread,layout)，代替 -O 预设" << endl;
+    cout << "    --time-passes : 输出每个优化遍的耗时、四元式条数变化与堆分配次数" << endl;
+    cout << "    --regalloc[=N]: 以每类 N 个寄存器(默认 16)做线性扫描寄存器分配，结果输出至 regalloc.txt" << endl;
+    cout << "    --run         : 解释执行生成的中间代码，输出 main 的返回值、执行的四元式条数与用时" << endl;
+    cout << "    --profile     : 剖析解释执行：按函数、源程序行、基本块与四元式输出执行次数与采样用时及调用图至 profile.txt，折叠栈至 profile.folded，剖析数据至 profile.data" << endl;
+    cout << "    --profile-use [剖析数据路径]: 按 --profile 得到的执行次数优化：内联热调用点、跳过冷循环，并把热路径排为顺序执行" << endl;
+    cout << "    --tiered      : 分层执行：先解释执行，调用频繁的函数与循环多次的函数经即时编译(栈上替换)转为本机代码执行" << endl;
+    cout << "    --vm          : 经寄存器分配生成寄存器字节码(反汇编输出至 bytecode.txt)，在虚拟机中执行；与 --run 同用时比较用时" << endl;
+    cout << "    --jit         : 在进程内按需把函数编译为 x86-64 机器码并执行，输出每个函数的代码大小、编译用时与采样估计的执行用时" << endl;
+    cout << "    -c [目标文件路径]: 将字节码连同常量池、名字表与函数表写成二进制目标文件，由 ./runner 映射后直接执行" << endl;
+    cout << "    -S [汇编文件路径]: 生成 x86-64 GNU as 汇编(System V)，可用 gcc 汇编并链接为可执行文件" << endl;
+    cout << "    --elf [目标文件路径]: 不经汇编器，直接生成 x86-64 可重定位 ELF 目标文件，可用 gcc 链接为可执行文件" << endl;
+    cout << "    --vectorize[=sse2|avx2]: --jit/--tiered/-S 生成本机代码时向量化计数循环中的整数归约，结果输出至 vectorize.txt；"
+            "不指定宽度时 -S 用 SSE2，即时编译用本机支持的最宽指令集" << endl;
+    cout << "    --ssa         : 将中间代码的 SSA 形式输出至 ssa.txt，再经消去 SSA 得到输出的中间代码" << endl;
     cout << "例：" << endl;
     cout << "    ./compiler -x source.txt -g grammar.txt" << endl;
     cout << "    对当前目录下的 source.txt 进行分析处理，文法参考 grammar.txt" << endl;
 }
 
+/* 循环向量化的结果输出至 vectorize.txt */
+void
+report_vectorization(const NativeCompiler& native) {
+    ofstream vectorize_out("./vectorize.txt", ios::out);
+    native.PrintVectorization(vectorize_out);
+    cout << "\t 循环向量化(" << (native.lanes() == NativeCompiler::Avx2Lanes ? "AVX2" : "SSE2") << ", " << native.lanes()
+         << " 路)：" << native.vector_candidates() << " 个循环中向量化 " << native.vectorized()
+         << " 个，结果已输出至当前目录下的 vectorize.txt 文件中。" << endl;
+}
+
 int
 main(int argc, char** argv) {
     string code_path    = "./homework/compiling/test/source_code.txt";
     string grammar_path = "./homework/compiling/Grammar.txt";
+    bool   alloc_stats  = false;
+    bool   dump_cfg     = false;
+    int    opt_level    = 0;
+    string pass_list;
+    bool   time_passes  = false;
+    bool   dump_ssa     = false;
+    int    registers    = 0;
+    bool   run          = false;
+    bool   profile      = false;
+    string profile_path;
+    bool   vm           = false;
+    bool   jit          = false;
+    bool   tiered       = false;
+    string object_path;
+    string assembly_path;
+    string elf_path;
+    int    lanes        = 0;
+    bool   host_lanes   = false;
 
     if (argc <= 1) {
         usage(nullptr);
@@ -56,25 +147,120 @@ main(int argc, char** argv) {
                 usage();
                 exit(EXIT_SUCCESS);
             }
+        } else if (!strcmp(argv[i], "--alloc-stats")) {
+            alloc_stats = true;
+        } else if (!strcmp(argv[i], "--cfg")) {
+            dump_cfg = true;
+        } else if (!strcmp(argv[i], "-O") || !strcmp(argv[i], "-O2")) {
+            opt_level = 2;
+        } else if (!strcmp(argv[i], "-O1")) {
+            opt_level = 1;
+        } else if (!strcmp(argv[i], "-O0")) {
+            opt_level = 0;
+        } else if (!strncmp(argv[i], "--passes=", 9)) {
+            pass_list = argv[i] + 9;
+            if (!PassManager::Unknown(pass_list).empty()) {
+                usage(("未知的优化遍 " + PassManager::Unknown(pass_list)).c_str());
+                exit(EXIT_SUCCESS);
+            }
+        } else if (!strcmp(argv[i], "--time-passes")) {
+            time_passes = true;
+        } else if (!strcmp(argv[i], "--regalloc")) {
+            registers = 16;
+        } else if (!strncmp(argv[i], "--regalloc=", 11)) {
+            registers = atoi(argv[i] + 11);
+            if (registers <= RegisterAllocation::ScratchRegisters) {
+                usage("寄存器个数至少为 3");
+                exit(EXIT_SUCCESS);
+            }
+        } else if (!strcmp(argv[i], "--run")) {
+            run = true;
+        } else if (!strcmp(argv[i], "--profile")) {
+            profile = true;
+        } else if (!strcmp(argv[i], "--profile-use")) {
+            if (i + 1 < argc) {
+                profile_path = argv[++i];
+            } else {
+                usage();
+                exit(EXIT_SUCCESS);
+            }
+        } else if (!strcmp(argv[i], "--vm")) {
+            vm = true;
+        } else if (!strcmp(argv[i], "--tiered")) {
+            tiered = true;
+        } else if (!strcmp(argv[i], "--jit")) {
+            jit = true;
+        } else if (!strcmp(argv[i], "-c")) {
+            if (i + 1 < argc) {
+                object_path = argv[++i];
+            } else {
+                usage();
+                exit(EXIT_SUCCESS);
+            }
+        } else if (!strcmp(argv[i], "-S")) {
+            if (i + 1 < argc) {
+                assembly_path = argv[++i];
+            } else {
+                usage();
+                exit(EXIT_SUCCESS);
+            }
+        } else if (!strcmp(argv[i], "--elf")) {
+            if (i + 1 < argc) {
+                elf_path = argv[++i];
+            } else {
+                usage();
+                exit(EXIT_SUCCESS);
+            }
+        } else if (!strcmp(argv[i], "--vectorize")) {
+            lanes      = NativeCompiler::Sse2Lanes;
+            host_lanes = true;
+        } else if (!strcmp(argv[i], "--vectorize=sse2")) {
+            lanes = NativeCompiler::Sse2Lanes;
+        } else if (!strcmp(argv[i], "--vectorize=avx2")) {
+            lanes = NativeCompiler::Avx2Lanes;
+        } else if (!strcmp(argv[i], "--ssa")) {
+            dump_ssa = true;
         } else {
             usage();
             exit(EXIT_SUCCESS);
         }
     }
 
+    /* 即时编译在本机执行：不指定宽度时取本机支持的最宽指令集，本机不支持 AVX2 时退回 SSE2 */
+    int jit_lanes = host_lanes ? NativeCompiler::HostLanes() : std::min(lanes, NativeCompiler::HostLanes());
+    if ((jit || tiered) && lanes == NativeCompiler::Avx2Lanes && jit_lanes != lanes) {
+        cout << "本机不支持 AVX2，即时编译改用 SSE2 向量化" << endl;
+    }
+
+    ProfileData profile_data;
+    if (!profile_path.empty() && !profile_data.Read(profile_path)) {
+        usage(("无法读取剖析数据 " + profile_path).c_str());
+        exit(EXIT_SUCCESS);
+    }
+
     ofstream lex_tokens("./Lex_token_stream.txt", ios::out);
     ofstream lr1_table("./Lr1_table.txt", ios::out);
     ofstream lr1_process("./Lr1_process.txt", ios::out);
     ofstream intermediate("./inter_code.txt", ios::out);
 
-    Lexical lex(code_path);
+    /* 本次编译的所有驻留字符串都分配在 arena 中，编译结束时一次性释放 */
+    Arena      arena;
+    StringPool pool(arena);
+
+    size_t  lex_allocs = g_allocation_count;
+    Lexical lex(code_path, pool);
     lex.scan();
+    lex_allocs = g_allocation_count - lex_allocs;
     lex.print(lex_tokens);
 
-    LR_1 grammar(grammar_path);
+    size_t table_allocs = g_allocation_count;
+    LR_1   grammar(grammar_path, pool);
+    table_allocs = g_allocation_count - table_allocs;
     grammar.printTable(lr1_table);
 
-    auto error_count = grammar.parse_token(lex.getTokenStream(), lr1_process);
+    size_t parse_allocs = g_allocation_count;
+    auto   error_count  = grammar.parse_token(lex.getTokenStream(), lr1_process);
+    parse_allocs        = g_allocation_count - parse_allocs;
     if (error_count.first) {
         cout << "\n 语法分析共发现 " << error_count.first << "处错误！" << endl;
     } else {
@@ -87,9 +273,173 @@ main(int argc, char** argv) {
         cout << "\n 语义分析完成，未发现语义错误。" << endl;
     }
 
+    /* 只优化没有错误的程序；--passes 给出的列表代替 -O 预设 */
+    PassManager passes(grammar.semantic, &g_allocation_count, profile_path.empty() ? nullptr : &profile_data);
+    if (pass_list.empty()) {
+        passes.AddPreset(opt_level);
+    } else {
+        passes.AddList(pass_list);
+    }
+    bool optimize = !passes.empty();
+    if (optimize && !error_count.first && !error_count.second) {
+        passes.Run(cout);
+        if (time_passes) {
+            passes.PrintTiming(cout);
+        }
+    }
+
+    if (dump_ssa && !error_count.first && !error_count.second) {
+        ofstream ssa_out("./ssa.txt", ios::out);
+        SsaForm  ssa(grammar.semantic);
+        ssa.Construct();
+        ssa.Print(ssa_out);
+        ssa.Destruct();
+        cout << "\n SSA 形式共插入 " << ssa.phi_count() << " 个 φ 函数，已输出至当前目录下的 ssa.txt 文件中；消去时插入 "
+             << ssa.copy_count() << " 条复写，为拆分关键边新增 " << ssa.split_edges() << " 个基本块。" << endl;
+        if (optimize) {
+            PassManager cleanup(grammar.semantic);
+            cleanup.AddList("copy-prop,dce");
+            cleanup.Run(cout, false);
+        }
+    }
+
     grammar.semantic.PrintQuadruple(intermediate);
     cout << "\n 中间代码生成完成。" << endl;
 
+    double interpreter_time = 0;
+    if ((run || profile) && !error_count.first && !error_count.second) {
+        Profiler    profiler(grammar.semantic);
+        Interpreter interpreter(grammar.semantic, nullptr, profile ? &profiler : nullptr);
+        if (interpreter.Run()) {
+            interpreter.Print(cout);
+            /* 剖析的开销使用时偏大，不作为比较的基准 */
+            interpreter_time = profile ? 0 : interpreter.millisecond();
+        }
+        if (profile) {
+            ofstream profile_out("./profile.txt", ios::out);
+            ofstream folded_out("./profile.folded", ios::out);
+            ofstream data_out("./profile.data", ios::out);
+            ProfileData exported;
+            profiler.PrintFlat(profile_out);
+            profile_out << endl;
+            profiler.PrintCallGraph(profile_out);
+            profiler.PrintFolded(folded_out);
+            profiler.Export(exported);
+            exported.Write(data_out);
+            profiler.PrintSummary(cout);
+            cout << "\t 剖析结果已输出至当前目录下的 profile.txt 文件中，折叠栈已输出至 profile.folded 文件中，"
+                    "供 --profile-use 使用的剖析数据已输出至 profile.data 文件中。" << endl;
+        }
+    }
+
+    if (tiered && !error_count.first && !error_count.second) {
+        Jit         compiled(grammar.semantic, true, jit_lanes);
+        Interpreter interpreter(grammar.semantic, &compiled);
+        if (interpreter.Run()) {
+            interpreter.Print(cout);
+            if (interpreter_time > 0 && interpreter.millisecond() > 0) {
+                cout << "\t 相对四元式解释器加速 " << interpreter_time / interpreter.millisecond() << " 倍。" << endl;
+            }
+            if (jit_lanes) {
+                report_vectorization(compiled.native());
+            }
+        }
+    }
+
+    /* 虚拟机的栈帧不受物理寄存器数的限制，未指定 --regalloc 时按 64 个寄存器分配 */
+    if ((registers || vm || !object_path.empty()) && !error_count.first && !error_count.second) {
+        RegisterAllocation allocation(grammar.semantic, registers ? registers : 64);
+        allocation.Run();
+        if (registers) {
+            ofstream regalloc_out("./regalloc.txt", ios::out);
+            allocation.Print(regalloc_out);
+            cout << "\n 寄存器分配：" << allocation.intervals() << " 个活跃区间，溢出 " << allocation.spilled() << " 个，插入 "
+                 << allocation.spill_code() << " 条装入/存回复写，已输出至当前目录下的 regalloc.txt 文件中。" << endl;
+        }
+        if (vm || !object_path.empty()) {
+            ofstream         bytecode_out("./bytecode.txt", ios::out);
+            BytecodeCompiler bytecode(grammar.semantic, allocation);
+            bytecode.Run();
+            bytecode.program().Print(bytecode_out);
+            cout << "\n 字节码生成：" << bytecode.program().code.size() << " 条指令，合并 " << bytecode.superinstructions()
+                 << " 条超级指令，已输出至当前目录下的 bytecode.txt 文件中。" << endl;
+            if (!object_path.empty()) {
+                if (ObjectWriter::Write(bytecode.program(), object_path)) {
+                    cout << "\t 字节码目标文件已输出至 " << object_path << "。" << endl;
+                } else {
+                    cerr << "无法写入目标文件 " << object_path << endl;
+                }
+            }
+            if (vm) {
+                VirtualMachine machine(bytecode.program().View());
+                if (machine.Run()) {
+                    machine.Print(cout);
+                    if (interpreter_time > 0 && machine.millisecond() > 0) {
+                        cout << "\t 相对四元式解释器加速 " << interpreter_time / machine.millisecond() << " 倍。" << endl;
+                    }
+                }
+            }
+        }
+    }
+
+    if (jit && !error_count.first && !error_count.second) {
+        Jit compiled(grammar.semantic, false, jit_lanes);
+        if (compiled.Run()) {
+            compiled.Print(cout);
+            if (jit_lanes) {
+                report_vectorization(compiled.native());
+            }
+            if (interpreter_time > 0 && compiled.millisecond() > 0) {
+                cout << "\t 相对四元式解释器加速 " << interpreter_time / compiled.millisecond() << " 倍。" << endl;
+            }
+        }
+    }
+
+    if ((!assembly_path.empty() || !elf_path.empty()) && !error_count.first && !error_count.second) {
+        NativeCompiler native(grammar.semantic, false, lanes);
+        native.Run();
+        cout << "\n x86-64 代码生成：" << native.program().functions.size() << " 个函数、" << native.program().instruction_count()
+             << " 条机器指令，溢出 " << native.allocation().spilled() << " 个活跃区间。" << endl;
+        if (!assembly_path.empty()) {
+            ofstream assembly_out(assembly_path, ios::out);
+            native.program().Print(assembly_out);
+            cout << "\t 汇编已输出至 " << assembly_path << " (可用 gcc " << assembly_path << " 汇编并链接)。" << endl;
+        }
+        if (!elf_path.empty()) {
+            ElfWriter elf(native.program());
+            elf.Run();
+            if (elf.Write(elf_path)) {
+                cout << "\t ELF 目标文件(" << elf.text_size() << " 字节机器码、" << elf.symbol_count() << " 个符号、"
+                     << elf.relocation_count() << " 个重定位项)已输出至 " << elf_path << " (可用 gcc " << elf_path << " 链接)。"
+                     << endl;
+            } else {
+                cerr << "无法写入目标文件 " << elf_path << endl;
+            }
+        }
+        if (lanes) {
+            report_vectorization(native);
+        }
+    }
+
+    if (dump_cfg) {
+        ofstream         cfg_out("./cfg.txt", ios::out);
+        ControlFlowGraph cfg(grammar.semantic.quadruples());
+        cfg.Print(cfg_out, grammar.semantic.quadruples());
+        cout << "\n 控制流图共 " << cfg.block_count() << " 个基本块、" << cfg.loop_count() << " 个循环，已输出至当前目录下的 cfg.txt 文件中。"
+             << endl;
+    }
+
+    if (alloc_stats) {
+        size_t lines = lex.getLineCount() ? lex.getLineCount() : 1;
+        cout << "\n 堆分配统计：" << endl;
+        cout << "\t 词法分析         : " << lex_allocs << " 次" << endl;
+        cout << "\t LR(1) 分析表构造 : " << table_allocs << " 次 (与源程序无关)" << endl;
+        cout << "\t 语法及语义分析   : " << parse_allocs << " 次" << endl;
+        cout << "\t 源程序共 " << lines << " 行，平均每行 " << double(lex_allocs + parse_allocs) / lines << " 次" << endl;
+        cout << "\t 驻留字符串 " << pool.size() << " 个，arena 共 " << arena.block_count() << " 块 / "
+             << arena.bytes_allocated() << " 字节" << endl;
+    }
+
     lex_tokens.close();
     lr1_table.close();
     lr1_process.close();
@@ -0,0 +1,359 @@
+/**
+ * @file constant_propagation.hpp
+ * @brief 条件常量传播：在控制流图上传播常量、折叠运算、确定常量分支并删除不可达代码
+ */
+
+#ifndef _CONSTANT_PROPAGATION_HPP_
+#define _CONSTANT_PROPAGATION_HPP_
+
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 稀疏条件常量传播 (Wegman-Zadeck)
+ *        四元式不是 SSA 形式，因此按基本块做前向数据流：
+ *        每个块入口为函数内每个变量/临时变量记录一个格值 (未定 / 常量 / 非常量)，
+ *        只沿可执行的边传播，条件跳转的条件为常量时只有一条出边可执行。
+ *        收敛后用常量替换操作数、折叠运算、把常量条件跳转改为无条件跳转或删除，
+ *        并删除不可达块与不再被使用的临时变量赋值
+ */
+class ConstantPropagation {
+public:
+    static constexpr int Npos = -1;
+
+    explicit ConstantPropagation(Semantic& semantic)
+        : semantic_(semantic), folded_(0), resolved_branches_(0), unreachable_(0) {}
+
+    /**
+     * @brief  : 对所有函数执行常量传播
+     * @return : 删除的四元式条数
+     */
+    int
+    Run() {
+        auto&            quadruples = semantic_.quadruples();
+        ControlFlowGraph cfg(quadruples);
+
+        var_slot_.assign(semantic_.variable_count(), Npos);
+        temp_slot_.assign(semantic_.temp_count(), Npos);
+        const auto& entries = cfg.entries();
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int first = entries[f];
+            int last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+            RunFunction(cfg, first, last);
+        }
+        RemoveDeadTemps();
+        return RemoveNops(quadruples);
+    }
+
+    /* 折叠为常量的运算/转换条数 */
+    int
+    folded() const {
+        return folded_;
+    }
+
+    /* 条件为常量而被确定的条件跳转条数 */
+    int
+    resolved_branches() const {
+        return resolved_branches_;
+    }
+
+    /* 删除的不可达基本块数 */
+    int
+    unreachable_blocks() const {
+        return unreachable_;
+    }
+
+private:
+    /**
+     * @brief 格值
+     */
+    struct Lattice {
+        enum State : uint8_t { Top, Const, Bottom };
+        State state;
+        Value value;
+    };
+
+    /* 函数 [first, last) 内的基本块 */
+    void
+    RunFunction(const ControlFlowGraph& cfg, int first, int last) {
+        auto& quadruples = semantic_.quadruples();
+
+        /* 为函数中出现的变量、临时变量分配稠密的槽位 */
+        slot_globals_.clear();
+        int slots = 0;
+        auto assign_slot = [&](const Operand& opd) {
+            if (opd.kind == Operand::Variable && var_slot_[opd.id] == Npos) {
+                var_slot_[opd.id] = slots++;
+                if (semantic_.IsGlobalVariable(opd.id)) {
+                    slot_globals_.push_back(var_slot_[opd.id]);
+                }
+            } else if (opd.kind == Operand::Temp && temp_slot_[opd.id] == Npos) {
+                temp_slot_[opd.id] = slots++;
+            }
+        };
+        int quad_begin = cfg.begin(first);
+        int quad_end   = cfg.end(last - 1);
+        for (int i = quad_begin; i < quad_end; ++i) {
+            assign_slot(quadruples[i].arg_1);
+            assign_slot(quadruples[i].arg_2);
+            assign_slot(quadruples[i].result);
+        }
+        slot_count_ = slots;
+
+        /* 块入口的格值；入口块中所有值未知(形参、全局变量、未初始化的局部变量) */
+        int blocks = last - first;
+        in_.assign(static_cast<size_t>(blocks) * slots, Lattice{ Lattice::Top, Value() });
+        std::vector<char> visited(blocks, 0);
+        for (int s = 0; s < slots; ++s) {
+            in_[s].state = Lattice::Bottom;
+        }
+
+        std::vector<int>     worklist(1, first);
+        std::vector<char>    queued(blocks, 0);
+        std::vector<Lattice> state(slots);
+        queued[0] = 1;
+        while (!worklist.empty()) {
+            int block = worklist.back();
+            worklist.pop_back();
+            queued[block - first] = 0;
+            visited[block - first] = 1;
+
+            state.assign(in_.begin() + static_cast<size_t>(block - first) * slots,
+                         in_.begin() + static_cast<size_t>(block - first + 1) * slots);
+            for (int i = cfg.begin(block); i < cfg.end(block); ++i) {
+                Transfer(quadruples[i], state);
+            }
+
+            /* 可执行的出边 */
+            const auto& last_quad   = quadruples[cfg.end(block) - 1];
+            bool        take_target = true, take_fall = true;
+            if (IsConditionalJump(last_quad.operate)) {
+                Lattice a = Evaluate(last_quad.arg_1, state), b = Evaluate(last_quad.arg_2, state);
+                if (a.state == Lattice::Top || b.state == Lattice::Top) {
+                    take_target = take_fall = false;
+                } else if (a.state == Lattice::Const && b.state == Lattice::Const) {
+                    bool taken  = EvalCondition(last_quad.operate, a.value, b.value);
+                    take_target = taken;
+                    take_fall   = !taken;
+                }
+            }
+            int target = IsJump(last_quad.operate) ? cfg.block_of_label(last_quad.result.id) : Npos;
+            for (auto s = cfg.succ_begin(block); s != cfg.succ_end(block); ++s) {
+                bool is_target = *s == target, is_fall = *s == block + 1 && last_quad.operate != Opcode::Jump;
+                if (!((is_target && take_target) || (is_fall && take_fall))) {
+                    continue;
+                }
+                if (Meet(*s - first, state, !visited[*s - first]) && !queued[*s - first]) {
+                    queued[*s - first] = 1;
+                    worklist.push_back(*s);
+                }
+            }
+        }
+
+        /* 改写 */
+        for (int block = first; block < last; ++block) {
+            if (!visited[block - first]) {
+                bool removed = false;
+                for (int i = cfg.begin(block); i < cfg.end(block); ++i) {
+                    if (quadruples[i].operate != Opcode::FunBegin && quadruples[i].operate != Opcode::Nop) {
+                        quadruples[i].operate = Opcode::Nop;
+                        removed               = true;
+                    }
+                }
+                unreachable_ += removed;
+                continue;
+            }
+            state.assign(in_.begin() + static_cast<size_t>(block - first) * slots,
+                         in_.begin() + static_cast<size_t>(block - first + 1) * slots);
+            for (int i = cfg.begin(block); i < cfg.end(block); ++i) {
+                Rewrite(quadruples[i], state);
+            }
+        }
+
+        for (int i = quad_begin; i < quad_end; ++i) {
+            const auto& qua = quadruples[i];
+            for (const Operand* opd : { &qua.arg_1, &qua.arg_2, &qua.result }) {
+                if (opd->kind == Operand::Variable) {
+                    var_slot_[opd->id] = Npos;
+                } else if (opd->kind == Operand::Temp) {
+                    temp_slot_[opd->id] = Npos;
+                }
+            }
+        }
+    }
+
+    /* 操作数对应的槽位，常量等返回 Npos */
+    int
+    Slot(const Operand& opd) const {
+        if (opd.kind == Operand::Variable) {
+            return var_slot_[opd.id];
+        }
+        if (opd.kind == Operand::Temp) {
+            return temp_slot_[opd.id];
+        }
+        return Npos;
+    }
+
+    Lattice
+    Evaluate(const Operand& opd, const std::vector<Lattice>& state) const {
+        if (opd.kind == Operand::Constant) {
+            return Lattice{ Lattice::Const, semantic_.ConstantValue(opd) };
+        }
+        int slot = Slot(opd);
+        if (slot == Npos) {
+            return Lattice{ Lattice::Bottom, Value() };
+        }
+        return state[slot];
+    }
+
+    /* 四元式结果的格值 */
+    Lattice
+    Compute(const Quadruple& qua, const std::vector<Lattice>& state) const {
+        Lattice bottom{ Lattice::Bottom, Value() };
+        if (qua.operate == Opcode::Call) {
+            return bottom;
+        }
+        Lattice a = Evaluate(qua.arg_1, state);
+        if (qua.operate == Opcode::Assign) {
+            return a;
+        }
+        Lattice b = IsArithmetic(qua.operate) ? Evaluate(qua.arg_2, state) : Lattice{ Lattice::Const, Value() };
+        if (a.state == Lattice::Bottom || b.state == Lattice::Bottom) {
+            return bottom;
+        }
+        if (a.state == Lattice::Top || b.state == Lattice::Top) {
+            return Lattice{ Lattice::Top, Value() };
+        }
+        Lattice result{ Lattice::Const, Value() };
+        bool    defined = IsArithmetic(qua.operate) ? EvalArith(qua.operate, a.value, b.value, result.value)
+                                                    : EvalConvert(qua.operate, a.value, result.value);
+        return defined ? result : bottom;
+    }
+
+    void
+    Transfer(const Quadruple& qua, std::vector<Lattice>& state) const {
+        if (qua.operate == Opcode::Call) {
+            /* 被调函数可能修改任何全局变量 */
+            for (int slot : slot_globals_) {
+                state[slot].state = Lattice::Bottom;
+            }
+        }
+        if (DefinesResult(qua.operate)) {
+            int slot = Slot(qua.result);
+            if (slot != Npos) {
+                state[slot] = Compute(qua, state);
+            }
+        }
+    }
+
+    /**
+     * @brief  : 将 state 合并入块 block 的入口格值
+     * @return : 入口格值是否变化
+     */
+    bool
+    Meet(int block, const std::vector<Lattice>& state, bool first_visit) {
+        Lattice* in      = in_.data() + static_cast<size_t>(block) * slot_count_;
+        bool     changed = first_visit;
+        for (int s = 0; s < slot_count_; ++s) {
+            const Lattice& from = state[s];
+            Lattice&       to   = in[s];
+            if (from.state == Lattice::Top || to.state == Lattice::Bottom) {
+                continue;
+            }
+            if (to.state == Lattice::Top) {
+                to      = from;
+                changed = true;
+            } else if (from.state == Lattice::Bottom || from.value.i != to.value.i) {
+                /* 比较值的位模式：同一槽位的类型固定 */
+                to.state = Lattice::Bottom;
+                changed  = true;
+            }
+        }
+        return changed;
+    }
+
+    /* 用常量替换操作数并折叠，随后更新 state */
+    void
+    Rewrite(Quadruple& qua, std::vector<Lattice>& state) {
+        auto substitute = [&](Operand& opd) {
+            if (!opd.IsLocation()) {
+                return;
+            }
+            Lattice value = Evaluate(opd, state);
+            if (value.state == Lattice::Const) {
+                opd = semantic_.MakeConstant(value.value, opd.type);
+            }
+        };
+        if (ReadsArg1(qua.operate)) {
+            substitute(qua.arg_1);
+        }
+        if (ReadsArg2(qua.operate)) {
+            substitute(qua.arg_2);
+        }
+
+        if (IsConditionalJump(qua.operate) && qua.arg_1.kind == Operand::Constant && qua.arg_2.kind == Operand::Constant) {
+            if (EvalCondition(qua.operate, semantic_.ConstantValue(qua.arg_1), semantic_.ConstantValue(qua.arg_2))) {
+                qua.operate = Opcode::Jump;
+                qua.arg_1   = Operand();
+                qua.arg_2   = Operand();
+            } else {
+                qua.operate = Opcode::Nop;
+            }
+            ++resolved_branches_;
+            return;
+        }
+
+        if (qua.operate != Opcode::Assign && qua.operate != Opcode::Call && DefinesResult(qua.operate)) {
+            Lattice value = Compute(qua, state);
+            if (value.state == Lattice::Const) {
+                qua.operate = Opcode::Assign;
+                qua.arg_1   = semantic_.MakeConstant(value.value, qua.result.type);
+                qua.arg_2   = Operand();
+                ++folded_;
+            }
+        }
+        Transfer(qua, state);
+    }
+
+    /**
+     * @brief : 删除结果不再被读取的临时变量赋值(函数调用除外)
+     *          临时变量只在表达式内部使用，常量替换后其定值常常不再被读取
+     */
+    void
+    RemoveDeadTemps() {
+        auto&            quadruples = semantic_.quadruples();
+        std::vector<int> uses(semantic_.temp_count(), 0);
+        for (const auto& qua : quadruples) {
+            if (ReadsArg1(qua.operate) && qua.arg_1.kind == Operand::Temp) {
+                ++uses[qua.arg_1.id];
+            }
+            if (ReadsArg2(qua.operate) && qua.arg_2.kind == Operand::Temp) {
+                ++uses[qua.arg_2.id];
+            }
+        }
+        for (auto& qua : quadruples) {
+            if (qua.operate != Opcode::Call && DefinesResult(qua.operate) && qua.result.kind == Operand::Temp
+                && uses[qua.result.id] == 0) {
+                qua.operate = Opcode::Nop;
+            }
+        }
+    }
+
+    Semantic&            semantic_;
+    std::vector<int>     var_slot_;     /* 变量编号 -> 当前函数中的槽位 */
+    std::vector<int>     temp_slot_;    /* 临时变量编号 -> 当前函数中的槽位 */
+    std::vector<int>     slot_globals_; /* 当前函数中全局变量的槽位 */
+    int                  slot_count_;   /* 当前函数的槽位数 */
+    std::vector<Lattice> in_;           /* 块入口格值，块 b 的槽位 s 位于 in_[b * slot_count_ + s] */
+
+    int folded_;            /* 折叠的运算条数 */
+    int resolved_branches_; /* 确定的条件跳转条数 */
+    int unreachable_;       /* 删除的不可达块数 */
+};
+
+constexpr int ConstantPropagation::Npos;
+
+#endif // !_CONSTANT_PROPAGATION_HPP_
@@ -0,0 +1,519 @@
+/**
+ * @file control_flow.hpp
+ * @brief 四元式序列上的基本块划分与控制流图：前驱/后继、支配树、循环嵌套
+ */
+
+#ifndef _CONTROL_FLOW_HPP_
+#define _CONTROL_FLOW_HPP_
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+#include "./quadruple.hpp"
+
+/**
+ * @brief 控制流图
+ *        基本块按四元式顺序编号，每个基本块是 quadruples 中连续的一段 [begin, end)；
+ *        各函数的基本块连续排列，函数之间没有边。
+ *        所有信息保存在以基本块编号(或循环编号)为下标的平坦数组中，
+ *        前驱/后继以 CSR 形式存放：块 b 的后继为 succs_[succ_begin_[b] .. succ_begin_[b + 1])
+ */
+class ControlFlowGraph {
+public:
+    static constexpr int Npos = -1;
+
+    /**
+     * @brief : 构造四元式序列的控制流图
+     *          基本块的首条四元式：函数入口、跳转目标、跳转/调用/返回的下一条
+     */
+    explicit ControlFlowGraph(const std::vector<Quadruple>& quadruples) {
+        BuildBlocks(quadruples);
+        BuildEdges(quadruples);
+        BuildDominators();
+        BuildLoops();
+    }
+
+    int
+    block_count() const {
+        return static_cast<int>(block_begin_.size()) - 1;
+    }
+
+    /* 基本块中第一条四元式的下标 */
+    int
+    begin(int block) const {
+        return block_begin_[block];
+    }
+
+    /* 基本块中最后一条四元式的下一个下标 */
+    int
+    end(int block) const {
+        return block_begin_[block + 1];
+    }
+
+    /* 四元式所在的基本块 */
+    int
+    block_of(int quad_index) const {
+        return quad_block_[quad_index];
+    }
+
+    /* 标号为 label 的四元式所在的基本块，标号不存在时返回 Npos */
+    int
+    block_of_label(int label) const {
+        if (label < 0 || label >= static_cast<int>(label_block_.size())) {
+            return Npos;
+        }
+        return label_block_[label];
+    }
+
+    /* 基本块所属函数的入口块 */
+    int
+    function_entry(int block) const {
+        return function_entry_[block];
+    }
+
+    /* 所有函数的入口块，按出现顺序排列 */
+    const std::vector<int>&
+    entries() const {
+        return entries_;
+    }
+
+    const int*
+    succ_begin(int block) const {
+        return succs_.data() + succ_begin_[block];
+    }
+    const int*
+    succ_end(int block) const {
+        return succs_.data() + succ_begin_[block + 1];
+    }
+    int
+    succ_count(int block) const {
+        return succ_begin_[block + 1] - succ_begin_[block];
+    }
+
+    const int*
+    pred_begin(int block) const {
+        return preds_.data() + pred_begin_[block];
+    }
+    const int*
+    pred_end(int block) const {
+        return preds_.data() + pred_begin_[block + 1];
+    }
+    int
+    pred_count(int block) const {
+        return pred_begin_[block + 1] - pred_begin_[block];
+    }
+
+    /* 从函数入口可达 */
+    bool
+    reachable(int block) const {
+        return rpo_index_[block] != Npos;
+    }
+
+    /* 直接支配者；函数入口块与不可达块为 Npos */
+    int
+    idom(int block) const {
+        return idom_[block];
+    }
+
+    /* 每个函数内按逆后序排列的可达基本块，函数依次相接 */
+    const std::vector<int>&
+    reverse_post_order() const {
+        return rpo_;
+    }
+
+    /**
+     * @brief  : a 是否支配 b (支配树上 a 是 b 的祖先，或 a == b)
+     */
+    bool
+    Dominates(int a, int b) const {
+        if (!reachable(a) || !reachable(b)) {
+            return false;
+        }
+        return dom_pre_[a] <= dom_pre_[b] && dom_post_[b] <= dom_post_[a];
+    }
+
+    int
+    loop_count() const {
+        return static_cast<int>(loop_header_.size());
+    }
+
+    /* 循环的首块 */
+    int
+    loop_header(int loop) const {
+        return loop_header_[loop];
+    }
+
+    /* 直接包含该循环的外层循环，最外层为 Npos */
+    int
+    loop_parent(int loop) const {
+        return loop_parent_[loop];
+    }
+
+    /* 循环嵌套深度，最外层循环为 1 */
+    int
+    loop_depth(int loop) const {
+        return loop_depth_[loop];
+    }
+
+    /* 包含基本块的最内层循环，不在循环中时为 Npos */
+    int
+    block_loop(int block) const {
+        return block_loop_[block];
+    }
+
+    /* 基本块的循环嵌套深度，不在循环中时为 0 */
+    int
+    block_loop_depth(int block) const {
+        return block_loop_[block] == Npos ? 0 : loop_depth_[block_loop_[block]];
+    }
+
+    /**
+     * @brief : 输出基本块、边、支配者与循环信息
+     */
+    void
+    Print(std::ostream& os, const std::vector<Quadruple>& quadruples) const {
+        for (int b = 0; b < block_count(); ++b) {
+            os << "B" << b << " : [" << quadruples[begin(b)].label << ", " << quadruples[end(b) - 1].label << "]";
+            os << "  preds :";
+            for (auto p = pred_begin(b); p != pred_end(b); ++p) {
+                os << " B" << *p;
+            }
+            os << "  succs :";
+            for (auto s = succ_begin(b); s != succ_end(b); ++s) {
+                os << " B" << *s;
+            }
+            if (!reachable(b)) {
+                os << "  (不可达)";
+            } else if (idom(b) != Npos) {
+                os << "  idom : B" << idom(b);
+            }
+            if (block_loop(b) != Npos) {
+                os << "  loop : B" << loop_header(block_loop(b)) << " depth " << block_loop_depth(b);
+            }
+            os << std::endl;
+        }
+    }
+
+private:
+    void
+    BuildBlocks(const std::vector<Quadruple>& quadruples) {
+        int count = static_cast<int>(quadruples.size());
+        int max_label = 0;
+        for (const auto& qua : quadruples) {
+            max_label = std::max(max_label, qua.label);
+        }
+        label_quad_.assign(max_label + 1, Npos);
+        for (int i = 0; i < count; ++i) {
+            label_quad_[quadruples[i].label] = i;
+        }
+
+        std::vector<char> leader(count + 1, 0);
+        leader[0]     = 1;
+        leader[count] = 1;
+        for (int i = 0; i < count; ++i) {
+            const auto& qua = quadruples[i];
+            if (qua.operate == Opcode::FunBegin) {
+                leader[i] = 1;
+            }
+            if (IsJump(qua.operate)) {
+                int target = JumpTarget(qua);
+                if (target != Npos) {
+                    leader[target] = 1;
+                }
+            }
+            if (IsJump(qua.operate) || qua.operate == Opcode::Call || qua.operate == Opcode::Return) {
+                leader[i + 1] = 1;
+            }
+        }
+
+        quad_block_.assign(count, Npos);
+        block_begin_.clear();
+        for (int i = 0; i < count; ++i) {
+            if (leader[i]) {
+                block_begin_.push_back(i);
+            }
+            quad_block_[i] = static_cast<int>(block_begin_.size()) - 1;
+        }
+        block_begin_.push_back(count);
+
+        label_block_.assign(max_label + 1, Npos);
+        for (int label = 0; label <= max_label; ++label) {
+            if (label_quad_[label] != Npos) {
+                label_block_[label] = quad_block_[label_quad_[label]];
+            }
+        }
+
+        /* 函数入口：以函数入口四元式开始的块；程序开头不属于任何函数的四元式自成一个"函数" */
+        function_entry_.assign(block_count(), Npos);
+        entries_.clear();
+        for (int b = 0; b < block_count(); ++b) {
+            if (b == 0 || quadruples[begin(b)].operate == Opcode::FunBegin) {
+                entries_.push_back(b);
+            }
+            function_entry_[b] = entries_.back();
+        }
+    }
+
+    void
+    BuildEdges(const std::vector<Quadruple>& quadruples) {
+        int              blocks = block_count();
+        std::vector<int> edge_from, edge_to;
+        for (int b = 0; b < blocks; ++b) {
+            const auto& last = quadruples[end(b) - 1];
+            /* 顺序执行到下一个块(同一函数内) */
+            bool falls_through = last.operate != Opcode::Jump && last.operate != Opcode::Return && b + 1 < blocks
+                                 && function_entry_[b + 1] == function_entry_[b];
+            if (IsJump(last.operate)) {
+                int target = JumpTarget(last);
+                if (target != Npos && function_entry_[quad_block_[target]] == function_entry_[b]) {
+                    edge_from.push_back(b);
+                    edge_to.push_back(quad_block_[target]);
+                }
+            }
+            if (falls_through && !(edge_from.size() && edge_from.back() == b && edge_to.back() == b + 1)) {
+                edge_from.push_back(b);
+                edge_to.push_back(b + 1);
+            }
+        }
+        FillCsr(edge_from, edge_to, succ_begin_, succs_);
+        FillCsr(edge_to, edge_from, pred_begin_, preds_);
+    }
+
+    /* 按 from 分组，保持边的原有顺序 */
+    void
+    FillCsr(const std::vector<int>& from, const std::vector<int>& to, std::vector<int>& offsets, std::vector<int>& edges) {
+        int blocks = block_count();
+        offsets.assign(blocks + 1, 0);
+        for (int f : from) {
+            ++offsets[f + 1];
+        }
+        for (int b = 0; b < blocks; ++b) {
+            offsets[b + 1] += offsets[b];
+        }
+        edges.assign(from.size(), Npos);
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t e = 0; e < from.size(); ++e) {
+            edges[fill[from[e]]++] = to[e];
+        }
+    }
+
+    /**
+     * @brief : Cooper-Harvey-Kennedy 迭代算法计算直接支配者，
+     *          再对支配树做一次深度优先编号，Dominates 因此为 O(1)
+     */
+    void
+    BuildDominators() {
+        int blocks = block_count();
+        rpo_.clear();
+        rpo_index_.assign(blocks, Npos);
+        idom_.assign(blocks, Npos);
+
+        std::vector<char>                visited(blocks, 0);
+        std::vector<int>                 post_order;
+        std::vector<std::pair<int, int>> stack; /* (块, 下一个要访问的后继序号) */
+        for (int entry : entries_) {
+            post_order.clear();
+            stack.push_back({ entry, 0 });
+            visited[entry] = 1;
+            while (!stack.empty()) {
+                int block = stack.back().first;
+                int next  = stack.back().second;
+                if (next < succ_count(block)) {
+                    ++stack.back().second;
+                    int succ = succ_begin(block)[next];
+                    if (!visited[succ]) {
+                        visited[succ] = 1;
+                        stack.push_back({ succ, 0 });
+                    }
+                } else {
+                    post_order.push_back(block);
+                    stack.pop_back();
+                }
+            }
+            int first = static_cast<int>(rpo_.size());
+            for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+                rpo_index_[*it] = static_cast<int>(rpo_.size());
+                rpo_.push_back(*it);
+            }
+
+            idom_[entry] = entry;
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (int i = first + 1; i < static_cast<int>(rpo_.size()); ++i) {
+                    int block    = rpo_[i];
+                    int new_idom = Npos;
+                    for (auto p = pred_begin(block); p != pred_end(block); ++p) {
+                        if (idom_[*p] == Npos) {
+                            continue;
+                        }
+                        new_idom = new_idom == Npos ? *p : Intersect(*p, new_idom);
+                    }
+                    if (new_idom != idom_[block]) {
+                        idom_[block] = new_idom;
+                        changed      = true;
+                    }
+                }
+            }
+            idom_[entry] = Npos;
+        }
+
+        /* 支配树的先序/后序编号 */
+        std::vector<int> child_begin(blocks + 1, 0), children;
+        std::vector<int> parent_of, child_of;
+        for (int b = 0; b < blocks; ++b) {
+            if (idom_[b] != Npos) {
+                parent_of.push_back(idom_[b]);
+                child_of.push_back(b);
+            }
+        }
+        FillCsr(parent_of, child_of, child_begin, children);
+
+        dom_pre_.assign(blocks, Npos);
+        dom_post_.assign(blocks, Npos);
+        int pre = 0, post = 0;
+        for (int entry : entries_) {
+            stack.push_back({ entry, 0 });
+            dom_pre_[entry] = pre++;
+            while (!stack.empty()) {
+                int block = stack.back().first;
+                int next  = child_begin[block] + stack.back().second;
+                if (next < child_begin[block + 1]) {
+                    ++stack.back().second;
+                    int child       = children[next];
+                    dom_pre_[child] = pre++;
+                    stack.push_back({ child, 0 });
+                } else {
+                    dom_post_[block] = post++;
+                    stack.pop_back();
+                }
+            }
+        }
+    }
+
+    int
+    Intersect(int a, int b) const {
+        while (a != b) {
+            while (rpo_index_[a] > rpo_index_[b]) {
+                a = idom_[a];
+            }
+            while (rpo_index_[b] > rpo_index_[a]) {
+                b = idom_[b];
+            }
+        }
+        return a;
+    }
+
+    /**
+     * @brief : 由回边 t -> h (h 支配 t) 得到自然循环，同一首块的回边合并为一个循环；
+     *          按循环体从大到小标记基本块，每个块最终记录包含它的最内层循环
+     */
+    void
+    BuildLoops() {
+        int blocks = block_count();
+        loop_header_.clear();
+        loop_parent_.clear();
+        loop_depth_.clear();
+        block_loop_.assign(blocks, Npos);
+
+        std::vector<int> header_loop(blocks, Npos);
+        std::vector<int> body_begin, body; /* 每个循环的循环体，CSR 形式 */
+        std::vector<int> stack;
+        std::vector<int> mark(blocks, Npos);
+        for (int h = 0; h < blocks; ++h) {
+            bool is_header = false;
+            for (auto p = pred_begin(h); p != pred_end(h); ++p) {
+                if (Dominates(h, *p)) {
+                    is_header = true;
+                    break;
+                }
+            }
+            if (!is_header) {
+                continue;
+            }
+            int loop = static_cast<int>(loop_header_.size());
+            loop_header_.push_back(h);
+            body_begin.push_back(static_cast<int>(body.size()));
+            body.push_back(h);
+            mark[h] = loop;
+            for (auto p = pred_begin(h); p != pred_end(h); ++p) {
+                if (Dominates(h, *p) && mark[*p] != loop) {
+                    mark[*p] = loop;
+                    stack.push_back(*p);
+                }
+            }
+            /* 沿前驱逆向搜索，直到首块 */
+            while (!stack.empty()) {
+                int block = stack.back();
+                stack.pop_back();
+                body.push_back(block);
+                for (auto p = pred_begin(block); p != pred_end(block); ++p) {
+                    if (reachable(*p) && mark[*p] != loop) {
+                        mark[*p] = loop;
+                        stack.push_back(*p);
+                    }
+                }
+            }
+        }
+        body_begin.push_back(static_cast<int>(body.size()));
+
+        int              loops = loop_count();
+        std::vector<int> order(loops);
+        for (int l = 0; l < loops; ++l) {
+            order[l] = l;
+        }
+        std::stable_sort(order.begin(), order.end(), [&body_begin](int a, int b) {
+            return body_begin[a + 1] - body_begin[a] > body_begin[b + 1] - body_begin[b];
+        });
+        loop_parent_.assign(loops, Npos);
+        loop_depth_.assign(loops, 1);
+        for (int loop : order) {
+            int parent = block_loop_[loop_header_[loop]];
+            if (parent != Npos) {
+                loop_parent_[loop] = parent;
+                loop_depth_[loop]  = loop_depth_[parent] + 1;
+            }
+            for (int i = body_begin[loop]; i < body_begin[loop + 1]; ++i) {
+                block_loop_[body[i]] = loop;
+            }
+        }
+    }
+
+    /* 跳转目标四元式的下标 */
+    int
+    JumpTarget(const Quadruple& qua) const {
+        int label = qua.result.id;
+        if (label < 0 || label >= static_cast<int>(label_quad_.size())) {
+            return Npos;
+        }
+        return label_quad_[label];
+    }
+
+    std::vector<int> block_begin_;    /* 基本块 -> 首条四元式下标，末尾多一项为四元式总数 */
+    std::vector<int> quad_block_;     /* 四元式下标 -> 基本块 */
+    std::vector<int> label_quad_;     /* 标号 -> 四元式下标 */
+    std::vector<int> label_block_;    /* 标号 -> 基本块 */
+    std::vector<int> function_entry_; /* 基本块 -> 所属函数的入口块 */
+    std::vector<int> entries_;        /* 所有函数的入口块 */
+
+    std::vector<int> succ_begin_; /* 后继的 CSR 偏移 */
+    std::vector<int> succs_;      /* 后继 */
+    std::vector<int> pred_begin_; /* 前驱的 CSR 偏移 */
+    std::vector<int> preds_;      /* 前驱 */
+
+    std::vector<int> rpo_;       /* 逆后序 */
+    std::vector<int> rpo_index_; /* 基本块在 rpo_ 中的位置，不可达为 Npos */
+    std::vector<int> idom_;      /* 直接支配者 */
+    std::vector<int> dom_pre_;   /* 支配树先序编号 */
+    std::vector<int> dom_post_;  /* 支配树后序编号 */
+
+    std::vector<int> loop_header_; /* 循环 -> 首块 */
+    std::vector<int> loop_parent_; /* 循环 -> 外层循环 */
+    std::vector<int> loop_depth_;  /* 循环 -> 嵌套深度 */
+    std::vector<int> block_loop_;  /* 基本块 -> 最内层循环 */
+};
+
+constexpr int ControlFlowGraph::Npos;
+
+#endif // !_CONTROL_FLOW_HPP_
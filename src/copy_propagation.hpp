@@ -0,0 +1,309 @@
+/**
+ * @file copy_propagation.hpp
+ * @brief 复写传播与基于活跃分析的死代码删除
+ */
+
+#ifndef _COPY_PROPAGATION_HPP_
+#define _COPY_PROPAGATION_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./liveness.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 复写传播
+ *        1. 合并：(op, a, b, T) (:=, T, -, x) 且 T 此后不再活跃时，改为 (op, a, b, x) 并删除复写；
+ *           表达式的值总是先算到临时变量再复写给变量或返回值变量，这一步消除其中的大部分复写
+ *        2. 传播：对可用复写 (x := y，x 与 y 此后都未被重新定值) 做前向数据流，
+ *           用 y 替换其后对 x 的读取，使复写本身成为死代码
+ *        删除的复写只置为 Nop，由死代码删除统一移除
+ */
+class CopyPropagation {
+public:
+    static constexpr int Npos = -1;
+
+    explicit CopyPropagation(Semantic& semantic) : semantic_(semantic), coalesced_(0), replaced_(0) {}
+
+    /**
+     * @brief  : 对所有函数执行复写传播
+     * @return : 合并的复写与替换的操作数总数
+     */
+    int
+    Run() {
+        auto&            quadruples = semantic_.quadruples();
+        ControlFlowGraph cfg(quadruples);
+        Liveness         liveness(semantic_, quadruples, cfg);
+
+        const auto& entries = cfg.entries();
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int first = entries[f];
+            int last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+            liveness.Compute(first, last);
+            Coalesce(cfg, liveness, first, last);
+            /* 替换后的复写可能又引出新的可用复写 (x := y; z := x)，最多重复几轮 */
+            for (int round = 0; round < 3 && Propagate(cfg, liveness, first, last); ++round) {
+            }
+        }
+        return coalesced_ + replaced_;
+    }
+
+    /* 合并的复写条数 */
+    int
+    coalesced() const {
+        return coalesced_;
+    }
+
+    /* 被替换的操作数个数 */
+    int
+    replaced() const {
+        return replaced_;
+    }
+
+private:
+    using BitSet = Liveness::BitSet;
+
+    void
+    Coalesce(const ControlFlowGraph& cfg, const Liveness& liveness, int first, int last) {
+        auto& quadruples = semantic_.quadruples();
+        for (int b = first; b < last; ++b) {
+            Liveness::BitSet live = liveness.LiveOutSet(b);
+            for (int i = cfg.end(b) - 1; i >= cfg.begin(b); --i) {
+                auto& qua = quadruples[i];
+                /* 调用结束基本块，调用结果的复写位于只从调用顺序执行到达的下一块的开头 */
+                bool after_call = i == cfg.begin(b) && b > first && quadruples[i - 1].operate == Opcode::Call
+                                  && cfg.pred_count(b) == 1 && *cfg.pred_begin(b) == b - 1;
+                if (qua.operate == Opcode::Assign && (i > cfg.begin(b) || after_call) && qua.arg_1.IsLocation()
+                    && qua.result.IsLocation() && qua.arg_1 != qua.result && qua.arg_1.type == qua.result.type) {
+                    auto& prev = quadruples[i - 1];
+                    if (DefinesResult(prev.operate) && prev.result == qua.arg_1
+                        && !Liveness::Test(live, liveness.Slot(qua.arg_1))) {
+                        prev.result = qua.result;
+                        qua.operate = Opcode::Nop;
+                        ++coalesced_;
+                        continue;
+                    }
+                }
+                liveness.Step(qua, live);
+            }
+        }
+    }
+
+    /**
+     * @brief  : 可用复写分析与替换
+     * @return : 本轮是否替换了操作数
+     */
+    bool
+    Propagate(const ControlFlowGraph& cfg, const Liveness& liveness, int first, int last) {
+        auto& quadruples = semantic_.quadruples();
+
+        /* 收集复写，并按槽位建立索引 */
+        int slots = liveness.slot_count();
+        copies_.clear();
+        by_slot_.assign(slots, std::vector<int>());
+        by_dest_.assign(slots, std::vector<int>());
+        for (int i = cfg.begin(first); i < cfg.end(last - 1); ++i) {
+            const auto& qua = quadruples[i];
+            if (qua.operate != Opcode::Assign || !qua.result.IsLocation() || qua.arg_1 == qua.result
+                || qua.arg_1.type != qua.result.type) {
+                continue;
+            }
+            int copy = static_cast<int>(copies_.size());
+            copies_.push_back({ i, qua.arg_1 });
+            by_dest_[liveness.Slot(qua.result)].push_back(copy);
+            by_slot_[liveness.Slot(qua.result)].push_back(copy);
+            if (qua.arg_1.IsLocation()) {
+                by_slot_[liveness.Slot(qua.arg_1)].push_back(copy);
+            }
+        }
+        if (copies_.empty()) {
+            return false;
+        }
+        words_ = (static_cast<int>(copies_.size()) + 63) / 64;
+
+        /* 前向数据流：in = ∩ out(pred)，入口块与没有前驱的块为空集 */
+        int    blocks = last - first;
+        BitSet in(static_cast<size_t>(blocks) * words_, ~uint64_t(0)), out(static_cast<size_t>(blocks) * words_, ~uint64_t(0));
+        BitSet avail(words_);
+        bool   changed = true;
+        while (changed) {
+            changed = false;
+            for (int b = first; b < last; ++b) {
+                uint64_t* block_in = in.data() + static_cast<size_t>(b - first) * words_;
+                if (b == first || cfg.pred_count(b) == 0) {
+                    std::fill(block_in, block_in + words_, 0);
+                } else {
+                    std::fill(block_in, block_in + words_, ~uint64_t(0));
+                    for (auto p = cfg.pred_begin(b); p != cfg.pred_end(b); ++p) {
+                        const uint64_t* pred_out = out.data() + static_cast<size_t>(*p - first) * words_;
+                        for (int w = 0; w < words_; ++w) {
+                            block_in[w] &= pred_out[w];
+                        }
+                    }
+                }
+                avail.assign(block_in, block_in + words_);
+                for (int i = cfg.begin(b); i < cfg.end(b); ++i) {
+                    Transfer(quadruples[i], i, liveness, avail);
+                }
+                uint64_t* block_out = out.data() + static_cast<size_t>(b - first) * words_;
+                for (int w = 0; w < words_; ++w) {
+                    changed |= block_out[w] != avail[w];
+                    block_out[w] = avail[w];
+                }
+            }
+        }
+
+        /* 替换 */
+        int replaced = replaced_;
+        for (int b = first; b < last; ++b) {
+            const uint64_t* block_in = in.data() + static_cast<size_t>(b - first) * words_;
+            avail.assign(block_in, block_in + words_);
+            for (int i = cfg.begin(b); i < cfg.end(b); ++i) {
+                auto& qua = quadruples[i];
+                if (ReadsArg1(qua.operate)) {
+                    Substitute(qua.arg_1, liveness, avail);
+                }
+                if (ReadsArg2(qua.operate)) {
+                    Substitute(qua.arg_2, liveness, avail);
+                }
+                Transfer(qua, i, liveness, avail);
+            }
+        }
+        return replaced_ != replaced;
+    }
+
+    /* 四元式对可用复写集合的影响：重新定值杀死涉及该槽位的复写，调用杀死涉及全局变量的复写 */
+    void
+    Transfer(const Quadruple& qua, int index, const Liveness& liveness, BitSet& avail) const {
+        if (qua.operate == Opcode::Call) {
+            for (int s : liveness.global_slots()) {
+                Kill(s, avail);
+            }
+        }
+        if (DefinesResult(qua.operate) && liveness.Slot(qua.result) != Npos) {
+            int slot = liveness.Slot(qua.result);
+            Kill(slot, avail);
+            for (int copy : by_dest_[slot]) {
+                if (copies_[copy].index == index) {
+                    avail[copy >> 6] |= uint64_t(1) << (copy & 63);
+                }
+            }
+        }
+    }
+
+    void
+    Kill(int slot, BitSet& avail) const {
+        for (int copy : by_slot_[slot]) {
+            avail[copy >> 6] &= ~(uint64_t(1) << (copy & 63));
+        }
+    }
+
+    void
+    Substitute(Operand& opd, const Liveness& liveness, const BitSet& avail) {
+        int slot = liveness.Slot(opd);
+        if (slot == Npos) {
+            return;
+        }
+        for (int copy : by_dest_[slot]) {
+            if ((avail[copy >> 6] >> (copy & 63)) & 1) {
+                opd = copies_[copy].source;
+                ++replaced_;
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief 一条复写 x := y
+     */
+    struct Copy {
+        int     index;  /* 复写四元式的下标 */
+        Operand source; /* 复写的来源 y (变量、临时变量或常量) */
+    };
+
+    Semantic&                     semantic_;
+    std::vector<Copy>             copies_;  /* 当前函数中的复写 */
+    std::vector<std::vector<int>> by_slot_; /* 槽位 -> 以其为目标或来源的复写 */
+    std::vector<std::vector<int>> by_dest_; /* 槽位 -> 以其为目标的复写 */
+    int                           words_;   /* 复写集合的字数 */
+
+    int coalesced_; /* 合并的复写条数 */
+    int replaced_;  /* 替换的操作数个数 */
+};
+
+constexpr int CopyPropagation::Npos;
+
+/**
+ * @brief 死代码删除
+ *        结果在之后不再活跃的赋值、运算与类型转换四元式被删除(函数调用有副作用，保留)；
+ *        删除会让更多的值不再活跃，因此重复至没有可删除的四元式。
+ *        最后移除 Nop 并重新连续编号标号
+ */
+class DeadCodeElimination {
+public:
+    explicit DeadCodeElimination(Semantic& semantic) : semantic_(semantic), removed_(0) {}
+
+    /**
+     * @brief  : 对所有函数执行死代码删除
+     * @return : 删除的四元式条数(包括之前各遍留下的 Nop)
+     */
+    int
+    Run() {
+        auto& quadruples = semantic_.quadruples();
+        bool  changed    = true;
+        while (changed) {
+            changed = false;
+            ControlFlowGraph cfg(quadruples);
+            Liveness         liveness(semantic_, quadruples, cfg);
+            const auto&      entries = cfg.entries();
+            for (size_t f = 0; f < entries.size(); ++f) {
+                int first = entries[f];
+                int last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+                liveness.Compute(first, last);
+                for (int b = first; b < last; ++b) {
+                    Liveness::BitSet live = liveness.LiveOutSet(b);
+                    for (int i = cfg.end(b) - 1; i >= cfg.begin(b); --i) {
+                        auto& qua = quadruples[i];
+                        if (IsDead(qua, liveness, live)) {
+                            qua.operate = Opcode::Nop;
+                            ++removed_;
+                            changed = true;
+                            continue;
+                        }
+                        liveness.Step(qua, live);
+                    }
+                }
+            }
+        }
+        int removed = RemoveNops(quadruples);
+        semantic_.RenumberLabels();
+        return removed;
+    }
+
+    /* 因结果不再活跃而删除的四元式条数 */
+    int
+    removed() const {
+        return removed_;
+    }
+
+private:
+    static bool
+    IsDead(const Quadruple& qua, const Liveness& liveness, const Liveness::BitSet& live) {
+        if (!DefinesResult(qua.operate) || qua.operate == Opcode::Call) {
+            return false;
+        }
+        if (qua.operate == Opcode::Assign && qua.arg_1 == qua.result) {
+            return true;
+        }
+        int slot = liveness.Slot(qua.result);
+        return slot != Liveness::Npos && !Liveness::Test(live, slot);
+    }
+
+    Semantic& semantic_;
+    int       removed_; /* 删除的四元式条数 */
+};
+
+#endif // !_COPY_PROPAGATION_HPP_
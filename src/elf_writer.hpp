@@ -0,0 +1,246 @@
+/**
+ * @file elf_writer.hpp
+ * @brief 把 x86-64 机器代码直接写成可重定位的 ELF64 目标文件，不经过汇编器
+ */
+
+#ifndef _ELF_WRITER_HPP_
+#define _ELF_WRITER_HPP_
+
+#include <elf.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "./x86_64.hpp"
+#include "./x86_encoder.hpp"
+
+/**
+ * @brief 可重定位的 ELF64 目标文件：与 X86Program::Print 输出的汇编经 as 汇编得到的目标文件等价
+ *        .text     : 各函数的机器码(X86Encoder 编码)，函数内的跳转已回填
+ *        .rela.text: 调用(R_X86_64_PLT32，对被调函数的符号)与相对 rip 的全局区(R_X86_64_PC32，对变量的符号)、
+ *                    常量池(R_X86_64_PC32，对 .rodata 的节符号)访问
+ *        .rodata   : 浮点常量池，每项 8 字节
+ *        .bss      : 用到的全局变量，每个 8 字节
+ *        .symtab   : 节符号、函数与全局变量为局部符号，main 为全局符号；调用了却没有生成代码的函数为未定义符号
+ *        输出可直接用 gcc 路径 -o a.out 链接
+ */
+class ElfWriter {
+public:
+    static constexpr int Npos = -1;
+
+    explicit ElfWriter(const X86Program& program) : program_(program) {}
+
+    /**
+     * @brief : 编码各函数，建立符号表与重定位表
+     */
+    void
+    Run() {
+        encoder_.Clear();
+        ranges_.clear();
+        for (const auto& function : program_.functions) {
+            size_t begin = encoder_.Encode(function.code);
+            ranges_.push_back(Range{ begin, encoder_.bytes().size() });
+        }
+        BuildSymbols();
+        relocations_.clear();
+        for (const auto& fixup : encoder_.fixups()) {
+            /* S + A - P 应等于 目标 - 下一条指令，P 为字段本身的偏移 */
+            int64_t addend = static_cast<int64_t>(fixup.offset) - fixup.next;
+            if (fixup.kind == X86Operand::Function) {
+                relocations_.push_back(Elf64_Rela{ fixup.offset, ELF64_R_INFO(function_symbol_[fixup.index], R_X86_64_PLT32),
+                                                   addend });
+            } else if (fixup.kind == X86Operand::Global) {
+                relocations_.push_back(Elf64_Rela{ fixup.offset, ELF64_R_INFO(global_symbol_[fixup.index], R_X86_64_PC32),
+                                                   addend });
+            } else {
+                relocations_.push_back(Elf64_Rela{ fixup.offset, ELF64_R_INFO(RodataSymbol, R_X86_64_PC32),
+                                                   addend + 8 * fixup.index });
+            }
+        }
+    }
+
+    /**
+     * @return : 无法写入时返回 false
+     */
+    bool
+    Write(const std::string& path) const {
+        std::vector<Elf64_Shdr> headers(SectionCount);
+        std::memset(headers.data(), 0, sizeof(Elf64_Shdr) * headers.size());
+        std::string section_names(1, '\0');
+        auto        section = [&](int s, const char* name, uint32_t type, uint64_t flags, uint64_t align, uint64_t entry) {
+            headers[s].sh_name      = static_cast<uint32_t>(section_names.size());
+            headers[s].sh_type      = type;
+            headers[s].sh_flags     = flags;
+            headers[s].sh_addralign = align;
+            headers[s].sh_entsize   = entry;
+            section_names += name;
+            section_names += '\0';
+        };
+        section(TextSection, ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 16, 0);
+        section(RelaSection, ".rela.text", SHT_RELA, SHF_INFO_LINK, 8, sizeof(Elf64_Rela));
+        section(RodataSection, ".rodata", SHT_PROGBITS, SHF_ALLOC, 8, 0);
+        section(BssSection, ".bss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE, 8, 0);
+        section(StackSection, ".note.GNU-stack", SHT_PROGBITS, 0, 1, 0);
+        section(SymtabSection, ".symtab", SHT_SYMTAB, 0, 8, sizeof(Elf64_Sym));
+        section(StrtabSection, ".strtab", SHT_STRTAB, 0, 1, 0);
+        section(ShstrtabSection, ".shstrtab", SHT_STRTAB, 0, 1, 0);
+        headers[RelaSection].sh_link   = SymtabSection;
+        headers[RelaSection].sh_info   = TextSection;
+        headers[SymtabSection].sh_link = StrtabSection;
+        headers[SymtabSection].sh_info = first_global_;
+        headers[BssSection].sh_size    = bss_size_;
+
+        std::vector<uint8_t> file(sizeof(Elf64_Ehdr), 0);
+        auto                 append = [&](int s, const void* data, size_t size) {
+            file.resize(RoundUp(file.size(), headers[s].sh_addralign), 0);
+            headers[s].sh_offset = file.size();
+            headers[s].sh_size   = size;
+            file.insert(file.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        };
+        append(TextSection, encoder_.bytes().data(), encoder_.bytes().size());
+        append(RodataSection, program_.constants.data(), sizeof(Value) * program_.constants.size());
+        append(RelaSection, relocations_.data(), sizeof(Elf64_Rela) * relocations_.size());
+        append(SymtabSection, symbols_.data(), sizeof(Elf64_Sym) * symbols_.size());
+        append(StrtabSection, names_.data(), names_.size());
+        append(ShstrtabSection, section_names.data(), section_names.size());
+        headers[BssSection].sh_offset   = file.size();
+        headers[StackSection].sh_offset = file.size();
+        file.resize(RoundUp(file.size(), 8), 0);
+
+        Elf64_Ehdr header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+        header.e_ident[EI_CLASS]   = ELFCLASS64;
+        header.e_ident[EI_DATA]    = ELFDATA2LSB;
+        header.e_ident[EI_VERSION] = EV_CURRENT;
+        header.e_ident[EI_OSABI]   = ELFOSABI_SYSV;
+        header.e_type              = ET_REL;
+        header.e_machine           = EM_X86_64;
+        header.e_version           = EV_CURRENT;
+        header.e_shoff             = file.size();
+        header.e_ehsize            = sizeof(Elf64_Ehdr);
+        header.e_shentsize         = sizeof(Elf64_Shdr);
+        header.e_shnum             = SectionCount;
+        header.e_shstrndx          = ShstrtabSection;
+        std::memcpy(file.data(), &header, sizeof(header));
+
+        std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        out.write(reinterpret_cast<const char*>(headers.data()), static_cast<std::streamsize>(sizeof(Elf64_Shdr) * headers.size()));
+        return static_cast<bool>(out);
+    }
+
+    size_t
+    text_size() const {
+        return encoder_.bytes().size();
+    }
+
+    size_t
+    symbol_count() const {
+        return symbols_.size() - 1;
+    }
+
+    size_t
+    relocation_count() const {
+        return relocations_.size();
+    }
+
+private:
+    /* 节的下标：0 为空节 */
+    enum Section { NullSection, TextSection, RelaSection, RodataSection, BssSection, StackSection, SymtabSection,
+                   StrtabSection, ShstrtabSection, SectionCount };
+
+    /* 符号的下标：0 为空符号，其后是三个节符号 */
+    enum { TextSymbol = 1, RodataSymbol, BssSymbol };
+
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    static uint64_t
+    RoundUp(uint64_t value, uint64_t align) {
+        return align > 1 ? (value + align - 1) / align * align : value;
+    }
+
+    void
+    Symbol(const std::string& name, unsigned char bind, unsigned char type, uint16_t section, uint64_t value,
+           uint64_t size) {
+        Elf64_Sym symbol;
+        std::memset(&symbol, 0, sizeof(symbol));
+        if (!name.empty()) {
+            symbol.st_name = static_cast<uint32_t>(names_.size());
+            names_ += name;
+            names_ += '\0';
+        }
+        symbol.st_info  = ELF64_ST_INFO(bind, type);
+        symbol.st_shndx = section;
+        symbol.st_value = value;
+        symbol.st_size  = size;
+        symbols_.push_back(symbol);
+    }
+
+    /* 局部符号必须排在全局符号之前，.symtab 的 sh_info 为第一个全局符号 */
+    void
+    BuildSymbols() {
+        symbols_.clear();
+        names_.assign(1, '\0');
+        function_symbol_.assign(program_.function_symbols.size(), Npos);
+        global_symbol_.assign(program_.globals.size(), Npos);
+        Symbol("", STB_LOCAL, STT_NOTYPE, SHN_UNDEF, 0, 0);
+        Symbol("", STB_LOCAL, STT_SECTION, TextSection, 0, 0);
+        Symbol("", STB_LOCAL, STT_SECTION, RodataSection, 0, 0);
+        Symbol("", STB_LOCAL, STT_SECTION, BssSection, 0, 0);
+        for (size_t f = 0; f < program_.functions.size(); ++f) {
+            if (static_cast<int>(f) != program_.main) {
+                DefineFunction(f, STB_LOCAL);
+            }
+        }
+        bss_size_ = 0;
+        for (size_t g = 0; g < program_.globals.size(); ++g) {
+            if (!program_.globals[g].empty()) {
+                global_symbol_[g] = static_cast<int>(symbols_.size());
+                Symbol(program_.globals[g], STB_LOCAL, STT_OBJECT, BssSection, bss_size_, 8);
+                bss_size_ += 8;
+            }
+        }
+        first_global_ = static_cast<uint32_t>(symbols_.size());
+        if (program_.main != X86Program::Npos) {
+            DefineFunction(program_.main, STB_GLOBAL);
+        }
+        for (const auto& fixup : encoder_.fixups()) {
+            if (fixup.kind == X86Operand::Function && function_symbol_[fixup.index] == Npos) {
+                function_symbol_[fixup.index] = static_cast<int>(symbols_.size());
+                Symbol(program_.function_symbols[fixup.index], STB_GLOBAL, STT_NOTYPE, SHN_UNDEF, 0, 0);
+            }
+        }
+    }
+
+    void
+    DefineFunction(size_t f, unsigned char bind) {
+        const auto& function                   = program_.functions[f];
+        function_symbol_[function.function]    = static_cast<int>(symbols_.size());
+        Symbol(function.symbol, bind, STT_FUNC, TextSection, ranges_[f].begin, ranges_[f].end - ranges_[f].begin);
+    }
+
+    const X86Program&       program_;
+    X86Encoder              encoder_;
+    std::vector<Range>      ranges_;          /* 各函数在 .text 中的范围 */
+    std::vector<Elf64_Sym>  symbols_;
+    std::string             names_;           /* .strtab */
+    std::vector<Elf64_Rela> relocations_;
+    std::vector<int>        function_symbol_; /* 全局符号表中的位置 -> 符号下标 */
+    std::vector<int>        global_symbol_;   /* 全局区下标 -> 符号下标 */
+    uint64_t                bss_size_     = 0;
+    uint32_t                first_global_ = 0;
+};
+
+constexpr int ElfWriter::Npos;
+
+#endif // !_ELF_WRITER_HPP_
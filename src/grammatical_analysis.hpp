@@ -476,6 +476,8 @@ private:
     std::map<std::pair<int, int>, ActionInfo> goto_table;
     std::map<std::pair<int, int>, ActionInfo> action_table;
 
+    StringPool& pool; /* 与词法分析、语义分析共享的字符串驻留池 */
+
 public:
     /* 语义分析器 */
     Semantic semantic;
@@ -698,19 +700,29 @@ public:
 
     void
     raise_error(const Token& token, std::ostream& os = std::cout) {
-        os << std::endl << "Error found near : " << token.value << " [row = " << token.row << "]" << std::endl;
+        os << std::endl << "Error found near : " << pool[token.value] << " [row = " << token.row << "]" << std::endl;
     }
 
 public:
     std::pair<int, int>
     parse_token(std::vector<Token>&& token_stream, std::ostream& os = std::cout) {
-        token_stream.push_back({ EndToken, EndToken, static_cast<unsigned>(-1) });
+        token_stream.push_back({ pool.Intern(EndToken), pool.Intern(EndToken), static_cast<unsigned>(-1) });
         /* first -> state; second -> symbol */
         std::vector<std::pair<int, int>> symbol_stack;
 
         int g_error_count = 0, s_error_count = 0;
 
-        semantic.AddSymbolToList(SymbolAttribute(StartToken));
+        /* 单词符号驻留编号 -> 文法符号index，避免每个单词都按字符串查找文法符号 */
+        IdHashMap token_symbols;
+        /* 预先生成每个产生式的左部与右部字符串，归约时不再逐次构造 */
+        std::vector<std::vector<std::string>> production_rights(productions.size());
+        for (int p = 0; p < static_cast<int>(productions.size()); ++p) {
+            for (auto& r : productions[p].right) {
+                production_rights[p].push_back(symbols[r].id);
+            }
+        }
+
+        semantic.AddSymbolToList(SymbolAttribute(pool.Intern(StartToken)));
 
         int step = 0;
         os << "步骤 \t 符号栈 \t 产生式 " << std::endl;
@@ -728,7 +740,11 @@ public:
 
             int cur_state = symbol_stack.back().first;
 
-            int  token_idx   = get_symbol_index_by_id(token_stream[i].token);
+            int token_idx = token_symbols.Find(token_stream[i].token);
+            if (token_idx == IdHashMap::Npos) {
+                token_idx = get_symbol_index_by_id(pool[token_stream[i].token]);
+                token_symbols.Set(token_stream[i].token, token_idx);
+            }
             auto action_iter = action_table.find({ cur_state, token_idx });
             if (action_iter == action_table.end()) {
                 raise_error(token_stream[i]);
@@ -773,11 +789,8 @@ public:
                         } else {
                             symbol_stack.push_back({ goto_iter->second.info, production.left });
                             --i;
-                            std::string              pro_left = symbols[production.left].id;
-                            std::vector<std::string> pro_right;
-                            for (auto& r : production.right) {
-                                pro_right.push_back(symbols[r].id);
-                            }
+                            const std::string&              pro_left  = symbols[production.left].id;
+                            const std::vector<std::string>& pro_right = production_rights[action_info.info];
                             if (!semantic.Analysis(pro_left, pro_right)) {
                                 /* todo : error of semantic analysis */
                                 ++s_error_count;
@@ -865,7 +878,7 @@ public:
     }
 
 public:
-    explicit LR_1(const std::string& grammar_path) : Grammar(grammar_path) {
+    LR_1(const std::string& grammar_path, StringPool& pool) : Grammar(grammar_path), pool(pool), semantic(pool) {
         generateLrItems();
         getItems();
         bulidTable();
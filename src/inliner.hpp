@@ -0,0 +1,427 @@
+/**
+ * @file inliner.hpp
+ * @brief 小函数的内联展开
+ */
+
+#ifndef _INLINER_HPP_
+#define _INLINER_HPP_
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./liveness.hpp"
+#include "./profile_data.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 内联展开
+ *        被调函数不含调用(因而不会递归)且函数体不超过 body_limit 条四元式时，
+ *        把调用点的 (param ...) (call, f, -, T) 替换为：
+ *          形参副本 := 实参 (param 按从右到左的顺序排列，倒数第 k 条是第 k 个实参)
+ *          函数体的副本：局部变量与返回值变量换成调用者符号表中的新变量(名字加上 $n)，
+ *                        临时变量换成新的临时变量，return 与跳出函数体的跳转改为跳到后续标号；
+ *                        在入口处活跃(先读后写)的局部变量的副本先置为 0，与调用时局部变量的初值相同
+ *          后续标号处 T := 返回值变量副本
+ *        所有内联增加的四元式总数不超过原四元式数的 growth_percent%，按调用点顺序贪心决定。
+ *        给出剖析数据时：剖析中未执行的调用点不内联；调用次数不少于最热调用点 HotPercent% 的调用点为热调用点，
+ *        函数体条数上限放宽为 HotBodyFactor 倍；预算按调用次数从多到少分配。
+ *        副本的后缀在整个编译过程中唯一；副本与已有的名字重复时不内联这个调用点。
+ *        函数本身保留(可能经由其他调用点或作为 main 被执行)，最后重新编号标号
+ */
+class Inliner {
+public:
+    static constexpr int Npos = -1;
+
+    /* 热调用点：调用次数不少于最热调用点的百分比；热调用点的函数体条数上限倍数 */
+    static constexpr int HotPercent    = 10;
+    static constexpr int HotBodyFactor = 4;
+
+    explicit Inliner(Semantic& semantic, const ProfileData* profile = nullptr, int body_limit = 12, int growth_percent = 50)
+        : semantic_(semantic), profile_(profile), body_limit_(body_limit), growth_percent_(growth_percent), inlined_(0) {}
+
+    /**
+     * @brief  : 对所有调用点作内联决策并展开
+     * @return : 内联的调用点个数
+     */
+    int
+    Run() {
+        auto& quadruples = semantic_.quadruples();
+        FindFunctions();
+        FindEntryLive();
+        Decide();
+
+        int next_label = 0;
+        for (const auto& qua : quadruples) {
+            next_label = qua.label > next_label ? qua.label : next_label;
+        }
+        next_label += 2; /* 原最大标号 + 1 表示末尾之后，不能使用 */
+
+        std::vector<Quadruple> output;
+        output.reserve(quadruples.size() + quadruples.size() * growth_percent_ / 100);
+        int caller = Npos;
+        int site   = 0;
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            const auto& qua = quadruples[i];
+            if (qua.operate == Opcode::FunBegin) {
+                caller = qua.arg_1.id;
+            }
+            if (qua.operate != Opcode::Call) {
+                output.push_back(qua);
+                continue;
+            }
+            auto& decision = decisions_[site++];
+            if (decision.inlined && !CopyLocals(caller, qua.arg_1.id)) {
+                decision.inlined = false;
+                decision.reason  = "局部变量的副本与已有的名字重复";
+            }
+            if (decision.inlined) {
+                Expand(output, qua, qua.arg_1.id, next_label);
+                ++inlined_;
+            } else {
+                output.push_back(qua);
+            }
+        }
+
+        quadruples.swap(output);
+        RemoveNops(quadruples);
+        semantic_.RenumberLabels();
+        return inlined_;
+    }
+
+    /* 内联的调用点个数 */
+    int
+    inlined() const {
+        return inlined_;
+    }
+
+    /* 考察的调用点个数 */
+    int
+    call_sites() const {
+        return static_cast<int>(decisions_.size());
+    }
+
+    /**
+     * @brief : 输出每个调用点的内联决策(标号为内联前的四元式标号)
+     */
+    void
+    Print(std::ostream& os) const {
+        os << "call label : caller -> callee (body size) : decision" << std::endl;
+        for (const auto& decision : decisions_) {
+            os << decision.label << " : ";
+            semantic_.PrintOperand(os, Operand(Operand::Function, decision.caller));
+            os << " -> ";
+            semantic_.PrintOperand(os, Operand(Operand::Function, decision.callee));
+            os << " (" << body_size_[decision.callee] << ")";
+            if (decision.count != ProfileData::Npos) {
+                os << " [" << decision.count << " calls]";
+            }
+            os << " : ";
+            if (decision.inlined) {
+                os << "内联" << std::endl;
+            } else {
+                os << "不内联，" << decision.reason << std::endl;
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief 一个调用点的内联决策
+     */
+    struct Decision {
+        int         label;   /* 调用四元式的标号 */
+        int         caller;  /* 调用者 */
+        int         callee;  /* 被调函数 */
+        bool        inlined; /* 是否内联 */
+        const char* reason;  /* 不内联的原因 */
+        int64_t     count;   /* 剖析中的调用次数，未知为 ProfileData::Npos */
+        int         growth;  /* 内联增加的四元式条数 */
+    };
+
+    /**
+     * @brief : 决定每个调用点是否内联。先排除不能内联的调用点，
+     *          再按调用点顺序(有剖析数据时按调用次数从多到少)在预算内贪心选取
+     */
+    void
+    Decide() {
+        const auto& quadruples = semantic_.quadruples();
+        int64_t     hot        = profile_ ? static_cast<int64_t>(profile_->max_call_count()) * HotPercent / 100 : 0;
+        hot                    = hot > 1 ? hot : 1;
+        std::vector<int> candidates;
+        int              caller = Npos;
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            const auto& qua = quadruples[i];
+            if (qua.operate == Opcode::FunBegin) {
+                caller = qua.arg_1.id;
+            }
+            if (qua.operate != Opcode::Call) {
+                continue;
+            }
+            int      callee = qua.arg_1.id;
+            Decision decision{ qua.label, caller, callee, false, nullptr, ProfileData::Npos, body_size_[callee] };
+            if (body_size_[callee] != Npos) {
+                decision.growth += static_cast<int>(entry_live_[callee].size());
+            }
+            if (profile_) {
+                decision.count = profile_->call_count(semantic_.FunctionInfo(callee).id_name, qua.row);
+            }
+            /* 函数体 + 局部变量置 0 + 结果复写 - 调用，param 改为复写不增加条数 */
+            const int params = semantic_.FunctionInfo(callee).parameter_num;
+            const int limit  = decision.count >= hot ? body_limit_ * HotBodyFactor : body_limit_;
+            if (body_size_[callee] == Npos || caller == Npos) {
+                decision.reason = "被调函数不存在";
+            } else if (has_call_[callee]) {
+                decision.reason = "被调函数含有函数调用";
+            } else if (decision.count == 0) {
+                decision.reason = "剖析中未执行的调用点";
+            } else if (body_size_[callee] > limit) {
+                decision.reason = "函数体超过条数上限";
+            } else if (!ParamsBefore(quadruples, i, params)) {
+                decision.reason = "实参不是紧接在调用之前的 param";
+            } else {
+                candidates.push_back(static_cast<int>(decisions_.size()));
+            }
+            decisions_.push_back(decision);
+        }
+
+        if (profile_) {
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [this](int a, int b) { return decisions_[a].count > decisions_[b].count; });
+        }
+        int budget = static_cast<int>(quadruples.size()) * growth_percent_ / 100;
+        for (int k : candidates) {
+            auto& decision = decisions_[k];
+            if (decision.growth > budget) {
+                decision.reason = "超出代码增长预算";
+            } else {
+                budget -= decision.growth;
+                decision.inlined = true;
+            }
+        }
+    }
+
+    /* 各函数的函数体范围 [body_begin_, body_end_)、条数与是否含调用 */
+    void
+    FindFunctions() {
+        const auto& quadruples = semantic_.quadruples();
+        int         functions  = 0;
+        for (const auto& qua : quadruples) {
+            if (qua.operate == Opcode::FunBegin || qua.operate == Opcode::Call) {
+                functions = qua.arg_1.id + 1 > functions ? qua.arg_1.id + 1 : functions;
+            }
+        }
+        body_begin_.assign(functions, Npos);
+        body_end_.assign(functions, Npos);
+        body_size_.assign(functions, Npos);
+        has_call_.assign(functions, 0);
+        int current = Npos;
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            const auto& qua = quadruples[i];
+            if (qua.operate == Opcode::FunBegin) {
+                current              = qua.arg_1.id;
+                body_begin_[current] = static_cast<int>(i + 1);
+            }
+            if (current == Npos) {
+                continue;
+            }
+            body_end_[current]  = static_cast<int>(i + 1);
+            body_size_[current] = body_end_[current] - body_begin_[current];
+            has_call_[current] |= qua.operate == Opcode::Call;
+        }
+    }
+
+    /* 不含调用的函数在入口处活跃的局部变量(形参除外)：函数体先读后写，内联时每次都要置为初值 0 */
+    void
+    FindEntryLive() {
+        const auto&      quadruples = semantic_.quadruples();
+        ControlFlowGraph cfg(quadruples);
+        Liveness         liveness(semantic_, quadruples, cfg);
+        const auto&      entries = cfg.entries();
+        entry_live_.assign(body_size_.size(), std::vector<int>());
+        for (size_t f = 0; f < entries.size(); ++f) {
+            const auto& entry  = quadruples[cfg.begin(entries[f])];
+            int         callee = entry.arg_1.id;
+            if (entry.operate != Opcode::FunBegin || has_call_[callee]) {
+                continue;
+            }
+            liveness.Compute(entries[f], f + 1 < entries.size() ? entries[f + 1] : cfg.block_count());
+            const int params = semantic_.FunctionInfo(callee).parameter_num;
+            for (int slot = 0; slot < liveness.slot_count(); ++slot) {
+                const Operand& opd = liveness.slot_operand(slot);
+                if (opd.kind != Operand::Variable || !semantic_.IsLocalOf(opd.id, callee)
+                    || !liveness.LiveIn(entries[f], slot)) {
+                    continue;
+                }
+                bool formal = false;
+                for (int k = 0; k < params; ++k) {
+                    formal |= semantic_.ParameterVariable(callee, k) == opd.id;
+                }
+                if (!formal) {
+                    entry_live_[callee].push_back(opd.id);
+                }
+            }
+        }
+    }
+
+    /* 变量操作数，类型为变量声明的类型 */
+    Operand
+    VariableOperand(int variable) const {
+        return Operand(Operand::Variable, variable, SpecifierValueType(semantic_.VariableInfo(variable).sp_type));
+    }
+
+    /* 第 call 条之前的 params 条四元式都是 param (展开时它们原样在输出的末尾) */
+    static bool
+    ParamsBefore(const std::vector<Quadruple>& quadruples, size_t call, int params) {
+        if (static_cast<int>(call) < params) {
+            return false;
+        }
+        for (int k = 1; k <= params; ++k) {
+            if (quadruples[call - k].operate != Opcode::Param) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief  : 在调用者的符号表中为被调函数的形参、返回值变量与函数体中的局部变量建立副本
+     * @return : 副本与已有的名字重复时返回 false
+     */
+    bool
+    CopyLocals(int caller, int callee) {
+        const auto& quadruples = semantic_.quadruples();
+        std::string suffix     = semantic_.NewCopySuffix();
+        var_copy_.assign(semantic_.variable_count(), Npos);
+        std::vector<int> locals(1, semantic_.ReturnVariable(callee));
+        for (int k = 0; k < semantic_.FunctionInfo(callee).parameter_num; ++k) {
+            locals.push_back(semantic_.ParameterVariable(callee, k));
+        }
+        for (int i = body_begin_[callee]; i < body_end_[callee]; ++i) {
+            for (const Operand* opd : { &quadruples[i].arg_1, &quadruples[i].arg_2, &quadruples[i].result }) {
+                if (opd->kind == Operand::Variable) {
+                    locals.push_back(opd->id);
+                }
+            }
+        }
+        for (int variable : locals) {
+            if (semantic_.IsLocalOf(variable, callee) && var_copy_[variable] == Npos) {
+                var_copy_[variable] = semantic_.CopyVariable(variable, caller, suffix);
+                if (var_copy_[variable] == Npos) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief : 展开一个调用点；output 末尾的 param 已在其中，改为对形参副本的复写；局部变量的副本已由 CopyLocals 建立
+     */
+    void
+    Expand(std::vector<Quadruple>& output, const Quadruple& call, int callee, int& next_label) {
+        const auto& quadruples = semantic_.quadruples();
+        const auto& info       = semantic_.FunctionInfo(callee);
+
+        /* 被调函数的局部变量与临时变量 -> 副本 */
+        temp_copy_.assign(semantic_.temp_count(), Npos);
+        auto rename = [&](Operand& opd) {
+            if (opd.kind == Operand::Variable && semantic_.IsLocalOf(opd.id, callee)) {
+                opd.id = var_copy_[opd.id];
+            } else if (opd.kind == Operand::Temp) {
+                if (temp_copy_[opd.id] == Npos) {
+                    temp_copy_[opd.id] = semantic_.GetNewTmpVar(opd.type).id;
+                }
+                opd.id = temp_copy_[opd.id];
+            }
+        };
+
+        /* 从右到左的 param 中倒数第 k 条是第 k 个实参，实参已按形参类型转换 */
+        for (int k = 1; k <= info.parameter_num; ++k) {
+            auto&   param = output[output.size() - k];
+            Operand formal = VariableOperand(semantic_.ParameterVariable(callee, k - 1));
+            rename(formal);
+            param.operate = Opcode::Assign;
+            param.result  = formal;
+        }
+
+        /* 函数体的标号 -> 新标号，后续标号在最后分配 */
+        int begin = body_begin_[callee], end = body_end_[callee];
+        int first_label = quadruples[begin].label;
+        int last_label  = quadruples[end - 1].label;
+        label_copy_.assign(last_label - first_label + 1, Npos);
+        for (int i = begin; i < end; ++i) {
+            label_copy_[quadruples[i].label - first_label] = next_label++;
+        }
+        int continuation = next_label++;
+
+        /* 跳到调用四元式的跳转(循环出口、&&/|| 的出口等)改为到达函数体副本：由一条 Nop 承载调用的标号 */
+        output.push_back(Quadruple(call.label, Opcode::Nop, Operand(), Operand(), Operand(), call.row));
+        for (int variable : entry_live_[callee]) {
+            Operand local = VariableOperand(variable);
+            rename(local);
+            Value zero;
+            if (local.type == ValueType::Float) {
+                zero.f = 0.0;
+            } else {
+                zero.i = 0;
+            }
+            output.push_back(
+                Quadruple(next_label++, Opcode::Assign, semantic_.MakeConstant(zero, local.type), Operand(), local, call.row));
+        }
+        for (int i = begin; i < end; ++i) {
+            Quadruple qua = quadruples[i];
+            qua.label     = label_copy_[qua.label - first_label];
+            if (qua.operate == Opcode::Return) {
+                qua.operate = Opcode::Jump;
+                qua.result  = Operand(Operand::Label, continuation);
+            } else if (IsJump(qua.operate)) {
+                int target       = qua.result.id;
+                bool inside      = target >= first_label && target <= last_label && label_copy_[target - first_label] != Npos;
+                qua.result.id    = inside ? label_copy_[target - first_label] : continuation;
+            } else if (qua.operate != Opcode::Param) {
+                rename(qua.result);
+            }
+            if (ReadsArg1(qua.operate)) {
+                rename(qua.arg_1);
+            }
+            if (ReadsArg2(qua.operate)) {
+                rename(qua.arg_2);
+            }
+            output.push_back(qua);
+        }
+
+        /* 后续：调用的结果；void 函数没有结果，留一条 Nop 承载后续标号 */
+        Operand value = VariableOperand(semantic_.ReturnVariable(callee));
+        rename(value);
+        if (call.result.type == ValueType::Void) {
+            output.push_back(Quadruple(continuation, Opcode::Nop, Operand(), Operand(), Operand(), call.row));
+        } else {
+            output.push_back(Quadruple(continuation, Opcode::Assign, value, Operand(), call.result, call.row));
+        }
+    }
+
+    Semantic&                     semantic_;
+    const ProfileData*            profile_;        /* 剖析数据，可为空 */
+    int                           body_limit_;     /* 可内联的函数体条数上限 */
+    int                           growth_percent_; /* 内联增加的四元式总数上限(占原四元式数的百分比) */
+    int                           inlined_;        /* 内联的调用点个数 */
+    std::vector<int>              body_begin_;     /* 函数 -> 函数体第一条四元式的下标 */
+    std::vector<int>              body_end_;       /* 函数 -> 函数体最后一条四元式的下一个下标 */
+    std::vector<int>              body_size_;      /* 函数 -> 函数体条数，不存在的函数为 Npos */
+    std::vector<char>             has_call_;       /* 函数 -> 函数体是否含调用 */
+    std::vector<std::vector<int>> entry_live_;     /* 函数 -> 入口处活跃的局部变量(形参除外) */
+    std::vector<int>              var_copy_;       /* 被调函数的变量 -> 副本 */
+    std::vector<int>              temp_copy_;      /* 被调函数的临时变量 -> 副本 */
+    std::vector<int>              label_copy_;     /* 被调函数的标号(减去第一个标号) -> 新标号 */
+    std::vector<Decision>         decisions_;      /* 每个调用点的决策 */
+};
+
+constexpr int Inliner::Npos;
+constexpr int Inliner::HotPercent;
+constexpr int Inliner::HotBodyFactor;
+
+#endif // !_INLINER_HPP_
@@ -0,0 +1,646 @@
+/**
+ * @file interpreter.hpp
+ * @brief 直接执行四元式中间代码的解释器
+ */
+
+#ifndef _INTERPRETER_HPP_
+#define _INTERPRETER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "./jit.hpp"
+#include "./profiler.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 四元式解释器
+ *        载入回填(及优化)后的四元式，预先译码为紧凑的指令：
+ *          操作数译码为 (所在区域, 下标)：全局变量与返回值变量在全局区(按变量编号)，常量在常量区，
+ *          函数的局部变量与临时变量在栈帧中按函数内的稠密编号存放；
+ *          跳转目标译码为指令下标，每个函数末尾追加一条隐式返回，跳出函数体的跳转跳到这条返回。
+ *        执行从 main 开始：param 把实参压入实参栈，call 建立新栈帧(清零)并把实参写入形参
+ *        (从右到左的 param 中倒数第 k 条是第 k 个实参)，return 从返回值变量读出结果写入调用者的结果操作数。
+ *        main 返回时结束，返回值即程序的退出值。
+ *        给出即时编译器时分层执行：全局区与生成的代码共享，
+ *          解释执行的调用使被调函数的计数达到 HotCalls 后编译它，此后对它的调用都直接执行本机代码；
+ *          向回的跳转使循环头的计数达到 HotLoops 后编译当前函数，从循环头的栈上替换入口带着栈帧中的值进入本机代码，
+ *          本机代码执行到函数返回后，解释器从该函数的隐式返回继续。本机代码调用的函数由即时编译器在第一次调用时编译
+ *        给出剖析器时，每条指令计数、每次调用记录调用边，并在指令之间响应剖析器的定时采样；
+ *        剖析与否分别实例化执行循环，不剖析时没有额外开销
+ */
+class Interpreter {
+public:
+    static constexpr int Npos = -1;
+
+    /* 调用层数上限 */
+    static constexpr int MaxDepth = 1 << 20;
+
+    /* 分层执行：函数被解释执行调用的次数、循环头经回边到达的次数达到阈值时编译 */
+    static constexpr int HotCalls = 1000;
+    static constexpr int HotLoops = 10000;
+
+    /**
+     * @param jit      : 分层执行使用的即时编译器(需生成栈上替换的入口)，为空时只解释执行
+     * @param profiler : 剖析器，为空时不剖析
+     */
+    explicit Interpreter(const Semantic& semantic, Jit* jit = nullptr, Profiler* profiler = nullptr)
+        : semantic_(semantic),
+          jit_(jit),
+          profiler_(profiler),
+          frame_size_(0),
+          main_(Npos),
+          executed_(0),
+          calls_(0),
+          max_depth_(0),
+          millisecond_(0),
+          exit_type_(ValueType::Void) {
+        exit_value_.i = 0;
+        counts_.assign(static_cast<size_t>(Opcode::Return) + 1, 0);
+    }
+
+    /**
+     * @brief  : 译码并从 main 开始执行
+     * @return : 没有 main 或发生运行错误(整数除以 0、浮点数转换溢出、调用层数超过上限)时返回 false
+     */
+    bool
+    Run() {
+        Decode();
+        if (main_ == Npos) {
+            std::cerr << "运行错误 : 未找到 main 函数" << std::endl;
+            return false;
+        }
+        if (jit_ && !jit_->Start()) {
+            return false;
+        }
+        if (profiler_) {
+            profiler_->Start(quadruple_of_);
+        }
+        auto start  = std::chrono::steady_clock::now();
+        bool ok     = profiler_ ? Execute<true>() : Execute<false>();
+        auto finish = std::chrono::steady_clock::now();
+        millisecond_ = std::chrono::duration<double, std::milli>(finish - start).count();
+        if (profiler_) {
+            profiler_->Stop(millisecond_);
+        }
+        if (jit_) {
+            jit_->Stop();
+        }
+        return ok;
+    }
+
+    /* main 的返回值，void 的 main 为 0 */
+    Value
+    exit_value() const {
+        return exit_value_;
+    }
+
+    ValueType
+    exit_type() const {
+        return exit_type_;
+    }
+
+    /* 执行的指令条数(不含函数入口与隐式返回) */
+    uint64_t
+    executed() const {
+        return executed_;
+    }
+
+    /* 各操作码的执行次数 */
+    uint64_t
+    count(Opcode op) const {
+        return counts_[static_cast<size_t>(op)];
+    }
+
+    /* 函数调用次数(不含 main) */
+    uint64_t
+    calls() const {
+        return calls_;
+    }
+
+    /* 最大调用层数 */
+    int
+    max_depth() const {
+        return max_depth_;
+    }
+
+    /* 执行用时(分层执行时包括编译) */
+    double
+    millisecond() const {
+        return millisecond_;
+    }
+
+    /**
+     * @brief : 输出退出值、执行的指令条数、调用次数与用时，以及各操作码的执行次数
+     */
+    void
+    Print(std::ostream& os) const {
+        os << (jit_ ? "\n 分层执行：main 返回 " : "\n 解释执行：main 返回 ");
+        if (exit_type_ == ValueType::Float) {
+            os << exit_value_.f;
+        } else {
+            os << exit_value_.i;
+        }
+        os << "；执行 " << executed_ << " 条四元式，调用 " << calls_ << " 次，最大调用层数 " << max_depth_ << "，用时 "
+           << millisecond_ << " ms。" << std::endl;
+        if (jit_) {
+            os << "\t 按调用次数编译 " << promoted_calls_ << " 个函数，栈上替换 " << jit_->resumes() << " 次，进入本机代码的调用 "
+               << native_calls_ << " 次；共编译 " << jit_->stats().size() << " 个函数，编译用时 " << jit_->compile_millisecond()
+               << " ms。" << std::endl;
+            jit_->PrintFunctions(os, millisecond_);
+        }
+        os << "\t 各操作码执行次数：" << std::endl;
+        for (size_t op = 0; op < counts_.size(); ++op) {
+            if (counts_[op] && static_cast<Opcode>(op) != Opcode::FunBegin) {
+                os << "\t " << OpcodeText(static_cast<Opcode>(op)) << " : " << counts_[op] << std::endl;
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief 译码后的操作数：frame 为 0、1、2 时分别是全局区、栈帧与常量区中的下标
+     */
+    struct Location {
+        int32_t frame;
+        int32_t index;
+    };
+
+    /**
+     * @brief 译码后的指令
+     */
+    struct Instruction {
+        Opcode   operate;
+        Location arg_1;
+        Location arg_2;
+        Location result;
+        int      target; /* 跳转目标的指令下标；调用为被调函数 */
+        int      label;  /* 原四元式的标号，隐式返回为 Npos */
+    };
+
+    /**
+     * @brief 译码后的函数
+     */
+    struct Function {
+        int                  entry;      /* 函数入口之后第一条指令的下标，不存在的函数为 Npos */
+        int                  exit;       /* 隐式返回的指令下标 */
+        int                  frame_size; /* 栈帧大小 */
+        Location             ret_value;  /* 返回值变量 */
+        std::vector<int>     parameters; /* 各形参在栈帧中的下标 */
+        std::vector<Operand> locals;     /* 栈帧下标 -> 局部变量或临时变量，栈上替换时使用 */
+    };
+
+    /**
+     * @brief 调用栈的一项：被调函数与调用者的现场
+     */
+    struct CallFrame {
+        int      function; /* 被调函数 */
+        int      pc;       /* 返回后执行的指令 */
+        size_t   base;     /* 调用者栈帧在栈中的起点 */
+        Location result;   /* 调用者接收返回值的操作数 */
+    };
+
+    /* 全局区中变量(按编号)或常量区中常量的下标 */
+    Location
+    StaticLocation(const Operand& opd) {
+        if (opd.kind == Operand::Constant) {
+            constants_.push_back(semantic_.ConstantValue(opd));
+            return Location{ 2, static_cast<int32_t>(constants_.size() - 1) };
+        }
+        return Location{ 0, opd.id };
+    }
+
+    /* 当前函数中操作数的位置，局部变量与临时变量第一次出现时分配栈帧下标 */
+    Location
+    Locate(const Operand& opd, int function) {
+        if (opd.kind == Operand::Temp || (opd.kind == Operand::Variable && function != Npos
+                                          && semantic_.IsLocalOf(opd.id, function)
+                                          && semantic_.VariableInfo(opd.id).id_type != IdentifierInfo::ReturnVar)) {
+            auto& index = opd.kind == Operand::Temp ? temp_index_[opd.id] : var_index_[opd.id];
+            if (index == Npos) {
+                index = frame_size_++;
+                frame_operands_.push_back(&index);
+                if (function != Npos) {
+                    functions_[function].locals.push_back(opd);
+                }
+            }
+            return Location{ 1, index };
+        }
+        if (opd.kind == Operand::Variable || opd.kind == Operand::Constant) {
+            return StaticLocation(opd);
+        }
+        return Location{ 0, Npos };
+    }
+
+    /* 结束一个函数的译码：追加隐式返回，记录栈帧大小，清除栈帧下标 */
+    void
+    FinishFunction(int function) {
+        if (function != Npos) {
+            Instruction ret{ Opcode::Return, {}, {}, {}, function, Npos };
+            code_.push_back(ret);
+            quadruple_of_.push_back(Npos);
+            functions_[function].frame_size = frame_size_;
+        }
+        for (int* index : frame_operands_) {
+            *index = Npos;
+        }
+        frame_operands_.clear();
+        frame_size_ = 0;
+    }
+
+    void
+    Decode() {
+        const auto& quadruples = semantic_.quadruples();
+        int         functions  = 0;
+        int         max_label  = 0;
+        for (const auto& qua : quadruples) {
+            if (qua.operate == Opcode::FunBegin || qua.operate == Opcode::Call) {
+                functions = qua.arg_1.id + 1 > functions ? qua.arg_1.id + 1 : functions;
+            }
+            max_label = qua.label > max_label ? qua.label : max_label;
+        }
+        functions_.assign(functions, Function{ Npos, Npos, 0, Location{ 0, Npos }, {}, {} });
+        statics_.assign(semantic_.variable_count(), Value());
+        constants_.clear();
+        var_index_.assign(semantic_.variable_count(), Npos);
+        temp_index_.assign(semantic_.temp_count(), Npos);
+        frame_size_ = 0;
+        code_.clear();
+        code_.reserve(quadruples.size() + functions);
+        quadruple_of_.clear();
+        quadruple_of_.reserve(quadruples.size() + functions);
+
+        /* 四元式 -> 指令下标；函数 -> 隐式返回的指令下标 */
+        std::vector<int> instruction(quadruples.size(), Npos);
+        std::vector<int> function_of(quadruples.size(), Npos);
+        std::vector<int> implicit_return(functions, Npos);
+        int              current = Npos;
+        int              next    = 0;
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            if (quadruples[i].operate == Opcode::FunBegin) {
+                if (current != Npos) {
+                    implicit_return[current] = next++;
+                }
+                current = quadruples[i].arg_1.id;
+            }
+            function_of[i] = current;
+            instruction[i] = next++;
+        }
+        if (current != Npos) {
+            implicit_return[current] = next++;
+        }
+        std::vector<int> label_quad(max_label + 2, Npos);
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            label_quad[quadruples[i].label] = static_cast<int>(i);
+        }
+
+        current = Npos;
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            const auto& qua = quadruples[i];
+            if (qua.operate == Opcode::FunBegin) {
+                FinishFunction(current);
+                current       = qua.arg_1.id;
+                auto& function = functions_[current];
+                function.entry = instruction[i] + 1;
+                function.exit  = implicit_return[current];
+                function.ret_value = StaticLocation(Operand(Operand::Variable, semantic_.ReturnVariable(current)));
+                for (int k = 0; k < semantic_.FunctionInfo(current).parameter_num; ++k) {
+                    Operand formal(Operand::Variable, semantic_.ParameterVariable(current, k));
+                    function.parameters.push_back(Locate(formal, current).index);
+                }
+                if (qua.label == semantic_.main_label()) {
+                    main_ = current;
+                }
+            }
+
+            Instruction ins{ qua.operate, {}, {}, {}, Npos, qua.label };
+            if (ReadsArg1(qua.operate)) {
+                ins.arg_1 = Locate(qua.arg_1, current);
+            }
+            if (ReadsArg2(qua.operate)) {
+                ins.arg_2 = Locate(qua.arg_2, current);
+            }
+            if (DefinesResult(qua.operate)) {
+                ins.result = Locate(qua.result, current);
+            }
+            if (IsJump(qua.operate)) {
+                /* 跳出函数体(包括跳到末尾之后)即返回 */
+                int target = qua.result.id >= 0 && qua.result.id <= max_label ? label_quad[qua.result.id] : Npos;
+                if (target == Npos || function_of[target] != current) {
+                    ins.target = current != Npos ? implicit_return[current] : Npos;
+                } else {
+                    ins.target = instruction[target];
+                }
+            } else if (qua.operate == Opcode::Call) {
+                ins.target = qua.arg_1.id;
+            } else if (qua.operate == Opcode::Return) {
+                ins.target = current;
+            }
+            code_.push_back(ins);
+            quadruple_of_.push_back(static_cast<int>(i));
+        }
+        FinishFunction(current);
+    }
+
+    /* 调用 function：建立新栈帧，从实参栈取出实参写入形参 */
+    bool
+    Enter(int function) {
+        const auto& callee = functions_[function];
+        if (callee.entry == Npos) {
+            std::cerr << "运行错误 : 调用了未定义的函数" << std::endl;
+            return false;
+        }
+        if (static_cast<int>(calls_stack_.size()) >= MaxDepth) {
+            std::cerr << "运行错误 : 调用层数超过上限 " << MaxDepth << std::endl;
+            return false;
+        }
+        size_t base = stack_.size();
+        stack_.resize(base + callee.frame_size, Value());
+        size_t params = callee.parameters.size();
+        for (size_t k = 0; k < params && k < arguments_.size(); ++k) {
+            stack_[base + callee.parameters[k]] = arguments_[arguments_.size() - 1 - k];
+        }
+        arguments_.resize(arguments_.size() > params ? arguments_.size() - params : 0);
+        return true;
+    }
+
+    template <bool Profiling>
+    bool
+    Execute() {
+        stack_.clear();
+        arguments_.clear();
+        calls_stack_.clear();
+        stack_.reserve(1024);
+        if (!Enter(main_)) {
+            return false;
+        }
+        calls_stack_.push_back(CallFrame{ main_, Npos, 0, Location{ 0, Npos } });
+        max_depth_ = 1;
+        if (jit_) {
+            invocations_.assign(functions_.size(), 0);
+            back_edges_.assign(code_.size(), 0);
+        }
+
+        size_t base = 0;
+        Value* frame[3];
+        frame[0] = jit_ ? jit_->variables() : statics_.data();
+        frame[1] = stack_.data();
+        frame[2] = constants_.data();
+        int pc   = functions_[main_].entry;
+#define READ(loc) frame[(loc).frame][(loc).index]
+        while (true) {
+            const Instruction& ins = code_[pc];
+            ++counts_[static_cast<size_t>(ins.operate)];
+            if (Profiling) {
+                if (Profiler::Pending()) {
+                    Sample(pc);
+                }
+                profiler_->Count(pc);
+            }
+            switch (ins.operate) {
+                case Opcode::Nop:
+                case Opcode::FunBegin:
+                    ++pc;
+                    break;
+                case Opcode::Assign:
+                    READ(ins.result) = READ(ins.arg_1);
+                    ++pc;
+                    break;
+                case Opcode::IAdd:
+                case Opcode::ISub:
+                case Opcode::IMul:
+                case Opcode::IDiv:
+                case Opcode::FAdd:
+                case Opcode::FSub:
+                case Opcode::FMul:
+                case Opcode::FDiv:
+                    if (!EvalArith(ins.operate, READ(ins.arg_1), READ(ins.arg_2), READ(ins.result))) {
+                        std::cerr << "运行错误 : 第 " << ins.label << " 条四元式整数除以零或溢出" << std::endl;
+                        return false;
+                    }
+                    ++pc;
+                    break;
+                case Opcode::IntToFloat:
+                case Opcode::FloatToInt:
+                    if (!EvalConvert(ins.operate, READ(ins.arg_1), READ(ins.result))) {
+                        std::cerr << "运行错误 : 第 " << ins.label << " 条四元式浮点数超出整数的表示范围" << std::endl;
+                        return false;
+                    }
+                    ++pc;
+                    break;
+                case Opcode::Jump:
+                    if (jit_ && ins.target <= pc) {
+                        if (!BackEdge(ins.target, pc, frame)) {
+                            return false;
+                        }
+                        break;
+                    }
+                    pc = ins.target;
+                    break;
+                case Opcode::Param:
+                    arguments_.push_back(READ(ins.arg_1));
+                    ++pc;
+                    break;
+                case Opcode::Call:
+                    if (Profiling) {
+                        profiler_->Call(calls_stack_.back().function, ins.target);
+                    }
+                    if (jit_ && IsHot(ins.target)) {
+                        if (!CallNative(ins, frame)) {
+                            return false;
+                        }
+                        ++pc;
+                        break;
+                    }
+                    if (!Enter(ins.target)) {
+                        return false;
+                    }
+                    calls_stack_.push_back(CallFrame{ ins.target, pc + 1, base, ins.result });
+                    ++calls_;
+                    max_depth_ = static_cast<int>(calls_stack_.size()) > max_depth_ ? static_cast<int>(calls_stack_.size())
+                                                                                      : max_depth_;
+                    base     = stack_.size() - functions_[ins.target].frame_size;
+                    frame[1] = stack_.data() + base;
+                    pc       = functions_[ins.target].entry;
+                    break;
+                case Opcode::Return: {
+                    if (ins.label == Npos) {
+                        --counts_[static_cast<size_t>(Opcode::Return)]; /* 隐式返回不计数 */
+                    }
+                    CallFrame call  = calls_stack_.back();
+                    Value     value = READ(functions_[call.function].ret_value);
+                    calls_stack_.pop_back();
+                    stack_.resize(base);
+                    if (calls_stack_.empty()) {
+                        exit_value_ = value;
+                        exit_type_  = SpecifierValueType(semantic_.FunctionInfo(main_).sp_type);
+                        if (exit_type_ == ValueType::Void) {
+                            exit_value_.i = 0;
+                        }
+                        return Finish();
+                    }
+                    base     = call.base;
+                    frame[1] = stack_.data() + base;
+                    if (call.result.index != Npos) {
+                        READ(call.result) = value;
+                    }
+                    pc = call.pc;
+                } break;
+                default:
+                    /* 条件跳转 */
+                    if (!EvalCondition(ins.operate, READ(ins.arg_1), READ(ins.arg_2))) {
+                        ++pc;
+                    } else if (jit_ && ins.target <= pc) {
+                        if (!BackEdge(ins.target, pc, frame)) {
+                            return false;
+                        }
+                    } else {
+                        pc = ins.target;
+                    }
+                    break;
+            }
+        }
+#undef READ
+    }
+
+    /* 剖析：记录当前指令与调用栈上的函数 */
+    void
+    Sample(int pc) {
+        sample_stack_.clear();
+        for (const auto& call : calls_stack_) {
+            sample_stack_.push_back(call.function);
+        }
+        profiler_->Sample(pc, sample_stack_);
+    }
+
+    /* 分层执行：被调函数已经编译，或者这次调用使它的计数达到阈值 */
+    bool
+    IsHot(int function) {
+        if (jit_->IsCompiled(function)) {
+            return true;
+        }
+        if (functions_[function].entry == Npos || ++invocations_[function] < HotCalls) {
+            return false;
+        }
+        ++promoted_calls_;
+        return true;
+    }
+
+    /* 分层执行：以实参栈顶的实参调用被调函数的本机代码，返回值写入结果操作数 */
+    bool
+    CallNative(const Instruction& ins, Value** frame) {
+        if (!jit_->Promote(ins.target)) {
+            return false;
+        }
+        size_t params = functions_[ins.target].parameters.size();
+        native_arguments_.assign(params, Value());
+        for (size_t k = 0; k < params && k < arguments_.size(); ++k) {
+            native_arguments_[k] = arguments_[arguments_.size() - 1 - k];
+        }
+        arguments_.resize(arguments_.size() > params ? arguments_.size() - params : 0);
+        Value result;
+        if (!jit_->Call(ins.target, native_arguments_.data(), static_cast<int>(params), result)) {
+            return false;
+        }
+        ++calls_;
+        ++native_calls_;
+        if (ins.result.index != Npos) {
+            frame[ins.result.frame][ins.result.index] = result;
+        }
+        return true;
+    }
+
+    /**
+     * @brief : 分层执行中跳到循环头 target 的回边。计数达到阈值时编译当前函数，
+     *          以栈帧中的值从循环头的栈上替换入口进入本机代码；函数在本机代码中返回后，从它的隐式返回继续
+     */
+    bool
+    BackEdge(int target, int& pc, Value** frame) {
+        pc = target;
+        if (++back_edges_[target] < HotLoops) {
+            return true;
+        }
+        int function = calls_stack_.back().function;
+        if (!jit_->Promote(function)) {
+            return false;
+        }
+        const auto* entry = jit_->FindOsrEntry(function, code_[target].label);
+        if (!entry) {
+            back_edges_[target] = INT64_MIN; /* 不是本机代码中的循环头，不再尝试 */
+            return true;
+        }
+        const auto& locals = functions_[function].locals;
+        native_arguments_.assign(entry->values.size(), Value());
+        for (size_t k = 0; k < entry->values.size(); ++k) {
+            const auto& value = entry->values[k];
+            for (size_t index = 0; index < locals.size(); ++index) {
+                if (locals[index].kind == value.kind && locals[index].id == value.id) {
+                    native_arguments_[k] = frame[1][index];
+                    break;
+                }
+            }
+        }
+        Value result;
+        if (!jit_->Resume(*entry, native_arguments_.data(), result)) {
+            return false;
+        }
+        pc = functions_[function].exit;
+        return true;
+    }
+
+    /* 汇总执行的指令条数 */
+    bool
+    Finish() {
+        executed_ = 0;
+        for (size_t op = 0; op < counts_.size(); ++op) {
+            if (static_cast<Opcode>(op) != Opcode::FunBegin) {
+                executed_ += counts_[op];
+            }
+        }
+        return true;
+    }
+
+    const Semantic& semantic_;
+    Jit*            jit_;      /* 分层执行的即时编译器 */
+    Profiler*       profiler_; /* 剖析器 */
+
+    std::vector<Instruction> code_;           /* 译码后的指令 */
+    std::vector<int>         quadruple_of_;   /* 指令 -> 四元式下标，隐式返回为 Npos */
+    std::vector<Function>    functions_;      /* 函数(全局符号表中的位置) -> 译码后的函数 */
+    std::vector<Value>       statics_;        /* 全局区：变量(按编号)，分层执行时使用即时编译器的全局区 */
+    std::vector<Value>       constants_;      /* 常量区 */
+    std::vector<int>         var_index_;      /* 译码时：变量 -> 当前函数栈帧中的下标 */
+    std::vector<int>         temp_index_;     /* 译码时：临时变量 -> 当前函数栈帧中的下标 */
+    std::vector<int*>        frame_operands_; /* 译码时：当前函数已分配下标的项，函数结束时清除 */
+    int                      frame_size_;     /* 译码时：当前函数的栈帧大小 */
+    int                      main_;           /* main 函数 */
+
+    std::vector<Value>     stack_;        /* 所有栈帧 */
+    std::vector<Value>     arguments_;    /* 实参栈 */
+    std::vector<CallFrame> calls_stack_;  /* 调用栈 */
+    std::vector<int>       sample_stack_; /* 剖析：采样时调用栈上的函数 */
+
+    std::vector<uint64_t> invocations_;      /* 分层执行：函数 -> 解释执行的调用次数 */
+    std::vector<int64_t>  back_edges_;       /* 分层执行：循环头的指令下标 -> 经回边到达的次数 */
+    std::vector<Value>    native_arguments_; /* 分层执行：进入本机代码时的实参或栈上替换的值 */
+    uint64_t              promoted_calls_ = 0;
+    uint64_t              native_calls_   = 0;
+
+    std::vector<uint64_t> counts_;      /* 操作码 -> 执行次数 */
+    uint64_t              executed_;    /* 执行的指令条数 */
+    uint64_t              calls_;       /* 调用次数 */
+    int                   max_depth_;   /* 最大调用层数 */
+    double                millisecond_; /* 执行用时 */
+    Value                 exit_value_;  /* main 的返回值 */
+    ValueType             exit_type_;   /* main 的返回类型 */
+};
+
+constexpr int Interpreter::Npos;
+constexpr int Interpreter::MaxDepth;
+constexpr int Interpreter::HotCalls;
+constexpr int Interpreter::HotLoops;
+
+#endif // !_INTERPRETER_HPP_
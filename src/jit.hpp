@@ -0,0 +1,721 @@
+/**
+ * @file jit.hpp
+ * @brief 即时编译：在进程内把四元式按需编译为 x86-64 机器码并直接执行
+ */
+
+#ifndef _JIT_HPP_
+#define _JIT_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./native.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+#include "./x86_64.hpp"
+#include "./x86_encoder.hpp"
+
+/* 生成的代码与运行时桩只适用于 x86-64 Linux(System V 调用约定、ucontext 中的 rip) */
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED 1
+#include <csetjmp>
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+/**
+ * @brief 即时编译器
+ *        机器代码由 NativeCompiler 生成、X86Encoder 编码，安装在一块预留的地址空间中：
+ *          数据页(可读写) - 全局区(每个变量 8 字节)，其后是函数入口表 table[f]；
+ *          代码区(写入时可读写，安装后只读可执行) - 运行时桩与逐个安装的函数，函数的浮点常量紧跟其代码。
+ *        每个函数有一个固定的桩 jmp *table[f](%rip)，调用一律经由桩；table[f] 起初指向惰性入口，
+ *        第一次调用时经蹦床进入 CompileEntry 编译并安装该函数，再把 table[f] 改为函数的代码，
+ *        蹦床保存并恢复参与分配的寄存器，因此对调用者透明。
+ *        生成的代码在单独分配的栈上执行，栈底有保护页：
+ *        SIGFPE(整数除以零或溢出)、保护页上的 SIGSEGV(调用层数过多)与其它非法访问都报告为运行错误。
+ *        执行期间以 SIGPROF 按固定间隔采样 rip，估计每个函数的自身执行时间
+ */
+class Jit {
+public:
+    static constexpr int Npos = -1;
+
+    /* 代码区预留的大小 */
+    static constexpr size_t CodeCapacity = size_t(64) << 20;
+
+    /* 执行栈的大小，不含栈底的保护区 */
+    static constexpr size_t StackSize = size_t(256) << 20;
+
+    /* 栈底保护区的大小，大于任何一个栈帧 */
+    static constexpr size_t GuardSize = size_t(1) << 20;
+
+    /* 采样间隔(微秒) */
+    static constexpr int SampleInterval = 1000;
+
+    /**
+     * @brief 一个函数的编译与执行统计
+     */
+    struct FunctionStats {
+        int      function;            /* 函数在全局符号表中的位置 */
+        uint32_t bytes;               /* 机器码与常量的字节数 */
+        double   compile_millisecond; /* 编译、编码与安装用时 */
+        uint64_t samples;             /* 落在该函数代码中的采样数 */
+    };
+
+    /**
+     * @param osr   : 是否为每个循环头生成栈上替换的入口(分层执行从解释器进入循环时使用)
+     * @param lanes : 循环向量化的 lane 数，0 为不向量化(见 NativeCompiler)
+     */
+    explicit Jit(const Semantic& semantic, bool osr = false, int lanes = 0)
+        : semantic_(semantic), native_(semantic, osr, lanes) {
+        exit_value_.i = 0;
+    }
+
+    ~Jit() {
+#if JIT_SUPPORTED
+        if (region_) {
+            munmap(region_, region_size_);
+        }
+        if (stack_) {
+            munmap(stack_, StackSize + GuardSize);
+        }
+#endif
+    }
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    /**
+     * @brief 栈上替换的入口
+     */
+    struct OsrEntry {
+        int                  label;   /* 循环头四元式的标号 */
+        uintptr_t            address; /* 入口代码的地址 */
+        std::vector<Operand> values;  /* 进入时依次装入的临时变量与局部变量 */
+    };
+
+    /**
+     * @brief  : 从 main 开始执行，函数在第一次被调用时编译
+     * @return : 没有 main、平台不支持或发生运行错误时返回 false
+     */
+    bool
+    Run() {
+        if (!Start()) {
+            return false;
+        }
+        int main = native_.main_function();
+        if (main == Npos) {
+            Stop();
+            std::cerr << "运行错误 : 未找到 main 函数" << std::endl;
+            return false;
+        }
+        Value result;
+        auto  start  = std::chrono::steady_clock::now();
+        bool  ok     = Call(main, nullptr, 0, result);
+        auto  finish = std::chrono::steady_clock::now();
+        Stop();
+        millisecond_ = std::chrono::duration<double, std::milli>(finish - start).count() - compile_millisecond_;
+        if (!ok) {
+            return false;
+        }
+        main_type_ = SpecifierValueType(semantic_.FunctionInfo(main).sp_type);
+        if (main_type_ != ValueType::Void) {
+            exit_value_ = variables()[semantic_.ReturnVariable(main)];
+        }
+        return true;
+    }
+
+    /**
+     * @brief  : 准备执行：寄存器分配，预留代码区与数据页，生成运行时桩，安装信号处理与采样。
+     *           之后可以由 Call 与 Resume 多次进入生成的代码，最后由 Stop 结束
+     * @return : 平台不支持或无法分配内存时返回 false
+     */
+    bool
+    Start() {
+#if JIT_SUPPORTED
+        native_.Prepare();
+        if (!Map()) {
+            return false;
+        }
+        BuildRuntime();
+        Active() = this;
+        InstallHandlers();
+        return true;
+#else
+        std::cerr << "运行错误 : 即时编译只支持 x86-64 Linux" << std::endl;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief : 停止采样，恢复信号处理，汇总编译用时
+     */
+    void
+    Stop() {
+#if JIT_SUPPORTED
+        RestoreHandlers();
+        Active() = nullptr;
+#endif
+        compile_millisecond_ = 0;
+        for (const auto& stats : stats_) {
+            compile_millisecond_ += stats.compile_millisecond;
+        }
+    }
+
+    /**
+     * @brief : 全局区，按变量编号存放全局变量与返回值变量，与生成的代码共享(解释器也可以直接读写)
+     */
+    Value*
+    variables() {
+#if JIT_SUPPORTED
+        return reinterpret_cast<Value*>(data_);
+#else
+        return nullptr;
+#endif
+    }
+
+    /* 函数是否已经编译 */
+    bool
+    IsCompiled(int function) const {
+#if JIT_SUPPORTED
+        return ranges_[function].begin != 0;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief  : 立即编译函数(已经编译的函数不变)
+     * @return : 函数没有定义或代码区已满时返回 false
+     */
+    bool
+    Promote(int function) {
+#if JIT_SUPPORTED
+        if (IsCompiled(function) || Compile(function)) {
+            return true;
+        }
+        std::cerr << "运行错误 : " << error_ << std::endl;
+#endif
+        return false;
+    }
+
+    /* 已编译的函数在循环头 label 的栈上替换入口，没有时为 nullptr */
+    const OsrEntry*
+    FindOsrEntry(int function, int label) const {
+        for (const auto& entry : osr_entries_[function]) {
+            if (entry.label == label) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief  : 以 count 个实参(第 k 个为 arguments[k])调用函数，直到它返回
+     * @return : 发生运行错误时返回 false；result 为返回值(void 函数无意义)
+     */
+    bool
+    Call(int function, const Value* arguments, int count, Value& result) {
+#if JIT_SUPPORTED
+        uintptr_t sp = (reinterpret_cast<uintptr_t>(stack_) + GuardSize + StackSize - 8 * count) & ~uintptr_t(15);
+        if (count) {
+            memcpy(reinterpret_cast<void*>(sp), arguments, 8 * static_cast<size_t>(count));
+        }
+        return Enter(stub_[function], sp, nullptr, result);
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief  : 从栈上替换的入口进入函数的循环头，values[k] 为 entry.values[k] 的当前值，执行到函数返回
+     * @return : 发生运行错误时返回 false；result 为返回值
+     */
+    bool
+    Resume(const OsrEntry& entry, const Value* values, Value& result) {
+#if JIT_SUPPORTED
+        ++resumes_;
+        return Enter(entry.address, (reinterpret_cast<uintptr_t>(stack_) + GuardSize + StackSize), values, result);
+#else
+        return false;
+#endif
+    }
+
+    /* 栈上替换的次数 */
+    uint64_t
+    resumes() const {
+        return resumes_;
+    }
+
+    /* main 的返回值，void 的 main 为 0 */
+    Value
+    exit_value() const {
+        return exit_value_;
+    }
+
+    /* 执行用时(不含编译) */
+    double
+    millisecond() const {
+        return millisecond_;
+    }
+
+    /* 所有函数的编译用时之和 */
+    double
+    compile_millisecond() const {
+        return compile_millisecond_;
+    }
+
+    /* 按编译顺序的各函数统计 */
+    const std::vector<FunctionStats>&
+    stats() const {
+        return stats_;
+    }
+
+    /* 生成机器代码的本机代码生成器(含向量化的结果) */
+    const NativeCompiler&
+    native() const {
+        return native_;
+    }
+
+    /**
+     * @brief : 输出退出值、编译与执行用时，以及每个函数的代码大小、编译用时与按采样估计的执行用时
+     */
+    void
+    Print(std::ostream& os) const {
+        uint32_t bytes = 0;
+        for (const auto& stats : stats_) {
+            bytes += stats.bytes;
+        }
+        auto flags     = os.flags();
+        auto precision = os.precision();
+        os << "\n 即时编译执行：main 返回 ";
+        if (main_type_ == ValueType::Float) {
+            os << exit_value_.f;
+        } else {
+            os << exit_value_.i;
+        }
+        os << "；编译 " << stats_.size() << " 个函数共 " << bytes << " 字节，编译用时 " << compile_millisecond_ << " ms，执行用时 "
+           << millisecond_ << " ms。" << std::endl;
+        os.flags(flags);
+        os.precision(precision);
+        PrintFunctions(os, millisecond_);
+    }
+
+    /**
+     * @brief : 输出每个函数的代码大小、编译用时、采样数，以及按采样占比从 millisecond 中估计的自身用时
+     */
+    void
+    PrintFunctions(std::ostream& os, double millisecond) const {
+        uint64_t samples = other_samples_;
+        for (const auto& stats : stats_) {
+            samples += stats.samples;
+        }
+        auto flags     = os.flags();
+        auto precision = os.precision();
+        os << "\t " << std::left << std::setw(16) << "function" << std::right << std::setw(10) << "bytes" << std::setw(14)
+           << "compile(ms)" << std::setw(10) << "samples" << std::setw(12) << "self(ms)" << std::setw(10) << "share"
+           << std::endl;
+        for (const auto& stats : stats_) {
+            double share = samples ? double(stats.samples) / samples : 0;
+            os << "\t " << std::left << std::setw(16) << native_.program().function_symbols[stats.function] << std::right
+               << std::setw(10) << stats.bytes << std::fixed << std::setprecision(3) << std::setw(14)
+               << stats.compile_millisecond << std::setw(10) << stats.samples << std::setw(12) << share * millisecond
+               << std::setprecision(1) << std::setw(9) << share * 100 << "%" << std::endl;
+        }
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+private:
+#if JIT_SUPPORTED
+    /* 当前正在执行的即时编译器，供信号处理函数使用 */
+    static Jit*&
+    Active() {
+        static Jit* active = nullptr;
+        return active;
+    }
+
+    static size_t
+    PageSize() {
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return page;
+    }
+
+    static size_t
+    RoundUp(size_t size, size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+     * @brief : 预留数据页与代码区，分配执行栈
+     */
+    bool
+    Map() {
+        const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+        variables_      = semantic_.variable_count();
+        functions_      = static_cast<int>(native_.program().function_symbols.size());
+        data_size_      = RoundUp(8 * static_cast<size_t>(variables_ + functions_) + 8, PageSize());
+        region_size_    = data_size_ + CodeCapacity;
+        void* region    = mmap(nullptr, region_size_, PROT_NONE, flags, -1, 0);
+        void* stack     = mmap(nullptr, StackSize + GuardSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+        region_         = region == MAP_FAILED ? nullptr : static_cast<uint8_t*>(region);
+        stack_          = stack == MAP_FAILED ? nullptr : static_cast<uint8_t*>(stack);
+        if (!region_ || !stack_ || mprotect(region_, data_size_, PROT_READ | PROT_WRITE)
+            || mprotect(stack_, GuardSize, PROT_NONE)) {
+            std::cerr << "运行错误 : 无法为即时编译分配内存" << std::endl;
+            return false;
+        }
+        data_      = reinterpret_cast<int64_t*>(region_);
+        code_      = region_ + data_size_;
+        code_used_ = 0;
+        stub_.assign(functions_, 0);
+        ranges_.assign(functions_, Range{ 0, 0 });
+        samples_.assign(functions_, 0);
+        other_samples_ = 0;
+        osr_entries_.assign(functions_, std::vector<OsrEntry>());
+        resumes_ = 0;
+        stats_.clear();
+        stats_.reserve(functions_);
+        return true;
+    }
+
+    /* 桩、惰性入口与蹦床中用到的标号 */
+    static int32_t
+    StubLabel(int function) {
+        return 2 + 2 * function;
+    }
+
+    static int32_t
+    LazyLabel(int function) {
+        return 3 + 2 * function;
+    }
+
+    /**
+     * @brief : 生成运行时桩：
+     *          thunk(entry, stack, buffer) - 切换到执行栈后调用 entry(rdx 原样传给栈上替换的入口)，返回时恢复原来的栈；
+     *          蹦床                        - 保存参与分配的寄存器，调用 CompileEntry(this, rax)，恢复后跳到它返回的地址；
+     *          每个函数的桩与惰性入口      - jmp *table[f](%rip) 与 mov $f, %rax; jmp 蹦床
+     */
+    void
+    BuildRuntime() {
+        std::vector<X86Instruction> code;
+        auto emit = [&](X86Op op, const X86Operand& dst = X86Operand(), const X86Operand& src = X86Operand()) {
+            code.push_back(X86Instruction{ op, Cond::O, dst, src });
+        };
+        auto label = [](int32_t index) {
+            return X86Operand(X86Operand::Label, 0, index);
+        };
+        const auto rax = GprOperand(Gpr::Rax);
+        const auto rbp = GprOperand(Gpr::Rbp);
+        const auto rsp = GprOperand(Gpr::Rsp);
+
+        emit(X86Op::Label, label(0));
+        emit(X86Op::Push, rbp);
+        emit(X86Op::Mov, rbp, rsp);
+        emit(X86Op::Mov, rsp, GprOperand(Gpr::Rsi));
+        emit(X86Op::Call, GprOperand(Gpr::Rdi));
+        emit(X86Op::Leave);
+        emit(X86Op::Ret);
+
+        std::vector<X86Operand> saved;
+        for (int id = 0; id < NativeCompiler::Registers - RegisterAllocation::ScratchRegisters; ++id) {
+            saved.push_back(GprOperand(NativeCompiler::IntRegister(id)));
+            saved.push_back(XmmOperand(NativeCompiler::FloatRegister(id)));
+        }
+        emit(X86Op::Label, label(1));
+        emit(X86Op::Push, rbp);
+        emit(X86Op::Mov, rbp, rsp);
+        emit(X86Op::Sub, rsp, ImmediateOperand(8 * static_cast<int64_t>(saved.size())));
+        for (size_t k = 0; k < saved.size(); ++k) {
+            auto slot = MemoryOperand(Gpr::Rbp, -8 * static_cast<int32_t>(k + 1));
+            emit(saved[k].kind == X86Operand::Xmm ? X86Op::MovSd : X86Op::Mov, slot, saved[k]);
+        }
+        /* 生成的代码不保持栈的 16 字节对齐，调用 C++ 函数前对齐 */
+        emit(X86Op::And, rsp, ImmediateOperand(-16));
+        emit(X86Op::Mov, GprOperand(Gpr::Rsi), rax);
+        emit(X86Op::Mov, GprOperand(Gpr::Rdi), ImmediateOperand(static_cast<int64_t>(reinterpret_cast<uintptr_t>(this))));
+        emit(X86Op::Mov, rax, ImmediateOperand(static_cast<int64_t>(reinterpret_cast<uintptr_t>(&CompileEntry))));
+        emit(X86Op::Call, rax);
+        for (size_t k = 0; k < saved.size(); ++k) {
+            auto slot = MemoryOperand(Gpr::Rbp, -8 * static_cast<int32_t>(k + 1));
+            emit(saved[k].kind == X86Operand::Xmm ? X86Op::MovSd : X86Op::Mov, saved[k], slot);
+        }
+        emit(X86Op::Leave);
+        emit(X86Op::Jmp, rax);
+
+        for (int f = 0; f < functions_; ++f) {
+            emit(X86Op::Label, label(StubLabel(f)));
+            emit(X86Op::Jmp, X86Operand(X86Operand::Global, 0, variables_ + f));
+            emit(X86Op::Label, label(LazyLabel(f)));
+            emit(X86Op::Mov, rax, ImmediateOperand(f));
+            emit(X86Op::Jmp, label(1));
+        }
+
+        X86Encoder encoder;
+        encoder.Encode(code);
+        uint8_t* base = Install(encoder, std::vector<int32_t>());
+        thunk_        = reinterpret_cast<uintptr_t>(base);
+        for (int f = 0; f < functions_; ++f) {
+            uintptr_t lazy        = reinterpret_cast<uintptr_t>(base + encoder.label_offset(LazyLabel(f)));
+            stub_[f]              = reinterpret_cast<uintptr_t>(base + encoder.label_offset(StubLabel(f)));
+            data_[variables_ + f] = static_cast<int64_t>(lazy);
+        }
+    }
+
+    /**
+     * @brief : 把编码好的代码连同它用到的浮点常量(按 constants 的顺序紧跟代码)复制到代码区并回填地址
+     * @return : 代码在代码区中的地址，代码区已满时为 nullptr
+     */
+    uint8_t*
+    Install(const X86Encoder& encoder, const std::vector<int32_t>& constants) {
+        const auto& bytes = encoder.bytes();
+        size_t      pool  = RoundUp(bytes.size(), 8);
+        size_t      size  = RoundUp(pool + 8 * constants.size(), PageSize());
+        if (code_used_ + size > CodeCapacity) {
+            return nullptr;
+        }
+        uint8_t* base = code_ + code_used_;
+        if (mprotect(base, size, PROT_READ | PROT_WRITE)) {
+            return nullptr;
+        }
+        code_used_ += size;
+        memcpy(base, bytes.data(), bytes.size());
+        const auto& values = native_.program().constants;
+        for (size_t k = 0; k < constants.size(); ++k) {
+            memcpy(base + pool + 8 * k, &values[constants[k]], 8);
+        }
+        for (const auto& fixup : encoder.fixups()) {
+            uintptr_t target = 0;
+            if (fixup.kind == X86Operand::Global) {
+                target = reinterpret_cast<uintptr_t>(data_ + fixup.index);
+            } else if (fixup.kind == X86Operand::Constant) {
+                size_t k = 0;
+                while (constants[k] != fixup.index) {
+                    ++k;
+                }
+                target = reinterpret_cast<uintptr_t>(base + pool + 8 * k);
+            } else {
+                target = stub_[fixup.index];
+            }
+            int32_t relative = static_cast<int32_t>(target - reinterpret_cast<uintptr_t>(base + fixup.next));
+            memcpy(base + fixup.offset, &relative, 4);
+        }
+        mprotect(base, size, PROT_READ | PROT_EXEC);
+        return base;
+    }
+
+    /**
+     * @brief : 经 thunk 进入生成的代码，运行错误时由信号处理函数或 CompileEntry 跳回这里
+     */
+    bool
+    Enter(uintptr_t entry, uintptr_t sp, const Value* buffer, Value& result) {
+        using Thunk = int64_t (*)(uintptr_t, uintptr_t, const Value*);
+        error_      = nullptr;
+        if (sigsetjmp(escape_, 0) == 0) {
+            result.i = reinterpret_cast<Thunk>(thunk_)(entry, sp, buffer);
+            return true;
+        }
+        std::cerr << "运行错误 : " << error_ << std::endl;
+        return false;
+    }
+
+    /**
+     * @brief : 蹦床调用的编译入口，返回函数的代码地址；失败时直接跳出执行
+     */
+    static uintptr_t
+    CompileEntry(Jit* jit, int64_t function) {
+        uintptr_t address = jit->Compile(static_cast<int>(function));
+        if (!address) {
+            siglongjmp(jit->escape_, 1);
+        }
+        return address;
+    }
+
+    /**
+     * @brief : 编译、编码并安装函数，把入口表指向它
+     * @return : 函数的代码地址，失败时为 0 并设置 error_
+     */
+    uintptr_t
+    Compile(int function) {
+        auto start = std::chrono::steady_clock::now();
+        int  index = native_.Compile(function);
+        if (index == Npos) {
+            error_ = "调用了未定义的函数";
+            return 0;
+        }
+        X86Encoder encoder;
+        encoder.Encode(native_.program().functions[index].code);
+        std::vector<int32_t> constants;
+        for (const auto& fixup : encoder.fixups()) {
+            if (fixup.kind == X86Operand::Constant
+                && std::find(constants.begin(), constants.end(), fixup.index) == constants.end()) {
+                constants.push_back(fixup.index);
+            }
+        }
+        uint8_t* base = Install(encoder, constants);
+        if (!base) {
+            error_ = "即时编译的代码区已满";
+            return 0;
+        }
+        for (const auto& entry : native_.program().functions[index].osr_entries) {
+            uintptr_t address = reinterpret_cast<uintptr_t>(base + encoder.label_offset(entry.entry));
+            osr_entries_[function].push_back(OsrEntry{ entry.label, address, entry.values });
+        }
+        uintptr_t begin              = reinterpret_cast<uintptr_t>(base);
+        ranges_[function]            = Range{ begin, begin + encoder.bytes().size() };
+        data_[variables_ + function] = static_cast<int64_t>(begin);
+        auto     finish = std::chrono::steady_clock::now();
+        uint32_t bytes  = static_cast<uint32_t>(RoundUp(encoder.bytes().size(), 8) + 8 * constants.size());
+        stats_.push_back(
+            FunctionStats{ function, bytes, std::chrono::duration<double, std::milli>(finish - start).count(), 0 });
+        return reinterpret_cast<uintptr_t>(base);
+    }
+
+    /**
+     * @brief : 在备用信号栈上处理执行中的异常，并开始采样
+     */
+    void
+    InstallHandlers() {
+        signal_stack_.resize(1 << 16);
+        stack_t alternate;
+        alternate.ss_sp    = signal_stack_.data();
+        alternate.ss_size  = signal_stack_.size();
+        alternate.ss_flags = 0;
+        sigaltstack(&alternate, &old_stack_);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        sigemptyset(&action.sa_mask);
+        /* 处理函数用 siglongjmp 跳出而不恢复信号掩码，因此处理期间不屏蔽该信号 */
+        action.sa_flags     = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+        action.sa_sigaction = OnFault;
+        sigaction(SIGSEGV, &action, &old_actions_[0]);
+        sigaction(SIGBUS, &action, &old_actions_[1]);
+        sigaction(SIGFPE, &action, &old_actions_[2]);
+        action.sa_flags     = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+        action.sa_sigaction = OnSample;
+        sigaction(SIGPROF, &action, &old_actions_[3]);
+
+        struct itimerval timer;
+        timer.it_interval.tv_sec  = 0;
+        timer.it_interval.tv_usec = SampleInterval;
+        timer.it_value            = timer.it_interval;
+        setitimer(ITIMER_PROF, &timer, &old_timer_);
+    }
+
+    void
+    RestoreHandlers() {
+        setitimer(ITIMER_PROF, &old_timer_, nullptr);
+        sigaction(SIGSEGV, &old_actions_[0], nullptr);
+        sigaction(SIGBUS, &old_actions_[1], nullptr);
+        sigaction(SIGFPE, &old_actions_[2], nullptr);
+        sigaction(SIGPROF, &old_actions_[3], nullptr);
+        sigaltstack(&old_stack_, nullptr);
+        for (auto& stats : stats_) {
+            stats.samples = samples_[stats.function];
+        }
+    }
+
+    /* 地址是否在代码区中 */
+    bool
+    InCode(uintptr_t address) const {
+        return address >= reinterpret_cast<uintptr_t>(code_) && address < reinterpret_cast<uintptr_t>(code_ + code_used_);
+    }
+
+    static void
+    OnFault(int signal, siginfo_t* info, void* context) {
+        Jit*      jit = Active();
+        uintptr_t rip = static_cast<uintptr_t>(static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP]);
+        uintptr_t address = reinterpret_cast<uintptr_t>(info->si_addr);
+        uintptr_t guard   = jit ? reinterpret_cast<uintptr_t>(jit->stack_) : 0;
+        bool      overflow = jit && signal != SIGFPE && address >= guard && address < guard + GuardSize;
+        if (!jit || (!overflow && !jit->InCode(rip))) {
+            /* 不是生成的代码引起的，恢复默认处理后重新触发 */
+            ::signal(signal, SIG_DFL);
+            return;
+        }
+        if (signal == SIGFPE) {
+            jit->error_ = "整数除以零或溢出";
+        } else if (overflow) {
+            jit->error_ = "调用层数过多，执行栈溢出";
+        } else {
+            jit->error_ = "非法的内存访问";
+        }
+        siglongjmp(jit->escape_, 1);
+    }
+
+    static void
+    OnSample(int, siginfo_t*, void* context) {
+        Jit* jit = Active();
+        if (!jit) {
+            return;
+        }
+        uintptr_t rip = static_cast<uintptr_t>(static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP]);
+        for (int f = 0; f < jit->functions_; ++f) {
+            if (rip >= jit->ranges_[f].begin && rip < jit->ranges_[f].end) {
+                ++jit->samples_[f];
+                return;
+            }
+        }
+        ++jit->other_samples_;
+    }
+
+    /**
+     * @brief 函数代码的地址范围
+     */
+    struct Range {
+        uintptr_t begin;
+        uintptr_t end;
+    };
+
+    uint8_t*               region_      = nullptr; /* 数据页与代码区 */
+    size_t                 region_size_ = 0;
+    size_t                 data_size_   = 0;
+    int64_t*               data_        = nullptr; /* 全局区，其后是函数入口表 */
+    uint8_t*               code_        = nullptr; /* 代码区 */
+    size_t                 code_used_   = 0;
+    uint8_t*               stack_       = nullptr; /* 执行栈，最低的 GuardSize 字节为保护区 */
+    uintptr_t              thunk_       = 0;
+    std::vector<uintptr_t> stub_;                  /* 函数 -> 桩的地址 */
+    std::vector<Range>     ranges_;                /* 函数 -> 已安装代码的地址范围 */
+    std::vector<uint64_t>  samples_;               /* 函数 -> 采样数 */
+    std::vector<char>      signal_stack_;
+    stack_t                old_stack_;
+    struct sigaction       old_actions_[4];
+    struct itimerval       old_timer_;
+    sigjmp_buf             escape_;
+    const char*            volatile error_ = nullptr; /* 运行错误，跳出执行前设置 */
+#endif
+
+    const Semantic& semantic_;
+    NativeCompiler  native_;
+
+    int                                variables_           = 0;
+    int                                functions_           = 0;
+    std::vector<FunctionStats>         stats_;
+    std::vector<std::vector<OsrEntry>> osr_entries_;             /* 函数 -> 已编译代码中栈上替换的入口 */
+    uint64_t                           resumes_             = 0; /* 栈上替换的次数 */
+    uint64_t                           other_samples_       = 0; /* 落在运行时桩、解释器与编译器中的采样数 */
+    ValueType                          main_type_           = ValueType::Int;
+    Value                              exit_value_;
+    double                             millisecond_         = 0;
+    double                             compile_millisecond_ = 0;
+};
+
+constexpr int    Jit::Npos;
+constexpr size_t Jit::CodeCapacity;
+constexpr size_t Jit::StackSize;
+constexpr size_t Jit::GuardSize;
+constexpr int    Jit::SampleInterval;
+
+#endif // !_JIT_HPP_
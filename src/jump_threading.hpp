@@ -0,0 +1,258 @@
+/**
+ * @file jump_threading.hpp
+ * @brief 跳转串接与回填产生的分支的窥孔清理
+ */
+
+#ifndef _JUMP_THREADING_HPP_
+#define _JUMP_THREADING_HPP_
+
+#include <vector>
+
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 跳转的窥孔优化，每轮依次：
+ *        1. 串接：跳到 (j, L) 的跳转直接跳到 L (沿链求最终目标并记忆，环上的跳转保持不变)；
+ *           无条件跳转的最终目标是返回四元式时，直接改为返回
+ *        2. 删除跳到下一条四元式的跳转
+ *        3. (j<rel>, L1) (j, L2) L1: 且 (j, L2) 不是跳转目标、条件可以取反时，合并为 (j<!rel>, L2)
+ *        4. 删除无条件跳转、返回之后直到下一个跳转目标或函数入口之间的不可达四元式
+ *        每轮为线性时间，重复至没有变化；最后重新编号标号
+ */
+class JumpThreading {
+public:
+    static constexpr int Npos = -1;
+
+    explicit JumpThreading(Semantic& semantic)
+        : semantic_(semantic), threaded_(0), removed_jumps_(0), merged_(0), unreachable_(0) {}
+
+    /**
+     * @brief  : 执行跳转优化至不动点
+     * @return : 删除的四元式条数
+     */
+    int
+    Run() {
+        auto& quadruples = semantic_.quadruples();
+        int   removed    = 0;
+        bool  changed    = true;
+        while (changed) {
+            BuildIndex();
+            changed = Thread();
+            MarkTargets();
+            changed |= RemoveJumpsToNext();
+            changed |= MergeBranches();
+            changed |= RemoveUnreachable();
+            removed += RemoveNops(quadruples);
+        }
+        semantic_.RenumberLabels();
+        return removed;
+    }
+
+    /* 改为跳到链末尾(或改为返回)的跳转条数 */
+    int
+    threaded() const {
+        return threaded_;
+    }
+
+    /* 删除的跳到下一条的跳转条数 */
+    int
+    removed_jumps() const {
+        return removed_jumps_;
+    }
+
+    /* 合并为一条条件跳转的跳转对数 */
+    int
+    merged() const {
+        return merged_;
+    }
+
+    /* 删除的不可达四元式条数 */
+    int
+    unreachable() const {
+        return unreachable_;
+    }
+
+private:
+    /* 标号 -> 四元式下标，不属于任何四元式的标号为 Npos */
+    void
+    BuildIndex() {
+        const auto& quadruples = semantic_.quadruples();
+        int         max_label  = 0;
+        for (const auto& qua : quadruples) {
+            max_label = qua.label > max_label ? qua.label : max_label;
+        }
+        index_.assign(max_label + 2, Npos);
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            index_[quadruples[i].label] = static_cast<int>(i);
+        }
+    }
+
+    /* 标号所在的四元式下标 */
+    int
+    IndexOf(int label) const {
+        return label >= 0 && label < static_cast<int>(index_.size()) ? index_[label] : Npos;
+    }
+
+    /**
+     * @brief  : 跳到 label 时最终到达的标号：沿无条件跳转链前进，结果记忆在 final_ 中
+     */
+    int
+    Resolve(int label) {
+        const auto& quadruples = semantic_.quadruples();
+        /* 沿链前进，记录经过的标号；遇到环(正在求解的标号)时停在环的入口 */
+        chain_.clear();
+        int current = label;
+        while (true) {
+            int index = IndexOf(current);
+            if (index == Npos || quadruples[index].operate != Opcode::Jump) {
+                break;
+            }
+            if (final_[index] != Npos) {
+                current = final_[index];
+                break;
+            }
+            if (state_[index]) {
+                break;
+            }
+            state_[index] = 1;
+            chain_.push_back(index);
+            current = quadruples[index].result.id;
+        }
+        for (int index : chain_) {
+            final_[index] = current;
+        }
+        return current;
+    }
+
+    bool
+    Thread() {
+        auto& quadruples = semantic_.quadruples();
+        final_.assign(quadruples.size(), Npos);
+        state_.assign(quadruples.size(), 0);
+        bool changed = false;
+        for (auto& qua : quadruples) {
+            if (!IsJump(qua.operate)) {
+                continue;
+            }
+            int target = Resolve(qua.result.id);
+            int index  = IndexOf(target);
+            if (qua.operate == Opcode::Jump && index != Npos && quadruples[index].operate == Opcode::Return) {
+                /* 跳到返回：就地返回 */
+                qua.operate = Opcode::Return;
+                qua.arg_1   = Operand();
+                qua.arg_2   = Operand();
+                qua.result  = quadruples[index].result;
+            } else if (target != qua.result.id) {
+                qua.result.id = target;
+            } else {
+                continue;
+            }
+            ++threaded_;
+            changed = true;
+        }
+        return changed;
+    }
+
+    /* 标记被跳转到的四元式 */
+    void
+    MarkTargets() {
+        const auto& quadruples = semantic_.quadruples();
+        targeted_.assign(quadruples.size(), 0);
+        for (const auto& qua : quadruples) {
+            int index = IsJump(qua.operate) ? IndexOf(qua.result.id) : Npos;
+            if (index != Npos) {
+                targeted_[index] = 1;
+            }
+        }
+    }
+
+    /* 跳转的目标是紧随其后的四元式(或跳到末尾之后的跳转是最后一条) */
+    bool
+    JumpsToNext(int i) const {
+        const auto& quadruples = semantic_.quadruples();
+        int         index      = IndexOf(quadruples[i].result.id);
+        if (index != Npos) {
+            return index == i + 1;
+        }
+        return i + 1 == static_cast<int>(quadruples.size()) && quadruples[i].result.id > quadruples[i].label;
+    }
+
+    bool
+    RemoveJumpsToNext() {
+        auto& quadruples = semantic_.quadruples();
+        bool  changed    = false;
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            if (IsJump(quadruples[i].operate) && JumpsToNext(static_cast<int>(i))) {
+                quadruples[i].operate = Opcode::Nop;
+                ++removed_jumps_;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    bool
+    MergeBranches() {
+        auto& quadruples = semantic_.quadruples();
+        bool  changed    = false;
+        for (size_t i = 0; i + 1 < quadruples.size(); ++i) {
+            auto& branch = quadruples[i];
+            auto& jump   = quadruples[i + 1];
+            if (!IsConditionalJump(branch.operate) || jump.operate != Opcode::Jump || targeted_[i + 1]) {
+                continue;
+            }
+            int index = IndexOf(branch.result.id);
+            bool over = index != Npos ? index == static_cast<int>(i) + 2
+                                      : i + 2 == quadruples.size() && branch.result.id > jump.label;
+            if (!over || !CanInvertJump(branch.operate)) {
+                continue;
+            }
+            branch.operate   = InvertJump(branch.operate);
+            branch.result.id = jump.result.id;
+            jump.operate     = Opcode::Nop;
+            ++merged_;
+            changed = true;
+        }
+        return changed;
+    }
+
+    bool
+    RemoveUnreachable() {
+        auto& quadruples = semantic_.quadruples();
+        bool  changed    = false;
+        bool  dead       = false;
+        for (size_t i = 0; i < quadruples.size(); ++i) {
+            auto& qua = quadruples[i];
+            if (qua.operate == Opcode::FunBegin || targeted_[i]) {
+                dead = false;
+            }
+            if (dead && qua.operate != Opcode::Nop) {
+                qua.operate = Opcode::Nop;
+                ++unreachable_;
+                changed = true;
+                continue;
+            }
+            if (qua.operate == Opcode::Jump || qua.operate == Opcode::Return) {
+                dead = true;
+            }
+        }
+        return changed;
+    }
+
+    Semantic&         semantic_;
+    std::vector<int>  index_;    /* 标号 -> 四元式下标 */
+    std::vector<int>  final_;    /* 无条件跳转四元式 -> 链末尾的标号，未求解为 Npos */
+    std::vector<char> state_;    /* 无条件跳转四元式是否已在求解的链上 */
+    std::vector<int>  chain_;    /* 正在求解的链 */
+    std::vector<char> targeted_; /* 四元式是否为跳转目标 */
+
+    int threaded_;      /* 串接的跳转条数 */
+    int removed_jumps_; /* 删除的跳到下一条的跳转条数 */
+    int merged_;        /* 合并的跳转对数 */
+    int unreachable_;   /* 删除的不可达四元式条数 */
+};
+
+constexpr int JumpThreading::Npos;
+
+#endif // !_JUMP_THREADING_HPP_
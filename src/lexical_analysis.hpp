@@ -19,6 +19,8 @@
 #include <iomanip>
 #include <iostream>
 
+#include "util.hpp"
+
 typedef std::string token_t; // 符号类型
 typedef std::string value_t; // 值类型(标识符名称/常量值等)
 typedef unsigned row_t;      // 行号类型
@@ -46,11 +48,12 @@ const std::set<token_t> All_Tokens = std::move([]() {
 
 /**
  * @brief 词法分析输出的单词类型
+ *        单词符号与具体值均保存为字符串驻留池中的编号
  */
 typedef struct Token {
-  token_t token; // 对应单词符号
-  value_t value; // 该符号的具体值
-  row_t row;     // 所在代码行
+  int token; // 对应单词符号
+  int value; // 该符号的具体值
+  row_t row; // 所在代码行
 } Token;
 
 /**
@@ -58,20 +61,28 @@ typedef struct Token {
  */
 class Lexical {
 private:
-  std::list<Token> token_stream; /* 需要输出的单词流 */
-  std::ifstream fin;             /* 源文件 */
+  std::vector<Token> token_stream; /* 需要输出的单词流 */
+  std::ifstream fin;               /* 源文件 */
+  StringPool &pool;                /* 单词符号/值的驻留池 */
+  row_t lines;                     /* 源文件行数 */
+
+  /* 加入一个单词，符号与值都驻留到池中 */
+  void push(const token_t &token, const std::string &value, row_t row) {
+    this->token_stream.push_back(
+        {this->pool.Intern(token), this->pool.Intern(value), row});
+  }
 
 public:
   Lexical() = delete;
-  Lexical(const std::string &code_path) {
+  Lexical(const std::string &code_path, StringPool &pool)
+      : pool(pool), lines(0) {
     this->fin = std::ifstream(code_path);
   }
   ~Lexical() { this->fin.close(); }
   void scan();
   void print(std::ostream &out = std::cout);
-  std::vector<Token> getTokenStream() {
-    return std::vector<Token>{token_stream.begin(), token_stream.end()};
-  }
+  std::vector<Token> getTokenStream() { return this->token_stream; }
+  row_t getLineCount() const { return this->lines; }
 };
 
 void Lexical::print(std::ostream &out) {
@@ -79,14 +90,19 @@ void Lexical::print(std::ostream &out) {
   out << std::setw(16) << "token value";
   out << std::setw(8) << "row" << std::endl;
   for (const auto &token : this->token_stream) {
-    out << std::setw(16) << token.token;
-    out << std::setw(16) << token.value;
+    out << std::setw(16) << this->pool[token.token];
+    out << std::setw(16) << this->pool[token.value];
     out << std::setw(8) << token.row << std::endl;
   }
 }
 
 void Lexical::scan() {
-  this->fin.seekg(std::ios::beg);
+  /* 按源文件大小预估单词数，预留单词流空间 */
+  this->fin.seekg(0, std::ios::end);
+  auto file_size = this->fin.tellg();
+  if (file_size > 0)
+    this->token_stream.reserve(static_cast<size_t>(file_size) / 4 + 16);
+  this->fin.seekg(0, std::ios::beg);
 
   row_t line = 1;
   char tmp;
@@ -121,10 +137,10 @@ void Lexical::scan() {
       this->fin.seekg(-1, std::ios::cur);
       // 关键字
       if (Keyword.find(buf) != Keyword.cend())
-        this->token_stream.push_back({buf, buf, line});
+        this->push(buf, buf, line);
       // 标识符
       else
-        this->token_stream.push_back({Identifier, buf, line});
+        this->push(Identifier, buf, line);
     }
     // 常量数值
     else if (isdigit(tmp)) {
@@ -154,17 +170,18 @@ void Lexical::scan() {
       this->fin.seekg(-1, std::ios::cur);
       // 浮点数 (暂时只实现 . 小数点形式)
       if (isfloat)
-        this->token_stream.push_back({ConstFloat, buf, line});
+        this->push(ConstFloat, buf, line);
       // 整数
       else
-        this->token_stream.push_back({ConstInt, buf, line});
+        this->push(ConstInt, buf, line);
     }
     // 分隔符
     else if (Separator.find(buf) != Separator.cend()) {
-      this->token_stream.push_back({buf, buf, line});
+      this->push(buf, buf, line);
     }
-    // 运算符
-    else if (Operator.find(buf) != Operator.cend()) {
+    // 运算符 ('&&' 与 '||' 没有单字符形式)
+    else if (Operator.find(buf) != Operator.cend() ||
+             Operator.find(buf + char(this->fin.peek())) != Operator.cend()) {
       tmp = char(this->fin.peek());
       if (this->fin.eof())
         break;
@@ -192,25 +209,26 @@ void Lexical::scan() {
         else if (tmp == '=') {
           buf += '=';
           this->fin.seekg(1, std::ios::cur);
-          this->token_stream.push_back({buf, buf, line});
+          this->push(buf, buf, line);
         }
         // '/' 运算符
         else
-          this->token_stream.push_back({buf, buf, line});
+          this->push(buf, buf, line);
       }
       // 其他双符号长度运算符
       else if (Operator.find(buf + tmp) != Operator.cend()) {
         this->fin.seekg(1, std::ios::cur);
-        this->token_stream.push_back({buf + tmp, buf + tmp, line});
+        this->push(buf + tmp, buf + tmp, line);
       }
       // 其他单符号长度运算符
       else
-        this->token_stream.push_back({buf, buf, line});
+        this->push(buf, buf, line);
     } else {
       std::cout << "第 " << line << " 行，无法识别的单词符号 : " << (int)buf[0]
                 << std::endl;
     }
   }
+  this->lines = line;
 }
 
 #endif // !_LEXICAL_ANALYSIS_HPP_
@@ -0,0 +1,282 @@
+/**
+ * @file liveness.hpp
+ * @brief 变量与临时变量的活跃分析
+ */
+
+#ifndef _LIVENESS_HPP_
+#define _LIVENESS_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 一个函数内的活跃变量分析(逆向数据流)
+ *        函数中出现的变量与临时变量被分配稠密的槽位，活跃集合是以槽位为下标的位集合。
+ *        函数调用读取所有全局变量；返回(以及落出函数末尾)时全局变量和函数的返回值变量活跃
+ */
+class Liveness {
+public:
+    static constexpr int Npos = -1;
+
+    using BitSet = std::vector<uint64_t>;
+
+    Liveness(const Semantic& semantic, const std::vector<Quadruple>& quadruples, const ControlFlowGraph& cfg)
+        : semantic_(semantic),
+          quadruples_(quadruples),
+          cfg_(cfg),
+          var_slot_(semantic.variable_count(), Npos),
+          temp_slot_(semantic.temp_count(), Npos),
+          slot_count_(0),
+          words_(0) {}
+
+    /**
+     * @brief : 计算函数 [first, last) (基本块编号) 的活跃信息，覆盖上一个函数的结果
+     */
+    void
+    Compute(int first, int last) {
+        for (const auto& opd : slot_operands_) {
+            (opd.kind == Operand::Variable ? var_slot_ : temp_slot_)[opd.id] = Npos;
+        }
+        slot_operands_.clear();
+        global_slots_.clear();
+        exit_slots_.clear();
+        first_ = first;
+        last_  = last;
+
+        for (int i = cfg_.begin(first); i < cfg_.end(last - 1); ++i) {
+            AssignSlot(quadruples_[i].arg_1);
+            AssignSlot(quadruples_[i].arg_2);
+            AssignSlot(quadruples_[i].result);
+        }
+        slot_count_ = static_cast<int>(slot_operands_.size());
+        words_      = (slot_count_ + 63) / 64;
+
+        exit_slots_ = global_slots_;
+        const auto& entry = quadruples_[cfg_.begin(first)];
+        if (entry.operate == Opcode::FunBegin) {
+            int ret_slot = Slot(Operand(Operand::Variable, semantic_.ReturnVariable(entry.arg_1.id)));
+            if (ret_slot != Npos) {
+                exit_slots_.push_back(ret_slot);
+            }
+        }
+
+        /* 块内的 use (先于定值的读取) 与 def */
+        int    blocks = last - first;
+        BitSet use(static_cast<size_t>(blocks) * words_, 0), def(static_cast<size_t>(blocks) * words_, 0);
+        for (int b = first; b < last; ++b) {
+            uint64_t* block_use = use.data() + static_cast<size_t>(b - first) * words_;
+            uint64_t* block_def = def.data() + static_cast<size_t>(b - first) * words_;
+            for (int i = cfg_.end(b) - 1; i >= cfg_.begin(b); --i) {
+                const auto& qua  = quadruples_[i];
+                int         slot = DefinesResult(qua.operate) ? Slot(qua.result) : Npos;
+                if (slot != Npos) {
+                    Set(block_def, slot);
+                    Reset(block_use, slot);
+                }
+                ForEachUse(qua, [&](int s) { Set(block_use, s); });
+            }
+        }
+
+        /* 逆序迭代至不动点：out = ∪ in(succ)，in = use ∪ (out - def)；离开函数的块出口处出口槽位活跃 */
+        live_in_.assign(static_cast<size_t>(blocks) * words_, 0);
+        live_out_.assign(static_cast<size_t>(blocks) * words_, 0);
+        for (int b = first; b < last; ++b) {
+            if (IsExit(b)) {
+                for (int s : exit_slots_) {
+                    Set(live_out_.data() + static_cast<size_t>(b - first) * words_, s);
+                }
+            }
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int b = last - 1; b >= first; --b) {
+                uint64_t* out = live_out_.data() + static_cast<size_t>(b - first) * words_;
+                uint64_t* in  = live_in_.data() + static_cast<size_t>(b - first) * words_;
+                for (auto s = cfg_.succ_begin(b); s != cfg_.succ_end(b); ++s) {
+                    const uint64_t* succ_in = live_in_.data() + static_cast<size_t>(*s - first) * words_;
+                    for (int w = 0; w < words_; ++w) {
+                        out[w] |= succ_in[w];
+                    }
+                }
+                const uint64_t* block_use = use.data() + static_cast<size_t>(b - first) * words_;
+                const uint64_t* block_def = def.data() + static_cast<size_t>(b - first) * words_;
+                for (int w = 0; w < words_; ++w) {
+                    uint64_t value = block_use[w] | (out[w] & ~block_def[w]);
+                    if (value != in[w]) {
+                        in[w]   = value;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    int
+    slot_count() const {
+        return slot_count_;
+    }
+
+    /* 位集合的字数 */
+    int
+    words() const {
+        return words_;
+    }
+
+    /* 操作数的槽位，常量等不参与分析的操作数返回 Npos */
+    int
+    Slot(const Operand& opd) const {
+        if (opd.kind == Operand::Variable) {
+            return var_slot_[opd.id];
+        }
+        if (opd.kind == Operand::Temp) {
+            return temp_slot_[opd.id];
+        }
+        return Npos;
+    }
+
+    /* 槽位对应的操作数 */
+    const Operand&
+    slot_operand(int slot) const {
+        return slot_operands_[slot];
+    }
+
+    /* 函数中出现的全局变量的槽位 */
+    const std::vector<int>&
+    global_slots() const {
+        return global_slots_;
+    }
+
+    bool
+    LiveIn(int block, int slot) const {
+        return Test(live_in_.data() + static_cast<size_t>(block - first_) * words_, slot);
+    }
+
+    bool
+    LiveOut(int block, int slot) const {
+        return Test(live_out_.data() + static_cast<size_t>(block - first_) * words_, slot);
+    }
+
+    /* 块入口的活跃集合 */
+    BitSet
+    LiveInSet(int block) const {
+        auto begin = live_in_.begin() + static_cast<size_t>(block - first_) * words_;
+        return BitSet(begin, begin + words_);
+    }
+
+    /* 块出口的活跃集合 */
+    BitSet
+    LiveOutSet(int block) const {
+        auto begin = live_out_.begin() + static_cast<size_t>(block - first_) * words_;
+        return BitSet(begin, begin + words_);
+    }
+
+    /**
+     * @brief : 逆向经过一条四元式：live = (live - def) ∪ use
+     */
+    void
+    Step(const Quadruple& qua, BitSet& live) const {
+        int slot = DefinesResult(qua.operate) ? Slot(qua.result) : Npos;
+        if (slot != Npos) {
+            Reset(live.data(), slot);
+        }
+        ForEachUse(qua, [&](int s) { Set(live.data(), s); });
+    }
+
+    /**
+     * @brief : 四元式读取的每个槽位；调用读取全局变量，返回读取全局变量与返回值变量
+     */
+    template <typename Function>
+    void
+    ForEachUse(const Quadruple& qua, Function f) const {
+        if (ReadsArg1(qua.operate) && Slot(qua.arg_1) != Npos) {
+            f(Slot(qua.arg_1));
+        }
+        if (ReadsArg2(qua.operate) && Slot(qua.arg_2) != Npos) {
+            f(Slot(qua.arg_2));
+        }
+        if (qua.operate == Opcode::Call) {
+            for (int s : global_slots_) {
+                f(s);
+            }
+        } else if (qua.operate == Opcode::Return) {
+            for (int s : exit_slots_) {
+                f(s);
+            }
+        }
+    }
+
+    static bool
+    Test(const uint64_t* set, int slot) {
+        return (set[slot >> 6] >> (slot & 63)) & 1;
+    }
+    static bool
+    Test(const BitSet& set, int slot) {
+        return Test(set.data(), slot);
+    }
+    static void
+    Set(uint64_t* set, int slot) {
+        set[slot >> 6] |= uint64_t(1) << (slot & 63);
+    }
+    static void
+    Reset(uint64_t* set, int slot) {
+        set[slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+    }
+
+private:
+    void
+    AssignSlot(const Operand& opd) {
+        if (opd.kind == Operand::Variable && var_slot_[opd.id] == Npos) {
+            var_slot_[opd.id] = static_cast<int>(slot_operands_.size());
+            if (semantic_.IsGlobalVariable(opd.id)) {
+                global_slots_.push_back(var_slot_[opd.id]);
+            }
+        } else if (opd.kind == Operand::Temp && temp_slot_[opd.id] == Npos) {
+            temp_slot_[opd.id] = static_cast<int>(slot_operands_.size());
+        } else {
+            return;
+        }
+        slot_operands_.push_back(opd);
+    }
+
+    /* 控制从块的末尾离开函数：返回、跳出函数或落出函数末尾 */
+    bool
+    IsExit(int block) const {
+        const auto& last = quadruples_[cfg_.end(block) - 1];
+        if (last.operate == Opcode::Return) {
+            return false; /* 返回四元式本身读取出口活跃的槽位 */
+        }
+        if (IsJump(last.operate)) {
+            int target = cfg_.block_of_label(last.result.id);
+            if (target < first_ || target >= last_) {
+                return true;
+            }
+        }
+        return last.operate != Opcode::Jump && block + 1 == last_;
+    }
+
+    const Semantic&               semantic_;
+    const std::vector<Quadruple>& quadruples_;
+    const ControlFlowGraph&       cfg_;
+
+    std::vector<int>     var_slot_;      /* 变量编号 -> 槽位 */
+    std::vector<int>     temp_slot_;     /* 临时变量编号 -> 槽位 */
+    std::vector<Operand> slot_operands_; /* 槽位 -> 操作数 */
+    std::vector<int>     global_slots_;  /* 全局变量的槽位 */
+    std::vector<int>     exit_slots_;    /* 离开函数时活跃的槽位 */
+    int                  slot_count_;
+    int                  words_;
+    int                  first_; /* 当前函数的第一个块 */
+    int                  last_;  /* 当前函数最后一个块的下一个 */
+
+    BitSet live_in_;  /* 块 b 的入口活跃集合位于 [(b - first_) * words_, (b - first_ + 1) * words_) */
+    BitSet live_out_; /* 块出口活跃集合 */
+};
+
+constexpr int Liveness::Npos;
+
+#endif // !_LIVENESS_HPP_
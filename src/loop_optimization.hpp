@@ -0,0 +1,494 @@
+/**
+ * @file loop_optimization.hpp
+ * @brief 循环优化：循环不变运算外提、归纳变量乘法的强度削弱与循环旋转
+ */
+
+#ifndef _LOOP_OPTIMIZATION_HPP_
+#define _LOOP_OPTIMIZATION_HPP_
+
+#include <algorithm>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./liveness.hpp"
+#include "./profile_data.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 自然循环上的优化，只处理循环体位于连续四元式 [首块, 回边块] 中的循环(while 生成的循环都是如此)
+ *        1. 外提：操作数在循环内不变、结果在循环内只定值一次的运算/复写，若结果在首块入口与循环出口都不活跃，
+ *           或循环已旋转(前置块只在循环至少执行一次时经过)且其所在块支配回边块，移到前置块
+ *        2. 强度削弱：基本归纳变量 i (循环内唯一定值为 i := i ± c) 与常量 k 的乘法 i * k
+ *           改为从新的临时变量 s 复写；s 在前置块中初始化为 i * k，i 每次增加后 s 增加 c * k
+ *        3. 旋转：首块只有可以取反的条件测试时，while 的 (j<!rel>, 出口) ... (j, 首块) 改为
+ *           入口处保留一份测试作为守卫，循环体末尾放取反的测试跳回循环体，每次迭代少一条跳转
+ *        每变换一个循环后重新构造控制流图，内层循环优先；
+ *        给出剖析数据时按首块的执行次数从多到少处理，剖析中未执行的循环不作变换(旋转与外提只增加代码)
+ */
+class LoopOptimization {
+public:
+    static constexpr int Npos = -1;
+
+    explicit LoopOptimization(Semantic& semantic, const ProfileData* profile = nullptr)
+        : semantic_(semantic), profile_(profile), hoisted_(0), reduced_(0), rotated_(0), cold_(0) {}
+
+    /**
+     * @brief  : 对所有循环执行循环优化
+     * @return : 外提、削弱的四元式与旋转的循环总数
+     */
+    int
+    Run() {
+        auto& quadruples = semantic_.quadruples();
+        bool  changed    = true;
+        bool  first      = true;
+        while (changed) {
+            changed = false;
+            ControlFlowGraph cfg(quadruples);
+            Liveness         liveness(semantic_, quadruples, cfg);
+
+            std::vector<int>     order;
+            std::vector<int64_t> count(cfg.loop_count(), 0);
+            for (int l = 0; l < cfg.loop_count(); ++l) {
+                int header = cfg.loop_header(l);
+                count[l]   = profile_ ? profile_->range_count(quadruples, cfg.begin(header), cfg.end(header)) : 0;
+                if (count[l] == 0 && profile_) {
+                    cold_ += first;
+                    continue;
+                }
+                order.push_back(l);
+            }
+            first = false;
+            std::stable_sort(order.begin(), order.end(), [&cfg, &count](int a, int b) {
+                return count[a] != count[b] ? count[a] > count[b] : cfg.loop_depth(a) > cfg.loop_depth(b);
+            });
+
+            int computed = Npos; /* 已计算活跃信息的函数入口块 */
+            for (int loop : order) {
+                Shape shape;
+                if (!Analyze(cfg, loop, shape)) {
+                    continue;
+                }
+                if (shape.first != computed) {
+                    liveness.Compute(shape.first, shape.last);
+                    computed = shape.first;
+                }
+                if (Transform(cfg, liveness, loop, shape)) {
+                    changed = true;
+                    break;
+                }
+            }
+        }
+        return hoisted_ + reduced_ + rotated_;
+    }
+
+    /* 外提的循环不变四元式条数 */
+    int
+    hoisted() const {
+        return hoisted_;
+    }
+
+    /* 改为加法的归纳变量乘法条数 */
+    int
+    reduced() const {
+        return reduced_;
+    }
+
+    /* 旋转的循环个数 */
+    int
+    rotated() const {
+        return rotated_;
+    }
+
+    /* 剖析中未执行而跳过的循环个数 */
+    int
+    cold() const {
+        return cold_;
+    }
+
+private:
+    /**
+     * @brief 循环的布局
+     */
+    struct Shape {
+        int  header;      /* 首块 */
+        int  latch;       /* 回边块，循环的最后一个块 */
+        int  first, last; /* 所在函数的基本块 [first, last) */
+        int  hb, he, le;  /* 首块的四元式 [hb, he)，整个循环 [hb, le) */
+        bool rotate;      /* 首块只有可以取反的条件测试且回边为无条件跳转，可以旋转 */
+    };
+
+    /**
+     * @brief 基本归纳变量 i 与常量因子 k 的乘积 i * k 对应的临时变量
+     */
+    struct Reduction {
+        int     variable; /* 归纳变量的槽位 */
+        Operand factor;   /* 常量 k */
+        Operand temp;     /* 保存 i * k 的临时变量 */
+    };
+
+    /* 块是否属于循环 loop (包括其内层循环) */
+    static bool
+    InLoop(const ControlFlowGraph& cfg, int block, int loop) {
+        for (int l = cfg.block_loop(block); l != Npos; l = cfg.loop_parent(l)) {
+            if (l == loop) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief  : 检查循环是否为可处理的连续布局，并记录其范围
+     */
+    bool
+    Analyze(const ControlFlowGraph& cfg, int loop, Shape& shape) const {
+        const auto& quadruples = semantic_.quadruples();
+        const auto& entries    = cfg.entries();
+        shape.header           = cfg.loop_header(loop);
+        shape.first            = cfg.function_entry(shape.header);
+        auto next_entry        = std::upper_bound(entries.begin(), entries.end(), shape.first);
+        shape.last             = next_entry != entries.end() ? *next_entry : cfg.block_count();
+        if (quadruples[cfg.begin(shape.header)].operate == Opcode::FunBegin) {
+            return false;
+        }
+
+        shape.latch = shape.header;
+        for (int b = shape.header; b < shape.last; ++b) {
+            if (InLoop(cfg, b, loop)) {
+                shape.latch = b;
+            }
+        }
+        /* 范围内可以有不属于循环的块(如 && 条件的假出口)，但循环的块不能在首块之前 */
+        for (int b = shape.first; b < shape.header; ++b) {
+            if (InLoop(cfg, b, loop)) {
+                return false;
+            }
+        }
+        /* 循环内只有回边块跳回首块 */
+        for (auto p = cfg.pred_begin(shape.header); p != cfg.pred_end(shape.header); ++p) {
+            if (InLoop(cfg, *p, loop) && *p != shape.latch) {
+                return false;
+            }
+        }
+
+        shape.hb = cfg.begin(shape.header);
+        shape.he = cfg.end(shape.header);
+        shape.le = cfg.end(shape.latch);
+
+        const auto& test   = quadruples[shape.he - 1];
+        const auto& back   = quadruples[shape.le - 1];
+        int         target = IsJump(test.operate) ? cfg.block_of_label(test.result.id) : Npos;
+        shape.rotate       = shape.header != shape.latch && back.operate == Opcode::Jump
+                       && cfg.block_of_label(back.result.id) == shape.header && CanInvertJump(test.operate)
+                       && (target == Npos || !InLoop(cfg, target, loop));
+        return true;
+    }
+
+    /**
+     * @brief  : 变换一个循环，写回四元式并重新编号标号
+     * @return : 是否作了变换
+     */
+    bool
+    Transform(const ControlFlowGraph& cfg, const Liveness& liveness, int loop, const Shape& shape) {
+        auto& quadruples = semantic_.quadruples();
+        int   slots      = liveness.slot_count();
+        int   hb = shape.hb, he = shape.he, le = shape.le;
+
+        /* 四元式是否属于循环；循环内各槽位的定值次数(范围内的其他块也计入)，有调用时全局变量视为被多次定值 */
+        std::vector<char> in_loop(le - hb);
+        std::vector<int>  defs(slots, 0);
+        bool              has_call = false;
+        for (int i = hb; i < le; ++i) {
+            const auto& qua = quadruples[i];
+            in_loop[i - hb] = InLoop(cfg, cfg.block_of(i), loop);
+            has_call |= qua.operate == Opcode::Call;
+            if (DefinesResult(qua.operate) && liveness.Slot(qua.result) != Npos) {
+                ++defs[liveness.Slot(qua.result)];
+            }
+        }
+        if (has_call) {
+            for (int s : liveness.global_slots()) {
+                defs[s] += 2;
+            }
+        }
+
+        /* 循环的出口：离开循环的边的目标块；除首块外都不离开循环时，出口只在(旋转后的)循环末尾 */
+        std::vector<int> exits;
+        bool             header_exits_only = true;
+        for (int b = shape.header; b <= shape.latch; ++b) {
+            if (!InLoop(cfg, b, loop)) {
+                continue;
+            }
+            const auto& last_quad = quadruples[cfg.end(b) - 1];
+            bool        leaves    = last_quad.operate == Opcode::Return || cfg.succ_count(b) == 0;
+            for (auto s = cfg.succ_begin(b); s != cfg.succ_end(b); ++s) {
+                if (!InLoop(cfg, *s, loop)) {
+                    exits.push_back(*s);
+                    leaves = true;
+                }
+            }
+            if (IsJump(last_quad.operate) && cfg.block_of_label(last_quad.result.id) == Npos) {
+                leaves = true;
+            }
+            if (last_quad.operate != Opcode::Jump && last_quad.operate != Opcode::Return && b + 1 == shape.last) {
+                leaves = true;
+            }
+            header_exits_only &= !leaves || b == shape.header;
+        }
+
+        int         ret_slot = Npos;
+        const auto& entry    = quadruples[cfg.begin(shape.first)];
+        if (entry.operate == Opcode::FunBegin) {
+            ret_slot = liveness.Slot(Operand(Operand::Variable, semantic_.ReturnVariable(entry.arg_1.id)));
+        }
+
+        /* 操作数在循环内不变：常量、循环内没有定值，或只由已外提的四元式定值(fixed 时不允许) */
+        std::vector<char> invariant_slot(slots, 0);
+        auto              invariant = [&](const Operand& opd, bool fixed) {
+            int slot = liveness.Slot(opd);
+            return slot == Npos || defs[slot] == 0 || (!fixed && invariant_slot[slot]);
+        };
+
+        /**
+         * 循环不变运算：按四元式顺序反复标记至不动点。
+         * 旋转时首块的运算留在守卫中、从末尾的测试中删去，守卫算出的值在循环中始终不变，
+         * 只要求操作数在循环内没有定值；循环体中的运算在前置块(守卫之后)执行，
+         * 所在块支配回边块时只要求结果在循环体入口不活跃
+         */
+        std::vector<char> hoisted(le - hb, 0);
+        bool              marked = true;
+        while (marked) {
+            marked = false;
+            for (int i = hb; i < le; ++i) {
+                const auto& qua = quadruples[i];
+                if (!in_loop[i - hb] || hoisted[i - hb]
+                    || !(IsComputation(qua.operate) || qua.operate == Opcode::Assign)) {
+                    continue;
+                }
+                if (qua.operate == Opcode::IDiv && !SafeDivisor(qua.arg_2)) {
+                    continue;
+                }
+                int slot = liveness.Slot(qua.result);
+                if (slot == Npos || slot == ret_slot || defs[slot] != 1
+                    || (qua.result.kind == Operand::Variable && semantic_.IsGlobalVariable(qua.result.id))) {
+                    continue;
+                }
+                bool guard = shape.rotate && i < he;
+                if (!invariant(qua.arg_1, guard) || (ReadsArg2(qua.operate) && !invariant(qua.arg_2, guard))) {
+                    continue;
+                }
+                /* 旋转后守卫先于前置块执行，首块与支配回边块的运算在进入循环时一定会执行 */
+                bool always = guard
+                              || (shape.rotate && header_exits_only && cfg.Dominates(cfg.block_of(i), shape.latch));
+                if (qua.operate == Opcode::FloatToInt && !always && !SafeConversion(qua.arg_1)) {
+                    continue;
+                }
+                bool safe = guard || (always && !liveness.LiveIn(shape.header + 1, slot));
+                if (!safe) {
+                    safe = !liveness.LiveIn(shape.header, slot);
+                    for (int exit : exits) {
+                        safe &= !liveness.LiveIn(exit, slot);
+                    }
+                }
+                if (!safe) {
+                    continue;
+                }
+                hoisted[i - hb]      = 1;
+                invariant_slot[slot] = 1;
+                marked               = true;
+            }
+        }
+
+        /* 基本归纳变量 i := i ± c 及其定值四元式；首块中的定值不处理(旋转后首块被复制) */
+        std::vector<int> induction(slots, Npos);
+        for (int i = he; i < le; ++i) {
+            const auto& qua  = quadruples[i];
+            int         slot = liveness.Slot(qua.result);
+            if (!in_loop[i - hb] || hoisted[i - hb] || slot == Npos || defs[slot] != 1 || qua.result.type != ValueType::Int
+                || (qua.result.kind == Operand::Variable && semantic_.IsGlobalVariable(qua.result.id))) {
+                continue;
+            }
+            bool add = qua.operate == Opcode::IAdd
+                       && ((qua.arg_1 == qua.result && qua.arg_2.kind == Operand::Constant)
+                           || (qua.arg_2 == qua.result && qua.arg_1.kind == Operand::Constant));
+            bool sub = qua.operate == Opcode::ISub && qua.arg_1 == qua.result && qua.arg_2.kind == Operand::Constant;
+            if (add || sub) {
+                induction[slot] = i;
+            }
+        }
+
+        /* 归纳变量与常量的乘法 */
+        std::vector<Reduction> reductions;
+        std::vector<int>       reduced_quad(le - hb, Npos); /* 四元式 -> 替换它的 Reduction */
+        for (int i = he; i < le; ++i) {
+            const auto& qua = quadruples[i];
+            if (!in_loop[i - hb] || hoisted[i - hb] || qua.operate != Opcode::IMul) {
+                continue;
+            }
+            const Operand* variable = &qua.arg_1;
+            const Operand* factor   = &qua.arg_2;
+            if (factor->kind != Operand::Constant) {
+                std::swap(variable, factor);
+            }
+            int slot = liveness.Slot(*variable);
+            if (factor->kind != Operand::Constant || slot == Npos || induction[slot] == Npos) {
+                continue;
+            }
+            int r = 0;
+            while (r < static_cast<int>(reductions.size())
+                   && (reductions[r].variable != slot || reductions[r].factor != *factor)) {
+                ++r;
+            }
+            if (r == static_cast<int>(reductions.size())) {
+                reductions.push_back({ slot, *factor, semantic_.GetNewTmpVar(ValueType::Int) });
+            }
+            reduced_quad[i - hb] = r;
+        }
+
+        int hoist_count  = static_cast<int>(std::count(hoisted.begin(), hoisted.end(), 1));
+        int reduce_count = static_cast<int>(le - hb - std::count(reduced_quad.begin(), reduced_quad.end(), Npos));
+        if (hoist_count == 0 && reduce_count == 0 && !shape.rotate) {
+            return false;
+        }
+
+        int next_label = 0;
+        for (const auto& qua : quadruples) {
+            next_label = qua.label > next_label ? qua.label : next_label;
+        }
+        int end_label = next_label + 1; /* 末尾之后 */
+        next_label += 2;
+
+        /* 前置块：外提的四元式按原顺序，其后初始化强度削弱的临时变量 */
+        std::vector<Quadruple> preheader;
+        for (int i = shape.rotate ? he : hb; i < le; ++i) { /* 旋转时首块的外提运算留在守卫中 */
+            if (hoisted[i - hb]) {
+                preheader.push_back(quadruples[i]);
+                preheader.back().label = next_label++;
+            }
+        }
+        for (const auto& reduction : reductions) {
+            preheader.push_back(Quadruple(next_label++,
+                                          Opcode::IMul,
+                                          liveness.slot_operand(reduction.variable),
+                                          reduction.factor,
+                                          reduction.temp));
+        }
+
+        /* 循环中的一条四元式：外提的置为 Nop (保留标号)，乘法改为复写，归纳变量增加后更新临时变量 */
+        auto emit = [&](int i, std::vector<Quadruple>& output) {
+            Quadruple qua = quadruples[i];
+            if (hoisted[i - hb]) {
+                qua.operate = Opcode::Nop;
+            } else if (reduced_quad[i - hb] != Npos) {
+                qua.operate = Opcode::Assign;
+                qua.arg_1   = reductions[reduced_quad[i - hb]].temp;
+                qua.arg_2   = Operand();
+            }
+            output.push_back(qua);
+            int slot = DefinesResult(qua.operate) ? liveness.Slot(qua.result) : Npos;
+            if (slot == Npos || induction[slot] != i) {
+                return;
+            }
+            const Operand& step = qua.arg_1 == qua.result ? qua.arg_2 : qua.arg_1;
+            for (const auto& reduction : reductions) {
+                if (reduction.variable == slot) {
+                    Value value;
+                    EvalArith(Opcode::IMul,
+                              semantic_.ConstantValue(step),
+                              semantic_.ConstantValue(reduction.factor),
+                              value);
+                    output.push_back(Quadruple(next_label++,
+                                               qua.operate,
+                                               reduction.temp,
+                                               semantic_.MakeConstant(value, ValueType::Int),
+                                               reduction.temp,
+                                               qua.row));
+                }
+            }
+        };
+
+        std::vector<Quadruple> output;
+        output.reserve(quadruples.size() + preheader.size() + (he - hb) + 2 * reduce_count + 1);
+        output.insert(output.end(), quadruples.begin(), quadruples.begin() + hb);
+        if (shape.rotate) {
+            /* 守卫 + 前置块 + 循环体 + 末尾的取反测试；跳到原回边的跳转现在到达末尾的测试 */
+            output.insert(output.end(), quadruples.begin() + hb, quadruples.begin() + he);
+            output.insert(output.end(), preheader.begin(), preheader.end());
+            for (int i = he; i < le - 1; ++i) {
+                emit(i, output);
+            }
+            int bottom = static_cast<int>(output.size());
+            for (int i = hb; i < he; ++i) {
+                if (!hoisted[i - hb]) {
+                    output.push_back(quadruples[i]);
+                    output.back().label = next_label++;
+                }
+            }
+            output[bottom].label = quadruples[le - 1].label;
+            Quadruple& test       = output.back();
+            int        exit_label = test.result.id;
+            int        fall_label = le < static_cast<int>(quadruples.size()) ? quadruples[le].label : end_label;
+            test.operate          = InvertJump(test.operate);
+            test.result.id        = quadruples[he].label;
+            if (exit_label != fall_label) {
+                /* 原出口不是循环之后的四元式，测试不成立时跳过去 */
+                output.push_back(
+                    Quadruple(next_label++, Opcode::Jump, Operand(), Operand(), Operand(Operand::Label, exit_label)));
+            }
+            ++rotated_;
+        } else {
+            /* 前置块接替首块的标号，循环内跳回首块的跳转改到首块的新标号 */
+            int header_label = quadruples[hb].label;
+            int new_label    = next_label++;
+            preheader.front().label = header_label;
+            output.insert(output.end(), preheader.begin(), preheader.end());
+            int begin = static_cast<int>(output.size());
+            for (int i = hb; i < le; ++i) {
+                emit(i, output);
+            }
+            output[begin].label = new_label;
+            for (size_t i = begin; i < output.size(); ++i) {
+                if (IsJump(output[i].operate) && output[i].result.id == header_label) {
+                    output[i].result.id = new_label;
+                }
+            }
+        }
+        output.insert(output.end(), quadruples.begin() + le, quadruples.end());
+
+        hoisted_ += hoist_count;
+        reduced_ += reduce_count;
+        quadruples.swap(output);
+        RemoveNops(quadruples);
+        semantic_.RenumberLabels();
+        return true;
+    }
+
+    /* 除数为非 0、非 -1 的常量时除法不会出错，可以外提 */
+    bool
+    SafeDivisor(const Operand& opd) const {
+        if (opd.kind != Operand::Constant) {
+            return false;
+        }
+        int64_t divisor = semantic_.ConstantValue(opd).i;
+        return divisor != 0 && divisor != -1;
+    }
+
+    /* 源为 int 表示范围内的常量时 float 转 int 不会出错，可以外提 */
+    bool
+    SafeConversion(const Operand& opd) const {
+        Value value;
+        return opd.kind == Operand::Constant && EvalConvert(Opcode::FloatToInt, semantic_.ConstantValue(opd), value);
+    }
+
+    Semantic&          semantic_;
+    const ProfileData* profile_; /* 剖析数据，可为空 */
+    int                hoisted_; /* 外提的四元式条数 */
+    int                reduced_; /* 强度削弱的乘法条数 */
+    int                rotated_; /* 旋转的循环个数 */
+    int                cold_;    /* 剖析中未执行而跳过的循环个数 */
+};
+
+constexpr int LoopOptimization::Npos;
+
+#endif // !_LOOP_OPTIMIZATION_HPP_
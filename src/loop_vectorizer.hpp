@@ -0,0 +1,449 @@
+/**
+ * @file loop_vectorizer.hpp
+ * @brief 向量化的合法性分析：在寄存器分配后的代码中识别计数循环的归纳变量与加法归约
+ */
+
+#ifndef _LOOP_VECTORIZER_HPP_
+#define _LOOP_VECTORIZER_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "./quadruple.hpp"
+#include "./register_allocation.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 循环向量化分析
+ *        只处理单个基本块构成的计数循环，两种形状：
+ *          旋转后的循环  L: 循环体; j<rel> a b L
+ *          while 循环    L: j<rel> a b 出口; 循环体; j L
+ *        循环体只能含整数的复写、加、减、乘。把一次迭代符号执行为表达式(输入、常量、+ - *)后：
+ *          在循环中定值且在定值之前被读取的位置(跨迭代传递的值)必须是
+ *            归纳变量 x = x ± 常量，或加法归约 x = x ± D(D 不依赖任何归约变量，归约变量也不在别处使用)；
+ *          其余在循环中定值的位置只在循环内活跃(全局变量一律拒绝)；
+ *          循环条件比较一个归纳变量与循环不变量，且随迭代单调：步长为正时 < <=，为负时 > >=。
+ *        整数运算按 2 的补码回绕，加法满足结合律与交换律，所以按 lane 分组累加的结果与顺序执行完全相同；
+ *        条件的单调性由生成代码时检查溢出保证。不满足的循环给出原因，保持标量执行
+ */
+class LoopVectorizer {
+public:
+    static constexpr int Npos = -1;
+
+    /**
+     * @brief 一次迭代的符号表达式结点，子结点的下标总小于父结点
+     */
+    struct Node {
+        enum Kind : uint8_t { Input, Constant, Add, Sub, Mul };
+        Kind    kind;
+        int     a;        /* 运算的两个子结点 */
+        int     b;
+        Operand location; /* Input : 迭代开始时读取的位置 */
+        int64_t value;    /* Constant : 常量值 */
+    };
+
+    /* 归纳变量：每次迭代 location += step */
+    struct Induction {
+        Operand location;
+        int64_t step;
+        int     input; /* 迭代开始时的值(Input 结点) */
+    };
+
+    /* 加法归约：每次迭代 location += delta 或 location -= delta */
+    struct Reduction {
+        Operand location;
+        int     delta;
+        bool    subtract;
+    };
+
+    struct Loop {
+        int                    begin;   /* 循环的第一条四元式(循环头)在 code 中的位置 */
+        int                    end;     /* 回边跳转的位置 */
+        bool                   rotated; /* 旋转后的循环(条件在末尾) */
+        std::vector<Node>      nodes;
+        std::vector<Induction> inductions;
+        std::vector<Reduction> reductions;
+        int                    test;     /* 条件中的归纳变量(inductions 的下标) */
+        Opcode                 relation; /* 继续执行的条件：归纳变量 relation bound，为 j< j<= j> j>= 之一 */
+        int                    bound;    /* 条件中的循环不变量(结点) */
+        std::string            reason;   /* 不能向量化的原因，可以向量化时为空串 */
+    };
+
+    /* 归纳变量的步长不超过 MaxStep，向量化后每批前进的步长(至多 4 倍)仍可编码为 32 位立即数 */
+    static constexpr int64_t MaxStep = INT32_MAX / 4;
+
+    /**
+     * @param registers : 寄存器分配时每类寄存器的个数，编号最大的 RegisterAllocation::ScratchRegisters 个为暂存寄存器
+     */
+    LoopVectorizer(const Semantic& semantic, const std::vector<Quadruple>& code, const RegisterAllocation::Frame& frame,
+                   int registers)
+        : semantic_(semantic), code_(code), frame_(frame), registers_(registers) {
+        for (int i = frame.begin; i < frame.end; ++i) {
+            first_.emplace(code[i].label, i);
+            if (IsJump(code[i].operate)) {
+                targets_.insert(code[i].result.id);
+            }
+        }
+    }
+
+    /**
+     * @brief : 分析函数中的每个循环(每条向回的跳转)，按回边的位置排列
+     */
+    std::vector<Loop>
+    Run() {
+        std::vector<Loop> loops;
+        for (int i = frame_.begin; i < frame_.end; ++i) {
+            if (IsJump(code_[i].operate)) {
+                auto it = first_.find(code_[i].result.id);
+                if (it != first_.end() && it->second <= i) {
+                    loops.push_back(Analyze(it->second, i));
+                }
+            }
+        }
+        return loops;
+    }
+
+    /**
+     * @brief : 以 "循环头标号 : 结果" 的形式输出一个循环的分析结果
+     */
+    void
+    Print(std::ostream& os, const Loop& loop) const {
+        os << "L" << code_[loop.begin].label << " : ";
+        if (!loop.reason.empty()) {
+            os << loop.reason;
+            return;
+        }
+        os << (loop.rotated ? "rotated" : "while") << ", induction";
+        for (const auto& iv : loop.inductions) {
+            os << " ";
+            semantic_.PrintOperand(os, iv.location);
+            os << (iv.step > 0 ? "+=" : "-=") << (iv.step > 0 ? iv.step : -iv.step);
+        }
+        os << ", reduction";
+        for (const auto& reduction : loop.reductions) {
+            os << " ";
+            semantic_.PrintOperand(os, reduction.location);
+            os << (reduction.subtract ? "-=" : "+=");
+        }
+        if (loop.reductions.empty()) {
+            os << " (none)";
+        }
+    }
+
+private:
+    /* 位置的键：寄存器、溢出槽与全局变量各自编号 */
+    static int64_t
+    Key(const Operand& opd) {
+        return (static_cast<int64_t>(opd.kind) << 32) | static_cast<uint32_t>(opd.id);
+    }
+
+    /**
+     * @brief 一次迭代的符号执行状态
+     */
+    struct State {
+        std::vector<Node>                 nodes;
+        std::unordered_map<int64_t, int>  current; /* 位置 -> 当前值的结点 */
+        std::unordered_map<int64_t, int>  inputs;  /* 位置 -> 迭代开始时的值(Input 结点) */
+        std::unordered_map<int64_t, char> defined; /* 在循环中定值的位置 */
+        std::vector<Operand>              order;   /* 按第一次定值的顺序排列的位置 */
+
+        int
+        Add(Node::Kind kind, int a, int b, const Operand& location = Operand(), int64_t value = 0) {
+            nodes.push_back(Node{ kind, a, b, location, value });
+            return static_cast<int>(nodes.size() - 1);
+        }
+    };
+
+    int
+    Read(State& state, const Operand& opd) const {
+        if (opd.kind == Operand::Constant) {
+            return state.Add(Node::Constant, Npos, Npos, Operand(), semantic_.ConstantValue(opd).i);
+        }
+        int64_t key = Key(opd);
+        auto    it  = state.current.find(key);
+        if (it != state.current.end()) {
+            return it->second;
+        }
+        int input          = state.Add(Node::Input, Npos, Npos, opd);
+        state.current[key] = input;
+        state.inputs[key]  = input;
+        return input;
+    }
+
+    void
+    Write(State& state, const Operand& opd, int node) const {
+        int64_t key = Key(opd);
+        if (!state.defined.count(key)) {
+            state.defined[key] = 1;
+            state.order.push_back(opd);
+        }
+        state.current[key] = node;
+    }
+
+    /* 结点 root 是否用到结点 target */
+    static bool
+    Uses(const std::vector<Node>& nodes, int root, int target) {
+        std::vector<char> marked(root + 1, 0);
+        marked[root] = 1;
+        for (int n = root; n >= 0; --n) {
+            if (!marked[n]) {
+                continue;
+            }
+            if (n == target) {
+                return true;
+            }
+            if (nodes[n].kind != Node::Input && nodes[n].kind != Node::Constant) {
+                marked[nodes[n].a] = 1;
+                marked[nodes[n].b] = 1;
+            }
+        }
+        return false;
+    }
+
+    /* 把由 + - 构成的表达式展开为带符号的项(第二项为 true 表示取负) */
+    static void
+    Terms(const std::vector<Node>& nodes, int node, bool negative, std::vector<std::pair<int, bool>>& terms) {
+        const Node& n = nodes[node];
+        if (n.kind == Node::Add || n.kind == Node::Sub) {
+            Terms(nodes, n.a, negative, terms);
+            Terms(nodes, n.b, n.kind == Node::Sub ? !negative : negative, terms);
+        } else {
+            terms.emplace_back(node, negative);
+        }
+    }
+
+    /* 标号在函数中的位置不在 [begin, end] 内(跳出函数体即返回) */
+    bool
+    Outside(int label, int begin, int end) const {
+        auto it = first_.find(label);
+        return it == first_.end() || it->second < begin || it->second > end;
+    }
+
+    /* 位置在 [begin, end] 之外是否活跃：分配到该位置的活跃区间超出了循环 */
+    bool
+    LiveOutside(const Operand& location, int begin, int end) const {
+        for (const auto& interval : frame_.intervals) {
+            if (interval.location == location && interval.end >= begin && interval.start <= end
+                && (interval.start < begin || interval.end > end)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Loop
+    Analyze(int begin, int end) {
+        Loop loop{ begin, end, IsConditionalJump(code_[end].operate), {}, {}, {}, Npos, Opcode::Nop, Npos, {} };
+
+        /* 形状：循环内没有其他跳转目标；while 循环只有循环头的条件跳转跳出循环 */
+        int test = loop.rotated ? end : Npos;
+        for (int i = begin; i <= end; ++i) {
+            if (i > begin && code_[i].label != code_[i - 1].label && targets_.count(code_[i].label)) {
+                loop.reason = "循环体不是单个基本块";
+                return loop;
+            }
+            Opcode op = code_[i].operate;
+            if (i == end || !IsJump(op)) {
+                continue;
+            }
+            if (!loop.rotated && test == Npos && IsConditionalJump(op) && Outside(code_[i].result.id, begin, end)) {
+                test = i;
+            } else {
+                loop.reason = "循环体不是单个基本块";
+                return loop;
+            }
+        }
+        if (test == Npos) {
+            loop.reason = "循环头没有条件";
+            return loop;
+        }
+        if (IsFloatOp(code_[test].operate)) {
+            loop.reason = "循环条件是浮点比较";
+            return loop;
+        }
+
+        /* 符号执行一次迭代 */
+        State state;
+        int   test_a = Npos, test_b = Npos;
+        for (int i = begin; i < end; ++i) {
+            const auto& qua = code_[i];
+            if (i == test) {
+                test_a = Read(state, qua.arg_1);
+                test_b = Read(state, qua.arg_2);
+                continue;
+            }
+            if (qua.arg_1.type == ValueType::Float || qua.arg_2.type == ValueType::Float
+                || qua.result.type == ValueType::Float || IsFloatOp(qua.operate)) {
+                loop.reason = "含浮点运算(浮点加法不满足结合律)";
+                return loop;
+            }
+            switch (qua.operate) {
+                case Opcode::Nop:
+                    break;
+                case Opcode::Assign:
+                    Write(state, qua.result, Read(state, qua.arg_1));
+                    break;
+                case Opcode::IAdd:
+                case Opcode::ISub:
+                case Opcode::IMul: {
+                    static const Node::Kind kinds[] = { Node::Add, Node::Sub, Node::Mul };
+                    int a = Read(state, qua.arg_1), b = Read(state, qua.arg_2);
+                    Write(state, qua.result,
+                          state.Add(kinds[static_cast<int>(qua.operate) - static_cast<int>(Opcode::IAdd)], a, b));
+                } break;
+                case Opcode::IDiv:
+                    loop.reason = "含整数除法";
+                    return loop;
+                case Opcode::Param:
+                case Opcode::Call:
+                    loop.reason = "含函数调用";
+                    return loop;
+                default:
+                    loop.reason = std::string("含不能向量化的运算 ") + OpcodeText(qua.operate);
+                    return loop;
+            }
+        }
+        if (loop.rotated) {
+            test_a = Read(state, code_[end].arg_1);
+            test_b = Read(state, code_[end].arg_2);
+        }
+
+        /* 跨迭代传递的值：归纳变量或加法归约 */
+        for (const auto& location : state.order) {
+            int64_t key   = Key(location);
+            auto    input = state.inputs.find(key);
+            if (input == state.inputs.end()) {
+                if (location.kind == Operand::Variable) {
+                    loop.reason = "在循环中给全局变量赋值";
+                    return loop;
+                }
+                if (location.kind == Operand::Register
+                    && location.id >= registers_ - RegisterAllocation::ScratchRegisters) {
+                    continue; /* 暂存寄存器只在一条四元式内使用 */
+                }
+                if (LiveOutside(location, begin, end)) {
+                    std::ostringstream reason;
+                    reason << "在循环中定值的 ";
+                    semantic_.PrintOperand(reason, location);
+                    reason << " 在循环之外活跃";
+                    loop.reason = reason.str();
+                    return loop;
+                }
+                continue;
+            }
+            /* 新值按 + - 展开为带符号的项：x 恰好出现一次且为正，其余的项不用到 x */
+            int                              x = input->second;
+            std::vector<std::pair<int, bool>> terms, rest;
+            Terms(state.nodes, state.current[key], false, terms);
+            int      count    = 0;
+            bool     negated  = false, constant = true, uses = false;
+            uint64_t step     = 0;
+            for (const auto& term : terms) {
+                const Node& node = state.nodes[term.first];
+                if (term.first == x) {
+                    ++count;
+                    negated |= term.second;
+                    continue;
+                }
+                rest.push_back(term);
+                uses |= Uses(state.nodes, term.first, x);
+                constant &= node.kind == Node::Constant;
+                step += term.second ? 0 - static_cast<uint64_t>(node.value) : static_cast<uint64_t>(node.value);
+            }
+            if (count != 1 || negated || uses || rest.empty()) {
+                std::ostringstream reason;
+                reason << "跨迭代传递的 ";
+                semantic_.PrintOperand(reason, location);
+                reason << " 不是归纳变量或加法归约";
+                loop.reason = reason.str();
+                return loop;
+            }
+            if (constant && step != 0) {
+                int64_t value = static_cast<int64_t>(step);
+                if (value > MaxStep || value < -MaxStep) {
+                    loop.reason = "归纳变量的步长过大";
+                    return loop;
+                }
+                loop.inductions.push_back(Induction{ location, value, x });
+                continue;
+            }
+            /* 增量 = 正项之和 - 负项之和，只有负项时按减法归约 */
+            int plus = Npos, minus = Npos;
+            for (const auto& term : rest) {
+                int& sum = term.second ? minus : plus;
+                sum      = sum == Npos ? term.first : state.Add(Node::Add, sum, term.first);
+            }
+            if (plus == Npos) {
+                loop.reductions.push_back(Reduction{ location, minus, true });
+            } else {
+                loop.reductions.push_back(
+                    Reduction{ location, minus == Npos ? plus : state.Add(Node::Sub, plus, minus), false });
+            }
+        }
+        loop.nodes        = state.nodes;
+        const auto& nodes = loop.nodes;
+
+        /* 归约的增量只能用到归纳变量与循环不变量 */
+        for (const auto& reduction : loop.reductions) {
+            for (const auto& other : loop.reductions) {
+                if (Uses(nodes, reduction.delta, state.inputs[Key(other.location)])) {
+                    loop.reason = "归约变量在循环中另有使用";
+                    return loop;
+                }
+            }
+        }
+
+        /* 条件：归纳变量(while 循环为迭代开始时的值，旋转后的循环为迭代结束时的值)与循环不变量比较 */
+        Opcode relation = loop.rotated ? code_[end].operate : InvertJump(code_[test].operate);
+        for (int side = 0; side < 2 && loop.test == Npos; ++side) {
+            int value = side == 0 ? test_a : test_b, other = side == 0 ? test_b : test_a;
+            for (size_t k = 0; k < loop.inductions.size(); ++k) {
+                const auto& iv      = loop.inductions[k];
+                int         current = state.current[Key(iv.location)];
+                if (value == (loop.rotated ? current : iv.input) && Invariant(state, other)) {
+                    loop.test     = static_cast<int>(k);
+                    loop.bound    = other;
+                    loop.relation = side == 0 ? relation : MirrorJump(relation);
+                    break;
+                }
+            }
+        }
+        if (loop.test == Npos) {
+            loop.reason = "循环条件不是归纳变量与循环不变量的比较";
+            return loop;
+        }
+        int64_t step = loop.inductions[loop.test].step;
+        bool    up   = loop.relation == Opcode::IJumpLt || loop.relation == Opcode::IJumpLe;
+        bool    down = loop.relation == Opcode::IJumpGt || loop.relation == Opcode::IJumpGe;
+        if (!(up && step > 0) && !(down && step < 0)) {
+            loop.reason = "循环条件不随迭代单调";
+            return loop;
+        }
+        return loop;
+    }
+
+    /* 结点是常量或循环中没有定值的位置的值 */
+    static bool
+    Invariant(const State& state, int node) {
+        const Node& n = state.nodes[node];
+        return n.kind == Node::Constant || (n.kind == Node::Input && !state.defined.count(Key(n.location)));
+    }
+
+    const Semantic&                  semantic_;
+    const std::vector<Quadruple>&    code_;
+    const RegisterAllocation::Frame& frame_;
+    int                              registers_;
+    std::unordered_map<int, int>     first_;   /* 函数中的标号 -> 第一条四元式的位置 */
+    std::unordered_set<int>          targets_; /* 函数中跳转的目标标号 */
+};
+
+constexpr int     LoopVectorizer::Npos;
+constexpr int64_t LoopVectorizer::MaxStep;
+
+#endif // !_LOOP_VECTORIZER_HPP_
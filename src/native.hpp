@@ -0,0 +1,1045 @@
+/**
+ * @file native.hpp
+ * @brief x86-64 本机代码生成：由寄存器分配后的四元式生成 System V 目标的机器指令
+ */
+
+#ifndef _NATIVE_HPP_
+#define _NATIVE_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./loop_vectorizer.hpp"
+#include "./quadruple.hpp"
+#include "./register_allocation.hpp"
+#include "./semantic_analysis.hpp"
+#include "./x86_64.hpp"
+
+/**
+ * @brief 本机代码生成
+ *        以每类 Registers 个寄存器做寄存器分配，分配的寄存器映射到机器寄存器：
+ *          整型 rbx r12-r15 rsi rdi r8 r9 参与分配，暂存寄存器为 r10 r11；
+ *          浮点 xmm2-xmm10 参与分配，暂存寄存器为 xmm14 xmm15；
+ *          rax rcx rdx 与 xmm0 xmm1 留给代码生成本身使用。
+ *        函数之间的约定(生成的函数只调用生成的函数)：
+ *          实参按 param 的顺序压栈，第 k 个形参位于 16+8k(%rbp)，调用者在调用后弹出；
+ *          被调函数保存并恢复它分配到的寄存器，与寄存器分配"调用不破坏调用者的寄存器"的模型一致；
+ *          返回值在 rax 中(float 为其位模式)，同时写入返回值变量。
+ *        main 作为全局符号，按 System V 约定由 C 运行时调用：保存的寄存器包含 rbx r12-r15，
+ *        返回值在 eax 中(float 向零截断为 int)，栈帧保持 16 字节对齐。
+ *        栈帧：rbp 之下依次是保存的寄存器与溢出槽；入口处清零分配的寄存器与溢出槽，
+ *        与解释器、虚拟机中未赋值的局部变量为 0 一致。
+ *        整数除以零与 ftoi 溢出不做检查，行为与机器指令相同(前者产生 SIGFPE)。
+ *        向量化(lanes 不为 0)时，LoopVectorizer 判定合法的循环在循环头之前生成向量循环：每批执行 lanes 次迭代，
+ *        剩余不足一批的迭代由原来的标量循环完成；向量代码只使用 xmm0 xmm1 xmm11-xmm15(及其 ymm 形式)
+ */
+class NativeCompiler {
+public:
+    static constexpr int Npos = -1;
+
+    /* 每类寄存器的个数，含两个暂存寄存器 */
+    static constexpr int Registers = 11;
+
+    /* 向量化的 lane 数：SSE2 的 128 位与 AVX2 的 256 位寄存器各含 2、4 个 64 位整数 */
+    static constexpr int Sse2Lanes = 2;
+    static constexpr int Avx2Lanes = 4;
+
+    /**
+     * @param osr   : 是否为每个循环头生成栈上替换的入口(供分层执行使用)
+     * @param lanes : 循环向量化的 lane 数(Sse2Lanes 或 Avx2Lanes)，0 为不向量化
+     */
+    explicit NativeCompiler(const Semantic& semantic, bool osr = false, int lanes = 0)
+        : semantic_(semantic), allocation_(semantic, Registers), osr_(osr), lanes_(lanes) {}
+
+    /* 本机支持的最宽的向量化：有 AVX2(且操作系统保存 ymm 状态)时为 Avx2Lanes，否则为 Sse2Lanes */
+    static int
+    HostLanes() {
+#if defined(__GNUC__) && defined(__x86_64__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? Avx2Lanes : Sse2Lanes;
+#else
+        return Sse2Lanes;
+#endif
+    }
+
+    /**
+     * @brief : 寄存器分配后生成所有函数的机器代码
+     */
+    void
+    Run() {
+        Prepare();
+        for (const auto& frame : allocation_.frames()) {
+            if (frame.function != Npos) {
+                Lower(frame);
+            }
+        }
+    }
+
+    /**
+     * @brief : 只做寄存器分配并准备符号，函数由 Compile 逐个生成(供按需编译的即时编译器使用)
+     */
+    void
+    Prepare() {
+        allocation_.Run();
+        const auto& code      = allocation_.code();
+        int         max_label = 0;
+        int         functions = 0;
+        for (const auto& qua : code) {
+            max_label = qua.label > max_label ? qua.label : max_label;
+            if (qua.operate == Opcode::FunBegin || qua.operate == Opcode::Call) {
+                functions = qua.arg_1.id + 1 > functions ? qua.arg_1.id + 1 : functions;
+            }
+        }
+        program_ = X86Program();
+        program_.globals.assign(semantic_.variable_count(), std::string());
+        program_.function_symbols.resize(functions);
+        for (int f = 0; f < functions; ++f) {
+            program_.function_symbols[f] = semantic_.FunctionInfo(f).id_name;
+        }
+        frame_index_.assign(functions, Npos);
+        main_function_ = Npos;
+        const auto& frames = allocation_.frames();
+        for (size_t k = 0; k < frames.size(); ++k) {
+            if (frames[k].function != Npos) {
+                frame_index_[frames[k].function] = static_cast<int>(k);
+                if (code[frames[k].begin].label == semantic_.main_label()) {
+                    program_.function_symbols[frames[k].function] = "main";
+                    main_function_                                 = frames[k].function;
+                }
+            }
+        }
+        constant_index_.clear();
+        next_label_ = max_label + 1;
+    }
+
+    /**
+     * @return : 函数(全局符号表中的位置)的机器代码在 program().functions 中的下标，没有定义的函数为 Npos
+     */
+    int
+    Compile(int function) {
+        if (function < 0 || function >= static_cast<int>(frame_index_.size()) || frame_index_[function] == Npos) {
+            return Npos;
+        }
+        Lower(allocation_.frames()[frame_index_[function]]);
+        return static_cast<int>(program_.functions.size() - 1);
+    }
+
+    /* main 在全局符号表中的位置，未定义 main 时为 Npos */
+    int
+    main_function() const {
+        return main_function_;
+    }
+
+    /* 函数是否有定义 */
+    bool
+    IsDefined(int function) const {
+        return function >= 0 && function < static_cast<int>(frame_index_.size()) && frame_index_[function] != Npos;
+    }
+
+    const X86Program&
+    program() const {
+        return program_;
+    }
+
+    const RegisterAllocation&
+    allocation() const {
+        return allocation_;
+    }
+
+    /* 循环向量化的 lane 数，0 为不向量化 */
+    int
+    lanes() const {
+        return lanes_;
+    }
+
+    /* 分析过的循环个数 */
+    int
+    vector_candidates() const {
+        return static_cast<int>(vector_report_.size());
+    }
+
+    /* 向量化的循环个数 */
+    int
+    vectorized() const {
+        return vectorized_;
+    }
+
+    /**
+     * @brief : 输出每个循环的向量化结果：向量化的循环列出归纳变量与归约，其余给出原因
+     */
+    void
+    PrintVectorization(std::ostream& os) const {
+        os << "vectorization : " << (lanes_ == Avx2Lanes ? "AVX2" : "SSE2") << ", " << lanes_ << " x 64-bit lanes"
+           << std::endl;
+        for (const auto& line : vector_report_) {
+            os << line << std::endl;
+        }
+    }
+
+    /* 分配的寄存器 -> 机器寄存器 */
+    static Gpr
+    IntRegister(int id) {
+        static const Gpr registers[Registers] = { Gpr::Rbx, Gpr::R12, Gpr::R13, Gpr::R14, Gpr::R15, Gpr::Rsi,
+                                                  Gpr::Rdi, Gpr::R8,  Gpr::R9,  Gpr::R10, Gpr::R11 };
+        return registers[id];
+    }
+
+    static int
+    FloatRegister(int id) {
+        static const int registers[Registers] = { 2, 3, 4, 5, 6, 7, 8, 9, 10, 14, 15 };
+        return registers[id];
+    }
+
+private:
+    void
+    Emit(X86Op op, const X86Operand& dst = X86Operand(), const X86Operand& src = X86Operand(), Cond cond = Cond::O) {
+        code_->push_back(X86Instruction{ op, cond, dst, src });
+    }
+
+    int32_t
+    GlobalIndex(int variable) {
+        if (program_.globals[variable].empty()) {
+            std::ostringstream name;
+            semantic_.PrintOperand(name, Operand(Operand::Variable, variable));
+            program_.globals[variable] = name.str();
+        }
+        return variable;
+    }
+
+    int32_t
+    ConstantIndex(Value value) {
+        auto it = constant_index_.find(value.i);
+        if (it != constant_index_.end()) {
+            return it->second;
+        }
+        program_.constants.push_back(value);
+        constant_index_.emplace(value.i, static_cast<int32_t>(program_.constants.size() - 1));
+        return static_cast<int32_t>(program_.constants.size() - 1);
+    }
+
+    /* 溢出槽 slot 相对 rbp 的位移 */
+    int32_t
+    SlotDisplacement(int slot) const {
+        return -8 * (saved_ + slot + 1);
+    }
+
+    /* 四元式操作数所在的位置：寄存器、溢出槽、全局区、立即数或浮点常量池 */
+    X86Operand
+    Location(const Operand& opd) {
+        switch (opd.kind) {
+            case Operand::Register:
+                return opd.type == ValueType::Float ? XmmOperand(FloatRegister(opd.id)) : GprOperand(IntRegister(opd.id));
+            case Operand::Slot:
+                return MemoryOperand(Gpr::Rbp, SlotDisplacement(opd.id));
+            case Operand::Constant: {
+                Value value = semantic_.ConstantValue(opd);
+                if (opd.type == ValueType::Float) {
+                    return X86Operand(X86Operand::Constant, 0, ConstantIndex(value));
+                }
+                return ImmediateOperand(value.i);
+            }
+            default:
+                return X86Operand(X86Operand::Global, 0, GlobalIndex(opd.id));
+        }
+    }
+
+    /* 超出 32 位的立即数装入 reg */
+    X86Operand
+    Encodable(const X86Operand& opd, Gpr reg) {
+        if (opd.kind == X86Operand::Immediate && !FitsInt32(opd.imm)) {
+            Emit(X86Op::Mov, GprOperand(reg), opd);
+            return GprOperand(reg);
+        }
+        return opd;
+    }
+
+    /* 在任意两个位置之间搬运 64 位的值，内存之间经 rax 中转 */
+    void
+    Move(const X86Operand& dst, const X86Operand& src) {
+        if (dst == src) {
+            return;
+        }
+        const auto rax = GprOperand(Gpr::Rax);
+        if (dst.kind == X86Operand::Xmm) {
+            if (src.kind == X86Operand::Xmm) {
+                Emit(X86Op::MovApd, dst, src);
+            } else if (src.kind == X86Operand::Gpr) {
+                Emit(X86Op::MovQ, dst, src);
+            } else if (src.kind == X86Operand::Immediate) {
+                Emit(X86Op::Mov, rax, src);
+                Emit(X86Op::MovQ, dst, rax);
+            } else {
+                Emit(X86Op::MovSd, dst, src);
+            }
+        } else if (src.kind == X86Operand::Xmm) {
+            Emit(dst.kind == X86Operand::Gpr ? X86Op::MovQ : X86Op::MovSd, dst, src);
+        } else if (dst.kind == X86Operand::Gpr) {
+            if (src.kind == X86Operand::Immediate && src.imm == 0) {
+                Emit(X86Op::Xor, dst, dst);
+            } else {
+                Emit(X86Op::Mov, dst, src);
+            }
+        } else if (src.kind == X86Operand::Gpr || (src.kind == X86Operand::Immediate && FitsInt32(src.imm))) {
+            Emit(X86Op::Mov, dst, src);
+        } else {
+            Emit(X86Op::Mov, rax, src);
+            Emit(X86Op::Mov, dst, rax);
+        }
+    }
+
+    /* 跳转目标：函数体之外的标号即函数末尾的返回 */
+    X86Operand
+    Target(int label) const {
+        return X86Operand(X86Operand::Label, 0, targets_.count(label) ? label : epilogue_);
+    }
+
+    void
+    Lower(const RegisterAllocation::Frame& frame) {
+        const auto& code     = allocation_.code();
+        const auto& info     = semantic_.FunctionInfo(frame.function);
+        bool        is_main  = code[frame.begin].label == semantic_.main_label();
+        ValueType   ret_type = SpecifierValueType(info.sp_type);
+        int32_t     ret      = GlobalIndex(semantic_.ReturnVariable(frame.function));
+
+        program_.functions.push_back(X86Function{ frame.function, program_.function_symbols[frame.function], {}, {} });
+        if (is_main) {
+            program_.main = static_cast<int>(program_.functions.size() - 1);
+        }
+        code_     = &program_.functions.back().code;
+        epilogue_ = next_label_++;
+        pending_  = 0;
+
+        /* 函数体内的跳转目标；向回跳转的目标即循环头 */
+        targets_.clear();
+        first_.clear();
+        for (int i = frame.begin; i < frame.end; ++i) {
+            targets_.emplace(code[i].label, false);
+            first_.emplace(code[i].label, i);
+        }
+        std::vector<int> headers;
+        for (int i = frame.begin; i < frame.end; ++i) {
+            if (IsJump(code[i].operate) && targets_.count(code[i].result.id)) {
+                targets_[code[i].result.id] = true;
+                if (first_[code[i].result.id] <= i
+                    && std::find(headers.begin(), headers.end(), code[i].result.id) == headers.end()) {
+                    headers.push_back(code[i].result.id);
+                }
+            }
+        }
+
+        /* 序言：保存分配到的寄存器，清零寄存器与溢出槽，装入形参 */
+        std::vector<X86Operand> saved;
+        for (int id = 0; id < std::min(frame.registers[0], Registers - RegisterAllocation::ScratchRegisters); ++id) {
+            saved.push_back(GprOperand(IntRegister(id)));
+        }
+        for (int id = 0; id < std::min(frame.registers[1], Registers - RegisterAllocation::ScratchRegisters); ++id) {
+            saved.push_back(XmmOperand(FloatRegister(id)));
+        }
+        saved_         = static_cast<int>(saved.size());
+        int frame_size = 8 * (saved_ + frame.slots);
+        frame_size     = (frame_size + 15) & ~15;
+
+        EnterFrame(saved, frame_size);
+        for (const auto& reg : saved) {
+            if (std::find_if(frame.parameters.begin(), frame.parameters.end(), [&](const Operand& formal) {
+                    return formal.kind == Operand::Register && Location(formal) == reg;
+                }) == frame.parameters.end()) {
+                Emit(reg.kind == X86Operand::Xmm ? X86Op::PXor : X86Op::Xor, reg, reg);
+            }
+        }
+        for (int s = 0; s < frame.slots; ++s) {
+            Emit(X86Op::Mov, MemoryOperand(Gpr::Rbp, SlotDisplacement(s)), ImmediateOperand(0));
+        }
+        for (size_t k = 0; k < frame.parameters.size(); ++k) {
+            if (!frame.parameters[k].IsNone()) {
+                Move(Location(frame.parameters[k]), MemoryOperand(Gpr::Rbp, static_cast<int32_t>(16 + 8 * k)));
+            }
+        }
+
+        /* 可以向量化的循环：循环头的位置 -> 分析结果 */
+        LoopVectorizer                    vectorizer(semantic_, code, frame, Registers);
+        std::vector<LoopVectorizer::Loop> loops;
+        std::unordered_map<int, int>      vector_at;
+        std::unordered_map<int, int>      exits; /* 向量循环跳出的位置 -> 新建的标号 */
+        if (lanes_) {
+            loops = vectorizer.Run();
+            for (size_t k = 0; k < loops.size(); ++k) {
+                if (loops[k].reason.empty()) {
+                    vector_at.emplace(loops[k].begin, static_cast<int>(k));
+                }
+            }
+        }
+
+        for (int i = frame.begin; i < frame.end; ++i) {
+            const auto& qua  = code[i];
+            auto        exit = exits.find(i);
+            if (exit != exits.end()) {
+                Emit(X86Op::Label, X86Operand(X86Operand::Label, 0, exit->second));
+            }
+            auto vector = vector_at.find(i);
+            if (vector != vector_at.end()) {
+                auto& loop       = loops[vector->second];
+                int   exit_label = loop.end + 1 < frame.end ? next_label_++ : epilogue_;
+                if (LowerVectorLoop(loop, frame, exit_label) && exit_label != epilogue_) {
+                    exits.emplace(loop.end + 1, exit_label);
+                }
+            }
+            if ((i == frame.begin || code[i - 1].label != qua.label) && targets_[qua.label]) {
+                Emit(X86Op::Label, X86Operand(X86Operand::Label, 0, qua.label));
+            }
+            LowerQuadruple(qua);
+        }
+        if (lanes_) {
+            for (const auto& loop : loops) {
+                std::ostringstream line;
+                line << info.id_name << " ";
+                vectorizer.Print(line, loop);
+                if (loop.reason.empty()) {
+                    line << " -> vectorized x" << lanes_;
+                    ++vectorized_;
+                }
+                vector_report_.push_back(line.str());
+            }
+        }
+
+        /* 尾声：落出函数末尾的隐式返回，也是 return 与跳出函数体的跳转的目标 */
+        Emit(X86Op::Label, X86Operand(X86Operand::Label, 0, epilogue_));
+        const auto rax = GprOperand(Gpr::Rax);
+        const auto ret_value = X86Operand(X86Operand::Global, 0, ret);
+        if (is_main && ret_type == ValueType::Float) {
+            Emit(X86Op::CvtTSd2Si, rax, ret_value);
+        } else if (ret_type != ValueType::Void) {
+            Emit(X86Op::Mov, rax, ret_value);
+        } else if (is_main) {
+            Emit(X86Op::Xor, rax, rax);
+        }
+        for (int k = 0; k < saved_; ++k) {
+            Move(saved[k], MemoryOperand(Gpr::Rbp, -8 * (k + 1)));
+        }
+        Emit(X86Op::Leave);
+        Emit(X86Op::Ret);
+        if (osr_) {
+            for (int label : headers) {
+                LowerOsrEntry(frame, label, saved, frame_size);
+            }
+        }
+        RemoveFallthroughJumps();
+    }
+
+    /**
+     * @brief 向量循环使用的寄存器：常量与循环不变量的广播、归纳变量各 lane 的值与每批的步长、归约的累加器以及临时值。
+     *        除了代码生成自己使用的 xmm0 xmm1 xmm11-xmm15，还可以借用函数没有分配的浮点寄存器，
+     *        它们可能存放着调用者的值，在向量循环的前后保存与恢复
+     */
+    struct VectorRegisters {
+        std::vector<int>                       free;         /* 空闲的向量寄存器，借用的寄存器在最后分配 */
+        std::vector<int>                       saved;        /* 借用的寄存器 */
+        std::vector<char>                      allocated;    /* 寄存器号 -> 是否分配过 */
+        std::map<std::pair<int, int64_t>, int> broadcasts;   /* (0, 常量) 或 (1, 位置) -> 广播到的寄存器 */
+        std::vector<int>                       lanes;        /* 归纳变量 -> 各 lane 的值所在的寄存器，不需要时为 Npos */
+        std::vector<int>                       steps;        /* 归纳变量 -> 每批步长所在的寄存器 */
+        std::vector<int>                       accumulators; /* 归约 -> 累加器 */
+        bool                                   exhausted = false;
+    };
+
+    /* 当前宽度的向量寄存器 */
+    X86Operand
+    VectorOperand(int reg) const {
+        return lanes_ == Avx2Lanes ? YmmOperand(reg) : XmmOperand(reg);
+    }
+
+    X86Op
+    VectorOp(X86Op sse, X86Op avx) const {
+        return lanes_ == Avx2Lanes ? avx : sse;
+    }
+
+    int
+    AllocateVector(VectorRegisters& regs) {
+        if (regs.free.empty()) {
+            regs.exhausted = true;
+            return 0;
+        }
+        int reg = regs.free.back();
+        regs.free.pop_back();
+        regs.allocated[reg] = 1;
+        return reg;
+    }
+
+    /* 广播的键：常量按值，循环不变量按所在位置 */
+    static std::pair<int, int64_t>
+    BroadcastKey(const LoopVectorizer::Node& node) {
+        if (node.kind == LoopVectorizer::Node::Constant) {
+            return std::make_pair(0, node.value);
+        }
+        return std::make_pair(1, (static_cast<int64_t>(node.location.kind) << 32) | static_cast<uint32_t>(node.location.id));
+    }
+
+    /* 把 src 的值广播到向量寄存器 reg 的每个 lane */
+    void
+    Broadcast(int reg, const X86Operand& src) {
+        const auto rax = GprOperand(Gpr::Rax);
+        Move(rax, src);
+        if (lanes_ == Avx2Lanes) {
+            Emit(X86Op::VMovQ, XmmOperand(reg), rax);
+            Emit(X86Op::VPBroadcastQ, YmmOperand(reg), XmmOperand(reg));
+        } else {
+            Emit(X86Op::MovQ, XmmOperand(reg), rax);
+            Emit(X86Op::PUnpckLQdq, XmmOperand(reg), XmmOperand(reg));
+        }
+    }
+
+    /* 常量在 [0, 2^32) 中：作 pmuludq 的乘数时高 32 位的部分积为 0 */
+    static bool
+    IsSmallConstant(const LoopVectorizer::Node& node) {
+        return node.kind == LoopVectorizer::Node::Constant && node.value >= 0 && node.value <= UINT32_MAX;
+    }
+
+    /**
+     * @brief  : 按 lane 计算结点 n 的值
+     * @return : 结果所在的向量寄存器；temp 为 true 时是用完后应释放的临时寄存器
+     */
+    int
+    EvaluateVector(VectorRegisters& regs, const LoopVectorizer::Loop& loop, int n, bool& temp) {
+        using Node       = LoopVectorizer::Node;
+        const Node& node = loop.nodes[n];
+        temp             = false;
+        if (node.kind == Node::Input) {
+            for (size_t k = 0; k < loop.inductions.size(); ++k) {
+                if (loop.inductions[k].input == n) {
+                    return regs.lanes[k];
+                }
+            }
+        }
+        if (node.kind == Node::Input || node.kind == Node::Constant) {
+            return regs.broadcasts[BroadcastKey(node)];
+        }
+        int na = node.a, nb = node.b;
+        if (node.kind == Node::Mul && IsSmallConstant(loop.nodes[na])) {
+            std::swap(na, nb);
+        }
+        bool ta = false, tb = false;
+        int        a = EvaluateVector(regs, loop, na, ta), b = EvaluateVector(regs, loop, nb, tb);
+        X86Operand va = VectorOperand(a), vb = VectorOperand(b);
+        X86Op      move  = VectorOp(X86Op::MovDqa, X86Op::VMovDqa);
+        X86Op      add   = VectorOp(X86Op::PAddQ, X86Op::VPAddQ);
+        X86Op      mul   = VectorOp(X86Op::PMulUDq, X86Op::VPMulUDq);
+        X86Operand shift = ImmediateOperand(32);
+        int        dst   = Npos;
+        if (node.kind == Node::Mul) {
+            /* 64 位乘积的低 64 位 = lo(a)·lo(b) + ((hi(a)·lo(b) + lo(a)·hi(b)) << 32)，pmuludq 只乘各 lane 的低 32 位 */
+            int cross = AllocateVector(regs);
+            Emit(move, VectorOperand(cross), va);
+            Emit(VectorOp(X86Op::PSrlQ, X86Op::VPSrlQ), VectorOperand(cross), shift);
+            Emit(mul, VectorOperand(cross), vb);
+            if (!IsSmallConstant(loop.nodes[nb])) {
+                int high = AllocateVector(regs);
+                Emit(move, VectorOperand(high), vb);
+                Emit(VectorOp(X86Op::PSrlQ, X86Op::VPSrlQ), VectorOperand(high), shift);
+                Emit(mul, VectorOperand(high), va);
+                Emit(add, VectorOperand(cross), VectorOperand(high));
+                regs.free.push_back(high);
+            }
+            Emit(VectorOp(X86Op::PSllQ, X86Op::VPSllQ), VectorOperand(cross), shift);
+            dst = ta ? a : AllocateVector(regs);
+            if (!ta) {
+                Emit(move, VectorOperand(dst), va);
+            }
+            Emit(mul, VectorOperand(dst), vb);
+            Emit(add, VectorOperand(dst), VectorOperand(cross));
+            regs.free.push_back(cross);
+        } else {
+            dst = ta ? a : AllocateVector(regs);
+            if (!ta) {
+                Emit(move, VectorOperand(dst), va);
+            }
+            Emit(node.kind == Node::Add ? add : VectorOp(X86Op::PSubQ, X86Op::VPSubQ), VectorOperand(dst), vb);
+        }
+        if (tb) {
+            regs.free.push_back(b);
+        }
+        temp = true;
+        return dst;
+    }
+
+    /**
+     * @brief : 比较条件中的归纳变量再前进 lanes - 1 步的值与 bound，之后的 jcc 判断是否还有一整批迭代；
+     *          前进时溢出则跳到 overflow(条件不再随迭代单调)
+     */
+    void
+    CompareRemaining(const LoopVectorizer::Loop& loop, const X86Operand& bound, const X86Operand& overflow) {
+        const auto  rax = GprOperand(Gpr::Rax);
+        const auto& iv  = loop.inductions[loop.test];
+        Move(rax, Location(iv.location));
+        Emit(X86Op::Add, rax, ImmediateOperand((lanes_ - 1) * iv.step));
+        Emit(X86Op::Jcc, overflow, X86Operand(), Cond::O);
+        Emit(X86Op::Cmp, rax, Encodable(bound, Gpr::Rcx));
+    }
+
+    /* 把各累加器的 lane 加到归约变量上 */
+    void
+    HorizontalSum(const VectorRegisters& regs, const LoopVectorizer::Loop& loop) {
+        const auto rax = GprOperand(Gpr::Rax);
+        const auto rsp = GprOperand(Gpr::Rsp);
+        for (size_t r = 0; r < loop.reductions.size(); ++r) {
+            if (r == 0) {
+                Emit(X86Op::Sub, rsp, ImmediateOperand(8 * lanes_));
+            }
+            X86Operand location = Location(loop.reductions[r].location);
+            X86Operand work     = location.kind == X86Operand::Gpr ? location : rax;
+            Emit(VectorOp(X86Op::MovDqu, X86Op::VMovDqu), MemoryOperand(Gpr::Rsp, 0), VectorOperand(regs.accumulators[r]));
+            Move(work, location);
+            for (int j = 0; j < lanes_; ++j) {
+                Emit(X86Op::Add, work, MemoryOperand(Gpr::Rsp, 8 * j));
+            }
+            Move(location, work);
+            if (r + 1 == loop.reductions.size()) {
+                Emit(X86Op::Add, rsp, ImmediateOperand(8 * lanes_));
+            }
+        }
+        if (lanes_ == Avx2Lanes) {
+            Emit(X86Op::VZeroUpper);
+        }
+    }
+
+    /**
+     * @brief  : 在循环头之前生成向量循环，由顺序执行进入循环时经过：
+     *             迭代次数不足一批时直接进入标量循环；否则广播循环不变量，按 lane 建立归纳变量的值并清零累加器；
+     *             每批按 lane 计算归约的增量累加，归纳变量前进 lanes 步；剩余的迭代不足一批时把累加器归约到归约变量，
+     *             进入标量循环完成剩余的迭代。旋转后的循环在条件不再满足时(没有剩余的迭代)直接跳到 exit_label
+     * @return : 寄存器不足时不生成，在 loop.reason 中给出原因
+     */
+    bool
+    LowerVectorLoop(LoopVectorizer::Loop& loop, const RegisterAllocation::Frame& frame, int exit_label) {
+        int labels[] = { next_label_, next_label_ + 1, next_label_ + 2 };
+        next_label_ += 3;
+
+        /* 先不保存借用的寄存器生成一次，得知借用了哪些寄存器后再生成一次；两次的分配相同 */
+        std::vector<int>             spare, saved;
+        std::vector<X86Instruction>  vector_code;
+        std::vector<X86Instruction>* saved_code = code_;
+        for (int id = std::min(frame.registers[1], Registers - RegisterAllocation::ScratchRegisters);
+             id < Registers - RegisterAllocation::ScratchRegisters; ++id) {
+            spare.push_back(FloatRegister(id));
+        }
+        for (;;) {
+            VectorRegisters regs;
+            regs.free = spare;
+            regs.free.insert(regs.free.end(), { 15, 14, 13, 12, 11, 1, 0 });
+            regs.saved = saved;
+            regs.allocated.assign(16, 0);
+            vector_code.clear();
+            code_ = &vector_code;
+            GenerateVectorLoop(loop, regs, labels, exit_label);
+            code_ = saved_code;
+            if (regs.exhausted) {
+                loop.reason = "向量寄存器不足";
+                return false;
+            }
+            std::vector<int> borrowed;
+            for (int reg : spare) {
+                if (regs.allocated[reg]) {
+                    borrowed.push_back(reg);
+                }
+            }
+            if (borrowed == saved) {
+                break;
+            }
+            saved.swap(borrowed);
+        }
+        code_->insert(code_->end(), vector_code.begin(), vector_code.end());
+        return true;
+    }
+
+    /* 保存(store 为 true)或恢复借用的寄存器的低 64 位：调用者只在其中存放标量浮点数 */
+    void
+    SaveBorrowed(const VectorRegisters& regs, bool store) {
+        const auto rsp = GprOperand(Gpr::Rsp);
+        if (regs.saved.empty()) {
+            return;
+        }
+        int32_t size = static_cast<int32_t>(8 * regs.saved.size());
+        if (store) {
+            Emit(X86Op::Sub, rsp, ImmediateOperand(size));
+        }
+        for (size_t k = 0; k < regs.saved.size(); ++k) {
+            auto slot = MemoryOperand(Gpr::Rsp, static_cast<int32_t>(8 * k));
+            if (store) {
+                Emit(X86Op::MovSd, slot, XmmOperand(regs.saved[k]));
+            } else {
+                Emit(X86Op::MovSd, XmmOperand(regs.saved[k]), slot);
+            }
+        }
+        if (!store) {
+            Emit(X86Op::Add, rsp, ImmediateOperand(size));
+        }
+    }
+
+    /* LowerVectorLoop 的一次生成：labels 为批的开始、剩余不足一批与循环结束的标号 */
+    void
+    GenerateVectorLoop(const LoopVectorizer::Loop& loop, VectorRegisters& regs, const int labels[3], int exit_label) {
+        using Node                = LoopVectorizer::Node;
+        static const Cond conds[] = { Cond::L, Cond::LE, Cond::G, Cond::GE };
+        static const Cond stops[] = { Cond::GE, Cond::G, Cond::LE, Cond::L };
+        const auto        rax     = GprOperand(Gpr::Rax);
+        const auto        rsp     = GprOperand(Gpr::Rsp);
+        const Node&       last    = loop.nodes[loop.bound];
+        X86Operand        bound   = last.kind == Node::Constant ? ImmediateOperand(last.value) : Location(last.location);
+        X86Operand        scalar(X86Operand::Label, 0, allocation_.code()[loop.begin].label);
+        X86Operand        body(X86Operand::Label, 0, labels[0]);
+        X86Operand        done(X86Operand::Label, 0, labels[1]);
+        X86Operand        finish(X86Operand::Label, 0, labels[2]);
+        Cond              cond = conds[static_cast<int>(loop.relation) - static_cast<int>(Opcode::IJumpLt)];
+        Cond              stop = stops[static_cast<int>(loop.relation) - static_cast<int>(Opcode::IJumpLt)];
+        regs.lanes.assign(loop.inductions.size(), Npos);
+        regs.steps.assign(loop.inductions.size(), Npos);
+
+        /* 归约的增量用到的结点 */
+        std::vector<char> used(loop.nodes.size(), 0);
+        for (const auto& reduction : loop.reductions) {
+            used[reduction.delta] = 1;
+        }
+        for (int n = static_cast<int>(loop.nodes.size()) - 1; n >= 0; --n) {
+            const Node& node = loop.nodes[n];
+            if (used[n] && node.kind != Node::Input && node.kind != Node::Constant) {
+                used[node.a] = used[node.b] = 1;
+            }
+        }
+
+        CompareRemaining(loop, bound, scalar);
+        Emit(X86Op::Jcc, scalar, X86Operand(), stop);
+        SaveBorrowed(regs, true);
+        for (size_t n = 0; n < loop.nodes.size(); ++n) {
+            const Node& node = loop.nodes[n];
+            size_t      k    = 0;
+            while (k < loop.inductions.size() && loop.inductions[k].input != static_cast<int>(n)) {
+                ++k;
+            }
+            if (!used[n] || (node.kind != Node::Input && node.kind != Node::Constant)) {
+                continue;
+            }
+            if (k < loop.inductions.size()) {
+                regs.lanes[k] = 0;
+            } else if (!regs.broadcasts.count(BroadcastKey(node))) {
+                int reg                             = AllocateVector(regs);
+                regs.broadcasts[BroadcastKey(node)] = reg;
+                Broadcast(reg, node.kind == Node::Constant ? ImmediateOperand(node.value) : Location(node.location));
+            }
+        }
+        for (size_t k = 0; k < loop.inductions.size(); ++k) {
+            if (regs.lanes[k] == Npos) {
+                continue;
+            }
+            /* 各 lane 的初值 x, x + step, ... 经栈装入，每批的步长与常量一样广播 */
+            const auto& iv = loop.inductions[k];
+            Node        step{ Node::Constant, Npos, Npos, Operand(), lanes_ * iv.step };
+            if (!regs.broadcasts.count(BroadcastKey(step))) {
+                regs.broadcasts[BroadcastKey(step)] = AllocateVector(regs);
+                Broadcast(regs.broadcasts[BroadcastKey(step)], ImmediateOperand(step.value));
+            }
+            regs.steps[k] = regs.broadcasts[BroadcastKey(step)];
+            regs.lanes[k] = AllocateVector(regs);
+            Emit(X86Op::Sub, rsp, ImmediateOperand(8 * lanes_));
+            Move(rax, Location(iv.location));
+            for (int j = 0; j < lanes_; ++j) {
+                Emit(X86Op::Mov, MemoryOperand(Gpr::Rsp, 8 * j), rax);
+                if (j + 1 < lanes_) {
+                    Emit(X86Op::Add, rax, ImmediateOperand(iv.step));
+                }
+            }
+            Emit(VectorOp(X86Op::MovDqu, X86Op::VMovDqu), VectorOperand(regs.lanes[k]), MemoryOperand(Gpr::Rsp, 0));
+            Emit(X86Op::Add, rsp, ImmediateOperand(8 * lanes_));
+        }
+        for (size_t r = 0; r < loop.reductions.size(); ++r) {
+            int reg = AllocateVector(regs);
+            regs.accumulators.push_back(reg);
+            Emit(VectorOp(X86Op::PXor, X86Op::VPXor), VectorOperand(reg), VectorOperand(reg));
+        }
+
+        /* 每批 lanes 次迭代 */
+        Emit(X86Op::Label, body);
+        for (size_t r = 0; r < loop.reductions.size(); ++r) {
+            bool temp  = false;
+            int  delta = EvaluateVector(regs, loop, loop.reductions[r].delta, temp);
+            Emit(loop.reductions[r].subtract ? VectorOp(X86Op::PSubQ, X86Op::VPSubQ) : VectorOp(X86Op::PAddQ, X86Op::VPAddQ),
+                 VectorOperand(regs.accumulators[r]), VectorOperand(delta));
+            if (temp) {
+                regs.free.push_back(delta);
+            }
+        }
+        for (size_t k = 0; k < loop.inductions.size(); ++k) {
+            if (regs.lanes[k] != Npos) {
+                Emit(VectorOp(X86Op::PAddQ, X86Op::VPAddQ), VectorOperand(regs.lanes[k]), VectorOperand(regs.steps[k]));
+            }
+            Emit(X86Op::Add, Location(loop.inductions[k].location), ImmediateOperand(lanes_ * loop.inductions[k].step));
+        }
+        if (loop.rotated) {
+            /* 旋转后的循环：这一批的最后一次迭代的条件不满足时循环结束 */
+            X86Operand value = Location(loop.inductions[loop.test].location);
+            if (value.kind != X86Operand::Gpr) {
+                Move(rax, value);
+                value = rax;
+            }
+            Emit(X86Op::Cmp, value, Encodable(bound, Gpr::Rcx));
+            Emit(X86Op::Jcc, finish, X86Operand(), stop);
+        }
+        CompareRemaining(loop, bound, done);
+        Emit(X86Op::Jcc, body, X86Operand(), cond);
+        Emit(X86Op::Label, done);
+        HorizontalSum(regs, loop);
+        SaveBorrowed(regs, false);
+        if (loop.rotated) {
+            Emit(X86Op::Jmp, scalar);
+            Emit(X86Op::Label, finish);
+            HorizontalSum(regs, loop);
+            SaveBorrowed(regs, false);
+            Emit(X86Op::Jmp, X86Operand(X86Operand::Label, 0, exit_label));
+        }
+    }
+
+    /* 建立栈帧并保存分配到的寄存器 */
+    void
+    EnterFrame(const std::vector<X86Operand>& saved, int frame_size) {
+        const auto rbp = GprOperand(Gpr::Rbp);
+        const auto rsp = GprOperand(Gpr::Rsp);
+        Emit(X86Op::Push, rbp);
+        Emit(X86Op::Mov, rbp, rsp);
+        if (frame_size) {
+            Emit(X86Op::Sub, rsp, ImmediateOperand(frame_size));
+        }
+        for (int k = 0; k < saved_; ++k) {
+            Move(MemoryOperand(Gpr::Rbp, -8 * (k + 1)), saved[k]);
+        }
+    }
+
+    /**
+     * @brief : 循环头 label 的栈上替换入口：与序言相同地建立栈帧，装入在循环头活跃的值后跳到循环头。
+     *          区间不拆分且同时活跃的区间位置互不相同，所以区间覆盖循环头的值都可以直接装入
+     */
+    void
+    LowerOsrEntry(const RegisterAllocation::Frame& frame, int label, const std::vector<X86Operand>& saved,
+                  int frame_size) {
+        X86OsrEntry entry{ label, next_label_++, {} };
+        int         position = first_[label];
+        Emit(X86Op::Label, X86Operand(X86Operand::Label, 0, entry.entry));
+        EnterFrame(saved, frame_size);
+        for (const auto& interval : frame.intervals) {
+            if (interval.start <= position && position <= interval.end) {
+                int32_t offset = static_cast<int32_t>(8 * entry.values.size());
+                Move(Location(interval.location), MemoryOperand(Gpr::Rdx, offset));
+                entry.values.push_back(interval.value);
+            }
+        }
+        Emit(X86Op::Jmp, X86Operand(X86Operand::Label, 0, label));
+        program_.functions.back().osr_entries.push_back(std::move(entry));
+    }
+
+    /* 删除跳到紧随其后的标号的跳转，如 return 之后就是尾声 */
+    void
+    RemoveFallthroughJumps() {
+        auto&  code = *code_;
+        size_t kept = 0;
+        for (size_t i = 0; i < code.size(); ++i) {
+            const auto& ins = code[i];
+            if (ins.op == X86Op::Jmp || ins.op == X86Op::Jcc) {
+                size_t next = i + 1;
+                while (next < code.size() && code[next].op == X86Op::Label && code[next].dst != ins.dst) {
+                    ++next;
+                }
+                if (next < code.size() && code[next].op == X86Op::Label) {
+                    continue;
+                }
+            }
+            code[kept++] = ins;
+        }
+        code.resize(kept);
+    }
+
+    void
+    LowerQuadruple(const Quadruple& qua) {
+        const auto rax = GprOperand(Gpr::Rax);
+        const auto rcx = GprOperand(Gpr::Rcx);
+        const auto xmm0 = XmmOperand(0);
+        switch (qua.operate) {
+            case Opcode::Nop:
+            case Opcode::FunBegin:
+                break;
+            case Opcode::Assign:
+                Move(Location(qua.result), Location(qua.arg_1));
+                break;
+            case Opcode::IAdd:
+            case Opcode::ISub:
+            case Opcode::IMul: {
+                static const X86Op ops[] = { X86Op::Add, X86Op::Sub, X86Op::IMul };
+                X86Operand         dst = Location(qua.result), a = Location(qua.arg_1), b = Location(qua.arg_2);
+                if (IsCommutative(qua.operate) && b == dst && a != dst) {
+                    std::swap(a, b);
+                }
+                b               = Encodable(b, Gpr::Rcx);
+                X86Operand work = dst.kind == X86Operand::Gpr && dst != b ? dst : rax;
+                Move(work, a);
+                Emit(ops[static_cast<int>(qua.operate) - static_cast<int>(Opcode::IAdd)], work, b);
+                Move(dst, work);
+            } break;
+            case Opcode::IDiv: {
+                X86Operand b = Location(qua.arg_2);
+                Move(rax, Location(qua.arg_1));
+                if (b.kind == X86Operand::Immediate) {
+                    Move(rcx, b);
+                    b = rcx;
+                }
+                Emit(X86Op::Cqo);
+                Emit(X86Op::IDiv, b);
+                Move(Location(qua.result), rax);
+            } break;
+            case Opcode::FAdd:
+            case Opcode::FSub:
+            case Opcode::FMul:
+            case Opcode::FDiv: {
+                static const X86Op ops[] = { X86Op::AddSd, X86Op::SubSd, X86Op::MulSd, X86Op::DivSd };
+                X86Operand dst = Location(qua.result), a = Location(qua.arg_1), b = Location(qua.arg_2);
+                if (IsCommutative(qua.operate) && b == dst && a != dst) {
+                    std::swap(a, b);
+                }
+                X86Operand work = dst.kind == X86Operand::Xmm && dst != b ? dst : xmm0;
+                Move(work, a);
+                Emit(ops[static_cast<int>(qua.operate) - static_cast<int>(Opcode::FAdd)], work, b);
+                Move(dst, work);
+            } break;
+            case Opcode::IntToFloat: {
+                X86Operand dst = Location(qua.result), a = Location(qua.arg_1);
+                X86Operand work = dst.kind == X86Operand::Xmm ? dst : xmm0;
+                if (a.kind == X86Operand::Immediate) {
+                    Move(rax, a);
+                    a = rax;
+                }
+                /* cvtsi2sd 只写低 64 位，先清零以消除对目的寄存器旧值的依赖 */
+                Emit(X86Op::PXor, work, work);
+                Emit(X86Op::CvtSi2Sd, work, a);
+                Move(dst, work);
+            } break;
+            case Opcode::FloatToInt: {
+                X86Operand dst = Location(qua.result);
+                X86Operand work = dst.kind == X86Operand::Gpr ? dst : rax;
+                Emit(X86Op::CvtTSd2Si, work, Location(qua.arg_1));
+                Move(dst, work);
+            } break;
+            case Opcode::Jump:
+                Emit(X86Op::Jmp, Target(qua.result.id));
+                break;
+            case Opcode::Param: {
+                X86Operand a = Encodable(Location(qua.arg_1), Gpr::Rax);
+                if (a.kind == X86Operand::Xmm) {
+                    Emit(X86Op::Sub, GprOperand(Gpr::Rsp), ImmediateOperand(8));
+                    Emit(X86Op::MovSd, MemoryOperand(Gpr::Rsp, 0), a);
+                } else {
+                    Emit(X86Op::Push, a);
+                }
+                ++pending_;
+            } break;
+            case Opcode::Call: {
+                Emit(X86Op::Call, X86Operand(X86Operand::Function, 0, qua.arg_1.id));
+                /* 被调函数只读取它的形参个数个实参，与解释器一致 */
+                int count = std::min(pending_, semantic_.FunctionInfo(qua.arg_1.id).parameter_num);
+                if (count) {
+                    Emit(X86Op::Add, GprOperand(Gpr::Rsp), ImmediateOperand(8 * count));
+                    pending_ -= count;
+                }
+                if (qua.result.type != ValueType::Void) {
+                    Move(Location(qua.result), rax);
+                }
+            } break;
+            case Opcode::Return:
+                Emit(X86Op::Jmp, X86Operand(X86Operand::Label, 0, epilogue_));
+                break;
+            default:
+                LowerJump(qua);
+                break;
+        }
+    }
+
+    /* 条件跳转 */
+    void
+    LowerJump(const Quadruple& qua) {
+        const auto rax    = GprOperand(Gpr::Rax);
+        X86Operand target = Target(qua.result.id);
+        X86Operand a = Location(qua.arg_1), b = Location(qua.arg_2);
+        Opcode     op = qua.operate;
+        if (!IsFloatOp(op)) {
+            static const Cond conds[] = { Cond::L, Cond::LE, Cond::G, Cond::GE, Cond::E, Cond::NE };
+            if (a.kind == X86Operand::Immediate && b.kind != X86Operand::Immediate) {
+                std::swap(a, b);
+                op = MirrorJump(op);
+            }
+            if (a.kind == X86Operand::Immediate || (a.IsMemory() && b.IsMemory())) {
+                Move(rax, a);
+                a = rax;
+            }
+            b = Encodable(b, Gpr::Rcx);
+            Emit(X86Op::Cmp, a, b);
+            Emit(X86Op::Jcc, target, X86Operand(), conds[static_cast<int>(op) - static_cast<int>(Opcode::IJumpLt)]);
+            return;
+        }
+        /* ucomisd 对无序(含 NaN)的结果置 ZF PF CF：< <= 交换操作数后用 a/ae，== != 另外检查 PF */
+        if (op == Opcode::FJumpLt || op == Opcode::FJumpLe) {
+            std::swap(a, b);
+            op = MirrorJump(op);
+        }
+        if (a.kind != X86Operand::Xmm) {
+            Move(XmmOperand(0), a);
+            a = XmmOperand(0);
+        }
+        Emit(X86Op::UComISd, a, b);
+        switch (op) {
+            case Opcode::FJumpGt:
+                Emit(X86Op::Jcc, target, X86Operand(), Cond::A);
+                break;
+            case Opcode::FJumpGe:
+                Emit(X86Op::Jcc, target, X86Operand(), Cond::AE);
+                break;
+            case Opcode::FJumpEq: {
+                X86Operand skip(X86Operand::Label, 0, next_label_++);
+                Emit(X86Op::Jcc, skip, X86Operand(), Cond::P);
+                Emit(X86Op::Jcc, target, X86Operand(), Cond::E);
+                Emit(X86Op::Label, skip);
+            } break;
+            default:
+                Emit(X86Op::Jcc, target, X86Operand(), Cond::P);
+                Emit(X86Op::Jcc, target, X86Operand(), Cond::NE);
+                break;
+        }
+    }
+
+    const Semantic&    semantic_;
+    RegisterAllocation allocation_;
+    X86Program         program_;
+
+    std::unordered_map<int64_t, int32_t> constant_index_; /* 浮点常量的位模式 -> 常量池下标 */
+    std::unordered_map<int, bool>        targets_;        /* 当前函数中的标号 -> 是否为跳转目标 */
+    std::unordered_map<int, int>         first_;          /* 当前函数中的标号 -> 第一条四元式的位置 */
+    std::vector<int>                     frame_index_;    /* 函数 -> 在 allocation_.frames() 中的下标 */
+    int                                  main_function_ = Npos;
+    bool                                 osr_;
+    int                                  lanes_;
+    int                                  vectorized_ = 0; /* 向量化的循环个数 */
+    std::vector<std::string>             vector_report_;  /* 每个循环的向量化结果 */
+
+    std::vector<X86Instruction>* code_;       /* 当前函数的机器代码 */
+    int                          next_label_; /* 下一个新建的标号 */
+    int                          epilogue_;   /* 当前函数尾声的标号 */
+    int                          saved_;      /* 当前函数保存的寄存器个数 */
+    int                          pending_;    /* 已压栈、尚未被调用弹出的实参个数 */
+};
+
+constexpr int NativeCompiler::Npos;
+constexpr int NativeCompiler::Registers;
+constexpr int NativeCompiler::Sse2Lanes;
+constexpr int NativeCompiler::Avx2Lanes;
+
+#endif // !_NATIVE_HPP_
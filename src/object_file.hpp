@@ -0,0 +1,449 @@
+/**
+ * @file object_file.hpp
+ * @brief 字节码目标文件：带版本的二进制格式的写出，以及映射到内存后校验与执行
+ */
+
+#ifndef _OBJECT_FILE_HPP_
+#define _OBJECT_FILE_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./bytecode.hpp"
+
+/**
+ * @brief 目标文件的节：按顺序存放，每节从 8 字节对齐的偏移开始
+ *        Code          : Instruction[count]
+ *        Constants     : Value[count] (常量池)
+ *        ConstantTypes : uint8_t[count] (常量的 ValueType)
+ *        Functions     : BytecodeFunction[count] (按全局符号表中的位置编号)
+ *        Parameters    : int32_t[count] (形参寄存器)
+ *        GlobalNames   : int32_t[count] (全局区下标 -> 名字下标，count 即全局区大小)
+ *        NameOffsets   : uint32_t[count] (第 k 个名字在 NameData 中的起点，最后一项为 NameData 的大小)
+ *        NameData      : char[count] (以 '\0' 结尾的名字依次排列)
+ */
+enum class SectionId { Code, Constants, ConstantTypes, Functions, Parameters, GlobalNames, NameOffsets, NameData, Count };
+
+constexpr int SectionCount = static_cast<int>(SectionId::Count);
+
+struct ObjectSection {
+    uint64_t offset; /* 相对文件开头的偏移 */
+    uint64_t count;  /* 元素个数 */
+};
+
+/**
+ * @brief 目标文件头
+ */
+struct ObjectHeader {
+    char          magic[4];    /* "QBC\0" */
+    uint32_t      version;     /* 格式版本，不同版本不兼容 */
+    uint32_t      byte_order;  /* 以写出时的字节序存放 0x01020304，用于拒绝字节序不同的文件 */
+    uint32_t      header_size; /* sizeof(ObjectHeader) */
+    int32_t       main;        /* main 函数 */
+    int32_t       main_type;   /* main 的返回类型 */
+    ObjectSection sections[SectionCount];
+};
+
+constexpr char     ObjectMagic[4]  = { 'Q', 'B', 'C', '\0' };
+constexpr uint32_t ObjectVersion   = 1;
+constexpr uint32_t ObjectByteOrder = 0x01020304;
+
+/**
+ * @brief 写出目标文件
+ */
+class ObjectWriter {
+public:
+    /**
+     * @return : 无法写入时返回 false
+     */
+    static bool
+    Write(const BytecodeProgram& program, const std::string& path) {
+        std::vector<uint32_t> name_offsets;
+        std::string           name_data;
+        for (const auto& name : program.names) {
+            name_offsets.push_back(static_cast<uint32_t>(name_data.size()));
+            name_data += name;
+            name_data += '\0';
+        }
+        name_offsets.push_back(static_cast<uint32_t>(name_data.size()));
+        std::vector<uint8_t> constant_types;
+        for (auto type : program.constant_types) {
+            constant_types.push_back(static_cast<uint8_t>(type));
+        }
+
+        ObjectHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, ObjectMagic, sizeof(header.magic));
+        header.version     = ObjectVersion;
+        header.byte_order  = ObjectByteOrder;
+        header.header_size = sizeof(ObjectHeader);
+        header.main        = program.main;
+        header.main_type   = static_cast<int32_t>(program.main_type);
+
+        const void* data[SectionCount] = { program.code.data(),     program.constants.data(), constant_types.data(),
+                                           program.functions.data(), program.parameters.data(), program.global_names.data(),
+                                           name_offsets.data(),     name_data.data() };
+        const size_t count[SectionCount] = { program.code.size(),     program.constants.size(),  constant_types.size(),
+                                             program.functions.size(), program.parameters.size(), program.global_names.size(),
+                                             name_offsets.size(),     name_data.size() };
+        uint64_t offset = Align(sizeof(ObjectHeader));
+        for (int s = 0; s < SectionCount; ++s) {
+            header.sections[s] = ObjectSection{ offset, count[s] };
+            offset             = Align(offset + count[s] * ElementSize(static_cast<SectionId>(s)));
+        }
+
+        std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (int s = 0; s < SectionCount; ++s) {
+            Pad(out, written, header.sections[s].offset);
+            uint64_t bytes = count[s] * ElementSize(static_cast<SectionId>(s));
+            out.write(static_cast<const char*>(data[s]), static_cast<std::streamsize>(bytes));
+            written += bytes;
+        }
+        Pad(out, written, offset);
+        return static_cast<bool>(out);
+    }
+
+    /* 节中每个元素的字节数 */
+    static size_t
+    ElementSize(SectionId section) {
+        switch (section) {
+            case SectionId::Code:
+                return sizeof(Instruction);
+            case SectionId::Constants:
+                return sizeof(Value);
+            case SectionId::Functions:
+                return sizeof(BytecodeFunction);
+            case SectionId::Parameters:
+            case SectionId::GlobalNames:
+            case SectionId::NameOffsets:
+                return sizeof(int32_t);
+            default:
+                return 1;
+        }
+    }
+
+    static uint64_t
+    Align(uint64_t offset) {
+        return (offset + 7) & ~static_cast<uint64_t>(7);
+    }
+
+private:
+    static void
+    Pad(std::ofstream& out, uint64_t& written, uint64_t offset) {
+        for (; written < offset; ++written) {
+            out.put('\0');
+        }
+    }
+};
+
+/**
+ * @brief 映射到内存的目标文件
+ *        Open 映射整个文件并校验文件头、各节的范围以及每条指令的操作数
+ *        (寄存器不超出所在函数的栈帧、常量与全局区下标、跳转目标与被调函数在范围内、超级指令之后是比较跳转)，
+ *        校验通过后 View() 直接指向映射的内存，执行时不再复制字节码
+ */
+class ObjectFile {
+public:
+    ObjectFile() : data_(nullptr), size_(0) {}
+    ObjectFile(const ObjectFile&) = delete;
+    ObjectFile& operator=(const ObjectFile&) = delete;
+    ~ObjectFile() {
+        Close();
+    }
+
+    /**
+     * @return : 无法映射或校验失败时返回 false
+     */
+    bool
+    Open(const std::string& path) {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return Fail("无法打开 " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ObjectHeader))) {
+            close(fd);
+            return Fail("文件过短");
+        }
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            return Fail("无法映射 " + path);
+        }
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<size_t>(info.st_size);
+        if (!Verify()) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void
+    Close() {
+        if (data_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const ObjectHeader&
+    header() const {
+        return *reinterpret_cast<const ObjectHeader*>(data_);
+    }
+
+    /* 映射的字节数 */
+    size_t
+    size() const {
+        return size_;
+    }
+
+    BytecodeView
+    View() const {
+        return BytecodeView{ Section<Instruction>(SectionId::Code),           Count(SectionId::Code),
+                             Section<Value>(SectionId::Constants),            Count(SectionId::Constants),
+                             Section<BytecodeFunction>(SectionId::Functions), Count(SectionId::Functions),
+                             Section<int32_t>(SectionId::Parameters),         Count(SectionId::GlobalNames),
+                             header().main,                        static_cast<ValueType>(header().main_type) };
+    }
+
+    /* 第 k 个名字 */
+    const char*
+    Name(int32_t k) const {
+        return Section<char>(SectionId::NameData) + Section<uint32_t>(SectionId::NameOffsets)[k];
+    }
+
+private:
+    template <typename T>
+    const T*
+    Section(SectionId section) const {
+        return reinterpret_cast<const T*>(data_ + header().sections[static_cast<int>(section)].offset);
+    }
+
+    int32_t
+    Count(SectionId section) const {
+        return static_cast<int32_t>(header().sections[static_cast<int>(section)].count);
+    }
+
+    static bool
+    Fail(const std::string& message) {
+        std::cerr << "目标文件错误 : " << message << std::endl;
+        return false;
+    }
+
+    /* 指令各操作数的类别：R 寄存器，r 寄存器或 -1，K 常量，G 全局区，T 跳转目标，F 函数，- 不使用 */
+    static const char*
+    Signature(VmOp op) {
+        switch (op) {
+            case VmOp::Move:
+            case VmOp::IToF:
+            case VmOp::FToI:
+                return "RR-";
+            case VmOp::LoadK:
+                return "RK-";
+            case VmOp::GetG:
+                return "RG-";
+            case VmOp::SetG:
+            case VmOp::RetR:
+                return "GR-";
+            case VmOp::SetGK:
+            case VmOp::RetK:
+                return "GK-";
+            case VmOp::Jmp:
+                return "--T";
+            case VmOp::Param:
+                return "R--";
+            case VmOp::Call:
+                return "rF-";
+            case VmOp::Ret:
+                return "G--";
+            default:
+                if (op >= VmOp::IAdd && op <= VmOp::FDiv) {
+                    return "RRR";
+                }
+                if (op >= VmOp::IJLt && op <= VmOp::FJNe) {
+                    return "RRT";
+                }
+                if (op >= VmOp::IJLtK && op <= VmOp::FJNeK) {
+                    return "RKT";
+                }
+                return "RRK"; /* K 形式的算术运算与超级指令 */
+        }
+    }
+
+    bool
+    Verify() const {
+        const auto& head = header();
+        if (std::memcmp(head.magic, ObjectMagic, sizeof(head.magic)) != 0) {
+            return Fail("不是字节码目标文件");
+        }
+        if (head.byte_order != ObjectByteOrder) {
+            return Fail("字节序不同");
+        }
+        if (head.version != ObjectVersion || head.header_size != sizeof(ObjectHeader)) {
+            return Fail("版本 " + std::to_string(head.version) + " 与当前版本 " + std::to_string(ObjectVersion) + " 不兼容");
+        }
+        for (int s = 0; s < SectionCount; ++s) {
+            const auto& section = head.sections[s];
+            uint64_t    bytes   = section.count * ObjectWriter::ElementSize(static_cast<SectionId>(s));
+            if (section.offset % 8 || section.offset > size_ || section.count > size_ || bytes > size_ - section.offset
+                || section.count > INT32_MAX) {
+                return Fail("第 " + std::to_string(s) + " 节超出文件范围");
+            }
+        }
+
+        /* 名字表 */
+        const uint32_t* offsets    = Section<uint32_t>(SectionId::NameOffsets);
+        const char*     names      = Section<char>(SectionId::NameData);
+        int32_t         name_count = Count(SectionId::NameOffsets) - 1;
+        if (name_count < 0 || offsets[name_count] != static_cast<uint32_t>(Count(SectionId::NameData))) {
+            return Fail("名字表损坏");
+        }
+        for (int32_t k = 0; k < name_count; ++k) {
+            if (offsets[k] >= offsets[k + 1] || names[offsets[k + 1] - 1] != '\0') {
+                return Fail("名字表损坏");
+            }
+        }
+        for (int32_t g = 0; g < Count(SectionId::GlobalNames); ++g) {
+            int32_t name = Section<int32_t>(SectionId::GlobalNames)[g];
+            if (name < -1 || name >= name_count) {
+                return Fail("全局变量的名字超出范围");
+            }
+        }
+
+        for (int32_t k = 0; k < Count(SectionId::ConstantTypes); ++k) {
+            if (Section<uint8_t>(SectionId::ConstantTypes)[k] > static_cast<uint8_t>(ValueType::Float)) {
+                return Fail("常量池的类型损坏");
+            }
+        }
+        if (Count(SectionId::ConstantTypes) != Count(SectionId::Constants)) {
+            return Fail("常量池的类型与常量个数不一致");
+        }
+
+        /* 函数表；各指令所在函数的栈帧大小 */
+        const auto*          functions = Section<BytecodeFunction>(SectionId::Functions);
+        int32_t              code_size = Count(SectionId::Code);
+        std::vector<int32_t> frame(code_size, -1);
+        for (int32_t f = 0; f < Count(SectionId::Functions); ++f) {
+            const auto& function = functions[f];
+            if (function.entry < 0) {
+                continue;
+            }
+            if (function.entry >= code_size || function.frame_size < 0 || function.name < 0 || function.name >= name_count
+                || function.ret_value < 0 || function.ret_value >= Count(SectionId::GlobalNames) || function.param_begin < 0
+                || function.param_count < 0 || function.param_begin > Count(SectionId::Parameters)
+                || function.param_count > Count(SectionId::Parameters) - function.param_begin) {
+                return Fail("函数表第 " + std::to_string(f) + " 项损坏");
+            }
+            for (int32_t k = 0; k < function.param_count; ++k) {
+                int32_t reg = Section<int32_t>(SectionId::Parameters)[function.param_begin + k];
+                if (reg < -1 || reg >= function.frame_size) {
+                    return Fail("函数表第 " + std::to_string(f) + " 项的形参寄存器超出栈帧");
+                }
+            }
+            if (frame[function.entry] >= 0) {
+                return Fail("函数表第 " + std::to_string(f) + " 项的入口与其他函数重复");
+            }
+            frame[function.entry] = function.frame_size;
+        }
+        if (head.main < 0 || head.main >= Count(SectionId::Functions) || functions[head.main].entry < 0) {
+            return Fail("没有 main 函数");
+        }
+        if (head.main_type < 0 || head.main_type > static_cast<int32_t>(ValueType::Float)) {
+            return Fail("main 的返回类型损坏");
+        }
+
+        /* 各指令所在函数的范围 [begin, end[i])：跳转只能在函数内，否则可以带着较小的栈帧进入栈帧较大的函数 */
+        std::vector<int32_t> end(code_size);
+        for (int32_t i = code_size - 1, next = code_size; i >= 0; --i) {
+            end[i] = next;
+            next   = frame[i] >= 0 ? i : next;
+        }
+
+        /* 指令：函数入口之前的指令没有栈帧 */
+        const auto* code  = Section<Instruction>(SectionId::Code);
+        int32_t     size  = -1;
+        int32_t     begin = 0;
+        for (int32_t i = 0; i < code_size; ++i) {
+            if (frame[i] >= 0) {
+                size  = frame[i];
+                begin = i;
+            }
+            if (code[i].op >= static_cast<uint8_t>(VmOp::Count)) {
+                return Fail("第 " + std::to_string(i) + " 条指令的操作码非法");
+            }
+            VmOp          op          = static_cast<VmOp>(code[i].op);
+            const char*   signature   = Signature(op);
+            const int32_t operands[3] = { code[i].a, code[i].b, code[i].c };
+            for (int k = 0; k < 3; ++k) {
+                int32_t value = operands[k];
+                bool    ok    = true;
+                switch (signature[k]) {
+                    case 'r':
+                        ok = value == -1 || (value >= 0 && value < size);
+                        break;
+                    case 'R':
+                        ok = value >= 0 && value < size;
+                        break;
+                    case 'K':
+                        ok = value >= 0 && value < Count(SectionId::Constants);
+                        break;
+                    case 'G':
+                        ok = value >= 0 && value < Count(SectionId::GlobalNames);
+                        break;
+                    case 'T':
+                        ok = value >= begin && value < end[i];
+                        break;
+                    case 'F':
+                        ok = value >= 0 && value < Count(SectionId::Functions);
+                        break;
+                    default:
+                        break;
+                }
+                if (!ok) {
+                    return Fail("第 " + std::to_string(i) + " 条指令的操作数超出范围");
+                }
+            }
+            /* 也不能顺序执行到下一个函数 */
+            if (i + 1 == end[i] && !IsTerminator(op)) {
+                return Fail("第 " + std::to_string(i) + " 条指令之后是另一个函数，但它不是跳转或返回");
+            }
+            /* 超级指令的比较跳转是下一条指令 */
+            if (op >= VmOp::IAddKJLt && op <= VmOp::IAddKJNeK) {
+                VmOp first = op <= VmOp::IAddKJNe ? VmOp::IJLt : VmOp::IJLtK;
+                VmOp next  = i + 1 < code_size ? static_cast<VmOp>(code[i + 1].op) : VmOp::Count;
+                if (next < first || next > static_cast<VmOp>(static_cast<int>(first) + 5)) {
+                    return Fail("第 " + std::to_string(i) + " 条超级指令之后不是比较跳转");
+                }
+            }
+        }
+        return true;
+    }
+
+    /* 执行后不会顺序执行下一条的指令 */
+    static bool
+    IsTerminator(VmOp op) {
+        return op == VmOp::Jmp || op == VmOp::Ret || op == VmOp::RetR || op == VmOp::RetK;
+    }
+
+    const char* data_; /* 映射的内存 */
+    size_t      size_; /* 映射的字节数 */
+};
+
+#endif // !_OBJECT_FILE_HPP_
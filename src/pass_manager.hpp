@@ -0,0 +1,341 @@
+/**
+ * @file pass_manager.hpp
+ * @brief 中间代码优化遍的管理：有序的遍列表、-O0/-O1/-O2 预设与逐遍统计
+ */
+
+#ifndef _PASS_MANAGER_HPP_
+#define _PASS_MANAGER_HPP_
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "./block_layout.hpp"
+#include "./constant_propagation.hpp"
+#include "./copy_propagation.hpp"
+#include "./inliner.hpp"
+#include "./jump_threading.hpp"
+#include "./loop_optimization.hpp"
+#include "./profile_data.hpp"
+#include "./semantic_analysis.hpp"
+#include "./value_numbering.hpp"
+
+/**
+ * @brief 优化遍管理器
+ *        按加入的顺序执行各遍，每遍执行后输出一行报告；
+ *        同时记录每遍的墙钟时间、执行前后的四元式条数与堆分配次数，由 PrintTiming 输出。
+ *        分配次数来自调用者提供的计数器(compiler.cc 中替换的全局 operator new)，为空时记为 0。
+ *        给出剖析数据时，内联与循环优化按执行次数决策，并可执行按剖析结果重排基本块的 layout 遍
+ */
+class PassManager {
+public:
+    static constexpr int Npos = -1;
+
+    /* 写出遍的结果文件，在计时之外执行 */
+    using Writer = std::function<void()>;
+
+    /**
+     * @brief 一个可用的优化遍：名字(用于 --passes)、报告标题与执行函数
+     *        执行函数返回报告内容(剖析数据可为空)；有结果文件时把写出的函数存入 writer
+     */
+    struct PassInfo {
+        const char* name;
+        const char* title;
+        std::string (*run)(Semantic& semantic, const ProfileData* profile, Writer& writer);
+    };
+
+    /**
+     * @brief 一遍执行的统计
+     */
+    struct PassStats {
+        int    pass;        /* 在 Registry() 中的下标 */
+        double millisecond; /* 墙钟时间 */
+        size_t before;      /* 执行前的四元式条数 */
+        size_t after;       /* 执行后的四元式条数 */
+        size_t allocations; /* 堆分配次数 */
+    };
+
+    explicit PassManager(Semantic& semantic, const size_t* allocation_count = nullptr, const ProfileData* profile = nullptr)
+        : semantic_(semantic), allocation_count_(allocation_count), profile_(profile) {}
+
+    /**
+     * @brief  : 在末尾加入名为 name 的遍
+     * @return : 没有该遍时返回 false
+     */
+    bool
+    Add(const std::string& name) {
+        int pass = Find(name);
+        if (pass != Npos) {
+            passes_.push_back(pass);
+        }
+        return pass != Npos;
+    }
+
+    /**
+     * @brief  : 依次加入以逗号分隔的遍，如 "sccp,gvn,copy-prop,dce"
+     * @return : 第一个不存在的遍名(其后的遍不再加入)，全部存在时为空串
+     */
+    std::string
+    AddList(const std::string& list) {
+        for (const auto& name : Split(list)) {
+            if (!Add(name)) {
+                return name;
+            }
+        }
+        return std::string();
+    }
+
+    /**
+     * @brief  : 检查以逗号分隔的遍列表，用于在分析源程序之前报告命令行错误
+     * @return : 第一个不存在的遍名，全部存在时为空串
+     */
+    static std::string
+    Unknown(const std::string& list) {
+        for (const auto& name : Split(list)) {
+            if (Find(name) == Npos) {
+                return name;
+            }
+        }
+        return std::string();
+    }
+
+    /**
+     * @brief : 加入优化级别 level 的预设遍列表
+     *          O0 不优化；
+     *          O1 为与循环结构无关的标量优化：条件常量传播、值编号、复写传播与死代码删除、跳转优化；
+     *          O2 先内联，在 O1 的基础上加入循环优化，
+     *             旋转得到的守卫常常可以确定，外提与强度削弱留下复写，循环优化之后再做一次常量传播、复写传播与死代码删除；
+     *             删除无用的分支可能使条件中的值不再活跃，跳转优化之后再做一次死代码删除与跳转优化；
+     *          给出剖析数据时(任何级别)最后按剖析结果重排基本块
+     */
+    void
+    AddPreset(int level) {
+        static const char* const o1 = "sccp,gvn,copy-prop,dce,jump-thread";
+        static const char* const o2 =
+            "inline,sccp,gvn,copy-prop,dce,licm,sccp,copy-prop,dce,jump-thread,dce,jump-thread";
+        if (level == 1) {
+            AddList(o1);
+        } else if (level >= 2) {
+            AddList(o2);
+        }
+        if (profile_) {
+            Add("layout");
+        }
+    }
+
+    bool
+    empty() const {
+        return passes_.empty();
+    }
+
+    /**
+     * @brief : 按顺序执行所有遍；verbose 时每遍输出一行报告
+     */
+    void
+    Run(std::ostream& os, bool verbose = true) {
+        const auto& registry = Registry();
+        for (int pass : passes_) {
+            PassStats stats{ pass, 0, semantic_.quadruples().size(), 0, Allocations() };
+            Writer    writer;
+            auto      start  = std::chrono::steady_clock::now();
+            std::string report = registry[pass].run(semantic_, profile_, writer);
+            auto      finish = std::chrono::steady_clock::now();
+
+            stats.allocations = Allocations() - stats.allocations;
+            stats.after       = semantic_.quadruples().size();
+            stats.millisecond = std::chrono::duration<double, std::milli>(finish - start).count();
+            stats_.push_back(stats);
+            if (writer) {
+                writer();
+            }
+            if (verbose) {
+                os << "\n " << registry[pass].title << "：" << report << "；四元式 " << stats.before << " -> " << stats.after
+                   << " 条。" << std::endl;
+            }
+        }
+    }
+
+    /**
+     * @brief : 输出每遍的墙钟时间、四元式条数变化与堆分配次数(报告行与结果文件的输出不计入)
+     */
+    void
+    PrintTiming(std::ostream& os) const {
+        const auto& registry    = Registry();
+        double      total_time  = 0;
+        size_t      total_alloc = 0;
+        auto        flags       = os.flags();
+        auto        precision   = os.precision();
+        os << "\n 各优化遍统计：" << std::endl;
+        os << "\t " << std::left << std::setw(12) << "pass" << std::right << std::setw(12) << "time(ms)" << std::setw(10)
+           << "before" << std::setw(10) << "after" << std::setw(12) << "allocs" << std::endl;
+        for (const auto& stats : stats_) {
+            os << "\t " << std::left << std::setw(12) << registry[stats.pass].name << std::right << std::fixed
+               << std::setprecision(3) << std::setw(12) << stats.millisecond << std::setw(10) << stats.before << std::setw(10)
+               << stats.after << std::setw(12) << stats.allocations << std::endl;
+            total_time += stats.millisecond;
+            total_alloc += stats.allocations;
+        }
+        size_t before = stats_.empty() ? semantic_.quadruples().size() : stats_.front().before;
+        os << "\t " << std::left << std::setw(12) << "total" << std::right << std::fixed << std::setprecision(3)
+           << std::setw(12) << total_time << std::setw(10) << before << std::setw(10) << semantic_.quadruples().size()
+           << std::setw(12) << total_alloc << std::endl;
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    /**
+     * @brief : 所有可用的遍，名字在 --passes 中使用
+     */
+    static const std::vector<PassInfo>&
+    Registry() {
+        static const std::vector<PassInfo> registry{
+            { "inline", "内联", RunInliner },
+            { "sccp", "条件常量传播", RunConstantPropagation },
+            { "gvn", "值编号", RunValueNumbering },
+            { "copy-prop", "复写传播", RunCopyPropagation },
+            { "dce", "死代码删除", RunDeadCodeElimination },
+            { "licm", "循环优化", RunLoopOptimization },
+            { "jump-thread", "跳转优化", RunJumpThreading },
+            { "layout", "基本块布局", RunBlockLayout },
+        };
+        return registry;
+    }
+
+private:
+    /* 遍名在 Registry() 中的下标 */
+    static int
+    Find(const std::string& name) {
+        const auto& registry = Registry();
+        for (size_t i = 0; i < registry.size(); ++i) {
+            if (name == registry[i].name) {
+                return static_cast<int>(i);
+            }
+        }
+        return Npos;
+    }
+
+    /* 按逗号拆分，忽略空项 */
+    static std::vector<std::string>
+    Split(const std::string& list) {
+        std::vector<std::string> names;
+        size_t                   begin = 0;
+        while (begin <= list.size()) {
+            size_t end = list.find(',', begin);
+            end        = end == std::string::npos ? list.size() : end;
+            if (end > begin) {
+                names.push_back(list.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+        return names;
+    }
+
+    size_t
+    Allocations() const {
+        return allocation_count_ ? *allocation_count_ : 0;
+    }
+
+    static std::string
+    RunInliner(Semantic& semantic, const ProfileData* profile, Writer& writer) {
+        std::ostringstream       report;
+        std::shared_ptr<Inliner> inliner = std::make_shared<Inliner>(semantic, profile);
+        inliner->Run();
+        writer = [inliner]() {
+            std::ofstream inline_out("./inline.txt", std::ios::out);
+            inliner->Print(inline_out);
+        };
+        report << inliner->call_sites() << " 个调用点中内联 " << inliner->inlined() << " 个，决策已输出至当前目录下的 inline.txt 文件中";
+        return report.str();
+    }
+
+    static std::string
+    RunConstantPropagation(Semantic& semantic, const ProfileData*, Writer&) {
+        std::ostringstream  report;
+        ConstantPropagation constant_propagation(semantic);
+        constant_propagation.Run();
+        report << "折叠 " << constant_propagation.folded() << " 条运算，确定 " << constant_propagation.resolved_branches()
+               << " 条分支，删除 " << constant_propagation.unreachable_blocks() << " 个不可达基本块";
+        return report.str();
+    }
+
+    static std::string
+    RunValueNumbering(Semantic& semantic, const ProfileData*, Writer&) {
+        std::ostringstream report;
+        ValueNumbering     value_numbering(semantic);
+        value_numbering.Run();
+        report << "块内消除 " << value_numbering.local_eliminated() << " 条、跨基本块消除 "
+               << value_numbering.global_eliminated() << " 条公共子表达式";
+        return report.str();
+    }
+
+    static std::string
+    RunCopyPropagation(Semantic& semantic, const ProfileData*, Writer&) {
+        std::ostringstream report;
+        CopyPropagation    copy_propagation(semantic);
+        copy_propagation.Run();
+        report << "合并 " << copy_propagation.coalesced() << " 条复写，替换 " << copy_propagation.replaced() << " 个操作数";
+        return report.str();
+    }
+
+    static std::string
+    RunDeadCodeElimination(Semantic& semantic, const ProfileData*, Writer&) {
+        std::ostringstream  report;
+        DeadCodeElimination dead_code(semantic);
+        dead_code.Run();
+        report << "删除 " << dead_code.removed() << " 条";
+        return report.str();
+    }
+
+    static std::string
+    RunLoopOptimization(Semantic& semantic, const ProfileData* profile, Writer&) {
+        std::ostringstream report;
+        LoopOptimization   loop_optimization(semantic, profile);
+        loop_optimization.Run();
+        report << "外提 " << loop_optimization.hoisted() << " 条循环不变运算，强度削弱 " << loop_optimization.reduced()
+               << " 条乘法，旋转 " << loop_optimization.rotated() << " 个循环";
+        if (profile) {
+            report << "，跳过 " << loop_optimization.cold() << " 个剖析中未执行的循环";
+        }
+        return report.str();
+    }
+
+    static std::string
+    RunJumpThreading(Semantic& semantic, const ProfileData*, Writer&) {
+        std::ostringstream report;
+        JumpThreading      jump_threading(semantic);
+        jump_threading.Run();
+        report << "串接 " << jump_threading.threaded() << " 条跳转，删除 " << jump_threading.removed_jumps()
+               << " 条跳到下一条的跳转，合并 " << jump_threading.merged() << " 对条件/无条件跳转，删除 "
+               << jump_threading.unreachable() << " 条不可达四元式";
+        return report.str();
+    }
+
+    static std::string
+    RunBlockLayout(Semantic& semantic, const ProfileData* profile, Writer&) {
+        if (!profile) {
+            return "没有剖析数据，不重排";
+        }
+        std::ostringstream report;
+        BlockLayout        layout(semantic, *profile);
+        layout.Run();
+        report << "移动 " << layout.moved() << " 个基本块，取反 " << layout.inverted() << " 条条件跳转，补充 "
+               << layout.inserted() << " 条、删除 " << layout.removed() << " 条无条件跳转";
+        return report.str();
+    }
+
+    Semantic&              semantic_;
+    const size_t*          allocation_count_; /* 堆分配计数器，可为空 */
+    const ProfileData*     profile_;          /* 剖析数据，可为空 */
+    std::vector<int>       passes_;           /* 按执行顺序排列的遍(Registry() 中的下标) */
+    std::vector<PassStats> stats_;            /* 每遍执行的统计 */
+};
+
+constexpr int PassManager::Npos;
+
+#endif // !_PASS_MANAGER_HPP_
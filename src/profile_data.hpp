@@ -0,0 +1,149 @@
+/**
+ * @file profile_data.hpp
+ * @brief 剖析数据：由 --profile 写出、--profile-use 读入的执行计数，驱动按剖析结果的优化
+ */
+
+#ifndef _PROFILE_DATA_HPP_
+#define _PROFILE_DATA_HPP_
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./quadruple.hpp"
+
+/**
+ * @brief 剖析数据
+ *        优化遍会删除、复制四元式并重新编号标号，所以计数不按标号记录，而按在不同的优化选项下都不变的键记录：
+ *          row      行号 次数          - 源程序行的执行次数(该行各四元式执行次数的最大值)
+ *          call     被调函数 行号 次数 - 调用点的调用次数，内联得到的多个副本合计
+ *          function 函数名 次数        - 函数被调用的次数
+ *        文件为文本，每行一项，# 开始的行为注释
+ */
+class ProfileData {
+public:
+    static constexpr int64_t Npos = -1;
+
+    /**
+     * @brief  : 读入剖析数据文件
+     * @return : 文件不存在或格式错误时返回 false
+     */
+    bool
+    Read(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string        kind, name;
+            int                row   = 0;
+            uint64_t           count = 0;
+            if (!(fields >> kind) || kind[0] == '#') {
+                continue;
+            }
+            if (kind == "row" && fields >> row >> count) {
+                AddRow(row, count);
+            } else if (kind == "call" && fields >> name >> row >> count) {
+                AddCall(name, row, count);
+            } else if (kind == "function" && fields >> name >> count) {
+                AddFunction(name, count);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void
+    Write(std::ostream& os) const {
+        os << "# profile data : row <row> <count> | call <callee> <row> <count> | function <name> <count>" << std::endl;
+        for (const auto& row : rows_) {
+            os << "row " << row.first << " " << row.second << std::endl;
+        }
+        for (const auto& call : calls_) {
+            os << "call " << call.first.first << " " << call.first.second << " " << call.second << std::endl;
+        }
+        for (const auto& function : functions_) {
+            os << "function " << function.first << " " << function.second << std::endl;
+        }
+    }
+
+    /* 同一行取最大值 */
+    void
+    AddRow(int row, uint64_t count) {
+        auto& value = rows_[row];
+        value       = count > value ? count : value;
+    }
+
+    void
+    AddCall(const std::string& callee, int row, uint64_t count) {
+        auto& value = calls_[std::make_pair(callee, row)];
+        value += count;
+        max_call_ = value > max_call_ ? value : max_call_;
+    }
+
+    void
+    AddFunction(const std::string& name, uint64_t count) {
+        functions_[name] += count;
+    }
+
+    /* 源程序行的执行次数，不在剖析数据中为 Npos */
+    int64_t
+    row_count(int row) const {
+        auto it = rows_.find(row);
+        return it != rows_.end() ? static_cast<int64_t>(it->second) : Npos;
+    }
+
+    /* 四元式 [begin, end) 的执行次数：所在各行执行次数的最大值，都不在剖析数据中时为 Npos */
+    int64_t
+    range_count(const std::vector<Quadruple>& quadruples, int begin, int end) const {
+        int64_t count = Npos;
+        for (int i = begin; i < end; ++i) {
+            int64_t row = quadruples[i].row >= 0 ? row_count(quadruples[i].row) : Npos;
+            count       = row > count ? row : count;
+        }
+        return count;
+    }
+
+    /* 第 row 行对 callee 的调用次数，不在剖析数据中为 Npos */
+    int64_t
+    call_count(const std::string& callee, int row) const {
+        auto it = calls_.find(std::make_pair(callee, row));
+        return it != calls_.end() ? static_cast<int64_t>(it->second) : Npos;
+    }
+
+    /* 函数被调用的次数，不在剖析数据中为 Npos */
+    int64_t
+    function_count(const std::string& name) const {
+        auto it = functions_.find(name);
+        return it != functions_.end() ? static_cast<int64_t>(it->second) : Npos;
+    }
+
+    /* 调用次数最多的调用点的次数 */
+    uint64_t
+    max_call_count() const {
+        return max_call_;
+    }
+
+    bool
+    empty() const {
+        return rows_.empty();
+    }
+
+private:
+    std::map<int, uint64_t>                         rows_;      /* 行号 -> 执行次数 */
+    std::map<std::pair<std::string, int>, uint64_t> calls_;     /* (被调函数, 行号) -> 调用次数 */
+    std::map<std::string, uint64_t>                 functions_; /* 函数名 -> 调用次数 */
+    uint64_t                                        max_call_ = 0;
+};
+
+constexpr int64_t ProfileData::Npos;
+
+#endif // !_PROFILE_DATA_HPP_
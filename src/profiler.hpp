@@ -0,0 +1,456 @@
+/**
+ * @file profiler.hpp
+ * @brief 四元式解释器的剖析器：按四元式、基本块、源程序行与函数汇总执行次数与用时
+ */
+
+#ifndef _PROFILER_HPP_
+#define _PROFILER_HPP_
+
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "./control_flow.hpp"
+#include "./profile_data.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 剖析器
+ *        计数：每条指令的执行次数与每条调用边(调用者 -> 被调函数)的调用次数，是精确的；
+ *        采样：定时器以固定间隔(实际时间)置位标志，解释器在执行下一条指令之前记录当前指令与调用栈，
+ *        因此采样总在指令之间取得，调用栈总是完整的。各项的用时按采样数占比从执行用时中估计。
+ *        结果按四元式标号、基本块、源程序行与函数汇总，输出平坦剖析、调用图与折叠栈(flamegraph.pl 的输入)
+ */
+class Profiler {
+public:
+    static constexpr int Npos = -1;
+
+    /* 采样间隔(微秒) */
+    static constexpr int SampleInterval = 100;
+
+    explicit Profiler(const Semantic& semantic) : semantic_(semantic), samples_(0), millisecond_(0) {}
+
+    /**
+     * @brief : 开始剖析
+     * @param quadruple_of : 解释器的指令下标 -> 四元式下标，解释器追加的隐式返回为 Npos
+     */
+    void
+    Start(const std::vector<int>& quadruple_of) {
+        quadruple_of_ = quadruple_of;
+        counts_.assign(quadruple_of.size(), 0);
+        instruction_samples_.assign(quadruple_of.size(), 0);
+        calls_.clear();
+        edges_.clear();
+        stacks_.clear();
+        samples_ = 0;
+        Flag()   = 0;
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        sigemptyset(&action.sa_mask);
+        action.sa_flags   = SA_RESTART;
+        action.sa_handler = OnTimer;
+        sigaction(SIGALRM, &action, &old_action_);
+        struct itimerval timer;
+        timer.it_interval.tv_sec  = 0;
+        timer.it_interval.tv_usec = SampleInterval;
+        timer.it_value            = timer.it_interval;
+        setitimer(ITIMER_REAL, &timer, &old_timer_);
+    }
+
+    /**
+     * @brief : 停止采样并按四元式汇总
+     * @param millisecond : 执行用时，按采样占比分配给各项
+     */
+    void
+    Stop(double millisecond) {
+        setitimer(ITIMER_REAL, &old_timer_, nullptr);
+        sigaction(SIGALRM, &old_action_, nullptr);
+        millisecond_ = millisecond;
+        Summarize();
+    }
+
+    /* 是否到了采样的时刻 */
+    static bool
+    Pending() {
+        return Flag() != 0;
+    }
+
+    /* 执行一条指令 */
+    void
+    Count(int instruction) {
+        ++counts_[instruction];
+    }
+
+    /* 一次调用 */
+    void
+    Call(int caller, int callee) {
+        ++edges_[std::make_pair(caller, callee)];
+    }
+
+    /**
+     * @brief : 记录一个采样
+     * @param stack : 调用栈上的函数，从 main 开始，最后一个是当前函数
+     */
+    void
+    Sample(int instruction, const std::vector<int>& stack) {
+        Flag() = 0;
+        ++samples_;
+        ++instruction_samples_[instruction];
+        ++stacks_[stack];
+    }
+
+    /* 采样总数 */
+    uint64_t
+    samples() const {
+        return samples_;
+    }
+
+    /**
+     * @brief : 导出供 --profile-use 使用的剖析数据：各源程序行、调用点与函数的执行次数
+     */
+    void
+    Export(ProfileData& data) const {
+        const auto& quadruples = semantic_.quadruples();
+        for (size_t q = 0; q < quadruples.size(); ++q) {
+            if (rows_of_[q] < 0) {
+                continue;
+            }
+            data.AddRow(rows_of_[q], quadruples_[q].count);
+            if (quadruples[q].operate == Opcode::Call) {
+                data.AddCall(semantic_.FunctionInfo(quadruples[q].arg_1.id).id_name, rows_of_[q], quadruples_[q].count);
+            }
+        }
+        for (size_t f = 0; f < calls_.size(); ++f) {
+            if (calls_[f]) {
+                data.AddFunction(semantic_.FunctionInfo(static_cast<int>(f)).id_name, calls_[f]);
+            }
+        }
+    }
+
+    /**
+     * @brief : 输出采样数与最热的函数、源程序行
+     */
+    void
+    PrintSummary(std::ostream& os) const {
+        os << "\n 剖析：执行 " << Total(quadruples_, &Entry::count) << " 条四元式，采样 " << samples_ << " 次(间隔 "
+           << SampleInterval << " us)";
+        int function = Hottest(functions_);
+        int row      = Hottest(rows_);
+        if (function != Npos) {
+            os << "；最热的函数 " << semantic_.FunctionInfo(function).id_name << " 占 " << Percent(functions_[function].samples)
+               << "%";
+        }
+        if (row != Npos) {
+            os << "，最热的源程序行第 " << row << " 行占 " << Percent(rows_[row].samples) << "%";
+        }
+        os << "。" << std::endl;
+    }
+
+    /**
+     * @brief : 平坦剖析：函数、源程序行、基本块与四元式，各按采样数(其次执行次数)降序
+     */
+    void
+    PrintFlat(std::ostream& os) const {
+        auto flags     = os.flags();
+        auto precision = os.precision();
+        os << std::fixed << std::setprecision(2);
+        os << "flat profile : " << samples_ << " samples every " << SampleInterval << " us, " << millisecond_ << " ms"
+           << std::endl;
+
+        os << std::endl << "functions :" << std::endl;
+        os << std::setw(8) << "self%" << std::setw(12) << "self(ms)" << std::setw(8) << "total%" << std::setw(12)
+           << "total(ms)" << std::setw(12) << "calls" << std::setw(14) << "executed" << "  name" << std::endl;
+        for (int f : Order(functions_)) {
+            const auto& entry = functions_[f];
+            os << std::setw(8) << Percent(entry.samples) << std::setw(12) << Millisecond(entry.samples) << std::setw(8)
+               << Percent(inclusive_[f]) << std::setw(12) << Millisecond(inclusive_[f]) << std::setw(12) << calls_[f]
+               << std::setw(14) << entry.count << "  " << semantic_.FunctionInfo(f).id_name << std::endl;
+        }
+
+        os << std::endl << "rows :" << std::endl;
+        os << std::setw(8) << "self%" << std::setw(12) << "self(ms)" << std::setw(14) << "executed" << "  row" << std::endl;
+        for (int row : Order(rows_)) {
+            os << std::setw(8) << Percent(rows_[row].samples) << std::setw(12) << Millisecond(rows_[row].samples)
+               << std::setw(14) << rows_[row].count << "  " << row << std::endl;
+        }
+
+        os << std::endl << "blocks :" << std::endl;
+        os << std::setw(8) << "self%" << std::setw(12) << "self(ms)" << std::setw(14) << "entries" << std::setw(14)
+           << "executed" << "  block (labels, rows)" << std::endl;
+        const auto& quadruples = semantic_.quadruples();
+        for (int b : Order(blocks_)) {
+            int first = cfg_->begin(b), last = cfg_->end(b) - 1;
+            /* 函数入口不执行，进入块的次数取它的下一条 */
+            int entry = quadruples[first].operate == Opcode::FunBegin && first < last ? first + 1 : first;
+            os << std::setw(8) << Percent(blocks_[b].samples) << std::setw(12) << Millisecond(blocks_[b].samples)
+               << std::setw(14) << quadruples_[entry].count << std::setw(14) << blocks_[b].count << "  B" << b << " ("
+               << quadruples[first].label << "-" << quadruples[last].label << ", " << rows_of_[first] << "-"
+               << rows_of_[last] << ")";
+            if (function_of_[first] != Npos) {
+                os << " in " << semantic_.FunctionInfo(function_of_[first]).id_name;
+            }
+            os << std::endl;
+        }
+
+        os << std::endl << "quadruples :" << std::endl;
+        os << std::setw(8) << "self%" << std::setw(12) << "self(ms)" << std::setw(14) << "executed"
+           << "  label : operate, arg1, arg2, result (row)" << std::endl;
+        for (int q : Order(quadruples_)) {
+            const auto& qua = quadruples[q];
+            os << std::setw(8) << Percent(quadruples_[q].samples) << std::setw(12) << Millisecond(quadruples_[q].samples)
+               << std::setw(14) << quadruples_[q].count << "  " << qua.label << " : ";
+            if (qua.operate == Opcode::FunBegin) {
+                semantic_.PrintOperand(os, qua.arg_1);
+            } else {
+                os << OpcodeText(qua.operate);
+            }
+            os << ", ";
+            semantic_.PrintOperand(os, qua.operate == Opcode::FunBegin ? Operand() : qua.arg_1);
+            os << ", ";
+            semantic_.PrintOperand(os, qua.arg_2);
+            os << ", ";
+            semantic_.PrintOperand(os, qua.result);
+            os << " (" << rows_of_[q] << ")" << std::endl;
+        }
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    /**
+     * @brief : 调用图：每个函数的自身与总用时、被调用次数，以及它的调用者与被调函数(带调用次数)，按总用时降序
+     */
+    void
+    PrintCallGraph(std::ostream& os) const {
+        auto flags     = os.flags();
+        auto precision = os.precision();
+        os << std::fixed << std::setprecision(2);
+        os << "call graph :" << std::endl;
+        os << std::setw(8) << "total%" << std::setw(12) << "self(ms)" << std::setw(12) << "total(ms)" << std::setw(12)
+           << "calls" << "  name" << std::endl;
+        std::vector<int> order(functions_.size());
+        for (size_t f = 0; f < order.size(); ++f) {
+            order[f] = static_cast<int>(f);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return inclusive_[a] > inclusive_[b]; });
+        for (int f : order) {
+            if (!functions_[f].count && !inclusive_[f]) {
+                continue;
+            }
+            os << std::endl
+               << std::setw(8) << Percent(inclusive_[f]) << std::setw(12) << Millisecond(functions_[f].samples)
+               << std::setw(12) << Millisecond(inclusive_[f]) << std::setw(12) << calls_[f] << "  "
+               << semantic_.FunctionInfo(f).id_name << std::endl;
+            for (const auto& edge : edges_) {
+                if (edge.first.second == f) {
+                    os << std::setw(44) << edge.second << "    <- " << semantic_.FunctionInfo(edge.first.first).id_name
+                       << std::endl;
+                }
+            }
+            for (const auto& edge : edges_) {
+                if (edge.first.first == f) {
+                    os << std::setw(44) << edge.second << "    -> " << semantic_.FunctionInfo(edge.first.second).id_name
+                       << std::endl;
+                }
+            }
+        }
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+    /**
+     * @brief : 折叠栈：每行为 "main;f;g 采样数"，可直接作为 flamegraph.pl 的输入
+     */
+    void
+    PrintFolded(std::ostream& os) const {
+        for (const auto& stack : stacks_) {
+            for (size_t k = 0; k < stack.first.size(); ++k) {
+                os << (k ? ";" : "") << semantic_.FunctionInfo(stack.first[k]).id_name;
+            }
+            os << " " << stack.second << std::endl;
+        }
+    }
+
+private:
+    /**
+     * @brief 一项的执行次数与采样数
+     */
+    struct Entry {
+        uint64_t count;
+        uint64_t samples;
+    };
+
+    /* 定时器置位的标志 */
+    static volatile sig_atomic_t&
+    Flag() {
+        static volatile sig_atomic_t flag = 0;
+        return flag;
+    }
+
+    static void
+    OnTimer(int) {
+        Flag() = 1;
+    }
+
+    double
+    Percent(uint64_t samples) const {
+        return samples_ ? 100.0 * samples / samples_ : 0;
+    }
+
+    double
+    Millisecond(uint64_t samples) const {
+        return samples_ ? millisecond_ * samples / samples_ : 0;
+    }
+
+    static uint64_t
+    Total(const std::vector<Entry>& entries, uint64_t Entry::*field) {
+        uint64_t total = 0;
+        for (const auto& entry : entries) {
+            total += entry.*field;
+        }
+        return total;
+    }
+
+    /* 执行过的项按采样数、其次执行次数降序 */
+    static std::vector<int>
+    Order(const std::vector<Entry>& entries) {
+        std::vector<int> order;
+        for (size_t k = 0; k < entries.size(); ++k) {
+            if (entries[k].count || entries[k].samples) {
+                order.push_back(static_cast<int>(k));
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return entries[a].samples != entries[b].samples ? entries[a].samples > entries[b].samples
+                                                            : entries[a].count > entries[b].count;
+        });
+        return order;
+    }
+
+    /* 采样数最多的项，没有采样时为 Npos */
+    static int
+    Hottest(const std::vector<Entry>& entries) {
+        int hottest = Npos;
+        for (size_t k = 0; k < entries.size(); ++k) {
+            if (entries[k].samples && (hottest == Npos || entries[k].samples > entries[hottest].samples)) {
+                hottest = static_cast<int>(k);
+            }
+        }
+        return hottest;
+    }
+
+    /**
+     * @brief : 指令 -> 四元式，再由四元式汇总到基本块、源程序行与函数。
+     *          没有行号的四元式(优化遍插入的)取同一函数中前一条四元式的行
+     */
+    void
+    Summarize() {
+        const auto& quadruples = semantic_.quadruples();
+        const int   size       = static_cast<int>(quadruples.size());
+        cfg_.reset(new ControlFlowGraph(quadruples));
+
+        int functions = 0;
+        int max_row   = 0;
+        for (const auto& qua : quadruples) {
+            if (qua.operate == Opcode::FunBegin || qua.operate == Opcode::Call) {
+                functions = qua.arg_1.id + 1 > functions ? qua.arg_1.id + 1 : functions;
+            }
+            max_row = qua.row > max_row ? qua.row : max_row;
+        }
+        function_of_.assign(size, Npos);
+        rows_of_.assign(size, -1);
+        int function = Npos;
+        int row      = -1;
+        for (int q = 0; q < size; ++q) {
+            if (quadruples[q].operate == Opcode::FunBegin) {
+                function = quadruples[q].arg_1.id;
+                row      = -1;
+            }
+            row             = quadruples[q].row >= 0 ? quadruples[q].row : row;
+            function_of_[q] = function;
+            rows_of_[q]     = row;
+        }
+
+        quadruples_.assign(size, Entry{ 0, 0 });
+        blocks_.assign(cfg_->block_count(), Entry{ 0, 0 });
+        rows_.assign(max_row + 1, Entry{ 0, 0 });
+        functions_.assign(functions, Entry{ 0, 0 });
+        for (size_t i = 0; i < quadruple_of_.size(); ++i) {
+            int q = quadruple_of_[i];
+            if (q == Npos) {
+                continue;
+            }
+            quadruples_[q].count += counts_[i];
+            quadruples_[q].samples += instruction_samples_[i];
+        }
+        for (int q = 0; q < size; ++q) {
+            const auto& entry = quadruples_[q];
+            auto&       block = blocks_[cfg_->block_of(q)];
+            block.count += entry.count;
+            block.samples += entry.samples;
+            if (rows_of_[q] >= 0) {
+                rows_[rows_of_[q]].count += entry.count;
+                rows_[rows_of_[q]].samples += entry.samples;
+            }
+            if (function_of_[q] != Npos) {
+                functions_[function_of_[q]].count += entry.count;
+            }
+        }
+
+        /* 函数的自身采样取栈顶，总采样取栈中出现的所有函数(递归只计一次) */
+        calls_.assign(functions, 0);
+        inclusive_.assign(functions, 0);
+        for (const auto& edge : edges_) {
+            calls_[edge.first.second] += edge.second;
+        }
+        for (const auto& stack : stacks_) {
+            const auto& frames = stack.first;
+            functions_[frames.back()].samples += stack.second;
+            for (size_t k = 0; k < frames.size(); ++k) {
+                if (std::find(frames.begin(), frames.begin() + k, frames[k]) == frames.begin() + k) {
+                    inclusive_[frames[k]] += stack.second;
+                }
+            }
+        }
+    }
+
+    const Semantic& semantic_;
+
+    /* 执行中记录的原始数据 */
+    std::vector<int>                         quadruple_of_;        /* 指令 -> 四元式 */
+    std::vector<uint64_t>                    counts_;              /* 指令 -> 执行次数 */
+    std::vector<uint64_t>                    instruction_samples_; /* 指令 -> 采样数 */
+    std::map<std::pair<int, int>, uint64_t>  edges_;               /* (调用者, 被调函数) -> 调用次数 */
+    std::map<std::vector<int>, uint64_t>     stacks_;              /* 调用栈 -> 采样数 */
+    uint64_t                                 samples_;             /* 采样总数 */
+    double                                   millisecond_;         /* 执行用时 */
+    struct sigaction                         old_action_;
+    struct itimerval                         old_timer_;
+
+    /* 汇总的结果 */
+    std::unique_ptr<ControlFlowGraph> cfg_;
+    std::vector<int>                  function_of_; /* 四元式 -> 所在函数 */
+    std::vector<int>                  rows_of_;     /* 四元式 -> 源程序行 */
+    std::vector<Entry>                quadruples_;  /* 四元式 -> 执行次数与采样数 */
+    std::vector<Entry>                blocks_;      /* 基本块 -> 所含四元式的执行次数之和与采样数 */
+    std::vector<Entry>                rows_;        /* 源程序行 -> 执行次数与采样数 */
+    std::vector<Entry>                functions_;   /* 函数 -> 所含四元式的执行次数之和与自身采样数 */
+    std::vector<uint64_t>             calls_;       /* 函数 -> 被调用次数 */
+    std::vector<uint64_t>             inclusive_;   /* 函数 -> 总采样数(含被调函数) */
+};
+
+constexpr int Profiler::Npos;
+constexpr int Profiler::SampleInterval;
+
+#endif // !_PROFILER_HPP_
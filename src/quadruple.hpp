@@ -0,0 +1,496 @@
+/**
+ * @file quadruple.hpp
+ * @brief 四元式中间代码：操作码、带类别标记的操作数与紧凑的四元式记录
+ */
+
+#ifndef _QUADRUPLE_HPP_
+#define _QUADRUPLE_HPP_
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief 值的类型：void、int、float
+ */
+enum class ValueType : uint8_t { Void, Int, Float };
+
+/**
+ * @brief  : 类型说明符 "int"/"float"/"void" 对应的类型
+ */
+inline ValueType
+SpecifierValueType(const std::string& specifier) {
+    if (specifier == "int")
+        return ValueType::Int;
+    if (specifier == "float")
+        return ValueType::Float;
+    return ValueType::Void;
+}
+
+/**
+ * @brief  : 二元运算两个操作数的公共类型：有 float 则为 float
+ */
+inline ValueType
+PromoteType(ValueType a, ValueType b) {
+    return (a == ValueType::Float || b == ValueType::Float) ? ValueType::Float : ValueType::Int;
+}
+
+/**
+ * @brief 四元式操作码
+ *        算术运算与条件跳转按操作数类型区分，类型转换显式生成四元式；
+ *        赋值、传参、返回只搬运值，不区分类型
+ */
+enum class Opcode : uint8_t {
+    Nop,        /* 空操作(优化过程中被删除的四元式) */
+    FunBegin,   /* 函数入口 : (函数名, -, -, -) */
+    Assign,     /* 赋值 : (:=, 源, -, 目的) */
+    IAdd,       /* 整型运算 : (+, a, b, 结果) */
+    ISub,       /* (-, a, b, 结果) */
+    IMul,       /* (*, a, b, 结果) */
+    IDiv,       /* (/, a, b, 结果) */
+    FAdd,       /* 浮点运算 : (f+, a, b, 结果) */
+    FSub,       /* (f-, a, b, 结果) */
+    FMul,       /* (f*, a, b, 结果) */
+    FDiv,       /* (f/, a, b, 结果) */
+    IntToFloat, /* 类型转换 : (itof, 源, -, 结果) */
+    FloatToInt, /* (ftoi, 源, -, 结果)，向零截断 */
+    Jump,       /* 无条件跳转 : (j, -, -, 目标) */
+    IJumpLt,    /* 整型比较跳转 : (j<, a, b, 目标) */
+    IJumpLe,    /* (j<=, a, b, 目标) */
+    IJumpGt,    /* (j>, a, b, 目标) */
+    IJumpGe,    /* (j>=, a, b, 目标) */
+    IJumpEq,    /* (j==, a, b, 目标) */
+    IJumpNe,    /* (j!=, a, b, 目标) */
+    FJumpLt,    /* 浮点比较跳转 : (fj<, a, b, 目标) */
+    FJumpLe,    /* (fj<=, a, b, 目标) */
+    FJumpGt,    /* (fj>, a, b, 目标) */
+    FJumpGe,    /* (fj>=, a, b, 目标) */
+    FJumpEq,    /* (fj==, a, b, 目标) */
+    FJumpNe,    /* (fj!=, a, b, 目标) */
+    Param,      /* 传递实参 : (param, 实参, -, -) */
+    Call,       /* 函数调用 : (call, 函数, -, 返回值) */
+    Return,     /* 函数返回 : (return, -, -, 函数) */
+};
+
+/**
+ * @brief  : 操作码的文本形式(函数入口的文本为函数名，由调用者处理)
+ */
+inline const char*
+OpcodeText(Opcode op) {
+    switch (op) {
+        case Opcode::Nop:
+            return "nop";
+        case Opcode::FunBegin:
+            return "function";
+        case Opcode::Assign:
+            return ":=";
+        case Opcode::IAdd:
+            return "+";
+        case Opcode::ISub:
+            return "-";
+        case Opcode::IMul:
+            return "*";
+        case Opcode::IDiv:
+            return "/";
+        case Opcode::FAdd:
+            return "f+";
+        case Opcode::FSub:
+            return "f-";
+        case Opcode::FMul:
+            return "f*";
+        case Opcode::FDiv:
+            return "f/";
+        case Opcode::IntToFloat:
+            return "itof";
+        case Opcode::FloatToInt:
+            return "ftoi";
+        case Opcode::Jump:
+            return "j";
+        case Opcode::IJumpLt:
+            return "j<";
+        case Opcode::IJumpLe:
+            return "j<=";
+        case Opcode::IJumpGt:
+            return "j>";
+        case Opcode::IJumpGe:
+            return "j>=";
+        case Opcode::IJumpEq:
+            return "j==";
+        case Opcode::IJumpNe:
+            return "j!=";
+        case Opcode::FJumpLt:
+            return "fj<";
+        case Opcode::FJumpLe:
+            return "fj<=";
+        case Opcode::FJumpGt:
+            return "fj>";
+        case Opcode::FJumpGe:
+            return "fj>=";
+        case Opcode::FJumpEq:
+            return "fj==";
+        case Opcode::FJumpNe:
+            return "fj!=";
+        case Opcode::Param:
+            return "param";
+        case Opcode::Call:
+            return "call";
+        case Opcode::Return:
+            return "return";
+    }
+    return "?";
+}
+
+/**
+ * @brief  : 算术运算符 + - * / 在给定类型下对应的操作码
+ */
+inline Opcode
+ArithOpcode(const char* op, ValueType type) {
+    int offset = type == ValueType::Float ? 4 : 0;
+    switch (op[0]) {
+        case '+':
+            return static_cast<Opcode>(static_cast<int>(Opcode::IAdd) + offset);
+        case '-':
+            return static_cast<Opcode>(static_cast<int>(Opcode::ISub) + offset);
+        case '*':
+            return static_cast<Opcode>(static_cast<int>(Opcode::IMul) + offset);
+        default:
+            return static_cast<Opcode>(static_cast<int>(Opcode::IDiv) + offset);
+    }
+}
+
+/**
+ * @brief  : 关系运算符 > < >= <= == != 在给定类型下对应的条件跳转操作码
+ */
+inline Opcode
+RelopJumpOpcode(const char* op, ValueType type) {
+    Opcode jump;
+    if (!strcmp(op, "<"))
+        jump = Opcode::IJumpLt;
+    else if (!strcmp(op, "<="))
+        jump = Opcode::IJumpLe;
+    else if (!strcmp(op, ">"))
+        jump = Opcode::IJumpGt;
+    else if (!strcmp(op, ">="))
+        jump = Opcode::IJumpGe;
+    else if (!strcmp(op, "=="))
+        jump = Opcode::IJumpEq;
+    else
+        jump = Opcode::IJumpNe;
+    if (type == ValueType::Float) {
+        jump = static_cast<Opcode>(static_cast<int>(jump) + 6);
+    }
+    return jump;
+}
+
+/**
+ * @brief  : 条件跳转能否取反：浮点的 < <= > >= 在操作数含 NaN 时不成立，取反后的比较同样不成立，
+ *           !(a < b) 与 a >= b 不等价，只能保留原跳转；== 与 != 对 NaN 互为取反
+ */
+inline bool
+CanInvertJump(Opcode op) {
+    return (op >= Opcode::IJumpLt && op <= Opcode::IJumpNe) || op == Opcode::FJumpEq || op == Opcode::FJumpNe;
+}
+
+/**
+ * @brief  : 条件跳转取反后的操作码，如 j< -> j>=；只用于 CanInvertJump 成立的跳转
+ */
+inline Opcode
+InvertJump(Opcode op) {
+    switch (op) {
+        case Opcode::IJumpLt:
+            return Opcode::IJumpGe;
+        case Opcode::IJumpLe:
+            return Opcode::IJumpGt;
+        case Opcode::IJumpGt:
+            return Opcode::IJumpLe;
+        case Opcode::IJumpGe:
+            return Opcode::IJumpLt;
+        case Opcode::IJumpEq:
+            return Opcode::IJumpNe;
+        case Opcode::IJumpNe:
+            return Opcode::IJumpEq;
+        case Opcode::FJumpEq:
+            return Opcode::FJumpNe;
+        case Opcode::FJumpNe:
+            return Opcode::FJumpEq;
+        default:
+            return op;
+    }
+}
+
+/**
+ * @brief  : 交换比较的两个操作数后的条件跳转操作码，如 j< -> j>
+ */
+inline Opcode
+MirrorJump(Opcode op) {
+    switch (op) {
+        case Opcode::IJumpLt:
+            return Opcode::IJumpGt;
+        case Opcode::IJumpLe:
+            return Opcode::IJumpGe;
+        case Opcode::IJumpGt:
+            return Opcode::IJumpLt;
+        case Opcode::IJumpGe:
+            return Opcode::IJumpLe;
+        case Opcode::FJumpLt:
+            return Opcode::FJumpGt;
+        case Opcode::FJumpLe:
+            return Opcode::FJumpGe;
+        case Opcode::FJumpGt:
+            return Opcode::FJumpLt;
+        case Opcode::FJumpGe:
+            return Opcode::FJumpLe;
+        default:
+            return op;
+    }
+}
+
+inline bool
+IsConditionalJump(Opcode op) {
+    return op >= Opcode::IJumpLt && op <= Opcode::FJumpNe;
+}
+
+inline bool
+IsJump(Opcode op) {
+    return op == Opcode::Jump || IsConditionalJump(op);
+}
+
+inline bool
+IsArithmetic(Opcode op) {
+    return op >= Opcode::IAdd && op <= Opcode::FDiv;
+}
+
+/* 交换律成立的运算 */
+inline bool
+IsCommutative(Opcode op) {
+    return op == Opcode::IAdd || op == Opcode::IMul || op == Opcode::FAdd || op == Opcode::FMul;
+}
+
+/* 结果只取决于操作数的运算与类型转换，可以被公共子表达式消除 */
+inline bool
+IsComputation(Opcode op) {
+    return IsArithmetic(op) || op == Opcode::IntToFloat || op == Opcode::FloatToInt;
+}
+
+/* 操作数与结果为 float 的运算或比较 */
+inline bool
+IsFloatOp(Opcode op) {
+    return (op >= Opcode::FAdd && op <= Opcode::FDiv) || (op >= Opcode::FJumpLt && op <= Opcode::FJumpNe);
+}
+
+/**
+ * @brief 四元式操作数：类别标记 + 值类型 + 编号
+ *        Variable - 编号为变量在 Semantic 变量数组中的下标
+ *        Temp     - 编号为临时变量序号 (T0, T1 ...)
+ *        Constant - 编号为常量字面量的驻留编号
+ *        Label    - 编号为跳转目标四元式的标号
+ *        Function - 编号为函数在全局符号表中的位置
+ */
+struct Operand {
+    /* Register、Slot 只出现在寄存器分配输出的代码中：物理寄存器(按值类型分为整型与浮点两类)与栈帧中的溢出槽 */
+    enum Kind : uint8_t { None, Variable, Temp, Constant, Label, Function, Register, Slot };
+    Kind      kind;
+    ValueType type; /* 变量、临时变量、常量的值类型；其余为 Void */
+    int       id;
+
+    Operand() : kind(None), type(ValueType::Void), id(-1) {}
+    Operand(Kind kind, int id, ValueType type = ValueType::Void) : kind(kind), type(type), id(id) {}
+
+    bool
+    IsNone() const {
+        return kind == None;
+    }
+    /* 变量或临时变量：可以被赋值的位置 */
+    bool
+    IsLocation() const {
+        return kind == Variable || kind == Temp;
+    }
+    friend bool
+    operator==(const Operand& a, const Operand& b) {
+        return a.kind == b.kind && a.id == b.id && a.type == b.type;
+    }
+    friend bool
+    operator!=(const Operand& a, const Operand& b) {
+        return !(a == b);
+    }
+};
+
+/**
+ * @brief 四元式定义
+ *        跳转目标为 Label 类操作数，直接保存目标四元式的整数标号
+ */
+struct Quadruple {
+    int     label;   /* 四元式的标号 */
+    Opcode  operate; /* 操作类型 */
+    Operand arg_1;   /* 参数 1 */
+    Operand arg_2;   /* 参数 2 */
+    Operand result;  /* 结果 */
+    int     row;     /* 对应的源程序行，未知为 -1 */
+    Quadruple(const int      label,
+              const Opcode   ope,
+              const Operand& arg1,
+              const Operand& arg2,
+              const Operand& res,
+              const int      row = -1)
+        : label(label), operate(ope), arg_1(arg1), arg_2(arg2), result(res), row(row) {}
+};
+
+/* 对 result 赋值的四元式 */
+inline bool
+DefinesResult(Opcode op) {
+    return op == Opcode::Assign || IsArithmetic(op) || op == Opcode::IntToFloat || op == Opcode::FloatToInt
+           || op == Opcode::Call;
+}
+
+/* 读取 arg_1 的四元式 */
+inline bool
+ReadsArg1(Opcode op) {
+    return op == Opcode::Assign || IsArithmetic(op) || op == Opcode::IntToFloat || op == Opcode::FloatToInt
+           || IsConditionalJump(op) || op == Opcode::Param;
+}
+
+/* 读取 arg_2 的四元式 */
+inline bool
+ReadsArg2(Opcode op) {
+    return IsArithmetic(op) || IsConditionalJump(op);
+}
+
+/**
+ * @brief 编译期常量与运行时的值：int 为 64 位有符号整数，float 为双精度浮点数
+ */
+union Value {
+    int64_t i;
+    double  f;
+};
+
+/**
+ * @brief  : 计算算术运算 a op b
+ * @return : 结果无定义(整数除以 0、溢出的除法)时返回 false
+ */
+inline bool
+EvalArith(Opcode op, Value a, Value b, Value& result) {
+    /* 整数运算按补码回绕，避免有符号溢出 */
+    switch (op) {
+        case Opcode::IAdd:
+            result.i = static_cast<int64_t>(static_cast<uint64_t>(a.i) + static_cast<uint64_t>(b.i));
+            return true;
+        case Opcode::ISub:
+            result.i = static_cast<int64_t>(static_cast<uint64_t>(a.i) - static_cast<uint64_t>(b.i));
+            return true;
+        case Opcode::IMul:
+            result.i = static_cast<int64_t>(static_cast<uint64_t>(a.i) * static_cast<uint64_t>(b.i));
+            return true;
+        case Opcode::IDiv:
+            if (b.i == 0 || (b.i == -1 && a.i == INT64_MIN)) {
+                return false;
+            }
+            result.i = a.i / b.i;
+            return true;
+        case Opcode::FAdd:
+            result.f = a.f + b.f;
+            return true;
+        case Opcode::FSub:
+            result.f = a.f - b.f;
+            return true;
+        case Opcode::FMul:
+            result.f = a.f * b.f;
+            return true;
+        case Opcode::FDiv:
+            result.f = a.f / b.f;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief  : 计算类型转换
+ * @return : float 超出 int 的表示范围(含 NaN)时返回 false
+ */
+inline bool
+EvalConvert(Opcode op, Value a, Value& result) {
+    if (op == Opcode::IntToFloat) {
+        result.f = static_cast<double>(a.i);
+        return true;
+    }
+    if (!(a.f > -9223372036854775808.0 && a.f < 9223372036854775808.0)) {
+        return false;
+    }
+    result.i = static_cast<int64_t>(a.f);
+    return true;
+}
+
+/**
+ * @brief  : 计算条件跳转的条件是否成立
+ */
+inline bool
+EvalCondition(Opcode op, Value a, Value b) {
+    switch (op) {
+        case Opcode::IJumpLt:
+            return a.i < b.i;
+        case Opcode::IJumpLe:
+            return a.i <= b.i;
+        case Opcode::IJumpGt:
+            return a.i > b.i;
+        case Opcode::IJumpGe:
+            return a.i >= b.i;
+        case Opcode::IJumpEq:
+            return a.i == b.i;
+        case Opcode::IJumpNe:
+            return a.i != b.i;
+        case Opcode::FJumpLt:
+            return a.f < b.f;
+        case Opcode::FJumpLe:
+            return a.f <= b.f;
+        case Opcode::FJumpGt:
+            return a.f > b.f;
+        case Opcode::FJumpGe:
+            return a.f >= b.f;
+        case Opcode::FJumpEq:
+            return a.f == b.f;
+        case Opcode::FJumpNe:
+            return a.f != b.f;
+        default:
+            return true;
+    }
+}
+
+/**
+ * @brief  : 删除所有 Nop 四元式；指向被删除四元式的跳转改为指向其后第一条保留的四元式
+ * @return : 删除的四元式条数
+ */
+inline int
+RemoveNops(std::vector<Quadruple>& quadruples) {
+    int max_label = 0;
+    for (const auto& qua : quadruples) {
+        max_label = qua.label > max_label ? qua.label : max_label;
+    }
+    /* 标号 -> 跳转到该标号时实际到达的标号；末尾被删除的四元式对应最后标号的下一个 */
+    std::vector<int> forward(max_label + 1, -1);
+    int              next_kept = max_label + 1;
+    for (int i = static_cast<int>(quadruples.size()) - 1; i >= 0; --i) {
+        if (quadruples[i].operate != Opcode::Nop) {
+            next_kept = quadruples[i].label;
+        }
+        forward[quadruples[i].label] = next_kept;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < quadruples.size(); ++i) {
+        if (quadruples[i].operate == Opcode::Nop) {
+            continue;
+        }
+        auto& qua = quadruples[i];
+        if (IsJump(qua.operate) && qua.result.id >= 0 && qua.result.id <= max_label && forward[qua.result.id] != -1) {
+            qua.result.id = forward[qua.result.id];
+        }
+        quadruples[kept++] = qua;
+    }
+    int removed = static_cast<int>(quadruples.size() - kept);
+    quadruples.erase(quadruples.begin() + kept, quadruples.end());
+    return removed;
+}
+
+#endif // !_QUADRUPLE_HPP_
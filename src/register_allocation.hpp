@@ -0,0 +1,441 @@
+/**
+ * @file register_allocation.hpp
+ * @brief 基于活跃区间的线性扫描寄存器分配
+ */
+
+#ifndef _REGISTER_ALLOCATION_HPP_
+#define _REGISTER_ALLOCATION_HPP_
+
+#include <ostream>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./liveness.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief 线性扫描寄存器分配(Poletto & Sarkar)
+ *        目标机器模型：每个栈帧有 registers 个整型寄存器与 registers 个浮点寄存器(调用不破坏调用者的寄存器)，
+ *        其中编号最大的两个作为暂存寄存器，不参与分配；溢出的值放在栈帧的溢出槽中。
+ *        临时变量与函数的局部变量(形参、函数中定义的变量)参与分配；
+ *        全局变量与返回值变量(调用者在调用之后读取)仍是内存中的变量。
+ *        每个函数：
+ *          1. 活跃区间：按四元式顺序编号，区间覆盖值的所有定值、使用以及活跃的基本块边界；形参在函数入口定值
+ *          2. 按区间起点计数排序，扫描时维护按终点排序的活动区间(不超过可分配的寄存器数)；
+ *             没有空闲寄存器时溢出活动区间与当前区间中终点最远的一个
+ *          3. 改写：寄存器与溢出槽代替原操作数；溢出槽只能由复写读写，
+ *             其他四元式读取溢出的值之前插入复写装入暂存寄存器，结果溢出时写入暂存寄存器后插入复写存回溢出槽
+ *        除活跃分析外，分配与改写的时间与函数的四元式条数成线性关系。
+ *        输出的代码中插入的四元式与原四元式使用相同的标号，跳到该标号即跳到其中的第一条
+ */
+class RegisterAllocation {
+public:
+    static constexpr int Npos = -1;
+
+    /* 不参与分配的暂存寄存器个数：一条四元式最多读取两个溢出的值 */
+    static constexpr int ScratchRegisters = 2;
+
+    /**
+     * @brief 一个值的活跃区间与分配到的位置：区间不拆分，值在整个区间中都在同一位置
+     */
+    struct Interval {
+        Operand value;    /* 临时变量或局部变量 */
+        Operand location; /* 寄存器或溢出槽 */
+        int     start;    /* 在 code() 中的范围 [start, end] */
+        int     end;
+    };
+
+    /**
+     * @brief 一个函数(或程序开头不属于任何函数的四元式)分配的结果
+     */
+    struct Frame {
+        int                   function;     /* 函数在全局符号表中的位置，程序开头为 Npos */
+        int                   begin;        /* 在 code() 中的范围 [begin, end) */
+        int                   end;
+        int                   registers[2]; /* 使用的整型、浮点寄存器个数(含暂存寄存器) */
+        int                   slots;        /* 溢出槽个数 */
+        std::vector<Operand>  parameters;   /* 各形参所在的寄存器或溢出槽，函数中没有出现的形参为空操作数 */
+        std::vector<Interval> intervals;    /* 参与分配的值，按区间起点排序 */
+    };
+
+    /**
+     * @param registers : 每类寄存器的个数，至少为暂存寄存器个数 + 1
+     */
+    explicit RegisterAllocation(const Semantic& semantic, int registers = 16)
+        : semantic_(semantic),
+          registers_(registers > ScratchRegisters ? registers : ScratchRegisters + 1),
+          intervals_(0),
+          spilled_(0),
+          spill_code_(0) {}
+
+    /**
+     * @brief : 对所有函数分配寄存器并生成改写后的代码
+     */
+    void
+    Run() {
+        const auto&      quadruples = semantic_.quadruples();
+        ControlFlowGraph cfg(quadruples);
+        Liveness         liveness(semantic_, quadruples, cfg);
+        const auto&      entries = cfg.entries();
+        code_.clear();
+        frames_.clear();
+        code_.reserve(quadruples.size());
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int first = entries[f];
+            int last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+            liveness.Compute(first, last);
+            AllocateFunction(cfg, liveness, first, last);
+        }
+    }
+
+    /* 改写后的代码 */
+    const std::vector<Quadruple>&
+    code() const {
+        return code_;
+    }
+
+    /* 按出现顺序排列的各函数的分配结果 */
+    const std::vector<Frame>&
+    frames() const {
+        return frames_;
+    }
+
+    /* 每类寄存器的个数 */
+    int
+    registers() const {
+        return registers_;
+    }
+
+    /* 参与分配的活跃区间个数 */
+    int
+    intervals() const {
+        return intervals_;
+    }
+
+    /* 溢出的活跃区间个数 */
+    int
+    spilled() const {
+        return spilled_;
+    }
+
+    /* 插入的装入与存回复写条数 */
+    int
+    spill_code() const {
+        return spill_code_;
+    }
+
+    /**
+     * @brief : 输出每个函数的寄存器与溢出槽使用情况、形参的位置以及改写后的代码
+     */
+    void
+    Print(std::ostream& os) const {
+        os << "registers : " << registers_ << " int (R), " << registers_ << " float (F), last " << ScratchRegisters
+           << " of each are scratch" << std::endl;
+        for (const auto& frame : frames_) {
+            os << std::endl;
+            if (frame.function == Npos) {
+                os << "(program start)";
+            } else {
+                semantic_.PrintOperand(os, Operand(Operand::Function, frame.function));
+            }
+            os << " : R " << frame.registers[0] << ", F " << frame.registers[1] << ", slots " << frame.slots;
+            for (size_t k = 0; k < frame.parameters.size(); ++k) {
+                os << (k ? ", " : ", params ");
+                semantic_.PrintOperand(os, frame.parameters[k]);
+            }
+            os << std::endl;
+            for (int i = frame.begin; i < frame.end; ++i) {
+                const auto& qua = code_[i];
+                os << "    " << qua.label << " : ";
+                if (qua.operate == Opcode::FunBegin) {
+                    semantic_.PrintOperand(os, qua.arg_1);
+                } else {
+                    os << OpcodeText(qua.operate);
+                }
+                os << ", ";
+                semantic_.PrintOperand(os, qua.operate == Opcode::FunBegin ? Operand() : qua.arg_1);
+                os << ", ";
+                semantic_.PrintOperand(os, qua.arg_2);
+                os << ", ";
+                semantic_.PrintOperand(os, qua.result);
+                os << std::endl;
+            }
+        }
+    }
+
+private:
+    /* 寄存器类别：整型 0，浮点 1 */
+    static int
+    ClassOf(const Operand& opd) {
+        return opd.type == ValueType::Float ? 1 : 0;
+    }
+
+    /* 参与分配的槽位：临时变量与非返回值的局部变量 */
+    bool
+    Allocatable(const Operand& opd) const {
+        if (opd.kind == Operand::Temp) {
+            return true;
+        }
+        return opd.kind == Operand::Variable && !semantic_.IsGlobalVariable(opd.id)
+               && semantic_.VariableInfo(opd.id).id_type != IdentifierInfo::ReturnVar;
+    }
+
+    void
+    Extend(int slot, int position) {
+        if (start_[slot] == Npos || position < start_[slot]) {
+            start_[slot] = position;
+        }
+        if (position > end_[slot]) {
+            end_[slot] = position;
+        }
+    }
+
+    /* 活跃集合中的每个槽位延伸到 position */
+    void
+    ExtendSet(const Liveness::BitSet& set, int position) {
+        for (size_t w = 0; w < set.size(); ++w) {
+            for (uint64_t bits = set[w]; bits; bits &= bits - 1) {
+                Extend(static_cast<int>(w * 64 + __builtin_ctzll(bits)), position);
+            }
+        }
+    }
+
+    void
+    AllocateFunction(const ControlFlowGraph& cfg, const Liveness& liveness, int first, int last) {
+        const auto& quadruples = semantic_.quadruples();
+        const int   base       = cfg.begin(first);
+        const int   length     = cfg.end(last - 1) - base;
+        const int   slots      = liveness.slot_count();
+        const auto& entry      = quadruples[base];
+
+        Frame frame{ entry.operate == Opcode::FunBegin ? entry.arg_1.id : Npos, 0, 0, { 0, 0 }, 0, {}, {} };
+
+        /* 1. 活跃区间 */
+        start_.assign(slots, Npos);
+        end_.assign(slots, Npos);
+        for (int b = first; b < last; ++b) {
+            ExtendSet(liveness.LiveInSet(b), cfg.begin(b) - base);
+            ExtendSet(liveness.LiveOutSet(b), cfg.end(b) - 1 - base);
+        }
+        for (int i = 0; i < length; ++i) {
+            const auto& qua = quadruples[base + i];
+            liveness.ForEachUse(qua, [&](int s) { Extend(s, i); });
+            int slot = DefinesResult(qua.operate) ? liveness.Slot(qua.result) : Npos;
+            if (slot != Npos) {
+                Extend(slot, i);
+            }
+        }
+        if (frame.function != Npos) {
+            for (int k = 0; k < semantic_.FunctionInfo(frame.function).parameter_num; ++k) {
+                int slot = liveness.Slot(Operand(Operand::Variable, semantic_.ParameterVariable(frame.function, k)));
+                if (slot != Npos) {
+                    Extend(slot, 0);
+                }
+            }
+        }
+
+        /* 2. 按起点计数排序后分别扫描两类寄存器 */
+        std::vector<int> order;
+        order.reserve(slots);
+        bucket_.assign(length + 1, 0);
+        for (int s = 0; s < slots; ++s) {
+            if (start_[s] != Npos && Allocatable(liveness.slot_operand(s))) {
+                ++bucket_[start_[s] + 1];
+            }
+        }
+        for (int i = 0; i < length; ++i) {
+            bucket_[i + 1] += bucket_[i];
+        }
+        order.resize(bucket_[length]);
+        for (int s = 0; s < slots; ++s) {
+            if (start_[s] != Npos && Allocatable(liveness.slot_operand(s))) {
+                order[bucket_[start_[s]]++] = s;
+            }
+        }
+        intervals_ += static_cast<int>(order.size());
+
+        location_.assign(slots, Operand());
+        for (int s = 0; s < slots; ++s) {
+            location_[s] = liveness.slot_operand(s);
+        }
+        for (int c = 0; c < 2; ++c) {
+            frame.registers[c] = Scan(order, liveness, c, frame.slots);
+        }
+
+        /* 3. 改写，记录每条四元式改写后的起点以换算区间 */
+        frame.begin = static_cast<int>(code_.size());
+        position_.resize(length + 1);
+        for (int i = 0; i < length; ++i) {
+            position_[i] = static_cast<int>(code_.size());
+            Rewrite(quadruples[base + i], liveness, frame);
+        }
+        frame.end         = static_cast<int>(code_.size());
+        position_[length] = frame.end;
+        for (int s : order) {
+            frame.intervals.push_back(
+                Interval{ liveness.slot_operand(s), location_[s], position_[start_[s]], position_[end_[s] + 1] - 1 });
+        }
+
+        if (frame.function != Npos) {
+            for (int k = 0; k < semantic_.FunctionInfo(frame.function).parameter_num; ++k) {
+                int slot = liveness.Slot(Operand(Operand::Variable, semantic_.ParameterVariable(frame.function, k)));
+                frame.parameters.push_back(slot != Npos ? location_[slot] : Operand());
+            }
+        }
+        frames_.push_back(frame);
+    }
+
+    /**
+     * @brief  : 对类别 c 的区间做线性扫描，溢出的区间依次分配溢出槽
+     * @return : 使用的寄存器个数(不含暂存寄存器)
+     */
+    int
+    Scan(const std::vector<int>& order, const Liveness& liveness, int c, int& slots) {
+        const int allocatable = registers_ - ScratchRegisters;
+        int       used        = 0;
+        free_.clear();
+        for (int r = allocatable - 1; r >= 0; --r) {
+            free_.push_back(r);
+        }
+        active_.clear();
+        for (int s : order) {
+            const Operand& opd = liveness.slot_operand(s);
+            if (ClassOf(opd) != c) {
+                continue;
+            }
+            /* 终点在当前起点之前的区间结束，释放其寄存器 */
+            size_t expired = 0;
+            while (expired < active_.size() && end_[active_[expired]] < start_[s]) {
+                free_.push_back(location_[active_[expired]].id);
+                ++expired;
+            }
+            active_.erase(active_.begin(), active_.begin() + expired);
+
+            if (!free_.empty()) {
+                location_[s] = Operand(Operand::Register, free_.back(), opd.type);
+                free_.pop_back();
+                used = location_[s].id + 1 > used ? location_[s].id + 1 : used;
+                Activate(s);
+                continue;
+            }
+            /* 溢出终点最远的区间 */
+            int victim = active_.empty() ? Npos : active_.back();
+            if (victim != Npos && end_[victim] > end_[s]) {
+                location_[s]      = location_[victim];
+                location_[victim] = Operand(Operand::Slot, slots++, liveness.slot_operand(victim).type);
+                active_.pop_back();
+                Activate(s);
+            } else {
+                location_[s] = Operand(Operand::Slot, slots++, opd.type);
+            }
+            ++spilled_;
+        }
+        return used;
+    }
+
+    /* 按终点有序插入活动区间 */
+    void
+    Activate(int slot) {
+        size_t pos = active_.size();
+        active_.push_back(slot);
+        while (pos > 0 && end_[active_[pos - 1]] > end_[slot]) {
+            active_[pos] = active_[pos - 1];
+            --pos;
+        }
+        active_[pos] = slot;
+    }
+
+    /* 操作数分配到的位置，不参与分析的操作数不变 */
+    Operand
+    Locate(const Operand& opd, const Liveness& liveness) const {
+        int slot = liveness.Slot(opd);
+        return slot == Npos ? opd : location_[slot];
+    }
+
+    /* 第 k 个暂存寄存器，同时记录在栈帧使用的寄存器个数中 */
+    Operand
+    Scratch(int k, ValueType type, Frame& frame) const {
+        int c              = type == ValueType::Float ? 1 : 0;
+        frame.registers[c] = registers_;
+        return Operand(Operand::Register, registers_ - ScratchRegisters + k, type);
+    }
+
+    void
+    Rewrite(const Quadruple& original, const Liveness& liveness, Frame& frame) {
+        Quadruple qua = original;
+        if (ReadsArg1(qua.operate)) {
+            qua.arg_1 = Locate(qua.arg_1, liveness);
+        }
+        if (ReadsArg2(qua.operate)) {
+            qua.arg_2 = Locate(qua.arg_2, liveness);
+        }
+        if (DefinesResult(qua.operate)) {
+            qua.result = Locate(qua.result, liveness);
+        }
+
+        /* 复写本身就是装入或存回 */
+        bool load  = qua.arg_1.kind == Operand::Slot;
+        bool store = qua.result.kind == Operand::Slot;
+        if (qua.operate == Opcode::Assign && load != store) {
+            code_.push_back(qua);
+            return;
+        }
+
+        int     scratch = 0;
+        Operand spill   = qua.arg_1;
+        if (load) {
+            qua.arg_1 = Scratch(scratch++, spill.type, frame);
+            code_.push_back(Quadruple(qua.label, Opcode::Assign, spill, Operand(), qua.arg_1, qua.row));
+            ++spill_code_;
+        }
+        if (qua.arg_2.kind == Operand::Slot) {
+            if (load && qua.arg_2 == spill) {
+                qua.arg_2 = qua.arg_1;
+            } else {
+                Operand value = qua.arg_2;
+                qua.arg_2     = Scratch(scratch++, value.type, frame);
+                code_.push_back(Quadruple(qua.label, Opcode::Assign, value, Operand(), qua.arg_2, qua.row));
+                ++spill_code_;
+            }
+        }
+        if (qua.operate == Opcode::Assign && store) {
+            /* 溢出槽之间的复写：装入暂存寄存器后直接存回 */
+            code_.push_back(Quadruple(qua.label, Opcode::Assign, qua.arg_1, Operand(), qua.result, qua.row));
+            ++spill_code_;
+            return;
+        }
+        if (store) {
+            Operand target = qua.result;
+            qua.result     = Scratch(0, target.type, frame);
+            code_.push_back(qua);
+            code_.push_back(Quadruple(qua.label, Opcode::Assign, qua.result, Operand(), target, qua.row));
+            ++spill_code_;
+            return;
+        }
+        code_.push_back(qua);
+    }
+
+    const Semantic& semantic_;
+    int             registers_; /* 每类寄存器的个数 */
+
+    std::vector<int>     start_;    /* 槽位 -> 活跃区间起点(函数内的四元式序号)，不出现为 Npos */
+    std::vector<int>     end_;      /* 槽位 -> 活跃区间终点 */
+    std::vector<int>     bucket_;   /* 计数排序的桶 */
+    std::vector<int>     free_;     /* 空闲寄存器 */
+    std::vector<int>     active_;   /* 按终点排序的活动区间 */
+    std::vector<Operand> location_; /* 槽位 -> 寄存器、溢出槽或原操作数 */
+    std::vector<int>     position_; /* 函数内的四元式序号 -> 改写后在 code() 中的起点 */
+
+    std::vector<Quadruple> code_;   /* 改写后的代码 */
+    std::vector<Frame>     frames_; /* 各函数的分配结果 */
+
+    int intervals_;  /* 参与分配的活跃区间个数 */
+    int spilled_;    /* 溢出的活跃区间个数 */
+    int spill_code_; /* 插入的装入与存回复写条数 */
+};
+
+constexpr int RegisterAllocation::Npos;
+constexpr int RegisterAllocation::ScratchRegisters;
+
+#endif // !_REGISTER_ALLOCATION_HPP_
@@ -0,0 +1,67 @@
+/**
+ * @file runner.cc
+ * @brief 执行 compiler -c 生成的字节码目标文件：映射到内存、校验后直接在虚拟机中执行，不再经过词法与语法分析
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "object_file.hpp"
+#include "vm.hpp"
+
+using namespace std;
+
+void
+usage(const char* prompt = nullptr) {
+    if (prompt)
+        cout << prompt << endl;
+    cout << "用法如下：" << endl;
+    cout << "    ./runner [目标文件路径] : 执行 ./compiler -c 生成的字节码目标文件，以 main 的返回值作为退出码" << endl;
+    cout << "    -s : 输出装入用时以及虚拟机执行的返回值、调用次数与用时" << endl;
+    cout << "例：" << endl;
+    cout << "    ./compiler -x source.txt -g grammar.txt -O -c source.qbc && ./runner -s source.qbc" << endl;
+}
+
+int
+main(int argc, char** argv) {
+    string object_path;
+    bool   stats = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-s")) {
+            stats = true;
+        } else if (argv[i][0] != '-' && object_path.empty()) {
+            object_path = argv[i];
+        } else {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (object_path.empty()) {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    auto       start = chrono::steady_clock::now();
+    ObjectFile object;
+    if (!object.Open(object_path)) {
+        exit(EXIT_FAILURE);
+    }
+    double load_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    VirtualMachine machine(object.View());
+    if (!machine.Run()) {
+        exit(EXIT_FAILURE);
+    }
+    if (stats) {
+        cout << "\n 装入目标文件 " << object_path << "：" << object.size() << " 字节，映射并校验用时 " << load_time << " ms。"
+             << endl;
+        machine.Print(cout);
+    }
+    return object.View().main_type == ValueType::Float ? static_cast<int>(machine.exit_value().f)
+                                                          : static_cast<int>(machine.exit_value().i);
+}
@@ -1,28 +1,53 @@
 #ifndef _SEMANTIC_ANALYSIS_HPP_
 #define _SEMANTIC_ANALYSIS_HPP_
 
+#include <iostream>
 #include <string>
 #include <vector>
 
-#include "./grammatical_analysis.hpp"
+#include <cstdio>
+#include <cstdlib>
+
 #include "./lexical_analysis.hpp"
+#include "./quadruple.hpp"
 #include "./util.hpp"
 
 /**
  * @brief 语义分析过程中符号的具体信息
  */
 struct SymbolAttribute {
-    token_t token;          /* 符号标识 */
-    value_t value;          /* 符号的具体值 */
+    int     token;          /* 符号标识(驻留编号) */
+    int     value;          /* 符号的具体值(驻留编号)，没有值时为 StringPool::Npos */
     int     row;            /* 所在行号 */
     int     table_index;    /* 符号所处的table的index */
     int     in_table_index; /* 符号所处的table内部的index */
-    SymbolAttribute(const token_t& token        = "",
-                    const value_t& value        = "",
-                    const int      row          = -1,
-                    const int      table_idx    = -1,
-                    const int      in_table_idx = -1)
-        : token(token), value(value), row(row), table_index(table_idx), in_table_index(in_table_idx) {}
+    int     number;         /* 整数属性：四元式标号、实参个数等 */
+    Operand place;          /* 表达式的值所在的位置(变量/临时变量/常量) */
+    int     true_list;      /* 条件表达式的真出口跳转链表，-1 表示空 */
+    int     false_list;     /* 条件表达式的假出口跳转链表，-1 表示空 */
+    SymbolAttribute(const int token        = StringPool::Npos,
+                    const int value        = StringPool::Npos,
+                    const int row          = -1,
+                    const int table_idx    = -1,
+                    const int in_table_idx = -1,
+                    const int number       = -1)
+        : token(token),
+          value(value),
+          row(row),
+          table_index(table_idx),
+          in_table_index(in_table_idx),
+          number(number),
+          true_list(-1),
+          false_list(-1) {}
+    SymbolAttribute(const int token, const Operand& place) : SymbolAttribute(token) {
+        this->place = place;
+    }
+
+    /* 表达式以真/假出口跳转链表表示(尚未求出值) */
+    bool
+    IsCondition() const {
+        return true_list != -1 || false_list != -1;
+    }
 };
 /**
  * @brief 语义分析过程中标识符的具体信息
@@ -37,10 +62,12 @@ struct IdentifierInfo {
     IdentifierType id_type; /* 标识符类别 */
     SpecifierType  sp_type; /* 变(常)量类型/函数返回类型 */
     std::string    id_name; /* 标识符名/常量值 */
+    int            name_id; /* 标识符名的驻留编号 */
 
     int parameter_num;        /* 函数参数个数 */
     int function_entry;       /* 函数入口地址(四元式的标号) */
     int function_table_index; /* 函数的函数符号表在整个程序的符号表列表中的索引 */
+    int variable_index;       /* 变量在整个程序的变量数组中的下标(四元式操作数编号)，非变量为 -1 */
 
     IdentifierInfo() = default;
     IdentifierInfo(const IdentifierType id_type,
@@ -52,9 +79,27 @@ struct IdentifierInfo {
         : id_type(id_type),
           sp_type(sp_type),
           id_name(id_name),
+          name_id(StringPool::Npos),
           parameter_num(parameter_num),
           function_entry(function_entry),
-          function_table_index(fun_table_idx) {}
+          function_table_index(fun_table_idx),
+          variable_index(-1) {}
+};
+
+/**
+ * @brief 变量在符号表中的位置；四元式中的变量操作数以其在变量数组中的下标为编号
+ */
+struct VariableRef {
+    int table_index;    /* 变量所在符号表的index */
+    int in_table_index; /* 变量在符号表内部的index */
+};
+
+/**
+ * @brief 正在分析实参的函数调用
+ */
+struct PendingCall {
+    int function;  /* 被调函数在全局符号表中的位置，未定义时为 -1 */
+    int arg_count; /* 已分析的实参个数 */
 };
 
 /**
@@ -87,24 +132,30 @@ public:
     table(void) {
         return this->table_;
     }
+    const std::vector<IdentifierInfo>&
+    table(void) const {
+        return this->table_;
+    }
 
+    /**
+     * @brief  : 按驻留编号查找符号，与表的大小无关
+     * @return : 符号在表中的位置；不存在时返回 -1
+     */
     int
-    FindSymbol(const std::string& id_name) const {
-        int len = static_cast<int>(table_.size());
-        for (int i = 0; i < len; ++i) {
-            if (table_[i].id_name == id_name) {
-                return i;
-            }
+    FindSymbol(int name_id) const {
+        if (name_id < 0) {
+            return -1;
         }
-        return -1;
+        return index_.Find(name_id);
     }
 
     int
     AddSymbol(const IdentifierInfo& id) {
-        int pos = FindSymbol(id.id_name);
+        int pos = FindSymbol(id.name_id);
         if (pos == -1) {
             table_.push_back(id);
             pos = static_cast<int>(table_.size() - 1);
+            index_.Set(id.name_id, pos);
         } else {
             pos = -1; /* 已存在 添加失败 */
         }
@@ -118,20 +169,70 @@ public:
 private:
     SymbolTableType             table_type_; /* 表类型 */
     std::vector<IdentifierInfo> table_;      /* 符号列表 */
+    IdHashMap                   index_;      /* 标识符驻留编号 -> 符号在 table_ 中的位置 */
     std::string                 table_name_; /* 表名 */
 };
 
 /**
- * @brief 四元式定义
+ * @brief 作用域链：一张 标识符编号 -> 最内层可见定义 的哈希表，
+ *        同名的外层定义通过 shadowed 串成遮蔽链；
+ *        进入作用域只记录一个标记，退出作用域时按标记弹出本层定义并恢复被遮蔽的定义
  */
-struct Quadruple {
-    int         label;   /* 四元式的标号 */
-    std::string operate; /* 操作类型 */
-    std::string arg_1;   /* 参数 1 */
-    std::string arg_2;   /* 参数 2 */
-    std::string result;  /* 结果 */
-    Quadruple(const int label, const std::string& ope, const std::string& arg1, const std::string& arg2, const std::string& res)
-        : label(label), operate(ope), arg_1(arg1), arg_2(arg2), result(res) {}
+class ScopeChain {
+public:
+    static constexpr int Npos = -1;
+    /**
+     * @brief 一个可见的定义
+     */
+    struct Binding {
+        int name_id;        /* 标识符驻留编号 */
+        int table_index;    /* 定义所在符号表的index */
+        int in_table_index; /* 定义在符号表内部的index */
+        int shadowed;       /* 被本定义遮蔽的外层定义(bindings_ 的下标)，没有时为 Npos */
+    };
+
+    void
+    PushScope() {
+        scope_marks_.push_back(static_cast<int>(bindings_.size()));
+    }
+
+    void
+    PopScope() {
+        int mark = scope_marks_.back();
+        scope_marks_.pop_back();
+        while (static_cast<int>(bindings_.size()) > mark) {
+            const auto& binding = bindings_.back();
+            heads_.Set(binding.name_id, binding.shadowed);
+            bindings_.pop_back();
+        }
+    }
+
+    /**
+     * @brief : 在当前(最内层)作用域中加入一个定义
+     */
+    void
+    Bind(int name_id, int table_index, int in_table_index) {
+        bindings_.push_back({ name_id, table_index, in_table_index, heads_.Find(name_id) });
+        heads_.Set(name_id, static_cast<int>(bindings_.size() - 1));
+    }
+
+    /**
+     * @brief  : 查找当前可见的最内层定义
+     * @return : 不存在时返回 nullptr
+     */
+    const Binding*
+    Lookup(int name_id) const {
+        if (name_id < 0) {
+            return nullptr;
+        }
+        int pos = heads_.Find(name_id);
+        return pos == Npos ? nullptr : &bindings_[pos];
+    }
+
+private:
+    IdHashMap            heads_;       /* 标识符编号 -> 最内层定义 */
+    std::vector<Binding> bindings_;    /* 按定义顺序排列的所有可见定义 */
+    std::vector<int>     scope_marks_; /* 每层作用域开始时 bindings_ 的长度 */
 };
 
 /**
@@ -140,11 +241,12 @@ struct Quadruple {
 class Semantic {
 public:
     static constexpr int Npos = -1;
-    Semantic() {
+    explicit Semantic(StringPool& names) : names_(names) {
         /* 创建全局符号表 */
         tables_.push_back(SymbolTable(SymbolTable::GlobalTable, "global table"));
         /* 当前作用域为全局作用域 */
         current_table_stack_.push_back(0);
+        scopes_.PushScope();
 
         /* 所有临时变量存在一个表中 */
         tables_.push_back(SymbolTable(SymbolTable::TempTable, "temp variable table"));
@@ -152,11 +254,18 @@ public:
         /* 从 1 开始生成四元式标号；0号用于 (j, -, -, main_address) */
         next_label_num_ = 1;
         /* main函数标号置非法 */
-        main_label_ = Npos;
+        main_label_       = Npos;
+        current_function_ = Npos;
         /* 初始回填层次为0，表示不需要回填 */
         backpatching_level_ = 0;
         /* 临时变量计数 */
         temp_var_count = 0;
+        copy_suffix_   = 0;
+        current_row_   = -1;
+        stamped_       = 0;
+
+        symbol_list_.reserve(256);
+        quadruples_.reserve(1024);
     }
 
     int
@@ -171,19 +280,452 @@ public:
 
     bool
     AddSymbolToList(const SymbolAttribute& symbol) {
+        StampRows();
+        if (symbol.row >= 0) {
+            current_row_ = symbol.row;
+        }
         symbol_list_.push_back(symbol);
         return true;
     }
 
+    /**
+     * @brief : 上一个单词读入之后生成的四元式都来自以它结尾的归约，取它所在的行
+     */
+    void
+    StampRows() {
+        stamped_ = stamped_ < quadruples_.size() ? stamped_ : quadruples_.size();
+        for (; stamped_ < quadruples_.size(); ++stamped_) {
+            quadruples_[stamped_].row = current_row_;
+        }
+    }
+
+    /**
+     * @brief  : 向符号表中加入符号，并使其在当前作用域中可见
+     * @return : 符号在表中的位置；已存在时返回 -1
+     */
+    int
+    AddSymbolToTable(int table_index, IdentifierInfo id) {
+        id.name_id = names_.Intern(id.id_name);
+        if (id.id_type == IdentifierInfo::Variable || id.id_type == IdentifierInfo::ReturnVar) {
+            id.variable_index = static_cast<int>(variables_.size());
+        }
+        int pos = tables_[table_index].AddSymbol(id);
+        if (pos != -1) {
+            scopes_.Bind(id.name_id, table_index, pos);
+            if (id.variable_index != -1) {
+                variables_.push_back({ table_index, pos });
+            }
+        }
+        return pos;
+    }
+
+    /**
+     * @brief  : 查找当前作用域中可见的变量
+     * @return : 变量操作数；未定义或不是变量时返回空操作数
+     */
+    Operand
+    LookupVariable(int name_id) const {
+        const auto* binding = scopes_.Lookup(name_id);
+        if (binding == nullptr) {
+            return Operand();
+        }
+        const auto& info = tables_[binding->table_index].table()[binding->in_table_index];
+        if (info.variable_index == -1) {
+            return Operand();
+        }
+        return Operand(Operand::Variable, info.variable_index, SpecifierValueType(info.sp_type));
+    }
+
+    /**
+     * @brief  : 常量操作数
+     */
+    Operand
+    Constant(const char* literal, ValueType type = ValueType::Int) {
+        return Operand(Operand::Constant, names_.Intern(literal), type);
+    }
+
+    Operand
+    GetNewTmpVar(ValueType type) {
+        return Operand(Operand::Temp, temp_var_count++, type);
+    }
+
+    /**
+     * @brief  : 将操作数转换为 type 类型
+     *           常量直接改写为目标类型的常量，其余生成 itof / ftoi 四元式
+     * @return : 转换后的操作数；类型相同或涉及 void 时原样返回
+     */
+    Operand
+    Convert(const Operand& opd, ValueType type) {
+        if (opd.type == type || opd.type == ValueType::Void || type == ValueType::Void) {
+            return opd;
+        }
+        if (opd.kind == Operand::Constant) {
+            if (type == ValueType::Float) {
+                return Operand(Operand::Constant, opd.id, type);
+            }
+            /* 浮点常量向零截断 */
+            std::string literal = std::to_string(static_cast<long long>(atof(names_[opd.id])));
+            return Operand(Operand::Constant, names_.Intern(literal), type);
+        }
+        Operand converted = GetNewTmpVar(type);
+        Opcode  op        = type == ValueType::Float ? Opcode::IntToFloat : Opcode::FloatToInt;
+        quadruples_.push_back(Quadruple(GetNextLabelNum(), op, opd, Operand(), converted));
+        return converted;
+    }
+
+    /**
+     * @brief  : 检查二元运算的操作数：void 值不能参与运算
+     */
+    bool
+    CheckOperands(const SymbolAttribute& a, const SymbolAttribute& op, const SymbolAttribute& b) const {
+        if (a.place.type != ValueType::Void && b.place.type != ValueType::Void) {
+            return true;
+        }
+        /* 未定义变量等错误已在之前报告 */
+        if (a.place.IsNone() || b.place.IsNone()) {
+            return false;
+        }
+        std::cerr << "语义错误 : 第 " << op.row << " 行，void 类型的值不能参与 " << names_[op.value] << " 运算" << std::endl;
+        return false;
+    }
+
+    /**
+     * @brief  : 生成一条目标待回填的跳转四元式
+     *           待回填的跳转串成链表：链表以四元式在 quadruples_ 中的下标表示，
+     *           尚未回填的目标操作数中保存链表中的下一个下标，-1 表示链尾
+     * @return : 只含这条跳转的链表
+     */
+    int
+    MakeJumpList(Opcode op, const Operand& arg_1 = Operand(), const Operand& arg_2 = Operand()) {
+        quadruples_.push_back(Quadruple(GetNextLabelNum(), op, arg_1, arg_2, Operand(Operand::Label, Npos)));
+        return static_cast<int>(quadruples_.size() - 1);
+    }
+
+    /**
+     * @brief  : 合并两条跳转链表
+     */
+    int
+    MergeJumpList(int list_1, int list_2) {
+        if (list_1 == Npos) {
+            return list_2;
+        }
+        int tail = list_1;
+        while (quadruples_[tail].result.id != Npos) {
+            tail = quadruples_[tail].result.id;
+        }
+        quadruples_[tail].result.id = list_2;
+        return list_1;
+    }
+
+    /**
+     * @brief  : 从跳转链表中摘除一条跳转
+     * @return : 跳转不在链表中时返回 false
+     */
+    bool
+    RemoveFromJumpList(int& list, int index) {
+        for (int* link = &list; *link != Npos; link = &quadruples_[*link].result.id) {
+            if (*link == index) {
+                *link = quadruples_[index].result.id;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief  : 将跳转链表中所有跳转的目标回填为 label
+     */
+    void
+    Backpatch(int list, int label) {
+        while (list != Npos) {
+            int next                    = quadruples_[list].result.id;
+            quadruples_[list].result.id = label;
+            list                        = next;
+        }
+    }
+
+    /**
+     * @brief  : 表达式值 -> 条件：值不为 0 时转向真出口
+     */
+    void
+    ToCondition(SymbolAttribute& exp) {
+        if (exp.IsCondition()) {
+            return;
+        }
+        Opcode jump    = exp.place.type == ValueType::Float ? Opcode::FJumpNe : Opcode::IJumpNe;
+        exp.true_list  = MakeJumpList(jump, exp.place, Constant("0", exp.place.type));
+        exp.false_list = MakeJumpList(Opcode::Jump);
+        exp.place      = Operand();
+    }
+
+    /**
+     * @brief  : 条件 -> 表达式值：真出口置 1，假出口置 0
+     */
+    void
+    ToValue(SymbolAttribute& exp) {
+        if (!exp.IsCondition()) {
+            return;
+        }
+        int     label = PeekNextLabelNum();
+        Operand value = GetNewTmpVar(ValueType::Int);
+        Backpatch(exp.true_list, label);
+        quadruples_.push_back(Quadruple(GetNextLabelNum(), Opcode::Assign, Constant("1"), Operand(), value));
+        quadruples_.push_back(Quadruple(GetNextLabelNum(), Opcode::Jump, Operand(), Operand(), Operand(Operand::Label, label + 3)));
+        Backpatch(exp.false_list, PeekNextLabelNum());
+        quadruples_.push_back(Quadruple(GetNextLabelNum(), Opcode::Assign, Constant("0"), Operand(), value));
+        exp.true_list  = Npos;
+        exp.false_list = Npos;
+        exp.place      = value;
+    }
+
+    /**
+     * @brief  : 以表达式作为 if/while 的条件：真出口直接落到下一条四元式
+     *           条件末尾的一对可以取反的跳转 (j<rel>, 真) (j, 假) 合并为一条取反的条件跳转，
+     *           循环条件因此只需一条条件跳转
+     * @return : 待回填的假出口链表
+     */
+    int
+    BranchOnFalse(SymbolAttribute& exp) {
+        ToCondition(exp);
+        int last = static_cast<int>(quadruples_.size() - 1);
+        if (last >= 0 && quadruples_[last].operate == Opcode::Jump) {
+            /* (j, 真) 直接落到下一条 */
+            bool drop = RemoveFromJumpList(exp.true_list, last);
+            /* 浮点的 < <= > >= 不能取反，保留 (fj<rel>, 真) (j, 假) */
+            if (!drop && last >= 1 && CanInvertJump(quadruples_[last - 1].operate)
+                && RemoveFromJumpList(exp.true_list, last - 1)) {
+                quadruples_[last - 1].result.id = Npos;
+                if (RemoveFromJumpList(exp.false_list, last)) {
+                    /* (j<rel>, 真) (j, 假) => (j<!rel>, 假) */
+                    quadruples_[last - 1].operate = InvertJump(quadruples_[last - 1].operate);
+                    exp.false_list                = MergeJumpList(last - 1, exp.false_list);
+                    drop                          = true;
+                } else {
+                    exp.true_list = MergeJumpList(last - 1, exp.true_list);
+                }
+            }
+            /* 最后一条无条件跳转已不在任何链表中，删除 */
+            if (drop) {
+                quadruples_.pop_back();
+                --next_label_num_;
+            }
+        }
+        Backpatch(exp.true_list, PeekNextLabelNum());
+        exp.true_list = Npos;
+        return exp.false_list;
+    }
+
+    /**
+     * @brief : 输出操作数的文本形式
+     */
+    void
+    PrintOperand(std::ostream& os, const Operand& opd) const {
+        switch (opd.kind) {
+            case Operand::Variable: {
+                const auto& ref = variables_[opd.id];
+                os << tables_[ref.table_index].table()[ref.in_table_index].id_name;
+            } break;
+            case Operand::Temp:
+                os << "T" << opd.id;
+                break;
+            case Operand::Constant:
+                os << names_[opd.id];
+                break;
+            case Operand::Label:
+                os << opd.id;
+                break;
+            case Operand::Function:
+                os << tables_[0].table()[opd.id].id_name;
+                break;
+            case Operand::Register:
+                os << (opd.type == ValueType::Float ? "F" : "R") << opd.id;
+                break;
+            case Operand::Slot:
+                os << "S" << opd.id;
+                break;
+            default:
+                os << "-";
+                break;
+        }
+    }
+
+    /* 变量操作数的编号空间大小 */
+    int
+    variable_count() const {
+        return static_cast<int>(variables_.size());
+    }
+
+    /* 临时变量操作数的编号空间大小 */
+    int
+    temp_count() const {
+        return temp_var_count;
+    }
+
+    /* 全局变量：可能被任何函数调用修改 */
+    bool
+    IsGlobalVariable(int variable) const {
+        return variables_[variable].table_index == 0;
+    }
+
+    /* 变量所在的符号表项 */
+    const IdentifierInfo&
+    VariableInfo(int variable) const {
+        const auto& ref = variables_[variable];
+        return tables_[ref.table_index].table()[ref.in_table_index];
+    }
+
+    /* 函数(全局符号表中的位置)的返回值变量 */
+    int
+    ReturnVariable(int function) const {
+        return tables_[tables_[0].table()[function].function_table_index].table()[0].variable_index;
+    }
+
+    /* main 函数入口四元式的标号，未定义 main 时为 Npos */
+    int
+    main_label() const {
+        return main_label_;
+    }
+
+    /* 函数(全局符号表中的位置)的符号表项 */
+    const IdentifierInfo&
+    FunctionInfo(int function) const {
+        return tables_[0].table()[function];
+    }
+
+    /* 函数的第 k 个形参(从 0 开始)：函数表中紧跟返回值的前 parameter_num 项 */
+    int
+    ParameterVariable(int function, int k) const {
+        return tables_[tables_[0].table()[function].function_table_index].table()[1 + k].variable_index;
+    }
+
+    /* 变量属于函数的符号表：返回值变量、形参与函数中定义的变量 */
+    bool
+    IsLocalOf(int variable, int function) const {
+        return variables_[variable].table_index == tables_[0].table()[function].function_table_index;
+    }
+
+    /**
+     * @brief  : 新的变量副本后缀 $n，n 在整个编译过程中递增，多次内联(如 --passes=inline,inline)建立的副本也不会重名
+     */
     std::string
-    GetNewTmpVar() {
-        return "T" + std::to_string(temp_var_count++);
+    NewCopySuffix() {
+        return "$" + std::to_string(++copy_suffix_);
+    }
+
+    /**
+     * @brief  : 在函数 function 的符号表中加入变量 variable 的副本，名字加上后缀 suffix；
+     *           内联时用来重命名被调函数的局部变量，副本总是普通变量
+     * @return : 副本的变量编号；名字已存在时返回 Npos
+     */
+    int
+    CopyVariable(int variable, int function, const std::string& suffix) {
+        IdentifierInfo info = VariableInfo(variable);
+        info.id_type        = IdentifierInfo::Variable;
+        info.id_name += suffix;
+        info.name_id        = names_.Intern(info.id_name);
+        info.variable_index = static_cast<int>(variables_.size());
+        int table           = tables_[0].table()[function].function_table_index;
+        int pos             = tables_[table].AddSymbol(info);
+        if (pos == -1) {
+            return Npos;
+        }
+        variables_.push_back({ table, pos });
+        return info.variable_index;
+    }
+
+    /**
+     * @brief : 删除或插入四元式后重新从 1 开始连续编号，并修正跳转目标、函数入口与 main 的标号；
+     *          目标标号不属于任何四元式的跳转(跳到末尾之后)改为跳到新的末尾之后
+     */
+    void
+    RenumberLabels() {
+        int max_label = 0;
+        for (const auto& qua : quadruples_) {
+            max_label = qua.label > max_label ? qua.label : max_label;
+        }
+        std::vector<int> renumber(max_label + 2, static_cast<int>(quadruples_.size() + 1));
+        for (size_t i = 0; i < quadruples_.size(); ++i) {
+            renumber[quadruples_[i].label] = static_cast<int>(i + 1);
+        }
+        for (auto& qua : quadruples_) {
+            qua.label = renumber[qua.label];
+            if (IsJump(qua.operate) && qua.result.id >= 0 && qua.result.id <= max_label + 1) {
+                qua.result.id = renumber[qua.result.id];
+            }
+        }
+        for (auto& info : tables_[0].table()) {
+            if (info.id_type == IdentifierInfo::Function && info.function_entry >= 0 && info.function_entry <= max_label) {
+                info.function_entry = renumber[info.function_entry];
+            }
+        }
+        if (main_label_ != Npos) {
+            main_label_ = renumber[main_label_];
+        }
+        next_label_num_ = static_cast<int>(quadruples_.size() + 1);
+    }
+
+    /**
+     * @brief  : 常量操作数的值
+     */
+    Value
+    ConstantValue(const Operand& opd) const {
+        Value value;
+        if (opd.type == ValueType::Float) {
+            value.f = strtod(names_[opd.id], nullptr);
+        } else {
+            value.i = strtoll(names_[opd.id], nullptr, 10);
+        }
+        return value;
     }
 
+    /**
+     * @brief  : 值为 value 的常量操作数；浮点数取能精确还原的最短表示
+     */
+    Operand
+    MakeConstant(Value value, ValueType type) {
+        char literal[32];
+        if (type == ValueType::Float) {
+            for (int precision = 1; precision <= 17; ++precision) {
+                snprintf(literal, sizeof(literal), "%.*g", precision, value.f);
+                if (strtod(literal, nullptr) == value.f) {
+                    break;
+                }
+            }
+        } else {
+            snprintf(literal, sizeof(literal), "%lld", static_cast<long long>(value.i));
+        }
+        return Constant(literal, type);
+    }
+
+    /* 生成的四元式，供后续的分析与优化使用 */
+    std::vector<Quadruple>&
+    quadruples() {
+        return quadruples_;
+    }
+    const std::vector<Quadruple>&
+    quadruples() const {
+        return quadruples_;
+    }
+
+    /**
+     * @brief : 以文本形式输出全部四元式
+     */
     void PrintQuadruple(std::ostream& os) {
         os << "label : operate, arg1, arg2, result" << std::endl;
         for (auto &qua : quadruples_) {
-            os << qua.label << " : " << qua.operate << ", " << qua.arg_1 << ", " << qua.arg_2 << ", " << qua.result << std::endl;
+            os << qua.label << " : ";
+            if (qua.operate == Opcode::FunBegin) {
+                PrintOperand(os, qua.arg_1);
+            } else {
+                os << OpcodeText(qua.operate);
+            }
+            os << ", ";
+            PrintOperand(os, qua.operate == Opcode::FunBegin ? Operand() : qua.arg_1);
+            os << ", ";
+            PrintOperand(os, qua.arg_2);
+            os << ", ";
+            PrintOperand(os, qua.result);
+            os << std::endl;
         }
     }
 
@@ -197,26 +739,37 @@ private:
     std::vector<SymbolAttribute> symbol_list_;         /* 语义分析过程的符号数组 */
     std::vector<SymbolTable>     tables_;              /* 程序所有符号表数组 */
     std::vector<int>             current_table_stack_; /* 当前作用域对应的符号表 索引栈 */
+    std::vector<VariableRef>     variables_;           /* 程序中的所有变量(四元式变量操作数的编号空间) */
+    StringPool&                  names_;               /* 字符串驻留池(与词法分析共享) */
+    ScopeChain                   scopes_;              /* 当前可见的所有定义 */
+    std::vector<PendingCall>     pending_calls_;       /* 嵌套的函数调用，最内层在末尾 */
 
     int next_label_num_; /* 下一个四元式的标号 */
 
     int temp_var_count; /* 临时变量计数 */
+    int copy_suffix_;   /* 已分配的变量副本后缀个数 */
 
     std::vector<Quadruple> quadruples_;         /* 生成的四元式 */
     int                    backpatching_level_; /* 回填层次 */
     std::vector<int>       backpatching_list_;  /* 回填列表 */
 
-    int main_label_; /* main 函数对应的四元式标号 */
+    int main_label_;       /* main 函数对应的四元式标号 */
+    int current_function_; /* 当前函数在全局符号表中的位置 */
+
+    int    current_row_; /* 最近读入的单词所在的行 */
+    size_t stamped_;     /* 已记录行号的四元式条数 */
 };
 
 bool
 Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>& pro_right) {
+    int left = names_.Intern(pro_left);
     if ("Program" == pro_left) {
         /* Program -> ExtDefList */
         if (Semantic::Npos == main_label_) {
             std::cerr << "语义错误 : 未定义 main 函数" << std::endl;
             return false;
         }
+        StampRows();
         PrintQuadruple();
         if ("@" != pro_right[0]) {
             int count = static_cast<int>(pro_right.size());
@@ -224,39 +777,30 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
                 this->symbol_list_.pop_back();
             }
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left));
+        this->symbol_list_.push_back(SymbolAttribute(left));
     } else if ("ExtDef" == pro_left && "<ID>" == pro_right[1]) {
         /* ExtDef -> Specifier <ID> ; */
         int         list_length = static_cast<int>(symbol_list_.size());
         const auto& specifier   = symbol_list_[list_length - 3];
         const auto& identifier  = symbol_list_[list_length - 2];
 
-        bool existed = false;
-        for (int scope_layer = current_table_stack_.size() - 1; scope_layer >= 0; --scope_layer) {
-            const auto& table = tables_[current_table_stack_[scope_layer]];
-            if (table.FindSymbol(identifier.value) != -1) {
-                existed = true;
-                break;
-            }
-        }
-
-        if (existed) {
-            std::cerr << "语义错误 : 第 " << identifier.row << " 行，变量 " << identifier.value << " 重定义" << std::endl;
+        if (scopes_.Lookup(identifier.value)) {
+            std::cerr << "语义错误 : 第 " << identifier.row << " 行，变量 " << names_[identifier.value] << " 重定义" << std::endl;
             return false;
         }
 
         IdentifierInfo variable;
-        variable.id_name = identifier.value;
+        variable.id_name = names_[identifier.value];
         variable.id_type = IdentifierInfo::Variable;
-        variable.sp_type = IdentifierInfo::SpecifierType(specifier.value);
+        variable.sp_type = IdentifierInfo::SpecifierType(names_[specifier.value]);
 
-        tables_[current_table_stack_.back()].AddSymbol(variable);
+        AddSymbolToTable(current_table_stack_.back(), variable);
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, identifier.value, identifier.row));
+        this->symbol_list_.push_back(SymbolAttribute(left, identifier.value, identifier.row));
 
     } else if ("Specifier" == pro_left) {
         /* Specifier -> void | int | float */
@@ -266,7 +810,7 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, specifier.value, specifier.row));
+        this->symbol_list_.push_back(SymbolAttribute(left, specifier.value, specifier.row));
     } else if ("CreateFunTable_m" == pro_left) {
         /* CreateFunTable_m -> @ */
         /* 此时 symbol_list_ 的最后一个符号为 函数名
@@ -277,37 +821,45 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         const auto& identifier  = symbol_list_[list_length - 1];
         const auto& specifier   = symbol_list_[list_length - 2];
         if (tables_[0].FindSymbol(identifier.value) != -1) {
-            std::cerr << "语义错误 : 第 " << identifier.row << " 行，函数 " << identifier.value << " 重定义" << std::endl;
+            std::cerr << "语义错误 : 第 " << identifier.row << " 行，函数 " << names_[identifier.value] << " 重定义" << std::endl;
             return false;
         }
         /* 创建新的函数表 */
-        tables_.push_back(SymbolTable(SymbolTable::FunctionTable, identifier.value));
-        /* 在全局符号表中创建函数符号项 */
-        tables_[0].AddSymbol(
-            IdentifierInfo(IdentifierInfo::Function, specifier.value, identifier.value, 0, 0, tables_.size() - 1));
+        tables_.push_back(SymbolTable(SymbolTable::FunctionTable, names_[identifier.value]));
+        /* 在全局符号表中创建函数符号项，函数入口为即将生成的函数入口四元式 */
+        current_function_ = AddSymbolToTable(0,
+                                             IdentifierInfo(IdentifierInfo::Function,
+                                                            names_[specifier.value],
+                                                            names_[identifier.value],
+                                                            0,
+                                                            PeekNextLabelNum(),
+                                                            tables_.size() - 1));
         /* 进入新的函数作用域 */
         current_table_stack_.push_back(tables_.size() - 1);
+        scopes_.PushScope();
 
         IdentifierInfo return_val;
         return_val.id_type = IdentifierInfo::ReturnVar;
         return_val.id_name = tables_.back().table_name() + "_ret_val";
-        return_val.sp_type = specifier.value;
+        return_val.sp_type = names_[specifier.value];
 
         /* 记录main函数 */
-        if (identifier.value == "main") {
+        if (identifier.value == names_.Intern("main")) {
             main_label_ = PeekNextLabelNum();
         }
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), identifier.value, "-", "-", "-"));
+        quadruples_.push_back(
+            Quadruple(GetNextLabelNum(), Opcode::FunBegin, Operand(Operand::Function, current_function_), Operand(), Operand()));
         /* 向函数表中加入返回变量 */
-        tables_[current_table_stack_.back()].AddSymbol(return_val);
+        AddSymbolToTable(current_table_stack_.back(), return_val);
         /* 右部为空串 不需要pop */
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, identifier.value, identifier.row));
+        this->symbol_list_.push_back(SymbolAttribute(left, identifier.value, identifier.row));
     } else if ("ExitFunTable_m" == pro_left) {
         /* ExitFunTable_m -> @ */
         /* 函数结束 退出作用域 */
         current_table_stack_.pop_back();
+        scopes_.PopScope();
         /* 右部为空串 不需要pop */
-        this->symbol_list_.push_back(SymbolAttribute(pro_left));
+        this->symbol_list_.push_back(SymbolAttribute(left));
     } else if ("ParamDec" == pro_left) {
         /* ParamDec -> Specifier <ID> */
         int         list_length = static_cast<int>(symbol_list_.size());
@@ -316,15 +868,16 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         /* 获取当前函数表 */
         auto& function_table = tables_[current_table_stack_.back()];
         /* 获取当前函数在全局符号中的索引 */
-        int   table_pos       = tables_[0].FindSymbol(function_table.table_name());
-        auto& function_symbol = tables_[0][table_pos];
+        auto& function_symbol = tables_[0][current_function_];
 
         if (-1 != function_table.FindSymbol(identifier.value)) {
-            std::cerr << "语义错误 : 第 " << identifier.row << " 行，函数参数 " << identifier.value << " 重定义" << std::endl;
+            std::cerr << "语义错误 : 第 " << identifier.row << " 行，函数参数 " << names_[identifier.value] << " 重定义"
+                      << std::endl;
             return false;
         }
         /* 函数表中加入形参变量 */
-        int new_var_pos = function_table.AddSymbol(IdentifierInfo(IdentifierInfo::Variable, specifier.value, identifier.value));
+        int new_var_pos = AddSymbolToTable(current_table_stack_.back(),
+                                           IdentifierInfo(IdentifierInfo::Variable, names_[specifier.value], names_[identifier.value]));
         /* 函数形参个数增加 */
         ++function_symbol.parameter_num;
 
@@ -333,31 +886,33 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
             this->symbol_list_.pop_back();
         }
         this->symbol_list_.push_back(
-            SymbolAttribute(pro_left, identifier.value, identifier.row, current_table_stack_.back(), new_var_pos));
+            SymbolAttribute(left, identifier.value, identifier.row, current_table_stack_.back(), new_var_pos));
     } else if ("Block" == pro_left) {
         /* Block -> Block_m { DefList StmtList } */
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, std::to_string(PeekNextLabelNum())));
+        this->symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, PeekNextLabelNum()));
     } else if ("Stmt" == pro_left && "return" == pro_right[0]) {
         /* Stmt -> return Exp ; */
         int         list_length = static_cast<int>(symbol_list_.size());
-        const auto& ret_exp     = symbol_list_[list_length - 2];
+        auto&       ret_exp     = symbol_list_[list_length - 2];
         auto&       fun_table   = tables_[current_table_stack_.back()];
 
+        ToValue(ret_exp);
         SymbolAttribute symbol_attr;
-        if (!ret_exp.value.empty()) {
-            const auto& fun_name = fun_table.table_name();
-            std::string result   = fun_table[0].id_name;
-            std::string arg_1    = ret_exp.value;
-            quadruples_.push_back(Quadruple(GetNextLabelNum(), ":=", arg_1, "-", result));
-            symbol_attr.value = ret_exp.value;
+        if (!ret_exp.place.IsNone()) {
+            ValueType ret_type = SpecifierValueType(fun_table[0].sp_type);
+            Operand   result(Operand::Variable, fun_table[0].variable_index, ret_type);
+            Operand   value = Convert(ret_exp.place, ret_type);
+            quadruples_.push_back(Quadruple(GetNextLabelNum(), Opcode::Assign, value, Operand(), result));
+            symbol_attr.place = value;
         }
-        symbol_attr.token = pro_left;
+        symbol_attr.token = left;
 
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "return", "-", "-", fun_table.table_name()));
+        quadruples_.push_back(
+            Quadruple(GetNextLabelNum(), Opcode::Return, Operand(), Operand(), Operand(Operand::Function, current_function_)));
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
@@ -367,20 +922,16 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
     } else if ("IfStmt_m1" == pro_left) {
         /* IfStmt_m1 -> @ */
         ++backpatching_level_;
-        symbol_list_.push_back(SymbolAttribute(pro_left, std::to_string(PeekNextLabelNum())));
+        symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, PeekNextLabelNum()));
     } else if ("IfStmt_m2" == pro_left) {
         /* IfStmt_m2 -> @ */
-        int         list_len = static_cast<int>(symbol_list_.size());
-        const auto& if_exp   = symbol_list_[list_len - 2];
+        int   list_len = static_cast<int>(symbol_list_.size());
+        auto& if_exp   = symbol_list_[list_len - 2];
 
-        /* 待回填四元式 : 假出口 */
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "j=", if_exp.value, "0", ""));
-        backpatching_list_.push_back(quadruples_.size() - 1);
-        /* 待回填四元式 : 真出口 */
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "j", "-", "-", ""));
-        backpatching_list_.push_back(quadruples_.size() - 1);
+        /* 真出口落到 if 块；待回填 : 假出口链表 */
+        backpatching_list_.push_back(BranchOnFalse(if_exp));
 
-        symbol_list_.push_back(SymbolAttribute(pro_left, std::to_string(PeekNextLabelNum())));
+        symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, PeekNextLabelNum()));
     } else if ("IfNext" == pro_left && "IfStmt_next" == pro_right[0]) {
         /* IfNext -> IfStmt_next else Block */
         int         list_len  = static_cast<int>(symbol_list_.size());
@@ -390,44 +941,31 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, if_stmt_n.value));
+        this->symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, if_stmt_n.number));
     } else if ("IfStmt_next" == pro_left) {
         /* IfStmt_next -> @ */
         /* If 的跳出语句(else 之前) */
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "j", "-", "-", ""));
-        backpatching_list_.push_back(quadruples_.size() - 1);
+        backpatching_list_.push_back(MakeJumpList(Opcode::Jump));
 
-        symbol_list_.push_back(SymbolAttribute(pro_left, std::to_string(PeekNextLabelNum())));
+        symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, PeekNextLabelNum()));
     } else if ("IfStmt" == pro_left) {
         /* IfStmt -> if IfStmt_m1 ( Exp ) IfStmt_m2 Block IfNext */
         int         list_len = static_cast<int>(symbol_list_.size());
-        const auto& if_m2    = symbol_list_[list_len - 3];
         const auto& if_next  = symbol_list_[list_len - 1];
 
-        if (if_next.value.empty()) {
+        if (if_next.number == Npos) {
             /* 只有 if  */
-            /* 真出口 */
-            int pos = backpatching_list_.back();
-            backpatching_list_.pop_back();
-            quadruples_[pos].result = if_m2.value;
             /* 假出口 */
-            pos = backpatching_list_.back();
+            Backpatch(backpatching_list_.back(), PeekNextLabelNum());
             backpatching_list_.pop_back();
-            quadruples_[pos].result = std::to_string(PeekNextLabelNum());
         } else {
             /* if - else */
             /* if 块出口 */
-            int pos = backpatching_list_.back();
+            Backpatch(backpatching_list_.back(), PeekNextLabelNum());
             backpatching_list_.pop_back();
-            quadruples_[pos].result = std::to_string(PeekNextLabelNum());
-            /* if 真出口 */
-            pos = backpatching_list_.back();
-            backpatching_list_.pop_back();
-            quadruples_[pos].result = if_m2.value;
             /* if 假出口 */
-            pos = backpatching_list_.back();
+            Backpatch(backpatching_list_.back(), if_next.number);
             backpatching_list_.pop_back();
-            quadruples_[pos].result = if_next.value;
         }
         --backpatching_level_;
 
@@ -435,41 +973,32 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left));
+        this->symbol_list_.push_back(SymbolAttribute(left));
     } else if ("WhileStmt_m1" == pro_left) {
         /* WhileStmt_m1 -> @ */
         ++backpatching_level_;
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, std::to_string(PeekNextLabelNum())));
+        this->symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, PeekNextLabelNum()));
     } else if ("WhileStmt_m2" == pro_left) {
         /* WhileStmt_m2 -> @ */
-        int         list_len  = static_cast<int>(symbol_list_.size());
-        const auto& while_exp = symbol_list_[list_len - 2];
+        int   list_len  = static_cast<int>(symbol_list_.size());
+        auto& while_exp = symbol_list_[list_len - 2];
 
-        /* 待回填四元式 : 假出口 */
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "j=", while_exp.value, "0", ""));
-        backpatching_list_.push_back(quadruples_.size() - 1);
-        /* 待回填四元式 : 真出口 */
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "j", "-", "-", ""));
-        backpatching_list_.push_back(quadruples_.size() - 1);
+        /* 真出口落到循环体；待回填 : 假出口链表 */
+        backpatching_list_.push_back(BranchOnFalse(while_exp));
 
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, std::to_string(PeekNextLabelNum())));
+        this->symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, PeekNextLabelNum()));
     } else if ("WhileStmt" == pro_left) {
         /* WhileStmt -> while WhileStmt_m1 ( Exp ) WhileStmt_m2 Block */
         int         list_len = static_cast<int>(symbol_list_.size());
         const auto& while_m1 = symbol_list_[list_len - 6];
-        const auto& while_m2 = symbol_list_[list_len - 2];
 
         /* 无条件跳转到 while 的条件判断语句处 */
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "j", "-", "-", while_m1.value));
+        quadruples_.push_back(
+            Quadruple(GetNextLabelNum(), Opcode::Jump, Operand(), Operand(), Operand(Operand::Label, while_m1.number)));
 
-        /* 回填 : 真出口 */
-        int pos = backpatching_list_.back();
-        backpatching_list_.pop_back();
-        quadruples_[pos].result = while_m2.value;
         /* 回填 : 假出口 */
-        pos = backpatching_list_.back();
+        Backpatch(backpatching_list_.back(), PeekNextLabelNum());
         backpatching_list_.pop_back();
-        quadruples_[pos].result = std::to_string(PeekNextLabelNum());
 
         --backpatching_level_;
 
@@ -477,8 +1006,8 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left));
-    } else if ("Dec" == pro_left && (pro_right.size() <= 1)) {
+        this->symbol_list_.push_back(SymbolAttribute(left));
+    } else if ("Dec" == pro_left && (pro_right.size() == 1)) {
         /* Dec -> <ID> */
         int         list_len      = static_cast<int>(symbol_list_.size());
         const auto& identifier    = symbol_list_.back();
@@ -486,45 +1015,57 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         auto&       current_table = tables_[current_table_stack_.back()];
 
         if (-1 != current_table.FindSymbol(identifier.value)) {
-            std::cerr << "语义错误 : 第 " << identifier.row << " 行，变量 " << identifier.value << " 重定义" << std::endl;
+            std::cerr << "语义错误 : 第 " << identifier.row << " 行，变量 " << names_[identifier.value] << " 重定义" << std::endl;
             return false;
         }
 
-        current_table.AddSymbol(IdentifierInfo(IdentifierInfo::Variable, specifier.value, identifier.value));
+        AddSymbolToTable(current_table_stack_.back(),
+                         IdentifierInfo(IdentifierInfo::Variable, names_[specifier.value], names_[identifier.value]));
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, identifier.value));
-    } else if ("Dec" == pro_left && (pro_right.size() <= 1)) {
+        this->symbol_list_.push_back(SymbolAttribute(left, identifier.value));
+    } else if ("Dec" == pro_left && (pro_right.size() == 3)) {
         /* Dec -> <ID> = Exp */
         int         list_len      = static_cast<int>(symbol_list_.size());
         const auto& identifier    = symbol_list_[list_len - 3];
         const auto& specifier     = symbol_list_[list_len - 4];
+        auto&       init_exp      = symbol_list_.back();
         auto&       current_table = tables_[current_table_stack_.back()];
 
         if (-1 != current_table.FindSymbol(identifier.value)) {
-            std::cerr << "语义错误 : 第 " << identifier.row << " 行，变量 " << identifier.value << " 重定义" << std::endl;
+            std::cerr << "语义错误 : 第 " << identifier.row << " 行，变量 " << names_[identifier.value] << " 重定义" << std::endl;
             return false;
         }
 
-        current_table.AddSymbol(IdentifierInfo(IdentifierInfo::Variable, specifier.value, identifier.value));
+        AddSymbolToTable(current_table_stack_.back(),
+                         IdentifierInfo(IdentifierInfo::Variable, names_[specifier.value], names_[identifier.value]));
+        /* 初始化即赋值 */
+        ToValue(init_exp);
+        Operand variable = LookupVariable(identifier.value);
+        quadruples_.push_back(
+            Quadruple(GetNextLabelNum(), Opcode::Assign, Convert(init_exp.place, variable.type), Operand(), variable));
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, identifier.value));
-    } else if ("Aritop" == pro_left) {
-        /* Aritop -> + | - | * | / */
-        const auto& op = symbol_list_.back();
+        this->symbol_list_.push_back(SymbolAttribute(left, identifier.value));
+    } else if ("Aritop" == pro_left || "Mulop" == pro_left) {
+        /* Aritop -> + | - */
+        /* Mulop -> * | / */
+        /* 左操作数已经分析完毕，若是条件则在右操作数的代码之前求值 */
+        int         list_len = static_cast<int>(symbol_list_.size());
+        const auto& op       = symbol_list_.back();
+        ToValue(symbol_list_[list_len - 2]);
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, op.value));
+        this->symbol_list_.push_back(SymbolAttribute(left, op.value, op.row));
     } else if ("Assignop" == pro_left) {
         /* Assignop -> = | += | -= | *= | /= */
         const auto& op = symbol_list_.back();
@@ -533,55 +1074,82 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, op.value));
+        this->symbol_list_.push_back(SymbolAttribute(left, op.value));
     } else if ("Relop" == pro_left) {
         /* Relop -> > | < | >= | <= | == | != */
-        const auto& op = symbol_list_.back();
+        int         list_len = static_cast<int>(symbol_list_.size());
+        const auto& op       = symbol_list_.back();
+        ToValue(symbol_list_[list_len - 2]);
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, op.value));
+        this->symbol_list_.push_back(SymbolAttribute(left, op.value, op.row));
+    } else if ("BoolOr_m" == pro_left || "BoolAnd_m" == pro_left) {
+        /* BoolOr_m -> @ */
+        /* BoolAnd_m -> @ */
+        /* 左操作数转为条件，记录右操作数的起始标号 */
+        int list_len = static_cast<int>(symbol_list_.size());
+        ToCondition(symbol_list_[list_len - 2]);
+        symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, PeekNextLabelNum()));
     } else if ("CallFunCheck" == pro_left) {
         /* CallFunCheck -> @ */
         int         list_len = static_cast<int>(symbol_list_.size());
         const auto& fun_id   = symbol_list_[list_len - 2];
 
         int fun_id_pos = tables_[0].FindSymbol(fun_id.value);
-        symbol_list_.push_back(SymbolAttribute(pro_left, "", -1, 0, fun_id_pos));
-        if (-1 == fun_id_pos) {
-            std::cerr << "语义错误 : 第 " << fun_id.row << " 行，调用函数 " << fun_id.value << " 未定义" << std::endl;
-            return false;
+        if (-1 != fun_id_pos && tables_[0][fun_id_pos].id_type != IdentifierInfo::Function) {
+            fun_id_pos = -1;
         }
-        if (tables_[0][fun_id_pos].id_type != IdentifierInfo::Function) {
-            std::cerr << "语义错误 : 第 " << fun_id.row << " 行，调用函数 " << fun_id.value << " 未定义" << std::endl;
+        symbol_list_.push_back(SymbolAttribute(left, Npos, -1, 0, fun_id_pos));
+        pending_calls_.push_back({ fun_id_pos, 0 });
+        if (-1 == fun_id_pos) {
+            std::cerr << "语义错误 : 第 " << fun_id.row << " 行，调用函数 " << names_[fun_id.value] << " 未定义" << std::endl;
             return false;
         }
     } else if ("Args" == pro_left && pro_right[0] == "@") {
         /* Args -> @ */
-        /* 这里 value = 0 表示该产生式产生 0 个函数实参 */
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, "0"));
-    } else if ("Args" == pro_left && pro_right.back() == "Exp") {
-        /* Args -> Exp */
+        /* 这里 number = 0 表示该产生式产生 0 个函数实参 */
+        this->symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, 0));
+    } else if ("Arg" == pro_left) {
+        /* Arg -> Exp */
+        /* 实参在下一个实参的代码之前求值 */
+        auto& exp = symbol_list_.back();
+        ToValue(exp);
+        Operand place = exp.place;
+        /* 按形参类型转换实参；形参是函数表中紧跟返回值的前 parameter_num 项 */
+        auto& call = pending_calls_.back();
+        if (call.function != -1) {
+            const auto& function = tables_[0][call.function];
+            if (call.arg_count < function.parameter_num) {
+                const auto& parameter = tables_[function.function_table_index][1 + call.arg_count];
+                place                 = Convert(place, SpecifierValueType(parameter.sp_type));
+            }
+        }
+        ++call.arg_count;
+        symbol_list_.pop_back();
+        symbol_list_.push_back(SymbolAttribute(left, place));
+    } else if ("Args" == pro_left && pro_right.back() == "Arg") {
+        /* Args -> Arg */
         const auto& exp = symbol_list_.back();
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "param", exp.value, "-", "-"));
+        quadruples_.push_back(Quadruple(GetNextLabelNum(), Opcode::Param, exp.place, Operand(), Operand()));
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, "1"));
+        this->symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, 1));
     } else if ("Args" == pro_left) {
-        /* Args -> Exp , Args */
+        /* Args -> Arg , Args */
         int list_len = static_cast<int>(symbol_list_.size());
         const auto& exp = symbol_list_[list_len - 3];
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "param", exp.value, "-", "-"));
-        int aru_num = std::stoi(symbol_list_.back().value) + 1;
+        quadruples_.push_back(Quadruple(GetNextLabelNum(), Opcode::Param, exp.place, Operand(), Operand()));
+        int aru_num = symbol_list_.back().number + 1;
         int count   = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, std::to_string(aru_num)));
+        this->symbol_list_.push_back(SymbolAttribute(left, Npos, -1, -1, -1, aru_num));
     } else if ("Exp" == pro_left && "<ID>" == pro_right[0] && pro_right.back() != "<ID>" && pro_right.back() != "Exp") {
         /* Exp -> <ID> ( CallFunCheck Args ) */
         int         list_len   = static_cast<int>(symbol_list_.size());
@@ -589,99 +1157,177 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         const auto& args       = symbol_list_[list_len - 2];
         const auto& check      = symbol_list_[list_len - 3];
 
-        int para_num = tables_[check.table_index][check.in_table_index].parameter_num;
-        if (para_num > std::stoi(args.value)) {
-            std::cerr << "语义错误 : 第 " << identifier.row << " 行, 调用函数" << identifier.value << ", 所给参数过少"
-                      << std::endl;
-            return false;
-        } else if (para_num < std::stoi(args.value)) {
-            std::cerr << "语义错误 : 第 " << identifier.row << " 行, 调用函数" << identifier.value << ", 所给参数过多"
-                      << std::endl;
-            return false;
+        /* 出错时依旧归约，保持语义分析符号栈与语法分析栈一致 */
+        bool    args_ok     = false;
+        Operand new_tmp_var;
+        pending_calls_.pop_back();
+        if (check.in_table_index != -1) {
+            /* 返回值的类型为函数的返回类型 */
+            new_tmp_var  = GetNewTmpVar(SpecifierValueType(tables_[0][check.in_table_index].sp_type));
+            int para_num = tables_[check.table_index][check.in_table_index].parameter_num;
+            if (para_num > args.number) {
+                std::cerr << "语义错误 : 第 " << identifier.row << " 行, 调用函数" << names_[identifier.value] << ", 所给参数过少"
+                          << std::endl;
+            } else if (para_num < args.number) {
+                std::cerr << "语义错误 : 第 " << identifier.row << " 行, 调用函数" << names_[identifier.value] << ", 所给参数过多"
+                          << std::endl;
+            } else {
+                args_ok = true;
+                /* 生成函数调用四元式 */
+                quadruples_.push_back(Quadruple(
+                    GetNextLabelNum(), Opcode::Call, Operand(Operand::Function, check.in_table_index), Operand(), new_tmp_var));
+            }
         }
-        /* 生成函数调用四元式 */
-        std::string new_tmp_var = GetNewTmpVar();
-        quadruples_.push_back(Quadruple(GetNextLabelNum(), "call", identifier.value, "-", new_tmp_var));
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        /* 新的exp的value为临时变量名 */
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, new_tmp_var));
+        /* 新的exp的值为临时变量 */
+        this->symbol_list_.push_back(SymbolAttribute(left, new_tmp_var));
+        return args_ok;
     } else if ("Exp" == pro_left && "<ID>" == pro_right[0] && "<ID>" != pro_right.back()) {
         /* Exp -> <ID> Assignop Exp */
         int         list_len = static_cast<int>(symbol_list_.size());
         const auto& id       = symbol_list_[list_len - 3];
-        const auto& sub_exp  = symbol_list_.back();
+        auto&       sub_exp  = symbol_list_.back();
         const auto& op       = symbol_list_[list_len - 2];
 
-        if (op.value.size() == 1) {
-            quadruples_.push_back(Quadruple(GetNextLabelNum(), ":" + op.value, sub_exp.value, "-", id.value));
+        ToValue(sub_exp);
+        bool    defined = true;
+        Operand target  = LookupVariable(id.value);
+        if (target.IsNone()) {
+            std::cerr << "语义错误 : 第 " << id.row << " 行，变量 " << names_[id.value] << " 未定义" << std::endl;
+            defined = false;
+        } else if (names_.length(op.value) == 1) {
+            quadruples_.push_back(
+                Quadruple(GetNextLabelNum(), Opcode::Assign, Convert(sub_exp.place, target.type), Operand(), target));
         } else {
-            quadruples_.push_back(Quadruple(GetNextLabelNum(), op.value, id.value, sub_exp.value, id.value));
+            /* a op= b 即 a := a op b，运算在两者的公共类型下进行 */
+            ValueType type = PromoteType(target.type, sub_exp.place.type);
+            if (type == target.type) {
+                quadruples_.push_back(Quadruple(
+                    GetNextLabelNum(), ArithOpcode(names_[op.value], type), target, Convert(sub_exp.place, type), target));
+            } else {
+                Operand value = GetNewTmpVar(type);
+                quadruples_.push_back(Quadruple(
+                    GetNextLabelNum(), ArithOpcode(names_[op.value], type), Convert(target, type), sub_exp.place, value));
+                quadruples_.push_back(
+                    Quadruple(GetNextLabelNum(), Opcode::Assign, Convert(value, target.type), Operand(), target));
+            }
         }
 
-
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        /* 新的exp的value为临时变量名 */
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, id.value));
+        /* 新的exp的值为被赋值的变量 */
+        this->symbol_list_.push_back(SymbolAttribute(left, target));
+        return defined;
     } else if ("Exp" == pro_left && "<ID>" == pro_right[0]) {
         /* Exp -> <ID> */
-        const auto& id = symbol_list_.back();
-        /* todo : whether the <ID> was defined */
+        const auto& id       = symbol_list_.back();
+        Operand     variable = LookupVariable(id.value);
+        bool        defined  = !variable.IsNone();
+        if (!defined) {
+            std::cerr << "语义错误 : 第 " << id.row << " 行，变量 " << names_[id.value] << " 未定义" << std::endl;
+        }
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, id.value));
+        this->symbol_list_.push_back(SymbolAttribute(left, variable));
+        return defined;
     } else if ("Exp" == pro_left && ("<INT>" == pro_right[0] || "<FLOAT>" == pro_right[0])) {
         /* Exp -> <INT> | <FLOAT> */
         const auto& const_val = symbol_list_.back();
+        ValueType   type      = "<INT>" == pro_right[0] ? ValueType::Int : ValueType::Float;
 
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, const_val.value));
+        this->symbol_list_.push_back(SymbolAttribute(left, Operand(Operand::Constant, const_val.value, type)));
     } else if ("Exp" == pro_left) {
-        int         list_len = static_cast<int>(symbol_list_.size());
-        std::string new_exp_val;
+        int             list_len = static_cast<int>(symbol_list_.size());
+        bool            valid    = true;
+        SymbolAttribute new_exp(left);
         if ("(" == pro_right[0] && pro_right.size() == 3u) {
             /* Exp -> ( Exp ) */
             const auto& sub_exp = symbol_list_[list_len - 2];
-            new_exp_val = sub_exp.value;
+            new_exp.place       = sub_exp.place;
+            new_exp.true_list   = sub_exp.true_list;
+            new_exp.false_list  = sub_exp.false_list;
+        } else if ("!" == pro_right[0]) {
+            /* Exp -> ! Exp */
+            auto& sub_exp = symbol_list_.back();
+            ToCondition(sub_exp);
+            new_exp.true_list  = sub_exp.false_list;
+            new_exp.false_list = sub_exp.true_list;
+        } else if (pro_right[1] == "||") {
+            /* Exp -> Exp || BoolOr_m Exp */
+            const auto& sub_exp1 = symbol_list_[list_len - 4];
+            const auto& or_m     = symbol_list_[list_len - 2];
+            auto&       sub_exp2 = symbol_list_[list_len - 1];
+            ToCondition(sub_exp2);
+            /* 左操作数为假时才计算右操作数 */
+            Backpatch(sub_exp1.false_list, or_m.number);
+            new_exp.true_list  = MergeJumpList(sub_exp1.true_list, sub_exp2.true_list);
+            new_exp.false_list = sub_exp2.false_list;
+        } else if (pro_right[1] == "&&") {
+            /* Exp -> Exp && BoolAnd_m Exp */
+            const auto& sub_exp1 = symbol_list_[list_len - 4];
+            const auto& and_m    = symbol_list_[list_len - 2];
+            auto&       sub_exp2 = symbol_list_[list_len - 1];
+            ToCondition(sub_exp2);
+            /* 左操作数为真时才计算右操作数 */
+            Backpatch(sub_exp1.true_list, and_m.number);
+            new_exp.true_list  = sub_exp2.true_list;
+            new_exp.false_list = MergeJumpList(sub_exp1.false_list, sub_exp2.false_list);
         } else if (pro_right[1] == "Relop") {
             /* Exp -> Exp Relop Exp */
             const auto& sub_exp1 = symbol_list_[list_len - 3];
             const auto& op       = symbol_list_[list_len - 2];
-            const auto& sub_exp2 = symbol_list_[list_len - 1];
-            int next_label_num = GetNextLabelNum();
-            std::string new_tmp_var = GetNewTmpVar();
-            quadruples_.push_back(Quadruple(next_label_num, "j" + op.value, sub_exp1.value, sub_exp2.value, std::to_string(next_label_num + 3)));
-            quadruples_.push_back(Quadruple(GetNextLabelNum(), ":=", "0", "-", new_tmp_var));
-            quadruples_.push_back(Quadruple(GetNextLabelNum(), "j", "-", "-", std::to_string(next_label_num + 4)));
-            quadruples_.push_back(Quadruple(GetNextLabelNum(), ":=", "1", "-", new_tmp_var));
-
-            new_exp_val = new_tmp_var;
-        } else if (pro_right[1] == "Aritop") {
-            /* Exp -> Exp Aritop Exp */
-            const auto& sub_exp1= symbol_list_[list_len - 3];
-            const auto& op = symbol_list_[list_len - 2];
-            const auto& sub_exp2 = symbol_list_[list_len - 1];
-            std::string new_tmp_var = GetNewTmpVar();
-            quadruples_.push_back(Quadruple(GetNextLabelNum(), op.value, sub_exp1.value, sub_exp2.value, new_tmp_var));
-
-            new_exp_val = new_tmp_var;
+            auto&       sub_exp2 = symbol_list_[list_len - 1];
+            ToValue(sub_exp2);
+            valid = CheckOperands(sub_exp1, op, sub_exp2);
+            /* 比较结果不落到临时变量，直接生成真/假出口 */
+            ValueType type     = PromoteType(sub_exp1.place.type, sub_exp2.place.type);
+            Operand   arg_1    = Convert(sub_exp1.place, type);
+            Operand   arg_2    = Convert(sub_exp2.place, type);
+            new_exp.true_list  = MakeJumpList(RelopJumpOpcode(names_[op.value], type), arg_1, arg_2);
+            new_exp.false_list = MakeJumpList(Opcode::Jump);
+        } else if (pro_right[1] == "Aritop" || pro_right[1] == "Mulop") {
+            /* Exp -> Exp Aritop Exp | Exp Mulop Exp */
+            const auto& sub_exp1 = symbol_list_[list_len - 3];
+            const auto& op       = symbol_list_[list_len - 2];
+            auto&       sub_exp2 = symbol_list_[list_len - 1];
+            ToValue(sub_exp2);
+            valid = CheckOperands(sub_exp1, op, sub_exp2);
+            /* int 与 float 运算时先将 int 操作数转换为 float */
+            ValueType type        = PromoteType(sub_exp1.place.type, sub_exp2.place.type);
+            Operand   arg_1       = Convert(sub_exp1.place, type);
+            Operand   arg_2       = Convert(sub_exp2.place, type);
+            Operand   new_tmp_var = GetNewTmpVar(type);
+            quadruples_.push_back(Quadruple(GetNextLabelNum(), ArithOpcode(names_[op.value], type), arg_1, arg_2, new_tmp_var));
+
+            new_exp.place = new_tmp_var;
         }
         int count = static_cast<int>(pro_right.size());
         while (count--) {
             this->symbol_list_.pop_back();
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left, new_exp_val));
+        this->symbol_list_.push_back(new_exp);
+        return valid;
+    } else if ("Stmt" == pro_left && "Exp" == pro_right[0]) {
+        /* Stmt -> Exp ; */
+        /* 值不被使用的条件表达式：两个出口都落到下一条语句 */
+        const auto& exp = symbol_list_[symbol_list_.size() - 2];
+        Backpatch(exp.true_list, PeekNextLabelNum());
+        Backpatch(exp.false_list, PeekNextLabelNum());
+        symbol_list_.pop_back();
+        symbol_list_.pop_back();
+        symbol_list_.push_back(SymbolAttribute(left));
     } else {
         /* ExtDefList -> ExtDef ExtDefList | @ */
         /* ExtDef -> Specifier FunDec Block ExitFunTable_m */
@@ -689,7 +1335,7 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
         /* VarList -> ParamDec , VarList | ParamDec | @ */
         /* Block_m -> @ */
         /* StmtList -> Stmt StmtList | @ */
-        /* Stmt -> IfSttmt | WhileStmt | Exp ; */
+        /* Stmt -> IfSttmt | WhileStmt */
         /* IfNext -> @ */
         /* DefList -> Def DefList | @ */
         /* Def -> Specifier Dec ; */
@@ -699,7 +1345,7 @@ Semantic::Analysis(const std::string& pro_left, const std::vector<std::string>&
                 this->symbol_list_.pop_back();
             }
         }
-        this->symbol_list_.push_back(SymbolAttribute(pro_left));
+        this->symbol_list_.push_back(SymbolAttribute(left));
     }
     return true;
 }
@@ -0,0 +1,618 @@
+/**
+ * @file ssa.hpp
+ * @brief 四元式的静态单赋值(SSA)形式：构造(φ 插入与重命名)与消去(插入复写)
+ */
+
+#ifndef _SSA_HPP_
+#define _SSA_HPP_
+
+#include <algorithm>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./liveness.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+
+/**
+ * @brief SSA 形式
+ *        只重命名函数的局部变量(含形参)与临时变量；全局变量可能被调用修改，
+ *        返回值变量由调用者在返回时读取，二者保持原样。
+ *        每个定值得到一个新的临时变量作为版本，第 0 个版本就是原变量本身
+ *        (函数入口处的形参与未初始化的变量)；四元式原地改写，φ 函数另存于各基本块。
+ *        构造使用支配边界插入 φ，并以活跃分析剪枝(只在变量入口活跃的块插入)，
+ *        随后沿支配树重命名。消去时把 φ 改为前驱末尾的并行复写，关键边先被拆分
+ */
+class SsaForm {
+public:
+    static constexpr int Npos = -1;
+
+    /**
+     * @brief φ 函数：result = φ(args[0], args[1] ...)，args[j] 对应块的第 j 个前驱
+     */
+    struct Phi {
+        Operand              variable; /* 被合并的原变量 */
+        Operand              result;
+        std::vector<Operand> args;
+    };
+
+    explicit SsaForm(Semantic& semantic) : semantic_(semantic), phi_count_(0), copy_count_(0), split_edges_(0) {}
+
+    /**
+     * @brief : 将 semantic 中的四元式转换为 SSA 形式
+     */
+    void
+    Construct() {
+        auto& quadruples = semantic_.quadruples();
+        cfg_.reset(new ControlFlowGraph(quadruples));
+        phis_.assign(cfg_->block_count(), std::vector<Phi>());
+        origin_.assign(semantic_.temp_count(), Operand());
+        version_.assign(semantic_.temp_count(), 0);
+        BuildDominanceFrontiers();
+
+        Liveness    liveness(semantic_, quadruples, *cfg_);
+        const auto& entries = cfg_->entries();
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int first = entries[f];
+            int last  = f + 1 < entries.size() ? entries[f + 1] : cfg_->block_count();
+            liveness.Compute(first, last);
+            InsertPhis(liveness, first, last);
+            Rename(liveness, first, last);
+        }
+    }
+
+    /**
+     * @brief : 消去 SSA 形式：φ 改为前驱到本块的边上的复写，写回 semantic 并重新编号标号
+     */
+    void
+    Destruct() {
+        auto&                  quadruples = semantic_.quadruples();
+        const auto&            cfg        = *cfg_;
+        std::vector<Quadruple> output;
+        output.reserve(quadruples.size() + copy_count_);
+        added_.clear();
+
+        int next_label = 0;
+        for (const auto& qua : quadruples) {
+            next_label = qua.label > next_label ? qua.label : next_label;
+        }
+        next_label += 2; /* 原最大标号 + 1 表示末尾之后，不能使用 */
+
+        const auto& entries = cfg.entries();
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int                    first = entries[f];
+            int                    last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+            std::vector<Quadruple> stubs; /* 拆分关键边得到的块，放在函数末尾 */
+
+            for (int b = first; b < last; ++b) {
+                for (int i = cfg.begin(b); i < cfg.end(b) - 1; ++i) {
+                    output.push_back(quadruples[i]);
+                }
+                Quadruple term = quadruples[cfg.end(b) - 1];
+                if (!cfg.reachable(b) || cfg.succ_count(b) == 0) {
+                    output.push_back(term);
+                    continue;
+                }
+
+                /* 出边的目标：跳转目标与顺序执行的下一块(离开函数的边没有 φ) */
+                int target = IsJump(term.operate) ? cfg.block_of_label(term.result.id) : Npos;
+                int fall   = term.operate != Opcode::Jump && b + 1 < last ? b + 1 : Npos;
+                if (target != Npos && cfg.function_entry(target) != first) {
+                    target = Npos;
+                }
+                if (term.operate == Opcode::Jump || (target != Npos && target == fall)) {
+                    /* 两条出边指向同一块的条件跳转等价于无条件跳转，复写放在跳转之前 */
+                    std::vector<Quadruple> copies = EdgeCopies(b, target, next_label);
+                    if (!copies.empty() && term.operate != Opcode::Jump) {
+                        term.operate = Opcode::Jump;
+                        term.arg_1   = Operand();
+                        term.arg_2   = Operand();
+                    }
+                    if (!copies.empty()) {
+                        /* 跳转可能是块的首条四元式，跳到它的标号应当先执行复写 */
+                        std::swap(term.label, copies.front().label);
+                    }
+                    output.insert(output.end(), copies.begin(), copies.end());
+                    output.push_back(term);
+                    continue;
+                }
+
+                /* 条件跳转的目标边是关键边：复写放在函数末尾的新块中，再跳回目标 */
+                std::vector<Quadruple> target_copies = EdgeCopies(b, target, next_label);
+                if (!target_copies.empty()) {
+                    term.result.id = target_copies.front().label;
+                    stubs.insert(stubs.end(), target_copies.begin(), target_copies.end());
+                    stubs.push_back(Quadruple(next_label++,
+                                              Opcode::Jump,
+                                              Operand(),
+                                              Operand(),
+                                              Operand(Operand::Label, quadruples[cfg.begin(target)].label)));
+                    ++split_edges_;
+                }
+                output.push_back(term);
+                /* 顺序执行的边：复写紧跟在跳转之后，其他前驱仍跳到下一块原来的首条四元式 */
+                std::vector<Quadruple> fall_copies = EdgeCopies(b, fall, next_label);
+                if (!fall_copies.empty()) {
+                    output.insert(output.end(), fall_copies.begin(), fall_copies.end());
+                }
+            }
+
+            if (!stubs.empty()) {
+                /* 函数末尾原本落出函数(隐式返回)，放置拆分块之前补上显式返回 */
+                const auto& entry = quadruples[cfg.begin(first)];
+                Opcode      tail  = output.back().operate;
+                added_.resize(output.size(), Normal);
+                if (tail != Opcode::Jump && tail != Opcode::Return && entry.operate == Opcode::FunBegin) {
+                    output.push_back(Quadruple(next_label++, Opcode::Return, Operand(), Operand(), entry.arg_1));
+                    added_.push_back(AddedReturn);
+                }
+                output.insert(output.end(), stubs.begin(), stubs.end());
+                added_.resize(output.size(), Stub);
+            }
+        }
+
+        quadruples.swap(output);
+        added_.resize(quadruples.size(), Normal);
+        semantic_.RenumberLabels();
+        cfg_.reset();
+        phis_.clear();
+        CoalesceVersions();
+    }
+
+    /* 插入的 φ 函数个数 */
+    int
+    phi_count() const {
+        return phi_count_;
+    }
+
+    /* 消去后留下的复写条数 */
+    int
+    copy_count() const {
+        return copy_count_;
+    }
+
+    /* 消去时拆分关键边而新增、且最终保留的基本块数 */
+    int
+    split_edges() const {
+        return split_edges_;
+    }
+
+    /* 基本块的 φ 函数 */
+    const std::vector<Phi>&
+    phis(int block) const {
+        return phis_[block];
+    }
+
+    const ControlFlowGraph&
+    cfg() const {
+        return *cfg_;
+    }
+
+    /**
+     * @brief : 输出 SSA 形式：按基本块列出 φ 函数与四元式，版本写作 变量名.版本号
+     */
+    void
+    Print(std::ostream& os) const {
+        const auto& quadruples = semantic_.quadruples();
+        const auto& cfg        = *cfg_;
+        for (int b = 0; b < cfg.block_count(); ++b) {
+            os << "B" << b << " :";
+            if (cfg.pred_count(b)) {
+                os << "  preds :";
+                for (auto p = cfg.pred_begin(b); p != cfg.pred_end(b); ++p) {
+                    os << " B" << *p;
+                }
+            }
+            if (!cfg.reachable(b)) {
+                os << "  (不可达)";
+            }
+            os << std::endl;
+            for (const auto& phi : phis_[b]) {
+                os << "    ";
+                PrintOperand(os, phi.result);
+                os << " = phi(";
+                for (size_t j = 0; j < phi.args.size(); ++j) {
+                    os << (j ? ", " : "");
+                    PrintOperand(os, phi.args[j]);
+                    os << " [B" << cfg.pred_begin(b)[j] << "]";
+                }
+                os << ")" << std::endl;
+            }
+            for (int i = cfg.begin(b); i < cfg.end(b); ++i) {
+                const auto& qua = quadruples[i];
+                os << "    " << qua.label << " : ";
+                if (qua.operate == Opcode::FunBegin) {
+                    semantic_.PrintOperand(os, qua.arg_1);
+                } else {
+                    os << OpcodeText(qua.operate);
+                }
+                os << ", ";
+                PrintOperand(os, qua.operate == Opcode::FunBegin ? Operand() : qua.arg_1);
+                os << ", ";
+                PrintOperand(os, qua.arg_2);
+                os << ", ";
+                PrintOperand(os, qua.result);
+                os << std::endl;
+            }
+        }
+    }
+
+private:
+    void
+    PrintOperand(std::ostream& os, const Operand& opd) const {
+        if (opd.kind == Operand::Temp && opd.id < static_cast<int>(origin_.size()) && !origin_[opd.id].IsNone()) {
+            semantic_.PrintOperand(os, origin_[opd.id]);
+            os << "." << version_[opd.id];
+        } else {
+            semantic_.PrintOperand(os, opd);
+        }
+    }
+
+    /* 支配边界：汇合块 b 的每个可达前驱沿支配树向上直到 idom(b)，途经的块的支配边界含 b */
+    void
+    BuildDominanceFrontiers() {
+        const auto& cfg = *cfg_;
+        frontier_.assign(cfg.block_count(), std::vector<int>());
+        for (int b = 0; b < cfg.block_count(); ++b) {
+            if (!cfg.reachable(b) || cfg.pred_count(b) < 2) {
+                continue;
+            }
+            for (auto p = cfg.pred_begin(b); p != cfg.pred_end(b); ++p) {
+                for (int runner = *p; runner != Npos && runner != cfg.idom(b) && cfg.reachable(runner);
+                     runner          = cfg.idom(runner)) {
+                    if (frontier_[runner].empty() || frontier_[runner].back() != b) {
+                        frontier_[runner].push_back(b);
+                    }
+                }
+            }
+        }
+    }
+
+    /* 被重命名的槽位：临时变量与非全局的普通变量(返回值变量除外) */
+    bool
+    Renamable(const Liveness& liveness, int slot) const {
+        const Operand& opd = liveness.slot_operand(slot);
+        return opd.kind == Operand::Temp || (!semantic_.IsGlobalVariable(opd.id) && opd.id != return_variable_);
+    }
+
+    void
+    InsertPhis(const Liveness& liveness, int first, int last) {
+        const auto& quadruples = semantic_.quadruples();
+        const auto& cfg        = *cfg_;
+        const auto& entry      = quadruples[cfg.begin(first)];
+        return_variable_ = entry.operate == Opcode::FunBegin ? semantic_.ReturnVariable(entry.arg_1.id) : Npos;
+
+        /* 每个槽位被定值的块 */
+        int                           slots = liveness.slot_count();
+        std::vector<std::vector<int>> def_blocks(slots);
+        for (int b = first; b < last; ++b) {
+            if (!cfg.reachable(b)) {
+                continue;
+            }
+            for (int i = cfg.begin(b); i < cfg.end(b); ++i) {
+                const auto& qua = quadruples[i];
+                if (DefinesResult(qua.operate) && liveness.Slot(qua.result) != Npos) {
+                    auto& blocks = def_blocks[liveness.Slot(qua.result)];
+                    if (blocks.empty() || blocks.back() != b) {
+                        blocks.push_back(b);
+                    }
+                }
+            }
+        }
+
+        std::vector<int> has_phi(last - first, Npos), queued(last - first, Npos);
+        std::vector<int> worklist;
+        for (int s = 0; s < slots; ++s) {
+            if (!Renamable(liveness, s) || def_blocks[s].empty()) {
+                continue;
+            }
+            worklist = def_blocks[s];
+            for (int b : worklist) {
+                queued[b - first] = s;
+            }
+            while (!worklist.empty()) {
+                int b = worklist.back();
+                worklist.pop_back();
+                for (int d : frontier_[b]) {
+                    if (has_phi[d - first] == s || !liveness.LiveIn(d, s)) {
+                        continue;
+                    }
+                    has_phi[d - first] = s;
+                    const Operand& variable = liveness.slot_operand(s);
+                    phis_[d].push_back({ variable, variable, std::vector<Operand>(cfg.pred_count(d), variable) });
+                    ++phi_count_;
+                    if (queued[d - first] != s) {
+                        queued[d - first] = s;
+                        worklist.push_back(d);
+                    }
+                }
+            }
+        }
+    }
+
+    /* 槽位的新版本 */
+    Operand
+    NewVersion(const Operand& variable) {
+        Operand version = semantic_.GetNewTmpVar(variable.type);
+        origin_.resize(version.id + 1, Operand());
+        version_.resize(version.id + 1, 0);
+        origin_[version.id]  = variable;
+        version_[version.id] = ++version_count_[variable.kind == Operand::Variable ? 0 : 1][variable.id];
+        return version;
+    }
+
+    void
+    Rename(const Liveness& liveness, int first, int last) {
+        auto&       quadruples = semantic_.quadruples();
+        const auto& cfg        = *cfg_;
+        version_count_[0].resize(semantic_.variable_count(), 0);
+        version_count_[1].resize(semantic_.temp_count(), 0);
+
+        /* 支配树的子节点 */
+        std::vector<std::vector<int>> children(last - first);
+        for (int b = first + 1; b < last; ++b) {
+            if (cfg.reachable(b) && cfg.idom(b) != Npos) {
+                children[cfg.idom(b) - first].push_back(b);
+            }
+        }
+
+        /* 各槽位的版本栈，空栈表示第 0 个版本(原变量) */
+        int                               slots = liveness.slot_count();
+        std::vector<std::vector<Operand>> stacks(slots);
+        auto                              current = [&](const Operand& opd) {
+            int slot = liveness.Slot(opd);
+            return slot == Npos || stacks[slot].empty() ? opd : stacks[slot].back();
+        };
+
+        /* 迭代的先序遍历；退出块时弹出块内压入的版本 */
+        struct Frame {
+            int              block;
+            size_t           child;  /* 下一个要访问的子节点 */
+            bool             done;   /* 块已重命名 */
+            std::vector<int> pushed; /* 块内压入版本的槽位 */
+        };
+        std::vector<Frame> frames;
+        frames.push_back({ first, 0, false, {} });
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            int    b     = frame.block;
+            if (!frame.done) {
+                frame.done = true;
+                for (auto& phi : phis_[b]) {
+                    int slot   = liveness.Slot(phi.variable);
+                    phi.result = NewVersion(phi.result);
+                    stacks[slot].push_back(phi.result);
+                    frame.pushed.push_back(slot);
+                }
+                for (int i = cfg.begin(b); i < cfg.end(b); ++i) {
+                    auto& qua = quadruples[i];
+                    if (ReadsArg1(qua.operate)) {
+                        qua.arg_1 = current(qua.arg_1);
+                    }
+                    if (ReadsArg2(qua.operate)) {
+                        qua.arg_2 = current(qua.arg_2);
+                    }
+                    int slot = DefinesResult(qua.operate) ? liveness.Slot(qua.result) : Npos;
+                    if (slot != Npos && Renamable(liveness, slot)) {
+                        qua.result = NewVersion(qua.result);
+                        stacks[slot].push_back(qua.result);
+                        frame.pushed.push_back(slot);
+                    }
+                }
+                for (auto s = cfg.succ_begin(b); s != cfg.succ_end(b); ++s) {
+                    int j = static_cast<int>(std::find(cfg.pred_begin(*s), cfg.pred_end(*s), b) - cfg.pred_begin(*s));
+                    for (auto& phi : phis_[*s]) {
+                        phi.args[j] = current(phi.variable);
+                    }
+                }
+            }
+            if (frame.child < children[b - first].size()) {
+                int child = children[b - first][frame.child++];
+                frames.push_back({ child, 0, false, {} });
+                continue;
+            }
+            for (int slot : frame.pushed) {
+                stacks[slot].pop_back();
+            }
+            frames.pop_back();
+        }
+    }
+
+    /**
+     * @brief : 同一变量的各个版本互不干扰时全部改回原变量，随后删除成为自身复写的复写
+     *          直接由构造得到的 SSA 形式总是如此，消去后得到的就是原来的四元式；
+     *          优化使版本的生存期重叠时，只有重叠的变量保留版本
+     *          两个版本干扰：其中一个的定值点上另一个活跃，且定值不是二者之间的复写
+     */
+    void
+    CoalesceVersions() {
+        auto&            quadruples = semantic_.quadruples();
+        ControlFlowGraph cfg(quadruples);
+        Liveness         liveness(semantic_, quadruples, cfg);
+
+        /* 操作数所属的组：版本归入原变量的组 */
+        auto origin = [&](const Operand& opd) {
+            return opd.kind == Operand::Temp && opd.id < static_cast<int>(origin_.size()) && !origin_[opd.id].IsNone()
+                       ? origin_[opd.id]
+                       : opd;
+        };
+        std::vector<char> interfere[2] = { std::vector<char>(semantic_.variable_count(), 0),
+                                           std::vector<char>(semantic_.temp_count(), 0) };
+        auto              group        = [&](const Operand& opd) -> char& {
+            Operand root = origin(opd);
+            return interfere[root.kind == Operand::Variable ? 0 : 1][root.id];
+        };
+
+        const auto& entries = cfg.entries();
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int first = entries[f];
+            int last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+            liveness.Compute(first, last);
+
+            /* 组 -> 组内在本函数中出现的槽位 */
+            std::vector<std::vector<int>> members(liveness.slot_count());
+            std::vector<int>              leader(liveness.slot_count(), Npos);
+            for (int s = 0; s < liveness.slot_count(); ++s) {
+                Operand root = origin(liveness.slot_operand(s));
+                for (int t = 0; t <= s; ++t) {
+                    if (origin(liveness.slot_operand(t)) == root) {
+                        leader[s] = leader[t] == Npos ? t : leader[t];
+                        break;
+                    }
+                }
+                members[leader[s]].push_back(s);
+            }
+
+            for (int b = first; b < last; ++b) {
+                Liveness::BitSet live = liveness.LiveOutSet(b);
+                for (int i = cfg.end(b) - 1; i >= cfg.begin(b); --i) {
+                    const auto& qua  = quadruples[i];
+                    int         slot = DefinesResult(qua.operate) ? liveness.Slot(qua.result) : Npos;
+                    if (slot != Npos && members[leader[slot]].size() > 1) {
+                        for (int other : members[leader[slot]]) {
+                            if (other != slot && Liveness::Test(live, other)
+                                && !(qua.operate == Opcode::Assign && qua.arg_1 == liveness.slot_operand(other))) {
+                                group(qua.result) = 1;
+                            }
+                        }
+                    }
+                    liveness.Step(qua, live);
+                }
+            }
+        }
+
+        /* 改回原变量，删除自身复写 */
+        auto restore = [&](Operand& opd) {
+            if (opd.IsLocation() && !group(opd)) {
+                opd = origin(opd);
+            }
+        };
+        int removed = 0;
+        for (auto& qua : quadruples) {
+            if (qua.operate == Opcode::FunBegin) {
+                continue;
+            }
+            restore(qua.arg_1);
+            restore(qua.arg_2);
+            restore(qua.result);
+            if (qua.operate == Opcode::Assign && qua.arg_1 == qua.result) {
+                qua.operate = Opcode::Nop;
+                ++removed;
+            }
+        }
+        copy_count_ -= removed;
+        if (!removed) {
+            return;
+        }
+
+        /* 复写全部删除后只剩跳转的拆分块：跳向它的跳转直接跳到原目标，块本身与补上的返回一并删除 */
+        int              count = static_cast<int>(quadruples.size());
+        std::vector<int> stub_begin;
+        for (int i = 0; i < count; ++i) {
+            if (added_[i] == Stub && (added_[i - 1] != Stub || quadruples[i - 1].operate == Opcode::Jump)) {
+                stub_begin.push_back(i);
+            }
+        }
+        for (int begin : stub_begin) {
+            int end = begin;
+            while (quadruples[end].operate == Opcode::Nop) {
+                ++end;
+            }
+            if (quadruples[end].operate != Opcode::Jump) {
+                continue;
+            }
+            for (auto& qua : quadruples) {
+                if (IsJump(qua.operate) && qua.result.id == quadruples[begin].label) {
+                    qua.result.id = quadruples[end].result.id;
+                }
+            }
+            quadruples[end].operate = Opcode::Nop;
+            --split_edges_;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (added_[i] == AddedReturn) {
+                bool stubs_left = false;
+                for (int k = i + 1; k < count && added_[k] == Stub; ++k) {
+                    stubs_left |= quadruples[k].operate != Opcode::Nop;
+                }
+                if (!stubs_left) {
+                    quadruples[i].operate = Opcode::Nop;
+                }
+            }
+        }
+        RemoveNops(quadruples);
+        semantic_.RenumberLabels();
+    }
+
+    /**
+     * @brief  : 边 from -> to 上 φ 对应的复写，已串行化并分配新标号
+     *           并行复写中目标不再被其他复写读取的先执行；只剩环时借助临时变量打破
+     */
+    std::vector<Quadruple>
+    EdgeCopies(int from, int to, int& next_label) {
+        std::vector<Quadruple> copies;
+        const auto&            cfg = *cfg_;
+        if (to == Npos || phis_[to].empty()) {
+            return copies;
+        }
+        int j = static_cast<int>(std::find(cfg.pred_begin(to), cfg.pred_end(to), from) - cfg.pred_begin(to));
+
+        std::vector<std::pair<Operand, Operand>> pending; /* (目标, 来源) */
+        for (const auto& phi : phis_[to]) {
+            if (phi.args[j] != phi.result) {
+                pending.push_back({ phi.result, phi.args[j] });
+            }
+        }
+        while (!pending.empty()) {
+            bool progress = false;
+            for (size_t k = 0; k < pending.size(); ++k) {
+                bool read = false;
+                for (size_t m = 0; m < pending.size(); ++m) {
+                    read |= m != k && pending[m].second == pending[k].first;
+                }
+                if (!read) {
+                    copies.push_back(
+                        Quadruple(next_label++, Opcode::Assign, pending[k].second, Operand(), pending[k].first));
+                    pending.erase(pending.begin() + k);
+                    progress = true;
+                    break;
+                }
+            }
+            if (!progress) {
+                /* 环：先保存第一个目标的旧值，读取它的复写改读保存的值 */
+                Operand saved = semantic_.GetNewTmpVar(pending[0].first.type);
+                copies.push_back(Quadruple(next_label++, Opcode::Assign, pending[0].first, Operand(), saved));
+                for (auto& copy : pending) {
+                    if (copy.second == pending[0].first) {
+                        copy.second = saved;
+                    }
+                }
+            }
+        }
+        copy_count_ += static_cast<int>(copies.size());
+        return copies;
+    }
+
+    /* 消去时加入的四元式 */
+    enum Added : char { Normal, Stub, AddedReturn };
+
+    Semantic&                         semantic_;
+    std::vector<char>                 added_;              /* 消去后的四元式 -> 是否为拆分块或补上的返回 */
+    std::unique_ptr<ControlFlowGraph> cfg_;                /* SSA 形式所基于的控制流图 */
+    std::vector<std::vector<Phi>>     phis_;               /* 基本块 -> φ 函数 */
+    std::vector<std::vector<int>>     frontier_;           /* 基本块 -> 支配边界 */
+    std::vector<Operand>              origin_;             /* 临时变量 -> 它所代表版本的原变量，不是版本时为空 */
+    std::vector<int>                  version_;            /* 临时变量 -> 版本号 */
+    std::vector<int>                  version_count_[2];   /* 变量/临时变量已分配的版本数 */
+    int                               return_variable_;    /* 当前函数的返回值变量 */
+
+    int phi_count_;   /* 插入的 φ 函数个数 */
+    int copy_count_;  /* 消去时插入的复写条数 */
+    int split_edges_; /* 拆分关键边新增的基本块数 */
+};
+
+constexpr int SsaForm::Npos;
+
+#endif // !_SSA_HPP_
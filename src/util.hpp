@@ -10,9 +10,15 @@
 #include <algorithm>
 #include <list>
 #include <memory>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
 /**
  * @brief LR(0)的项目/原始文法(包含拓展产生式)产生式
  *        left         - 产生式的左部符号Symbol的index
@@ -100,4 +106,276 @@ split(const std::string& str, const std::string& splitStr) {
     return strs;
 }
 
+/**
+ * @brief 以非负整数(通常是驻留字符串编号)为键的开放寻址哈希表
+ *        采用线性探测，容量始终为2的幂，负载因子不超过 1/2；
+ *        不支持删除键，需要"删除"时由使用者将值置为 Npos
+ */
+class IdHashMap {
+public:
+    static constexpr int Npos = -1; // 键不存在
+
+    IdHashMap() : size_(0) {
+        slots_.assign(16, { Npos, Npos });
+    }
+
+    /**
+     * @brief  : 查找键对应的值
+     * @return : 键不存在时返回 Npos
+     */
+    int
+    Find(int key) const {
+        const Slot& slot = slots_[Probe(key)];
+        return slot.key == key ? slot.value : Npos;
+    }
+
+    /**
+     * @brief : 插入或覆盖键对应的值
+     */
+    void
+    Set(int key, int value) {
+        if ((size_ + 1) * 2 > static_cast<int>(slots_.size())) {
+            Rehash(slots_.size() * 2);
+        }
+        Slot& slot = slots_[Probe(key)];
+        if (slot.key != key) {
+            slot.key = key;
+            ++size_;
+        }
+        slot.value = value;
+    }
+
+private:
+    struct Slot {
+        int key;   /* 键，Npos 表示空槽 */
+        int value; /* 值 */
+    };
+
+    /* 返回键所在的槽，或第一个空槽 */
+    size_t
+    Probe(int key) const {
+        size_t mask = slots_.size() - 1;
+        /* Fibonacci 散列：乘以 2^32/φ 打散相邻编号 */
+        size_t pos = (static_cast<uint32_t>(key) * 2654435769u) & mask;
+        while (slots_[pos].key != Npos && slots_[pos].key != key) {
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    void
+    Rehash(size_t capacity) {
+        std::vector<Slot> old(capacity, { Npos, Npos });
+        old.swap(slots_);
+        size_ = 0;
+        for (const auto& slot : old) {
+            if (slot.key != Npos) {
+                slots_[Probe(slot.key)] = slot;
+                ++size_;
+            }
+        }
+    }
+
+    std::vector<Slot> slots_; /* 槽数组 */
+    int               size_;  /* 已占用的槽数 */
+};
+
+constexpr int IdHashMap::Npos;
+
+/**
+ * @brief 单次编译使用的线性(bump)分配器
+ *        内存按块申请，块内顺序分配，不支持单独释放；
+ *        分配器析构时一次性释放本次编译分配的全部内存
+ */
+class Arena {
+public:
+    static constexpr size_t BlockSize = 64 * 1024; // 每次申请的块大小
+
+    Arena() : cur_(nullptr), end_(nullptr), bytes_(0) {}
+    Arena(const Arena&) = delete;
+    Arena&
+    operator=(const Arena&) = delete;
+    ~Arena() {
+        for (auto block : blocks_) {
+            ::operator delete(block);
+        }
+    }
+
+    /**
+     * @brief  : 分配 size 字节，按 align 对齐(align 必须是2的幂)
+     * @return : 分配得到的内存，生命周期与 Arena 相同
+     */
+    void*
+    Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        bytes_ += size;
+        /* 大对象单独占用一块，不打断当前块的顺序分配 */
+        if (size > BlockSize / 4) {
+            char* block = static_cast<char*>(::operator new(size));
+            blocks_.push_back(block);
+            return block;
+        }
+        uintptr_t pos = (reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(uintptr_t)(align - 1);
+        if (cur_ == nullptr || pos + size > reinterpret_cast<uintptr_t>(end_)) {
+            cur_ = static_cast<char*>(::operator new(BlockSize));
+            end_ = cur_ + BlockSize;
+            blocks_.push_back(cur_);
+            pos = (reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        cur_ = reinterpret_cast<char*>(pos + size);
+        return reinterpret_cast<void*>(pos);
+    }
+
+    /**
+     * @brief : 在 Arena 上构造对象；析构函数不会被调用，只适用于平凡析构的类型
+     */
+    template <typename T, typename... Args>
+    T*
+    New(Args&&... args) {
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    size_t
+    bytes_allocated() const {
+        return bytes_;
+    }
+
+    size_t
+    block_count() const {
+        return blocks_.size();
+    }
+
+private:
+    std::vector<char*> blocks_; /* 已申请的所有块 */
+    char*              cur_;    /* 当前块中下一个可分配的位置 */
+    char*              end_;    /* 当前块的末尾 */
+    size_t             bytes_;  /* 累计分配的字节数 */
+};
+
+/**
+ * @brief 字符串驻留池：为每个不同的字符串分配一个从0开始的稠密编号，
+ *        相同内容的字符串总是得到相同编号，比较标识符只需比较整数；
+ *        字符串内容保存在 Arena 中，随 Arena 一并释放。
+ *        词法分析、语义分析与四元式共享同一个池
+ */
+class StringPool {
+public:
+    static constexpr int Npos = -1; // 字符串不存在
+
+    explicit StringPool(Arena& arena) : arena_(arena), slots_(1024, Npos) {
+        entries_.reserve(512);
+    }
+
+    /**
+     * @brief  : 驻留字符串
+     * @return : 字符串的编号(已存在时返回原编号)
+     */
+    int
+    Intern(const char* str, size_t length) {
+        uint32_t hash = Hash(str, length);
+        size_t   pos  = Probe(str, length, hash);
+        if (slots_[pos] != Npos) {
+            return slots_[pos];
+        }
+        char* copy = static_cast<char*>(arena_.Allocate(length + 1, 1));
+        memcpy(copy, str, length);
+        copy[length] = '\0';
+
+        int id = static_cast<int>(entries_.size());
+        entries_.push_back({ copy, static_cast<uint32_t>(length), hash });
+        slots_[pos] = id;
+        if (entries_.size() * 2 > slots_.size()) {
+            Rehash(slots_.size() * 2);
+        }
+        return id;
+    }
+
+    int
+    Intern(const std::string& str) {
+        return Intern(str.data(), str.size());
+    }
+
+    int
+    Intern(const char* str) {
+        return Intern(str, strlen(str));
+    }
+
+    /**
+     * @brief  : 查找字符串的编号，不存在时不插入
+     * @return : 字符串的编号；不存在时返回 Npos
+     */
+    int
+    Find(const std::string& str) const {
+        return slots_[Probe(str.data(), str.size(), Hash(str.data(), str.size()))];
+    }
+
+    /**
+     * @brief  : 编号对应的字符串(以 '\0' 结尾)
+     */
+    const char* operator[](int id) const {
+        return entries_[id].str;
+    }
+
+    size_t
+    length(int id) const {
+        return entries_[id].length;
+    }
+
+    int
+    size() const {
+        return static_cast<int>(entries_.size());
+    }
+
+private:
+    struct Entry {
+        const char* str;    /* Arena 中的字符串内容 */
+        uint32_t    length; /* 字符串长度 */
+        uint32_t    hash;   /* 缓存的散列值，扩容时无需重新计算 */
+    };
+
+    /* FNV-1a */
+    static uint32_t
+    Hash(const char* str, size_t length) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < length; ++i) {
+            h = (h ^ static_cast<unsigned char>(str[i])) * 16777619u;
+        }
+        return h;
+    }
+
+    /* 返回字符串所在的槽，或第一个空槽 */
+    size_t
+    Probe(const char* str, size_t length, uint32_t hash) const {
+        size_t mask = slots_.size() - 1;
+        size_t pos  = hash & mask;
+        while (slots_[pos] != Npos) {
+            const Entry& entry = entries_[slots_[pos]];
+            if (entry.hash == hash && entry.length == length && memcmp(entry.str, str, length) == 0) {
+                break;
+            }
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    void
+    Rehash(size_t capacity) {
+        slots_.assign(capacity, Npos);
+        size_t mask = capacity - 1;
+        for (int id = 0; id < static_cast<int>(entries_.size()); ++id) {
+            size_t pos = entries_[id].hash & mask;
+            while (slots_[pos] != Npos) {
+                pos = (pos + 1) & mask;
+            }
+            slots_[pos] = id;
+        }
+    }
+
+    Arena&             arena_;   /* 字符串内容所在的分配器 */
+    std::vector<Entry> entries_; /* 编号 -> 字符串 */
+    std::vector<int>   slots_;   /* 开放寻址槽，存放字符串编号 */
+};
+
+constexpr size_t Arena::BlockSize;
+constexpr int    StringPool::Npos;
+
 #endif // !_UTILS_HPP_
\ No newline at end of file
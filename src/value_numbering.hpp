@@ -0,0 +1,331 @@
+/**
+ * @file value_numbering.hpp
+ * @brief 局部值编号与跨基本块的公共子表达式消除
+ */
+
+#ifndef _VALUE_NUMBERING_HPP_
+#define _VALUE_NUMBERING_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "./control_flow.hpp"
+#include "./liveness.hpp"
+#include "./quadruple.hpp"
+#include "./semantic_analysis.hpp"
+#include "./util.hpp"
+
+/**
+ * @brief 公共子表达式消除
+ *        1. 局部值编号：在基本块内为每个值分配编号，复写使目标与来源同号，
+ *           运算以 (运算符, 操作数值编号) 为键，键已存在且仍有变量/临时变量保存该值时，
+ *           运算改为从保存者复写；对变量重新定值即换上新编号，旧值的表达式自然失效
+ *        2. 全局消除：对每条运算四元式做可用性分析(前向数据流，交集汇合)，
+ *           运算在某点可用当且仅当它所在的块支配该点且此后其操作数与结果都未被重新定值；
+ *           遇到可用的相同运算时改为从其结果复写
+ *        产生的复写由之后的复写传播与死代码删除清理
+ */
+class ValueNumbering {
+public:
+    static constexpr int Npos = -1;
+
+    explicit ValueNumbering(Semantic& semantic) : semantic_(semantic), local_(0), global_(0) {}
+
+    /**
+     * @brief  : 对所有函数执行值编号与公共子表达式消除
+     * @return : 被消除的运算条数
+     */
+    int
+    Run() {
+        auto&            quadruples = semantic_.quadruples();
+        ControlFlowGraph cfg(quadruples);
+        Liveness         liveness(semantic_, quadruples, cfg);
+
+        const auto& entries = cfg.entries();
+        for (size_t f = 0; f < entries.size(); ++f) {
+            int first = entries[f];
+            int last  = f + 1 < entries.size() ? entries[f + 1] : cfg.block_count();
+            liveness.Compute(first, last);
+            slot_value_.assign(liveness.slot_count(), Npos);
+            slot_stamp_.assign(liveness.slot_count(), Npos);
+            for (int b = first; b < last; ++b) {
+                NumberBlock(cfg, liveness, b);
+            }
+            EliminateGlobal(cfg, liveness, first, last);
+        }
+        return local_ + global_;
+    }
+
+    /* 块内消除的运算条数 */
+    int
+    local_eliminated() const {
+        return local_;
+    }
+
+    /* 跨块消除的运算条数 */
+    int
+    global_eliminated() const {
+        return global_;
+    }
+
+private:
+    using BitSet = Liveness::BitSet;
+
+    /* 操作数当前的值编号，块内首次读取的变量得到新编号 */
+    int
+    ValueOf(const Operand& opd, const Liveness& liveness, int block) {
+        if (opd.kind == Operand::Constant) {
+            int key   = opd.id * 4 + static_cast<int>(opd.type);
+            int value = constant_value_.Find(key);
+            if (value == IdHashMap::Npos) {
+                value = NewValue();
+                constant_value_.Set(key, value);
+            }
+            return value;
+        }
+        int slot = liveness.Slot(opd);
+        if (slot == Npos) {
+            return 0;
+        }
+        if (slot_stamp_[slot] != block) {
+            Define(slot, NewValue(), block);
+        }
+        return slot_value_[slot];
+    }
+
+    int
+    NewValue() {
+        value_holder_.push_back(Npos);
+        return static_cast<int>(value_holder_.size() - 1);
+    }
+
+    /* 槽位得到值编号 value；该值还没有有效的保存者时由它保存 */
+    void
+    Define(int slot, int value, int block) {
+        slot_value_[slot] = value;
+        slot_stamp_[slot] = block;
+        int holder        = value_holder_[value];
+        if (holder == Npos || slot_stamp_[holder] != block || slot_value_[holder] != value) {
+            value_holder_[value] = slot;
+        }
+    }
+
+    void
+    NumberBlock(const ControlFlowGraph& cfg, const Liveness& liveness, int block) {
+        auto& quadruples = semantic_.quadruples();
+        expressions_.clear();
+        for (int i = cfg.begin(block); i < cfg.end(block); ++i) {
+            auto& qua = quadruples[i];
+            if (qua.operate == Opcode::Call) {
+                /* 被调函数可能修改任何全局变量 */
+                for (int s : liveness.global_slots()) {
+                    Define(s, NewValue(), block);
+                }
+            }
+            if (!DefinesResult(qua.operate) || liveness.Slot(qua.result) == Npos) {
+                continue;
+            }
+            int slot = liveness.Slot(qua.result);
+            if (qua.operate == Opcode::Assign) {
+                Define(slot, ValueOf(qua.arg_1, liveness, block), block);
+                continue;
+            }
+            if (!IsComputation(qua.operate)) {
+                Define(slot, NewValue(), block);
+                continue;
+            }
+
+            uint64_t a = ValueOf(qua.arg_1, liveness, block);
+            uint64_t b = IsArithmetic(qua.operate) ? ValueOf(qua.arg_2, liveness, block) : 0;
+            if (IsCommutative(qua.operate) && b < a) {
+                std::swap(a, b);
+            }
+            uint64_t key   = (static_cast<uint64_t>(qua.operate) << 56) | (a << 28) | b;
+            auto     found = expressions_.find(key);
+            if (found != expressions_.end()) {
+                int value  = found->second;
+                int holder = value_holder_[value];
+                if (holder != Npos && slot_stamp_[holder] == block && slot_value_[holder] == value) {
+                    qua.operate = Opcode::Assign;
+                    qua.arg_1   = liveness.slot_operand(holder);
+                    qua.arg_2   = Operand();
+                    ++local_;
+                    Define(slot, value, block);
+                    continue;
+                }
+            }
+            int value         = NewValue();
+            expressions_[key] = value;
+            Define(slot, value, block);
+        }
+    }
+
+    /* 运算四元式的键：交换律成立时操作数按固定顺序排列 */
+    struct Expression {
+        Opcode  op;
+        Operand a;
+        Operand b;
+        int     index; /* 四元式下标 */
+    };
+
+    static bool
+    OperandLess(const Operand& x, const Operand& y) {
+        if (x.kind != y.kind) {
+            return x.kind < y.kind;
+        }
+        if (x.id != y.id) {
+            return x.id < y.id;
+        }
+        return x.type < y.type;
+    }
+
+    static bool
+    SameKey(const Expression& x, const Expression& y) {
+        return x.op == y.op && x.a == y.a && x.b == y.b;
+    }
+
+    void
+    EliminateGlobal(const ControlFlowGraph& cfg, const Liveness& liveness, int first, int last) {
+        auto& quadruples = semantic_.quadruples();
+        int   quad_begin = cfg.begin(first), quad_end = cfg.end(last - 1);
+
+        /* 收集运算(结果不覆盖自身操作数的)，相同的运算排在一起 */
+        std::vector<Expression> expressions;
+        for (int i = quad_begin; i < quad_end; ++i) {
+            const auto& qua = quadruples[i];
+            if (!IsComputation(qua.operate) || !qua.result.IsLocation() || qua.result == qua.arg_1
+                || qua.result == qua.arg_2) {
+                continue;
+            }
+            Expression expression{ qua.operate, qua.arg_1, qua.arg_2, i };
+            if (IsCommutative(qua.operate) && OperandLess(expression.b, expression.a)) {
+                std::swap(expression.a, expression.b);
+            }
+            expressions.push_back(expression);
+        }
+        std::stable_sort(expressions.begin(), expressions.end(), [](const Expression& x, const Expression& y) {
+            if (x.op != y.op) {
+                return x.op < y.op;
+            }
+            if (x.a != y.a) {
+                return OperandLess(x.a, y.a);
+            }
+            return OperandLess(x.b, y.b);
+        });
+        int count = static_cast<int>(expressions.size());
+        if (count < 2) {
+            return;
+        }
+
+        /* 运算编号、同类运算的范围 [group_begin, group_end)，以及重新定值时失效的运算 */
+        std::vector<int>              quad_expression(quad_end - quad_begin, Npos);
+        std::vector<int>              group_begin(count), group_end(count);
+        std::vector<std::vector<int>> kills(liveness.slot_count());
+        std::vector<int>              global_kills;
+        for (int e = 0; e < count; ++e) {
+            group_begin[e] = e > 0 && SameKey(expressions[e - 1], expressions[e]) ? group_begin[e - 1] : e;
+        }
+        for (int e = count - 1; e >= 0; --e) {
+            group_end[e] = e + 1 < count && SameKey(expressions[e + 1], expressions[e]) ? group_end[e + 1] : e + 1;
+        }
+        for (int e = 0; e < count; ++e) {
+            const auto& qua = quadruples[expressions[e].index];
+            quad_expression[expressions[e].index - quad_begin] = e;
+            bool involves_global = false;
+            for (const Operand* opd : { &qua.arg_1, &qua.arg_2, &qua.result }) {
+                int slot = liveness.Slot(*opd);
+                if (slot != Npos) {
+                    kills[slot].push_back(e);
+                    involves_global |= opd->kind == Operand::Variable && semantic_.IsGlobalVariable(opd->id);
+                }
+            }
+            if (involves_global) {
+                global_kills.push_back(e);
+            }
+        }
+
+        int  words    = (count + 63) / 64;
+        auto transfer = [&](int index, BitSet& avail) {
+            const auto& qua = quadruples[index];
+            if (qua.operate == Opcode::Call) {
+                for (int e : global_kills) {
+                    Liveness::Reset(avail.data(), e);
+                }
+            }
+            if (DefinesResult(qua.operate) && liveness.Slot(qua.result) != Npos) {
+                for (int e : kills[liveness.Slot(qua.result)]) {
+                    Liveness::Reset(avail.data(), e);
+                }
+            }
+            if (quad_expression[index - quad_begin] != Npos) {
+                Liveness::Set(avail.data(), quad_expression[index - quad_begin]);
+            }
+        };
+
+        /* 可用性分析：in = ∩ out(pred)，入口块与没有前驱的块为空集 */
+        int    blocks = last - first;
+        BitSet in(static_cast<size_t>(blocks) * words, 0), out(static_cast<size_t>(blocks) * words, ~uint64_t(0));
+        BitSet avail(words);
+        bool   changed = true;
+        while (changed) {
+            changed = false;
+            for (int b = first; b < last; ++b) {
+                uint64_t* block_in = in.data() + static_cast<size_t>(b - first) * words;
+                std::fill(block_in, block_in + words, b == first || cfg.pred_count(b) == 0 ? 0 : ~uint64_t(0));
+                for (auto p = cfg.pred_begin(b); b != first && p != cfg.pred_end(b); ++p) {
+                    const uint64_t* pred_out = out.data() + static_cast<size_t>(*p - first) * words;
+                    for (int w = 0; w < words; ++w) {
+                        block_in[w] &= pred_out[w];
+                    }
+                }
+                avail.assign(block_in, block_in + words);
+                for (int i = cfg.begin(b); i < cfg.end(b); ++i) {
+                    transfer(i, avail);
+                }
+                uint64_t* block_out = out.data() + static_cast<size_t>(b - first) * words;
+                for (int w = 0; w < words; ++w) {
+                    changed |= block_out[w] != avail[w];
+                    block_out[w] = avail[w];
+                }
+            }
+        }
+
+        /* 消除：同类运算中有可用的，改为从它的结果复写 */
+        for (int b = first; b < last; ++b) {
+            const uint64_t* block_in = in.data() + static_cast<size_t>(b - first) * words;
+            avail.assign(block_in, block_in + words);
+            for (int i = cfg.begin(b); i < cfg.end(b); ++i) {
+                int e = quad_expression[i - quad_begin];
+                if (e != Npos) {
+                    for (int other = group_begin[e]; other < group_end[e]; ++other) {
+                        if (other != e && Liveness::Test(avail, other)) {
+                            auto& qua   = quadruples[i];
+                            qua.operate = Opcode::Assign;
+                            qua.arg_1   = quadruples[expressions[other].index].result;
+                            qua.arg_2   = Operand();
+                            ++global_;
+                            break;
+                        }
+                    }
+                }
+                transfer(i, avail);
+            }
+        }
+    }
+
+    Semantic&                         semantic_;
+    std::vector<int>                  slot_value_;     /* 槽位 -> 当前值编号 */
+    std::vector<int>                  slot_stamp_;     /* 槽位的值编号所属的块，不是当前块时编号无效 */
+    std::vector<int>                  value_holder_;   /* 值编号 -> 保存该值的槽位 */
+    IdHashMap                         constant_value_; /* 常量 -> 值编号 */
+    std::unordered_map<uint64_t, int> expressions_;    /* 块内 (运算符, 操作数值编号) -> 值编号 */
+
+    int local_;  /* 块内消除的运算条数 */
+    int global_; /* 跨块消除的运算条数 */
+};
+
+constexpr int ValueNumbering::Npos;
+
+#endif // !_VALUE_NUMBERING_HPP_
@@ -0,0 +1,431 @@
+/**
+ * @file vm.hpp
+ * @brief 执行寄存器字节码的虚拟机
+ */
+
+#ifndef _VM_HPP_
+#define _VM_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "./bytecode.hpp"
+#include "./quadruple.hpp"
+
+/* GCC 与 Clang 支持标号取地址，使用直接线索化分派；否则退化为 switch 分派 */
+#if defined(__GNUC__)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+/**
+ * @brief 寄存器字节码虚拟机
+ *        载入时把每条指令译为 (处理程序地址, a, b, c)，执行时每个处理程序末尾直接跳到下一条指令的处理程序(直接线索化)。
+ *        所有栈帧连续存放在一个值栈中，调用时新栈帧紧接在调用者的栈帧之后并清零，实参从实参栈写入形参寄存器；
+ *        返回值经由全局区中的返回值变量传递。main 返回时结束
+ */
+class VirtualMachine {
+public:
+    static constexpr int Npos = -1;
+
+    /* 调用层数上限 */
+    static constexpr int MaxDepth = 1 << 20;
+
+    explicit VirtualMachine(const BytecodeView& program)
+        : program_(program), calls_(0), max_depth_(0), millisecond_(0) {
+        exit_value_.i = 0;
+    }
+
+    /**
+     * @brief  : 从 main 开始执行
+     * @return : 没有 main 或发生运行错误时返回 false
+     */
+    bool
+    Run() {
+        if (program_.main < 0 || program_.main >= program_.function_count || program_.functions[program_.main].entry < 0) {
+            std::cerr << "运行错误 : 未找到 main 函数" << std::endl;
+            return false;
+        }
+        Load();
+        auto start  = std::chrono::steady_clock::now();
+        bool ok     = Execute();
+        auto finish = std::chrono::steady_clock::now();
+        millisecond_ = std::chrono::duration<double, std::milli>(finish - start).count();
+        return ok;
+    }
+
+    /* main 的返回值，void 的 main 为 0 */
+    Value
+    exit_value() const {
+        return exit_value_;
+    }
+
+    /* 函数调用次数(不含 main) */
+    uint64_t
+    calls() const {
+        return calls_;
+    }
+
+    /* 最大调用层数 */
+    int
+    max_depth() const {
+        return max_depth_;
+    }
+
+    /* 执行用时(不含载入) */
+    double
+    millisecond() const {
+        return millisecond_;
+    }
+
+    /**
+     * @brief : 输出退出值、调用次数与用时
+     */
+    void
+    Print(std::ostream& os) const {
+        os << "\n 虚拟机执行：main 返回 ";
+        if (program_.main_type == ValueType::Float) {
+            os << exit_value_.f;
+        } else {
+            os << exit_value_.i;
+        }
+        os << "；字节码 " << program_.code_size << " 条，调用 " << calls_ << " 次，最大调用层数 " << max_depth_ << "，用时 "
+           << millisecond_ << " ms。" << std::endl;
+    }
+
+private:
+    /**
+     * @brief 线索化的指令
+     */
+    struct Threaded {
+        const void* handler;
+        int32_t     op;
+        int32_t     a;
+        int32_t     b;
+        int32_t     c;
+    };
+
+    /**
+     * @brief 调用者的现场
+     */
+    struct CallRecord {
+        const Threaded* pc;         /* 返回后执行的指令 */
+        size_t          base;       /* 调用者栈帧在值栈中的起点 */
+        int32_t         frame_size; /* 调用者栈帧的大小 */
+        int32_t         result;     /* 调用者接收返回值的寄存器，-1 为丢弃 */
+    };
+
+    void
+    Load() {
+        code_.resize(program_.code_size);
+        for (int32_t i = 0; i < program_.code_size; ++i) {
+            const auto& ins = program_.code[i];
+            code_[i]        = Threaded{ nullptr, ins.op, ins.a, ins.b, ins.c };
+        }
+#if VM_THREADED
+        const void* const* handlers = Handlers();
+        for (auto& ins : code_) {
+            ins.handler = handlers[ins.op];
+        }
+#endif
+        globals_.assign(program_.globals, Value());
+        stack_.assign(4096, Value());
+        arguments_.clear();
+        records_.clear();
+    }
+
+#if VM_THREADED
+    /* 处理程序地址表：以空程序调用 Execute 取得 */
+    const void* const*
+    Handlers() {
+        handlers_ = nullptr;
+        Execute(true);
+        return handlers_;
+    }
+#endif
+
+    /* 值栈容纳不下新栈帧时扩大 */
+    void
+    Reserve(size_t size) {
+        if (size > stack_.size()) {
+            stack_.resize(size * 2, Value());
+        }
+    }
+
+    bool
+    Error(const char* message, const Threaded* pc) const {
+        std::cerr << "运行错误 : 第 " << (pc - code_.data()) << " 条字节码" << message << std::endl;
+        return false;
+    }
+
+    bool
+    Execute(bool handlers_only = false) {
+#if VM_THREADED
+        static const void* const table[] = {
+#define BYTECODE_LABEL(name, text) &&L_##name,
+            BYTECODE_OPCODES(BYTECODE_LABEL)
+#undef BYTECODE_LABEL
+        };
+        if (handlers_only) {
+            handlers_ = table;
+            return true;
+        }
+#define VM_CASE(name) L_##name:
+#define VM_NEXT() goto* pc->handler
+#else
+#define VM_CASE(name) case VmOp::name:
+#define VM_NEXT() continue
+#endif
+        const Value* K = program_.constants;
+        Value*       G = globals_.data();
+
+        const auto& main       = program_.functions[program_.main];
+        size_t      base       = 0;
+        int32_t     frame_size = main.frame_size;
+        Reserve(frame_size);
+        std::fill(stack_.begin(), stack_.begin() + frame_size, Value());
+        Value*          R  = stack_.data();
+        const Threaded* pc = code_.data() + main.entry;
+        Value           value;
+        max_depth_ = 1;
+
+#define INT_OP(name, expr)                                                                                                   \
+    VM_CASE(name) {                                                                                                          \
+        R[pc->a].i = static_cast<int64_t>(static_cast<uint64_t>(R[pc->b].i) expr static_cast<uint64_t>(R[pc->c].i));         \
+        ++pc;                                                                                                                \
+        VM_NEXT();                                                                                                           \
+    }                                                                                                                        \
+    VM_CASE(name##K) {                                                                                                       \
+        R[pc->a].i = static_cast<int64_t>(static_cast<uint64_t>(R[pc->b].i) expr static_cast<uint64_t>(K[pc->c].i));         \
+        ++pc;                                                                                                                \
+        VM_NEXT();                                                                                                           \
+    }
+#define FLOAT_OP(name, expr)                                                                                                 \
+    VM_CASE(name) {                                                                                                          \
+        R[pc->a].f = R[pc->b].f expr R[pc->c].f;                                                                             \
+        ++pc;                                                                                                                \
+        VM_NEXT();                                                                                                           \
+    }                                                                                                                        \
+    VM_CASE(name##K) {                                                                                                       \
+        R[pc->a].f = R[pc->b].f expr K[pc->c].f;                                                                             \
+        ++pc;                                                                                                                \
+        VM_NEXT();                                                                                                           \
+    }
+#define JUMP_OP(name, field, expr)                                                                                           \
+    VM_CASE(name) {                                                                                                          \
+        pc = R[pc->a].field expr R[pc->b].field ? code_.data() + pc->c : pc + 1;                                             \
+        VM_NEXT();                                                                                                           \
+    }                                                                                                                        \
+    VM_CASE(name##K) {                                                                                                       \
+        pc = R[pc->a].field expr K[pc->b].field ? code_.data() + pc->c : pc + 1;                                             \
+        VM_NEXT();                                                                                                           \
+    }
+#define FUSED_OP(name, expr)                                                                                                 \
+    VM_CASE(IAddK##name) {                                                                                                   \
+        R[pc->a].i = static_cast<int64_t>(static_cast<uint64_t>(R[pc->b].i) + static_cast<uint64_t>(K[pc->c].i));           \
+        ++pc;                                                                                                                \
+        pc = R[pc->a].i expr R[pc->b].i ? code_.data() + pc->c : pc + 1;                                                     \
+        VM_NEXT();                                                                                                           \
+    }                                                                                                                        \
+    VM_CASE(IAddK##name##K) {                                                                                                \
+        R[pc->a].i = static_cast<int64_t>(static_cast<uint64_t>(R[pc->b].i) + static_cast<uint64_t>(K[pc->c].i));           \
+        ++pc;                                                                                                                \
+        pc = R[pc->a].i expr K[pc->b].i ? code_.data() + pc->c : pc + 1;                                                     \
+        VM_NEXT();                                                                                                           \
+    }
+
+#if VM_THREADED
+        VM_NEXT();
+        {
+#else
+        for (;;) {
+            switch (static_cast<VmOp>(pc->op)) {
+#endif
+            VM_CASE(Move) {
+                R[pc->a] = R[pc->b];
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(LoadK) {
+                R[pc->a] = K[pc->b];
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(GetG) {
+                R[pc->a] = G[pc->b];
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(SetG) {
+                G[pc->a] = R[pc->b];
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(SetGK) {
+                G[pc->a] = K[pc->b];
+                ++pc;
+                VM_NEXT();
+            }
+            INT_OP(IAdd, +)
+            INT_OP(ISub, -)
+            INT_OP(IMul, *)
+            VM_CASE(IDiv) {
+                int64_t divisor = R[pc->c].i;
+                if (divisor == 0 || (divisor == -1 && R[pc->b].i == INT64_MIN)) {
+                    return Error("整数除以零或溢出", pc);
+                }
+                R[pc->a].i = R[pc->b].i / divisor;
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(IDivK) {
+                int64_t divisor = K[pc->c].i;
+                if (divisor == 0 || (divisor == -1 && R[pc->b].i == INT64_MIN)) {
+                    return Error("整数除以零或溢出", pc);
+                }
+                R[pc->a].i = R[pc->b].i / divisor;
+                ++pc;
+                VM_NEXT();
+            }
+            FLOAT_OP(FAdd, +)
+            FLOAT_OP(FSub, -)
+            FLOAT_OP(FMul, *)
+            FLOAT_OP(FDiv, /)
+            VM_CASE(IToF) {
+                R[pc->a].f = static_cast<double>(R[pc->b].i);
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(FToI) {
+                if (!EvalConvert(Opcode::FloatToInt, R[pc->b], R[pc->a])) {
+                    return Error("浮点数超出整数的表示范围", pc);
+                }
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(Jmp) {
+                pc = code_.data() + pc->c;
+                VM_NEXT();
+            }
+            JUMP_OP(IJLt, i, <)
+            JUMP_OP(IJLe, i, <=)
+            JUMP_OP(IJGt, i, >)
+            JUMP_OP(IJGe, i, >=)
+            JUMP_OP(IJEq, i, ==)
+            JUMP_OP(IJNe, i, !=)
+            JUMP_OP(FJLt, f, <)
+            JUMP_OP(FJLe, f, <=)
+            JUMP_OP(FJGt, f, >)
+            JUMP_OP(FJGe, f, >=)
+            JUMP_OP(FJEq, f, ==)
+            JUMP_OP(FJNe, f, !=)
+            VM_CASE(Param) {
+                arguments_.push_back(R[pc->a]);
+                ++pc;
+                VM_NEXT();
+            }
+            VM_CASE(Call) {
+                const auto& callee = program_.functions[pc->b];
+                if (callee.entry < 0) {
+                    return Error("调用了未定义的函数", pc);
+                }
+                if (static_cast<int>(records_.size()) + 1 >= MaxDepth) {
+                    return Error("调用层数超过上限", pc);
+                }
+                records_.push_back(CallRecord{ pc + 1, base, frame_size, pc->a });
+                base += frame_size;
+                frame_size = callee.frame_size;
+                Reserve(base + frame_size);
+                R = stack_.data() + base;
+                std::memset(static_cast<void*>(R), 0, sizeof(Value) * frame_size);
+                const int32_t* params = program_.parameters + callee.param_begin;
+                size_t         top    = arguments_.size();
+                for (int32_t k = 0; k < callee.param_count && static_cast<size_t>(k) < top; ++k) {
+                    if (params[k] >= 0) {
+                        R[params[k]] = arguments_[top - 1 - k];
+                    }
+                }
+                arguments_.resize(top > static_cast<size_t>(callee.param_count) ? top - callee.param_count : 0);
+                ++calls_;
+                max_depth_ = static_cast<int>(records_.size()) + 1 > max_depth_ ? static_cast<int>(records_.size()) + 1
+                                                                                 : max_depth_;
+                pc = code_.data() + callee.entry;
+                VM_NEXT();
+            }
+            VM_CASE(Ret) {
+                value = G[pc->a];
+                goto return_value;
+            }
+            VM_CASE(RetR) {
+                value = G[pc->a] = R[pc->b];
+                goto return_value;
+            }
+            VM_CASE(RetK) {
+                value = G[pc->a] = K[pc->b];
+                goto return_value;
+            }
+            FUSED_OP(JLt, <)
+            FUSED_OP(JLe, <=)
+            FUSED_OP(JGt, >)
+            FUSED_OP(JGe, >=)
+            FUSED_OP(JEq, ==)
+            FUSED_OP(JNe, !=)
+#if !VM_THREADED
+                default:
+                    return Error("非法的操作码", pc);
+            }
+#endif
+        return_value:
+            if (records_.empty()) {
+                exit_value_ = value;
+                if (program_.main_type == ValueType::Void) {
+                    exit_value_.i = 0;
+                }
+                return true;
+            }
+            {
+                const CallRecord& record = records_.back();
+                base                     = record.base;
+                frame_size               = record.frame_size;
+                R                        = stack_.data() + base;
+                if (record.result >= 0) {
+                    R[record.result] = value;
+                }
+                pc = record.pc;
+                records_.pop_back();
+            }
+            VM_NEXT();
+        }
+#undef INT_OP
+#undef FLOAT_OP
+#undef JUMP_OP
+#undef FUSED_OP
+#undef VM_CASE
+#undef VM_NEXT
+    }
+
+    BytecodeView            program_;
+    std::vector<Threaded>   code_;      /* 线索化的指令 */
+    std::vector<Value>      globals_;   /* 全局区 */
+    std::vector<Value>      stack_;     /* 值栈：所有栈帧 */
+    std::vector<Value>      arguments_; /* 实参栈 */
+    std::vector<CallRecord> records_;   /* 调用栈 */
+#if VM_THREADED
+    const void* const* handlers_ = nullptr; /* 处理程序地址表 */
+#endif
+
+    uint64_t calls_;       /* 调用次数 */
+    int      max_depth_;   /* 最大调用层数 */
+    double   millisecond_; /* 执行用时 */
+    Value    exit_value_;  /* main 的返回值 */
+};
+
+constexpr int VirtualMachine::Npos;
+constexpr int VirtualMachine::MaxDepth;
+
+#endif // !_VM_HPP_
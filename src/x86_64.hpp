@@ -0,0 +1,309 @@
+/**
+ * @file x86_64.hpp
+ * @brief x86-64 机器指令的表示与 GNU as (AT&T 语法) 汇编输出
+ */
+
+#ifndef _X86_64_HPP_
+#define _X86_64_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "./quadruple.hpp"
+
+/**
+ * @brief 通用寄存器，取值即机器编码中的寄存器号
+ */
+enum class Gpr : uint8_t { Rax, Rcx, Rdx, Rbx, Rsp, Rbp, Rsi, Rdi, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+/**
+ * @brief 条件码，取值即 Jcc/SETcc 编码中的条件号
+ */
+enum class Cond : uint8_t { O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G };
+
+inline const char*
+CondText(Cond cond) {
+    static const char* const texts[] = { "o", "no", "b", "ae", "e", "ne", "be", "a",
+                                         "s", "ns", "p", "np", "l", "ge", "le", "g" };
+    return texts[static_cast<int>(cond)];
+}
+
+/**
+ * @brief 机器指令的操作码：X(名字, AT&T 助记符)
+ *        整数运算都是 64 位的(Xor 只用于 32 位清零)，浮点运算都是标量双精度；
+ *        向量运算都按 64 位整数 lane：SSE2 的 128 位形式与 AVX2 的 256 位形式(V 开头，操作 ymm 寄存器)，
+ *        AVX2 的三操作数形式只用作 dst = dst op src，PSllQ/PSrlQ 的 src 为立即数
+ */
+#define X86_OPCODES(X)                                                                                                       \
+    X(Mov, "movq") X(Add, "addq") X(Sub, "subq") X(IMul, "imulq") X(Cqo, "cqto") X(IDiv, "idivq") X(Cmp, "cmpq")           \
+    X(And, "andq") X(Xor, "xorl") X(Push, "pushq") X(Pop, "popq") X(Call, "call") X(Ret, "ret") X(Leave, "leave")          \
+    X(Jmp, "jmp") X(Jcc, "j") X(MovSd, "movsd") X(MovApd, "movapd") X(MovQ, "movq") X(AddSd, "addsd") X(SubSd, "subsd")     \
+    X(MulSd, "mulsd") X(DivSd, "divsd") X(UComISd, "ucomisd") X(CvtSi2Sd, "cvtsi2sdq") X(CvtTSd2Si, "cvttsd2siq")           \
+    X(PXor, "pxor") X(MovDqa, "movdqa") X(MovDqu, "movdqu") X(PAddQ, "paddq") X(PSubQ, "psubq")                          \
+    X(PMulUDq, "pmuludq") X(PSllQ, "psllq") X(PSrlQ, "psrlq") X(PUnpckLQdq, "punpcklqdq") X(VMovDqa, "vmovdqa")             \
+    X(VMovDqu, "vmovdqu") X(VPAddQ, "vpaddq") X(VPSubQ, "vpsubq") X(VPMulUDq, "vpmuludq") X(VPSllQ, "vpsllq")             \
+    X(VPSrlQ, "vpsrlq") X(VPXor, "vpxor") X(VMovQ, "vmovq") X(VPBroadcastQ, "vpbroadcastq") X(VZeroUpper, "vzeroupper")        \
+    X(Label, "")
+
+enum class X86Op : uint8_t {
+#define X86_ENUM(name, text) name,
+    X86_OPCODES(X86_ENUM)
+#undef X86_ENUM
+        Count
+};
+
+inline const char*
+X86OpText(X86Op op) {
+    static const char* const texts[] = {
+#define X86_TEXT(name, text) text,
+        X86_OPCODES(X86_TEXT)
+#undef X86_TEXT
+    };
+    return op < X86Op::Count ? texts[static_cast<int>(op)] : "?";
+}
+
+/* AVX2 三操作数形式的运算：输出为 op src, dst, dst */
+inline bool
+IsVexBinary(X86Op op) {
+    return op == X86Op::VPAddQ || op == X86Op::VPSubQ || op == X86Op::VPMulUDq || op == X86Op::VPSllQ
+           || op == X86Op::VPSrlQ || op == X86Op::VPXor;
+}
+
+/**
+ * @brief 机器指令的操作数
+ *        Gpr/Xmm/Ymm - reg 为寄存器号
+ *        Memory      - [reg + index]
+ *        Global      - 全局区第 index 个变量(相对 rip 寻址)
+ *        Constant    - 浮点常量池第 index 项(相对 rip 寻址)
+ *        Immediate   - 立即数 imm，只有 Mov 到通用寄存器时可以超出 32 位
+ *        Label       - 代码中的标号 index
+ *        Function    - 全局符号表中第 index 个函数
+ */
+struct X86Operand {
+    enum Kind : uint8_t { None, Gpr, Xmm, Ymm, Memory, Global, Constant, Immediate, Label, Function };
+    Kind    kind;
+    uint8_t reg;
+    int32_t index;
+    int64_t imm;
+
+    X86Operand() : kind(None), reg(0), index(0), imm(0) {}
+    X86Operand(Kind kind, uint8_t reg, int32_t index = 0, int64_t imm = 0) : kind(kind), reg(reg), index(index), imm(imm) {}
+
+    /* 寄存器或内存：可以作为大多数指令的 r/m 操作数 */
+    bool
+    IsMemory() const {
+        return kind == Memory || kind == Global || kind == Constant;
+    }
+    friend bool
+    operator==(const X86Operand& a, const X86Operand& b) {
+        return a.kind == b.kind && a.reg == b.reg && a.index == b.index && a.imm == b.imm;
+    }
+    friend bool
+    operator!=(const X86Operand& a, const X86Operand& b) {
+        return !(a == b);
+    }
+};
+
+inline X86Operand
+GprOperand(Gpr reg) {
+    return X86Operand(X86Operand::Gpr, static_cast<uint8_t>(reg));
+}
+
+inline X86Operand
+XmmOperand(int reg) {
+    return X86Operand(X86Operand::Xmm, static_cast<uint8_t>(reg));
+}
+
+inline X86Operand
+YmmOperand(int reg) {
+    return X86Operand(X86Operand::Ymm, static_cast<uint8_t>(reg));
+}
+
+inline X86Operand
+MemoryOperand(Gpr base, int32_t displacement) {
+    return X86Operand(X86Operand::Memory, static_cast<uint8_t>(base), displacement);
+}
+
+inline X86Operand
+ImmediateOperand(int64_t imm) {
+    return X86Operand(X86Operand::Immediate, 0, 0, imm);
+}
+
+/* 立即数可以直接编码为符号扩展的 32 位立即数 */
+inline bool
+FitsInt32(int64_t imm) {
+    return imm >= INT32_MIN && imm <= INT32_MAX;
+}
+
+/**
+ * @brief 机器指令：AT&T 语法中输出为 op src, dst；单操作数的指令(push、idiv、call、跳转与标号)只用 dst，
+ *        call 与 jmp 的操作数不是函数或标号时为间接调用与跳转
+ */
+struct X86Instruction {
+    X86Op      op;
+    Cond       cond; /* Jcc 的条件 */
+    X86Operand dst;
+    X86Operand src;
+};
+
+/**
+ * @brief 栈上替换的入口：建立栈帧后把 rdx 所指缓冲区中的值依次装入各自的位置，再跳到循环头
+ */
+struct X86OsrEntry {
+    int32_t              label;  /* 循环头四元式的标号 */
+    int32_t              entry;  /* 入口代码的标号 */
+    std::vector<Operand> values; /* 缓冲区第 k 项对应的临时变量或局部变量 */
+};
+
+/**
+ * @brief 一个函数的机器代码
+ */
+struct X86Function {
+    int32_t                     function;    /* 函数在全局符号表中的位置 */
+    std::string                 symbol;      /* 符号名，main 函数为 "main" */
+    std::vector<X86Instruction> code;
+    std::vector<X86OsrEntry>    osr_entries; /* 栈上替换的入口，只在即时编译时生成 */
+};
+
+/**
+ * @brief 整个程序的机器代码与数据：全局区(每个变量 8 字节)与浮点常量池
+ */
+struct X86Program {
+    static constexpr int Npos = -1;
+
+    std::vector<X86Function> functions;
+    std::vector<std::string> function_symbols; /* 全局符号表中的位置 -> 符号名 */
+    std::vector<std::string> globals;          /* 全局区下标 -> 符号名，没有用到的变量为空 */
+    std::vector<Value>       constants;        /* 浮点常量池 */
+    int                      main = Npos;      /* main 在 functions 中的下标 */
+
+    size_t
+    instruction_count() const {
+        size_t count = 0;
+        for (const auto& function : functions) {
+            count += function.code.size();
+        }
+        return count;
+    }
+
+    /**
+     * @brief : 输出 GNU as 汇编：.text 中的各函数(只有 main 是全局符号)，.bss 中的全局区与 .rodata 中的常量池
+     */
+    void
+    Print(std::ostream& os) const {
+        os << "\t.text" << std::endl;
+        for (size_t f = 0; f < functions.size(); ++f) {
+            const auto& function = functions[f];
+            os << std::endl;
+            if (static_cast<int>(f) == main) {
+                os << "\t.globl\t" << function.symbol << std::endl;
+            }
+            os << "\t.type\t" << function.symbol << ", @function" << std::endl;
+            os << function.symbol << ":" << std::endl;
+            for (const auto& ins : function.code) {
+                PrintInstruction(os, ins);
+            }
+            os << "\t.size\t" << function.symbol << ", .-" << function.symbol << std::endl;
+        }
+        bool bss = false;
+        for (const auto& symbol : globals) {
+            if (symbol.empty()) {
+                continue;
+            }
+            if (!bss) {
+                os << std::endl << "\t.bss" << std::endl << "\t.align\t8" << std::endl;
+                bss = true;
+            }
+            os << "\t.type\t" << symbol << ", @object" << std::endl;
+            os << symbol << ":" << std::endl << "\t.zero\t8" << std::endl;
+        }
+        if (!constants.empty()) {
+            os << std::endl << "\t.section\t.rodata" << std::endl << "\t.align\t8" << std::endl;
+            for (size_t k = 0; k < constants.size(); ++k) {
+                os << ".LC" << k << ":" << std::endl
+                   << "\t.quad\t" << constants[k].i << "\t# " << constants[k].f << std::endl;
+            }
+        }
+        os << std::endl << "\t.section\t.note.GNU-stack,\"\",@progbits" << std::endl;
+    }
+
+    void
+    PrintInstruction(std::ostream& os, const X86Instruction& ins) const {
+        if (ins.op == X86Op::Label) {
+            os << ".L" << ins.dst.index << ":" << std::endl;
+            return;
+        }
+        os << "\t";
+        if (ins.op == X86Op::Jcc) {
+            os << "j" << CondText(ins.cond);
+        } else if (ins.op == X86Op::Mov && ins.src.kind == X86Operand::Immediate && !FitsInt32(ins.src.imm)) {
+            os << "movabsq";
+        } else {
+            os << X86OpText(ins.op);
+        }
+        if (ins.src.kind != X86Operand::None) {
+            os << "\t";
+            PrintOperand(os, ins.src, ins.op == X86Op::Xor);
+            os << ", ";
+            if (IsVexBinary(ins.op)) {
+                PrintOperand(os, ins.dst, false);
+                os << ", ";
+            }
+            PrintOperand(os, ins.dst, ins.op == X86Op::Xor);
+        } else if (ins.dst.kind != X86Operand::None) {
+            os << "\t";
+            if ((ins.op == X86Op::Call || ins.op == X86Op::Jmp) && ins.dst.kind != X86Operand::Function
+                && ins.dst.kind != X86Operand::Label) {
+                os << "*";
+            }
+            PrintOperand(os, ins.dst, false);
+        }
+        os << std::endl;
+    }
+
+    void
+    PrintOperand(std::ostream& os, const X86Operand& opd, bool dword) const {
+        static const char* const qwords[] = { "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                              "r8",  "r9",  "r10", "r11", "r12", "r13", "r14", "r15" };
+        static const char* const dwords[] = { "eax", "ecx", "edx",  "ebx",  "esp",  "ebp",  "esi",  "edi",
+                                              "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d" };
+        switch (opd.kind) {
+            case X86Operand::Gpr:
+                os << "%" << (dword ? dwords : qwords)[opd.reg];
+                break;
+            case X86Operand::Xmm:
+                os << "%xmm" << static_cast<int>(opd.reg);
+                break;
+            case X86Operand::Ymm:
+                os << "%ymm" << static_cast<int>(opd.reg);
+                break;
+            case X86Operand::Memory:
+                os << opd.index << "(%" << qwords[opd.reg] << ")";
+                break;
+            case X86Operand::Global:
+                os << globals[opd.index] << "(%rip)";
+                break;
+            case X86Operand::Constant:
+                os << ".LC" << opd.index << "(%rip)";
+                break;
+            case X86Operand::Immediate:
+                os << "$" << opd.imm;
+                break;
+            case X86Operand::Label:
+                os << ".L" << opd.index;
+                break;
+            case X86Operand::Function:
+                os << function_symbols[opd.index];
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+constexpr int X86Program::Npos;
+
+#endif // !_X86_64_HPP_
@@ -0,0 +1,459 @@
+/**
+ * @file x86_encoder.hpp
+ * @brief x86-64 机器指令的二进制编码
+ */
+
+#ifndef _X86_ENCODER_HPP_
+#define _X86_ENCODER_HPP_
+
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+#include "./x86_64.hpp"
+
+/**
+ * @brief 把 X86Instruction 编码为机器码
+ *        代码中的标号在 Encode 结束时直接回填为 rel32；
+ *        全局区、常量池(相对 rip 的 disp32)与被调函数(call rel32)的地址由使用者决定，记录为待重定位项：
+ *        即时编译器在安装时直接回填，目标文件写出为重定位表项。
+ *        跳转一律使用 rel32，编码长度只取决于指令本身
+ */
+class X86Encoder {
+public:
+    static constexpr int Npos = -1;
+
+    /**
+     * @brief 待重定位的 32 位相对地址：bytes()[offset, offset + 4) = 目标地址 - (代码起点 + next)
+     */
+    struct Fixup {
+        uint32_t         offset; /* rel32/disp32 字段的偏移 */
+        uint32_t         next;   /* 所在指令的下一条指令的偏移 */
+        X86Operand::Kind kind;   /* Global、Constant 或 Function */
+        int32_t          index;  /* 全局区下标、常量池下标或函数 */
+    };
+
+    /**
+     * @brief : 编码一段代码，追加到 bytes() 之后
+     * @return : 这段代码在 bytes() 中的起点
+     */
+    size_t
+    Encode(const std::vector<X86Instruction>& code) {
+        size_t begin = bytes_.size();
+        labels_.clear();
+        jumps_.clear();
+        for (const auto& ins : code) {
+            EncodeInstruction(ins);
+            if (pending_.offset != 0) {
+                pending_.next = static_cast<uint32_t>(bytes_.size());
+                fixups_.push_back(pending_);
+                pending_.offset = 0;
+            }
+        }
+        for (const auto& jump : jumps_) {
+            auto it = labels_.find(jump.index);
+            Patch(jump.offset, static_cast<int32_t>(it != labels_.end() ? it->second - jump.next : 0));
+        }
+        return begin;
+    }
+
+    const std::vector<uint8_t>&
+    bytes() const {
+        return bytes_;
+    }
+
+    const std::vector<Fixup>&
+    fixups() const {
+        return fixups_;
+    }
+
+    /* 最近一次 Encode 的代码中标号的偏移，未定义的标号为 Npos */
+    int64_t
+    label_offset(int32_t label) const {
+        auto it = labels_.find(label);
+        return it != labels_.end() ? static_cast<int64_t>(it->second) : Npos;
+    }
+
+    /* 把 bytes()[offset, offset + 4) 改写为 value */
+    void
+    Patch(uint32_t offset, int32_t value) {
+        for (int k = 0; k < 4; ++k) {
+            bytes_[offset + k] = static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * k));
+        }
+    }
+
+    void
+    Clear() {
+        bytes_.clear();
+        fixups_.clear();
+    }
+
+private:
+    void
+    Byte(uint8_t value) {
+        bytes_.push_back(value);
+    }
+
+    void
+    Int32(int32_t value) {
+        for (int k = 0; k < 4; ++k) {
+            bytes_.push_back(static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * k)));
+        }
+    }
+
+    void
+    Int64(int64_t value) {
+        for (int k = 0; k < 8; ++k) {
+            bytes_.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * k)));
+        }
+    }
+
+    static bool
+    FitsInt8(int64_t value) {
+        return value >= -128 && value <= 127;
+    }
+
+    /* 相对地址字段：标号在本段代码内回填，其余记录为待重定位项 */
+    void
+    Relative(const X86Operand& target) {
+        if (target.kind == X86Operand::Label) {
+            jumps_.push_back(Fixup{ static_cast<uint32_t>(bytes_.size()), static_cast<uint32_t>(bytes_.size() + 4),
+                                    X86Operand::Label, target.index });
+        } else {
+            pending_ = Fixup{ static_cast<uint32_t>(bytes_.size()), 0, target.kind, target.index };
+        }
+        Int32(0);
+    }
+
+    /**
+     * @brief : 带 ModRM 的指令：前缀(0 为无)、REX.W、操作码、ModRM 的 reg 字段与 r/m 操作数
+     *          r/m 为寄存器、[基址 + 位移] 或相对 rip 的全局区与常量池
+     */
+    void
+    ModRM(uint8_t prefix, bool wide, std::initializer_list<uint8_t> opcode, int reg, const X86Operand& rm) {
+        int base = rm.kind == X86Operand::Global || rm.kind == X86Operand::Constant ? 0 : rm.reg;
+        int rex  = 0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | (base >> 3);
+        if (prefix) {
+            Byte(prefix);
+        }
+        if (rex != 0x40) {
+            Byte(static_cast<uint8_t>(rex));
+        }
+        for (auto byte : opcode) {
+            Byte(byte);
+        }
+        Address(reg, rm);
+    }
+
+    /**
+     * @brief : VEX 编码的指令(三字节 C4 形式)：pp 为隐含前缀(0 无、1 66、2 F3、3 F2)，map 为操作码表(1 0F、2 0F38)，
+     *          wide 为 VEX.W，ymm 为 256 位，vvvv 为第二个源操作数(不用时为 0)
+     */
+    void
+    Vex(int pp, int map, bool wide, bool ymm, int vvvv, uint8_t opcode, int reg, const X86Operand& rm) {
+        int base = rm.kind == X86Operand::Global || rm.kind == X86Operand::Constant ? 0 : rm.reg;
+        Byte(0xC4);
+        Byte(static_cast<uint8_t>((((reg >> 3) ^ 1) << 7) | (1 << 6) | (((base >> 3) ^ 1) << 5) | map));
+        Byte(static_cast<uint8_t>((wide ? 0x80 : 0) | ((~vvvv & 15) << 3) | (ymm ? 4 : 0) | pp));
+        Byte(opcode);
+        Address(reg, rm);
+    }
+
+    /* ModRM 字节以及其后的 SIB 与位移 */
+    void
+    Address(int reg, const X86Operand& rm) {
+        int base  = rm.kind == X86Operand::Global || rm.kind == X86Operand::Constant ? 0 : rm.reg;
+        int field = (reg & 7) << 3;
+        switch (rm.kind) {
+            case X86Operand::Gpr:
+            case X86Operand::Xmm:
+            case X86Operand::Ymm:
+                Byte(static_cast<uint8_t>(0xC0 | field | (base & 7)));
+                break;
+            case X86Operand::Memory: {
+                int mod = rm.index == 0 && (base & 7) != 5 ? 0 : FitsInt8(rm.index) ? 1 : 2;
+                Byte(static_cast<uint8_t>((mod << 6) | field | (base & 7)));
+                if ((base & 7) == 4) {
+                    Byte(0x24); /* rsp/r12 作基址时需要 SIB */
+                }
+                if (mod == 1) {
+                    Byte(static_cast<uint8_t>(rm.index));
+                } else if (mod == 2) {
+                    Int32(rm.index);
+                }
+            } break;
+            default:
+                Byte(static_cast<uint8_t>(0x05 | field));
+                Relative(rm);
+                break;
+        }
+    }
+
+    /* add/sub/and/cmp：op r/m, r 与 op r, r/m 的操作码以及立即数形式的扩展操作码 */
+    void
+    Arith(const X86Instruction& ins, uint8_t rm_reg, uint8_t reg_rm, int extension) {
+        if (ins.src.kind == X86Operand::Immediate) {
+            ModRM(0, true, { static_cast<uint8_t>(FitsInt8(ins.src.imm) ? 0x83 : 0x81) }, extension, ins.dst);
+            if (FitsInt8(ins.src.imm)) {
+                Byte(static_cast<uint8_t>(ins.src.imm));
+            } else {
+                Int32(static_cast<int32_t>(ins.src.imm));
+            }
+        } else if (ins.dst.kind == X86Operand::Gpr) {
+            ModRM(0, true, { reg_rm }, ins.dst.reg, ins.src);
+        } else {
+            ModRM(0, true, { rm_reg }, ins.src.reg, ins.dst);
+        }
+    }
+
+    /* 标量双精度运算：F2 0F op /r */
+    void
+    Scalar(const X86Instruction& ins, uint8_t op) {
+        ModRM(0xF2, false, { 0x0F, op }, ins.dst.reg, ins.src);
+    }
+
+    /* 64 位整数 lane 的向量运算：SSE2 为 66 0F op /r，AVX2 为 VEX.256.66.0F op /r(vvvv 为 dst) */
+    void
+    Packed(const X86Instruction& ins, uint8_t op) {
+        if (ins.dst.kind == X86Operand::Ymm) {
+            Vex(1, 1, false, true, ins.dst.reg, op, ins.dst.reg, ins.src);
+        } else {
+            ModRM(0x66, false, { 0x0F, op }, ins.dst.reg, ins.src);
+        }
+    }
+
+    /* 按立即数移位：66 0F 73 /extension ib，AVX2 的 vvvv 为 dst */
+    void
+    Shift(const X86Instruction& ins, int extension) {
+        if (ins.dst.kind == X86Operand::Ymm) {
+            Vex(1, 1, false, true, ins.dst.reg, 0x73, extension, ins.dst);
+        } else {
+            ModRM(0x66, false, { 0x0F, 0x73 }, extension, ins.dst);
+        }
+        Byte(static_cast<uint8_t>(ins.src.imm));
+    }
+
+    /* 不对齐的装入与存储：F3 0F 6F /r 与 F3 0F 7F /r */
+    void
+    Unaligned(const X86Instruction& ins) {
+        bool              load = ins.dst.kind == X86Operand::Xmm || ins.dst.kind == X86Operand::Ymm;
+        int               reg  = load ? ins.dst.reg : ins.src.reg;
+        const X86Operand& rm   = load ? ins.src : ins.dst;
+        if (ins.op == X86Op::VMovDqu) {
+            Vex(2, 1, false, true, 0, load ? 0x6F : 0x7F, reg, rm);
+        } else {
+            ModRM(0xF3, false, { 0x0F, static_cast<uint8_t>(load ? 0x6F : 0x7F) }, reg, rm);
+        }
+    }
+
+    void
+    EncodeInstruction(const X86Instruction& ins) {
+        const auto& dst = ins.dst;
+        const auto& src = ins.src;
+        switch (ins.op) {
+            case X86Op::Mov:
+                if (src.kind == X86Operand::Immediate && !FitsInt32(src.imm)) {
+                    Byte(static_cast<uint8_t>(0x48 | (dst.reg >> 3)));
+                    Byte(static_cast<uint8_t>(0xB8 + (dst.reg & 7)));
+                    Int64(src.imm);
+                } else if (src.kind == X86Operand::Immediate) {
+                    ModRM(0, true, { 0xC7 }, 0, dst);
+                    Int32(static_cast<int32_t>(src.imm));
+                } else if (dst.kind == X86Operand::Gpr) {
+                    ModRM(0, true, { 0x8B }, dst.reg, src);
+                } else {
+                    ModRM(0, true, { 0x89 }, src.reg, dst);
+                }
+                break;
+            case X86Op::Add:
+                Arith(ins, 0x01, 0x03, 0);
+                break;
+            case X86Op::Sub:
+                Arith(ins, 0x29, 0x2B, 5);
+                break;
+            case X86Op::And:
+                Arith(ins, 0x21, 0x23, 4);
+                break;
+            case X86Op::Cmp:
+                Arith(ins, 0x39, 0x3B, 7);
+                break;
+            case X86Op::IMul:
+                if (src.kind == X86Operand::Immediate) {
+                    ModRM(0, true, { static_cast<uint8_t>(FitsInt8(src.imm) ? 0x6B : 0x69) }, dst.reg, dst);
+                    if (FitsInt8(src.imm)) {
+                        Byte(static_cast<uint8_t>(src.imm));
+                    } else {
+                        Int32(static_cast<int32_t>(src.imm));
+                    }
+                } else {
+                    ModRM(0, true, { 0x0F, 0xAF }, dst.reg, src);
+                }
+                break;
+            case X86Op::Cqo:
+                Byte(0x48);
+                Byte(0x99);
+                break;
+            case X86Op::IDiv:
+                ModRM(0, true, { 0xF7 }, 7, dst);
+                break;
+            case X86Op::Xor:
+                ModRM(0, false, { 0x31 }, src.reg, dst);
+                break;
+            case X86Op::Push:
+                if (dst.kind == X86Operand::Gpr) {
+                    if (dst.reg >= 8) {
+                        Byte(0x41);
+                    }
+                    Byte(static_cast<uint8_t>(0x50 + (dst.reg & 7)));
+                } else if (dst.kind == X86Operand::Immediate) {
+                    if (FitsInt8(dst.imm)) {
+                        Byte(0x6A);
+                        Byte(static_cast<uint8_t>(dst.imm));
+                    } else {
+                        Byte(0x68);
+                        Int32(static_cast<int32_t>(dst.imm));
+                    }
+                } else {
+                    ModRM(0, false, { 0xFF }, 6, dst);
+                }
+                break;
+            case X86Op::Pop:
+                if (dst.reg >= 8) {
+                    Byte(0x41);
+                }
+                Byte(static_cast<uint8_t>(0x58 + (dst.reg & 7)));
+                break;
+            case X86Op::Call:
+                if (dst.kind == X86Operand::Function) {
+                    Byte(0xE8);
+                    Relative(dst);
+                } else {
+                    ModRM(0, false, { 0xFF }, 2, dst);
+                }
+                break;
+            case X86Op::Jmp:
+                if (dst.kind == X86Operand::Label) {
+                    Byte(0xE9);
+                    Relative(dst);
+                } else {
+                    ModRM(0, false, { 0xFF }, 4, dst);
+                }
+                break;
+            case X86Op::Jcc:
+                Byte(0x0F);
+                Byte(static_cast<uint8_t>(0x80 + static_cast<int>(ins.cond)));
+                Relative(dst);
+                break;
+            case X86Op::Ret:
+                Byte(0xC3);
+                break;
+            case X86Op::Leave:
+                Byte(0xC9);
+                break;
+            case X86Op::MovSd:
+                if (dst.kind == X86Operand::Xmm) {
+                    ModRM(0xF2, false, { 0x0F, 0x10 }, dst.reg, src);
+                } else {
+                    ModRM(0xF2, false, { 0x0F, 0x11 }, src.reg, dst);
+                }
+                break;
+            case X86Op::MovApd:
+                ModRM(0x66, false, { 0x0F, 0x28 }, dst.reg, src);
+                break;
+            case X86Op::MovQ:
+                if (dst.kind == X86Operand::Xmm) {
+                    ModRM(0x66, true, { 0x0F, 0x6E }, dst.reg, src);
+                } else {
+                    ModRM(0x66, true, { 0x0F, 0x7E }, src.reg, dst);
+                }
+                break;
+            case X86Op::AddSd:
+                Scalar(ins, 0x58);
+                break;
+            case X86Op::MulSd:
+                Scalar(ins, 0x59);
+                break;
+            case X86Op::SubSd:
+                Scalar(ins, 0x5C);
+                break;
+            case X86Op::DivSd:
+                Scalar(ins, 0x5E);
+                break;
+            case X86Op::UComISd:
+                ModRM(0x66, false, { 0x0F, 0x2E }, dst.reg, src);
+                break;
+            case X86Op::CvtSi2Sd:
+                ModRM(0xF2, true, { 0x0F, 0x2A }, dst.reg, src);
+                break;
+            case X86Op::CvtTSd2Si:
+                ModRM(0xF2, true, { 0x0F, 0x2C }, dst.reg, src);
+                break;
+            case X86Op::PXor:
+                ModRM(0x66, false, { 0x0F, 0xEF }, dst.reg, src);
+                break;
+            case X86Op::MovDqa:
+                Packed(ins, 0x6F);
+                break;
+            case X86Op::VMovDqa:
+                Vex(1, 1, false, true, 0, 0x6F, dst.reg, src);
+                break;
+            case X86Op::MovDqu:
+            case X86Op::VMovDqu:
+                Unaligned(ins);
+                break;
+            case X86Op::PAddQ:
+            case X86Op::VPAddQ:
+                Packed(ins, 0xD4);
+                break;
+            case X86Op::PSubQ:
+            case X86Op::VPSubQ:
+                Packed(ins, 0xFB);
+                break;
+            case X86Op::PMulUDq:
+            case X86Op::VPMulUDq:
+                Packed(ins, 0xF4);
+                break;
+            case X86Op::VPXor:
+                Packed(ins, 0xEF);
+                break;
+            case X86Op::PUnpckLQdq:
+                Packed(ins, 0x6C);
+                break;
+            case X86Op::PSllQ:
+            case X86Op::VPSllQ:
+                Shift(ins, 6);
+                break;
+            case X86Op::PSrlQ:
+            case X86Op::VPSrlQ:
+                Shift(ins, 2);
+                break;
+            case X86Op::VMovQ:
+                Vex(1, 1, true, false, 0, 0x6E, dst.reg, src);
+                break;
+            case X86Op::VPBroadcastQ:
+                Vex(1, 2, false, true, 0, 0x59, dst.reg, src);
+                break;
+            case X86Op::VZeroUpper:
+                Byte(0xC5);
+                Byte(0xF8);
+                Byte(0x77);
+                break;
+            case X86Op::Label:
+                labels_[dst.index] = static_cast<uint32_t>(bytes_.size());
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::vector<uint8_t>                    bytes_;   /* 机器码 */
+    std::vector<Fixup>                      fixups_;  /* 待重定位项 */
+    std::vector<Fixup>                      jumps_;   /* 本段代码中跳到标号的 rel32 */
+    std::unordered_map<int32_t, uint32_t>   labels_;  /* 标号 -> 偏移 */
+    Fixup                                   pending_ = Fixup{ 0, 0, X86Operand::None, 0 }; /* 当前指令的待重定位项 */
+};
+
+constexpr int X86Encoder::Npos;
+
+#endif // !_X86_ENCODER_HPP_
@@ -0,0 +1,96 @@
+#!/bin/sh
+# 回归测试：用每个优化级别编译 test/regress_*.txt，比较各执行方式得到的 main 返回值与程序第一行 "// expect: N" 的期望值
+#   解释执行、分层执行、字节码虚拟机、即时编译(含 --vectorize)、字节码目标文件(runner)，
+#   -S 汇编与 --elf 目标文件经 gcc 链接后的退出码(取低 8 位)，
+#   以及经 SSA 形式且只有 3 个寄存器(大量溢出)的 -O2、-O2 --profile、-O2 --profile-use；
+#   每个优化遍单独执行与连续执行两次(--passes=)后的解释执行与虚拟机
+# 用法：regression.sh 编译器 文法文件 [runner]
+
+compiler=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+grammar=$(cd "$(dirname "$2")" && pwd)/$(basename "$2")
+runner=${3:+$(cd "$(dirname "$3")" && pwd)/$(basename "$3")}
+tests=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work" || exit 1
+
+native=0
+if [ "$(uname -m)" = x86_64 ] && command -v gcc > /dev/null 2>&1; then
+    native=1
+fi
+
+failures=0
+fail() {
+    echo "FAIL $1: $2"
+    failures=$((failures + 1))
+}
+
+# check 程序名 选项 输出文件 期望值：输出中每个 "main 返回 N" 都应等于期望值
+check() {
+    results=$(grep -o '[^ ]*执行：main 返回 [-0-9]*' "$3")
+    if [ -z "$results" ]; then
+        fail "$1 $2" "没有执行结果"
+        return
+    fi
+    echo "$results" | while read -r line; do
+        [ "${line##* }" = "$4" ] || echo "$line"
+    done > mismatch.txt
+    if [ -s mismatch.txt ]; then
+        fail "$1 $2" "期望 $4，$(tr '\n' ' ' < mismatch.txt)"
+    fi
+}
+
+# check_exit 程序名 说明 退出码 期望值
+check_exit() {
+    [ "$3" = "$(($4 & 255))" ] || fail "$1 $2" "期望退出码 $(($4 & 255))，实际 $3"
+}
+
+for source in "$tests"/regress_*.txt; do
+    name=$(basename "$source" .txt)
+    before=$failures
+    expect=$(sed -n '1s|^// expect: *\([-0-9]*\).*|\1|p' "$source")
+    if [ -z "$expect" ]; then
+        fail "$name" "第一行没有 // expect: N"
+        continue
+    fi
+    for level in -O0 -O1 -O2; do
+        options="$level --run --tiered --vm --jit -c a.qbc"
+        [ $native = 1 ] && options="$options -S a.s --elf a.o"
+        # shellcheck disable=SC2086
+        "$compiler" -x "$source" -g "$grammar" $options > out.txt 2>&1
+        check "$name" "$level" out.txt "$expect"
+        if [ -n "$runner" ]; then
+            "$runner" a.qbc > /dev/null 2>&1
+            check_exit "$name" "$level runner" $? "$expect"
+        fi
+        if [ $native = 1 ]; then
+            gcc a.s -o a.out && ./a.out
+            check_exit "$name" "$level -S" $? "$expect"
+            gcc a.o -o a.out && ./a.out
+            check_exit "$name" "$level --elf" $? "$expect"
+            "$compiler" -x "$source" -g "$grammar" $level --jit --vectorize -S a.s > out.txt 2>&1
+            check "$name" "$level --vectorize" out.txt "$expect"
+            gcc a.s -o a.out && ./a.out
+            check_exit "$name" "$level --vectorize -S" $? "$expect"
+        fi
+    done
+    "$compiler" -x "$source" -g "$grammar" -O2 --profile > out.txt 2>&1
+    check "$name" "-O2 --profile" out.txt "$expect"
+    "$compiler" -x "$source" -g "$grammar" -O2 --profile-use profile.data --run --vm > out.txt 2>&1
+    check "$name" "-O2 --profile-use" out.txt "$expect"
+    "$compiler" -x "$source" -g "$grammar" -O2 --ssa --regalloc=3 --run --vm > out.txt 2>&1
+    check "$name" "-O2 --ssa --regalloc=3" out.txt "$expect"
+    for pass in inline sccp gvn copy-prop dce licm jump-thread layout; do
+        for passes in $pass $pass,$pass; do
+            "$compiler" -x "$source" -g "$grammar" --passes=$passes --run --vm > out.txt 2>&1
+            check "$name" "--passes=$passes" out.txt "$expect"
+        done
+    done
+    [ $failures -eq "$before" ] && echo "ok   $name"
+done
+
+if [ $failures -ne 0 ]; then
+    echo "$failures 项不符"
+    exit 1
+fi
+exit 0